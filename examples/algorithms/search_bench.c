@@ -2,12 +2,6 @@
 #include "benchmark_single.h"
 #include <stdlib.h>
 
-#define SMALL_N 100
-#define MEDIUM_N 1000
-#define LARGE_N 10000
-
-static int g_small[SMALL_N], g_medium[MEDIUM_N], g_large[LARGE_N];
-
 static void init_sorted(int *arr, int n)
 {
     for (int i = 0; i < n; i++)
@@ -73,79 +67,51 @@ static int jump_search(const int *arr, int n, int target)
     return -1;
 }
 
-BENCH(linear_100)
-{
-    init_sorted(g_small, SMALL_N);
-    volatile int r = linear_search(g_small, SMALL_N, 98);
-    KEEP(r);
-}
-BENCH(binary_100)
-{
-    init_sorted(g_small, SMALL_N);
-    volatile int r = binary_search(g_small, SMALL_N, 98);
-    KEEP(r);
-}
-BENCH(interp_100)
-{
-    init_sorted(g_small, SMALL_N);
-    volatile int r = interpolation_search(g_small, SMALL_N, 98);
-    KEEP(r);
-}
-BENCH(jump_100)
+/* Sorted array of n even numbers, rebuilt only when n changes so that setup
+ * happens during warmup rather than inside every timed call. */
+static int *sorted_array(int64_t n)
 {
-    init_sorted(g_small, SMALL_N);
-    volatile int r = jump_search(g_small, SMALL_N, 98);
-    KEEP(r);
+    static int *arr;
+    static int64_t size;
+    if (size != n)
+    {
+        free(arr);
+        arr = malloc((size_t)n * sizeof(int));
+        init_sorted(arr, (int)n);
+        size = n;
+    }
+    return arr;
 }
 
-BENCH(linear_1k)
-{
-    init_sorted(g_medium, MEDIUM_N);
-    volatile int r = linear_search(g_medium, MEDIUM_N, 1998);
-    KEEP(r);
-}
-BENCH(binary_1k)
+BENCH_PARAM(linear, 100, 10000, 10)
 {
-    init_sorted(g_medium, MEDIUM_N);
-    volatile int r = binary_search(g_medium, MEDIUM_N, 1998);
+    volatile int r = linear_search(sorted_array(n), (int)n, (int)(2 * n - 2));
     KEEP(r);
 }
-BENCH(interp_1k)
-{
-    init_sorted(g_medium, MEDIUM_N);
-    volatile int r = interpolation_search(g_medium, MEDIUM_N, 1998);
-    KEEP(r);
-}
-
-BENCH(linear_10k)
+BENCH_PARAM(binary, 8, 1 << 20, 4)
 {
-    init_sorted(g_large, LARGE_N);
-    volatile int r = linear_search(g_large, LARGE_N, 19998);
+    volatile int r = binary_search(sorted_array(n), (int)n, (int)(2 * n - 2));
     KEEP(r);
 }
-BENCH(binary_10k)
+BENCH_PARAM(interp, 8, 1 << 20, 4)
 {
-    init_sorted(g_large, LARGE_N);
-    volatile int r = binary_search(g_large, LARGE_N, 19998);
+    volatile int r = interpolation_search(sorted_array(n), (int)n, (int)(2 * n - 2));
     KEEP(r);
 }
-BENCH(interp_10k)
+BENCH_PARAM(jump, 8, 1 << 20, 4)
 {
-    init_sorted(g_large, LARGE_N);
-    volatile int r = interpolation_search(g_large, LARGE_N, 19998);
+    volatile int r = jump_search(sorted_array(n), (int)n, (int)(2 * n - 2));
     KEEP(r);
 }
 
-BENCH(linear_1k_miss)
+BENCH_PARAM(linear_miss, 100, 10000, 10)
 {
-    init_sorted(g_medium, MEDIUM_N);
-    volatile int r = linear_search(g_medium, MEDIUM_N, 1999);
+    volatile int r = linear_search(sorted_array(n), (int)n, (int)(2 * n - 1));
     KEEP(r);
 }
-BENCH(binary_1k_miss)
+BENCH_PARAM(binary_miss, 8, 1 << 20, 4)
 {
-    init_sorted(g_medium, MEDIUM_N);
-    volatile int r = binary_search(g_medium, MEDIUM_N, 1999);
+    volatile int r = binary_search(sorted_array(n), (int)n, (int)(2 * n - 1));
     KEEP(r);
 }
 
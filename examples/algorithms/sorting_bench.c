@@ -117,60 +117,74 @@ static void quicksort_impl(int *arr, int lo, int hi)
 
 static void quicksort(int *arr, int n) { quicksort_impl(arr, 0, n - 1); }
 
+/* Fresh input before every call, outside the timed region */
+static void reverse_100(void) { fill_reverse(g_small, SMALL_N); }
+static void random_1k(void) { fill_random(g_medium, MEDIUM_N); }
+
+BENCH_ITERATION_FIXTURE(qsort_100_rev, reverse_100, NULL)
+BENCH_ITERATION_FIXTURE(insertion_100_rev, reverse_100, NULL)
+BENCH_ITERATION_FIXTURE(merge_100_rev, reverse_100, NULL)
+BENCH_ITERATION_FIXTURE(heap_100_rev, reverse_100, NULL)
+BENCH_ITERATION_FIXTURE(quick_100_rev, reverse_100, NULL)
+BENCH_ITERATION_FIXTURE(qsort_1k_rand, random_1k, NULL)
+BENCH_ITERATION_FIXTURE(merge_1k_rand, random_1k, NULL)
+BENCH_ITERATION_FIXTURE(heap_1k_rand, random_1k, NULL)
+BENCH_ITERATION_FIXTURE(quick_1k_rand, random_1k, NULL)
+
 BENCH(qsort_100_rev)
 {
-    fill_reverse(g_small, SMALL_N);
     qsort(g_small, SMALL_N, sizeof(int), cmp_int);
     KEEP(g_small);
+    BENCH_SET_ITEMS(SMALL_N);
 }
 BENCH(insertion_100_rev)
 {
-    fill_reverse(g_small, SMALL_N);
     insertion_sort(g_small, SMALL_N);
     KEEP(g_small);
+    BENCH_SET_ITEMS(SMALL_N);
 }
 BENCH(merge_100_rev)
 {
-    fill_reverse(g_small, SMALL_N);
     merge_sort(g_small, SMALL_N);
     KEEP(g_small);
+    BENCH_SET_ITEMS(SMALL_N);
 }
 BENCH(heap_100_rev)
 {
-    fill_reverse(g_small, SMALL_N);
     heap_sort(g_small, SMALL_N);
     KEEP(g_small);
+    BENCH_SET_ITEMS(SMALL_N);
 }
 BENCH(quick_100_rev)
 {
-    fill_reverse(g_small, SMALL_N);
     quicksort(g_small, SMALL_N);
     KEEP(g_small);
+    BENCH_SET_ITEMS(SMALL_N);
 }
 
 BENCH(qsort_1k_rand)
 {
-    fill_random(g_medium, MEDIUM_N);
     qsort(g_medium, MEDIUM_N, sizeof(int), cmp_int);
     KEEP(g_medium);
+    BENCH_SET_ITEMS(MEDIUM_N);
 }
 BENCH(merge_1k_rand)
 {
-    fill_random(g_medium, MEDIUM_N);
     merge_sort(g_medium, MEDIUM_N);
     KEEP(g_medium);
+    BENCH_SET_ITEMS(MEDIUM_N);
 }
 BENCH(heap_1k_rand)
 {
-    fill_random(g_medium, MEDIUM_N);
     heap_sort(g_medium, MEDIUM_N);
     KEEP(g_medium);
+    BENCH_SET_ITEMS(MEDIUM_N);
 }
 BENCH(quick_1k_rand)
 {
-    fill_random(g_medium, MEDIUM_N);
     quicksort(g_medium, MEDIUM_N);
     KEEP(g_medium);
+    BENCH_SET_ITEMS(MEDIUM_N);
 }
 
 int main(void)
@@ -44,6 +44,7 @@ BENCH_DEFINE(bench_memcpy_small, "memcpy 64 bytes")
     char src[64] = {0}, dst[64];
     memcpy(dst, src, 64);
     BENCH_KEEP(dst);
+    BENCH_SET_BYTES(64);
 }
 
 BENCH_DEFINE(bench_memcpy_medium, "memcpy 4KB")
@@ -51,6 +52,7 @@ BENCH_DEFINE(bench_memcpy_medium, "memcpy 4KB")
     static char src[4096], dst[4096];
     memcpy(dst, src, 4096);
     BENCH_KEEP(dst);
+    BENCH_SET_BYTES(4096);
 }
 
 BENCH_DEFINE(bench_array_access, "Array random access")
@@ -82,6 +84,31 @@ BENCH_DEFINE(bench_division, "Integer division")
     BENCH_KEEP(c);
 }
 
+/* Contention: every worker hits one counter, or counters sharing a cache line */
+static long g_shared;
+static long g_adjacent[64];
+static struct
+{
+    long value;
+    char pad[64 - sizeof(long)];
+} g_padded[64];
+
+BENCH_DEFINE_THREADED(bench_atomic_shared, "Atomic increment, one shared counter", 1, 2, 4, 8)
+{
+    (void)thread;
+    __atomic_fetch_add(&g_shared, 1, __ATOMIC_RELAXED);
+}
+
+BENCH_DEFINE_THREADED(bench_false_sharing, "Atomic increment, adjacent counters", 1, 2, 4, 8)
+{
+    __atomic_fetch_add(&g_adjacent[thread], 1, __ATOMIC_RELAXED);
+}
+
+BENCH_DEFINE_THREADED(bench_padded, "Atomic increment, one cache line per thread", 1, 2, 4, 8)
+{
+    __atomic_fetch_add(&g_padded[thread].value, 1, __ATOMIC_RELAXED);
+}
+
 void bench_custom(void)
 {
     volatile double x = 3.14159;
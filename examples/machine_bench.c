@@ -0,0 +1,26 @@
+/** Build with:
+ *   make examples
+ *
+ * Characterizes the host with the built-in machine suite alone: cache and
+ * memory latency by working set, and streaming bandwidth. BENCH_MACHINE=256M
+ * ends the latency sweep at 256 MB instead of 1 GB; the other BENCH_*
+ * variables apply as usual.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "benchmark.h"
+#include <stdlib.h>
+
+int main(void)
+{
+    setenv("BENCH_MACHINE", "1", 0);
+    setenv("BENCH_CSV", "machine_results.csv", 0);
+    bench_init();
+
+    const int failed = bench_run_all();
+    bench_write_json("machine_results.json");
+    bench_cleanup();
+
+    return failed;
+}
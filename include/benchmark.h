@@ -9,44 +9,347 @@ extern "C"
 {
 #endif
 
-#define BENCH_MAX_BENCHMARKS 256
-#define BENCH_MAX_NAME_LEN 128
+#define BENCH_MAX_NAME_LEN 128 /* of a name in the raw sample index; registered names have no limit */
 #define BENCH_DEFAULT_ITERATIONS 1000
 #define BENCH_DEFAULT_WARMUP 100
+#define BENCH_DEFAULT_WARMUP_TOLERANCE 0.03 /* automatic warmup: recent windows within +-3% */
+#define BENCH_DEFAULT_WARMUP_MAX_TIME 1.0   /* seconds before an automatic warmup gives up */
+#define BENCH_MAX_BATCH (1ULL << 30)
+#define BENCH_DEFAULT_PRECISION 0.01
+#define BENCH_MAX_USER_COUNTERS 8
+#define BENCH_MAX_REPETITIONS 64
+#define BENCH_MAX_CACHE_LEVELS 4
+#define BENCH_MACHINE_BYTES (1ULL << 30) /* largest working set of the machine suite by default */
+#define BENCH_DEFAULT_COLD_ITERATIONS 100
+#define BENCH_MAX_COLD_BUFFERS 16
+#define BENCH_DEFAULT_RATE_TIME 0.5 /* seconds at each open-loop rate */
+#define BENCH_MAX_RATE_STEPS 16
 
     typedef void (*bench_fn_t)(void);
 
+    /* Argument of the BENCH_DEFINE_PARAM instance being run */
+    extern int64_t bench_current_arg;
+    /* Worker index of the calling thread in a threaded benchmark, else 0 */
+    extern __thread int bench_current_thread;
+
+    typedef enum
+    {
+        BENCH_O_1,
+        BENCH_O_LOG_N,
+        BENCH_O_N,
+        BENCH_O_N_LOG_N,
+        BENCH_O_N_SQUARED
+    } bench_big_o_t;
+
+    typedef enum
+    {
+        BENCH_TIMER_AUTO,  /* cycle counter if invariant, else clock */
+        BENCH_TIMER_CLOCK, /* clock_gettime(CLOCK_MONOTONIC) */
+        BENCH_TIMER_TSC    /* rdtsc/rdtscp on x86-64, cntvct_el0 on aarch64 */
+    } bench_timer_t;
+
     typedef struct
     {
-        double min_ns, max_ns, mean_ns, median_ns, stddev_ns, p95_ns, p99_ns;
+        double min_ns, max_ns, mean_ns, median_ns, stddev_ns, p95_ns, p99_ns, p999_ns, p9999_ns;
+        double min_cycles, median_cycles, mean_cycles, p99_cycles; /* cycle-counter ticks, 0 if none */
+        double overhead_ns;    /* harness cost per call measured on an empty body */
+        double noise_floor_ns; /* p99 of that empty body */
         uint64_t iterations;
+        uint64_t batch_size; /* calls per timed sample; stats are per call */
+        int optimized_away;  /* median inside the noise floor */
+        double median_rel_error; /* half-width of the median's 95% CI over the median */
+        double mean_ci_low_ns, mean_ci_high_ns;     /* 95% bootstrap CI of the mean */
+        double median_ci_low_ns, median_ci_high_ns; /* 95% bootstrap CI of the median */
+        uint64_t outliers_low_severe, outliers_low_mild; /* below Q1 - 3 IQR, Q1 - 1.5 IQR */
+        uint64_t outliers_high_mild, outliers_high_severe; /* above Q3 + 1.5 IQR, Q3 + 3 IQR */
+        double outlier_variance; /* share of the variance contributed by outliers */
+        double pauses;            /* bench_pause/bench_resume pairs per call */
+        double pause_overhead_ns; /* their residual timer cost per call; subtracted with subtract_overhead */
     } bench_stats_t;
 
+    /* Against a baseline run: significant means the medians' 95% CIs do
+     * not overlap, a regression is significantly slower than the threshold */
+    typedef enum
+    {
+        BENCH_VERDICT_NONE, /* no baseline, or not in it */
+        BENCH_VERDICT_SAME,
+        BENCH_VERDICT_FASTER,
+        BENCH_VERDICT_SLOWER,
+        BENCH_VERDICT_REGRESSION
+    } bench_verdict_t;
+
+    /* Hardware counters per call, NaN when unavailable. */
     typedef struct
     {
-        char name[BENCH_MAX_NAME_LEN];
-        char description[BENCH_MAX_NAME_LEN];
+        double cycles, instructions, branch_misses, l1d_misses, llc_misses, dtlb_misses;
+        double ipc;                                        /* instructions per cycle */
+        double branch_mpki, l1d_mpki, llc_mpki, dtlb_mpki; /* misses per 1000 instructions */
+    } bench_counters_t;
+
+    /* A named amount per call declared with bench_set_counter */
+    typedef struct
+    {
+        char name[32];
+        double value;      /* per call */
+        double per_second; /* value x throughput */
+    } bench_user_counter_t;
+
+    /* A benchmark run in repetitions: its stats pool the samples of all of
+     * them, and this is the spread of their medians */
+    typedef struct
+    {
+        int count;                                /* 0 unless repeated */
+        double medians_ns[BENCH_MAX_REPETITIONS]; /* in the order they ran */
+        double mean_ns, median_ns, stddev_ns, min_ns, max_ns;
+    } bench_repetitions_t;
+
+    /* Heap use of the timed calls, from the allocation tracker (the
+     * build/lib/libbenchalloc.so shim under LD_PRELOAD); without it tracked
+     * is 0 and the rest NaN or 0. Iteration fixtures count too. */
+    typedef struct
+    {
+        int tracked;
+        double allocs, frees, bytes; /* per call; bytes as requested */
+        uint64_t peak_bytes;         /* most live heap above the run's start, summed over threads */
+        uint64_t leaks;              /* allocations the run left unfreed */
+    } bench_alloc_t;
+
+    /* The benchmark again with its data evicted from the caches and the TLB
+     * before every call (config cold): one call per sample, the eviction
+     * timed apart and left out. measured is 0 when it was not run, which
+     * includes benchmarks with an iteration fixture. */
+    typedef struct
+    {
+        int measured;
+        int flushed;          /* declared buffers were flushed, rather than a cache-sized buffer swept */
+        uint64_t evict_bytes; /* swept, or of the TLB-sized buffer touched after a flush */
+        double evict_ns;      /* median cost of one eviction */
+        double slowdown;      /* cold median over the hot one */
         bench_stats_t stats;
+    } bench_cold_t;
+
+    /* How the benchmark was warmed up. An automatic warmup times windows of
+     * samples until the last few agree on median and spread, with no
+     * monotonic trend, or until warmup_max_time. */
+    typedef struct
+    {
+        int automatic;       /* config warmup_auto; else the fixed warmup_iterations ran */
+        int steady;          /* automatic: a steady state was reached before the cap */
+        uint64_t iterations; /* calls made */
+        int windows;         /* automatic: windows timed */
+        double seconds;
+        double median_ns; /* automatic: per call over the last window */
+    } bench_warmup_t;
+
+    /* One open-loop run at a fixed rate. Latency counts from when a call was
+     * due, so time spent queued behind slower calls is part of it. */
+    typedef struct
+    {
+        double rate;     /* calls due per second */
+        double achieved; /* calls completed per second */
+        double p50_ns, p99_ns, p999_ns, max_ns;
+        uint64_t calls;
+        uint64_t unsent; /* due but not started when time ran out, counted with their wait so far */
+        int met;         /* p99 within the SLO, or there is none */
+    } bench_rate_step_t;
+
+    /* The benchmark driven open loop (config rate): calls come due on a
+     * schedule that does not wait for the previous one to finish, and are
+     * served one at a time. With rate_sweep the rate is searched for the
+     * highest one whose p99 meets the SLO. measured is 0 when not run. */
+    typedef struct
+    {
+        int measured;
+        int poisson;           /* exponential gaps between calls, else even ones */
+        double slo_ns;         /* p99 target, NaN without one */
+        double max_rate;       /* of a sweep: highest rate that met the SLO, 0 if none; NaN otherwise */
+        bench_rate_step_t run; /* the fixed rate, or the sweep's highest that met the SLO, else its last */
+        bench_stats_t latency; /* of that run, from when each call was due */
+        bench_stats_t service; /* of the same calls, from when each started */
+        int steps;
+        bench_rate_step_t step[BENCH_MAX_RATE_STEPS]; /* of a sweep, in the order tried */
+    } bench_open_loop_t;
+
+    typedef struct
+    {
+        const char *name; /* owned by the registry, valid until bench_cleanup */
+        const char *description;
+        bench_stats_t stats;
+        bench_counters_t counters;
+        int has_arg; /* registered through BENCH_DEFINE_PARAM or bench_register_args */
+        int64_t arg;
+        int threads;               /* workers running the body at once, 1 unless threaded */
+        double throughput;         /* calls per second over all threads */
+        double scaling_efficiency; /* throughput over threads x the 1-thread run; NaN if none */
+        double bytes_per_second;   /* bench_set_bytes x throughput; NaN if not set */
+        double items_per_second;   /* bench_set_items x throughput; NaN if not set */
+        double ns_per_item;        /* median_ns over items per call; NaN if not set */
+        bench_user_counter_t user_counters[BENCH_MAX_USER_COUNTERS];
+        int user_counter_count;
+        char error[64];            /* why an isolated run failed, empty if it did not */
+        int index;                 /* registration order; the merge key across shards */
+        bench_verdict_t verdict;   /* against baseline_file */
+        double baseline_change;    /* median over the baseline's, minus 1 */
+        bench_repetitions_t repetitions;
+        bench_alloc_t alloc;
+        bench_cold_t cold;
+        bench_open_loop_t open_loop;
+        bench_warmup_t warmup;
     } bench_result_t;
 
+    /* Best-fitting growth model of one parameter sweep, by median time */
+    typedef struct
+    {
+        const char *name; /* family name, without the /arg suffix */
+        bench_big_o_t big_o;
+        double coefficient_ns; /* median_ns ~ coefficient_ns * f(arg) */
+        double rms;            /* RMS of the residuals over the mean median_ns */
+    } bench_complexity_t;
+
     typedef struct
     {
         uint64_t iterations;
         uint64_t warmup_iterations;
+        int warmup_auto;          /* warm up until steady instead, see bench_warmup_t */
+        double warmup_tolerance;  /* relative, 0 means BENCH_DEFAULT_WARMUP_TOLERANCE */
+        double warmup_max_time;   /* seconds, 0 means BENCH_DEFAULT_WARMUP_MAX_TIME */
         const char *output_file;
         int verbose;
+        uint64_t batch_ns; /* target duration of one timed sample; 0 times every call */
+        bench_timer_t timer;
+        int subtract_overhead; /* subtract overhead_ns from every sample */
+        int perf_counters;     /* read hardware counters via perf_event_open */
+        int streaming;         /* constant-memory stats from a log-linear histogram */
+        const char *histogram_file; /* write per-benchmark latency histograms here */
+        const char *samples_file;   /* write every raw sample here, see src/samples.h */
+        int compress_samples;       /* delta+varint encode the raw samples */
+        const char *history_file;   /* append this run to a history, see src/history.h */
+        double min_time;            /* seconds; adaptive runs never stop sooner */
+        double max_time;            /* seconds; > 0 replaces iterations with an adaptive run */
+        double precision;           /* adaptive target for median_rel_error, 0 means 1% */
+        int pin_threads;            /* pin threaded workers to CPUs round-robin */
+        int stable;                 /* stable mode: pin, lock memory and check the machine first */
+        int cpu;                    /* stable mode pins here; -1 keeps the CPU it starts on */
+        int fifo_priority;          /* stable mode runs SCHED_FIFO at this priority if > 0 */
+        int isolate;                /* run each benchmark in its own forked child */
+        double timeout;             /* isolate: seconds before a child is killed, 0 waits forever */
+        int shard_index;            /* with shard_count > 1, run only this share of the families */
+        int shard_count;
+        int jobs;                   /* > 1 runs that many shards at once, one per physical core */
+        const char *baseline_file;  /* earlier CSV or JSON results to compare against */
+        double regression_threshold; /* slowdown that counts as a regression, 0 means 5% */
+        int repetitions;            /* > 1 runs every benchmark that often, in shuffled interleaved rounds */
+        uint64_t seed;              /* of that shuffle; 0 takes one from the clock */
+        const char *filter;         /* run only the benchmarks it selects, see bench_selected */
+        int list;                   /* bench_run_all prints the selected names instead of running them */
+        uint64_t machine_bytes;     /* > 0 adds the machine suite, its latency sweep ending at this size */
+        const char *cold;           /* also run these cold: "1" for all, else a filter like bench_selected's */
+        uint64_t cold_iterations;   /* samples of a cold run, 0 means BENCH_DEFAULT_COLD_ITERATIONS */
+        double rate;                /* > 0 also runs each benchmark open loop at this many calls per second */
+        int rate_sweep;             /* instead search for the highest rate that meets rate_slo_ns */
+        int rate_poisson;           /* Poisson arrivals rather than evenly spaced ones */
+        double rate_slo_ns;         /* p99 target; 0 means 10x the closed-loop p99 and noise floor */
+        double rate_time;           /* seconds at each rate, 0 means BENCH_DEFAULT_RATE_TIME */
     } bench_config_t;
 
+    /* What stable mode applied and what the machine looked like at init */
+    typedef struct
+    {
+        int stable;
+        int cpu;             /* the calling thread is pinned here, -1 if not pinned */
+        int fifo_priority;   /* SCHED_FIFO priority in effect, 0 for the normal class */
+        int memory_locked;   /* mlockall succeeded */
+        char governor[32];   /* cpufreq governor of that CPU, empty if unknown */
+        int smt_siblings;    /* other hardware threads on its core, -1 if unknown */
+        double load_average; /* 1-minute load average, NaN if unknown */
+    } bench_environment_t;
+
+    /* Streaming bandwidth in GB/s, counting bytes read plus written as STREAM does */
+    typedef struct
+    {
+        double read, write, copy, triad;
+    } bench_bandwidth_t;
+
+    /* What the machine suite (machine_bytes) found, to normalize results
+     * from different hosts: the steps of load-to-use latency over working
+     * sets, usually the cache levels, and the sustained bandwidth. */
+    typedef struct
+    {
+        int measured; /* the latency sweep ran */
+        int levels;   /* steps found below memory */
+        struct
+        {
+            uint64_t bytes;    /* largest working set before the step */
+            double latency_ns; /* at the middle of the plateau */
+        } cache[BENCH_MAX_CACHE_LEVELS];
+        uint64_t reported_bytes[BENCH_MAX_CACHE_LEVELS]; /* data cache per level from sysfs, 0 if unknown */
+        double memory_latency_ns;                        /* at the largest working set */
+        uint64_t stream_bytes;                           /* per array of the bandwidth kernels */
+        int threads;                                     /* of the widest bandwidth run, 0 if none ran */
+        bench_bandwidth_t single, all;                   /* one thread, and that many; NaN if not run */
+    } bench_machine_t;
+
     void bench_init(void);
     void bench_init_config(const bench_config_t *config);
     void bench_register(bench_fn_t fn, const char *name, const char *description);
+    /* Registers one instance per argument, named "name/arg". */
+    void bench_register_args(bench_fn_t fn, const char *name, const char *description, const int64_t *args,
+                             size_t count);
+    /* Geometric range: lo, lo * mult, ... up to and including hi. */
+    void bench_register_range(bench_fn_t fn, const char *name, const char *description, int64_t lo, int64_t hi,
+                              int64_t mult);
+    /* One instance per thread count, named "name/threads:N". Each worker
+     * runs the body for the configured iterations, starting together. */
+    void bench_register_threads(bench_fn_t fn, const char *name, const char *description, const int *threads,
+                                size_t count);
+    /* Fixtures: setup runs before and teardown after, either may be NULL. A
+     * name matches that benchmark or every instance of that family. Suite
+     * fixtures wrap a whole run; benchmark fixtures wrap warmup and
+     * measurement; iteration fixtures wrap every call, untimed. */
+    void bench_set_suite_fixture(bench_fn_t setup, bench_fn_t teardown);
+    void bench_set_fixture(const char *name, bench_fn_t setup, bench_fn_t teardown);
+    void bench_set_iteration_fixture(const char *name, bench_fn_t setup, bench_fn_t teardown);
+    /* Excludes the region between them from the current sample. */
+    void bench_pause(void);
+    void bench_resume(void);
+    /* Work done by one call of the running benchmark, declared from its body
+     * or a fixture; the last value set during the run is used. */
+    void bench_set_bytes(uint64_t bytes);
+    void bench_set_items(uint64_t items);
+    /* Takes a lock only the first time a name is set during a benchmark;
+     * after that it is matched by address, so pass the same string on every
+     * call, such as a literal. A copy at another address takes the lock. */
+    void bench_set_counter(const char *name, double value);
+    /* Data the running benchmark works on, declared from its fixture: its
+     * cold run flushes just these lines instead of sweeping the whole cache.
+     * A range declared again counts once. */
+    void bench_set_cold_buffer(const void *ptr, size_t bytes);
+    /* Whether the filter selects name: comma-separated globs, or POSIX
+     * extended regexes after "re:", any of which may exclude with a leading
+     * '-'. A glob also matches a family by the name before a '/'. */
+    int bench_selected(const char *name);
+    /* Returns how many benchmarks failed or regressed against the baseline. */
     int bench_run_all(void);
+    /* Runs one benchmark by exact name, filter or not; -1 if none has it. */
     int bench_run(const char *name);
     const bench_result_t *bench_get_results(size_t *count);
+    const bench_complexity_t *bench_get_complexity(size_t *count);
+    const bench_environment_t *bench_get_environment(void);
+    /* The machine suite's profile, once bench_run_all has run it */
+    const bench_machine_t *bench_get_machine(void);
+    const char *bench_big_o_name(bench_big_o_t big_o);
+    const char *bench_verdict_name(bench_verdict_t verdict);
     int bench_write_csv(const char *filename);
     int bench_write_json(const char *filename);
+    int bench_write_histograms(const char *filename);
+    /* Appends the results and what produced them (host, CPU, kernel,
+     * compiler, flags, commit) to an append-only run history. */
+    int bench_write_history(const char *filename);
     void bench_cleanup(void);
     uint64_t bench_timestamp_ns(void);
+    uint64_t bench_ticks(void);
+    double bench_ticks_per_ns(void);
+    const char *bench_timer_name(void);
     void bench_do_not_optimize(void *ptr);
     void bench_clobber(void);
 
@@ -61,6 +364,54 @@ extern "C"
     BENCH_REGISTER(name, desc)   \
     static void name(void)
 
+/* The body receives the argument as int64_t n. */
+#define BENCH_DEFINE_PARAM(name, desc, lo, hi, mult)                                  \
+    static void name(int64_t n);                                                      \
+    static void name##_run(void) { name(bench_current_arg); }                         \
+    __attribute__((constructor)) static void _bench_register_##name(void)             \
+    {                                                                                 \
+        bench_register_range(name##_run, #name, desc, lo, hi, mult);                  \
+    }                                                                                 \
+    static void name(int64_t n)
+
+/* The body receives the worker index as int thread; the thread counts
+ * follow the description. */
+#define BENCH_DEFINE_THREADED(name, desc, ...)                                      \
+    static void name(int thread);                                                   \
+    static void name##_run(void) { name(bench_current_thread); }                    \
+    __attribute__((constructor)) static void _bench_register_##name(void)           \
+    {                                                                               \
+        static const int threads[] = {__VA_ARGS__};                                 \
+        bench_register_threads(name##_run, #name, desc, threads,                    \
+                               sizeof(threads) / sizeof(threads[0]));               \
+    }                                                                               \
+    static void name(int thread)
+
+#define BENCH_FIXTURE(name, setup, teardown)                                        \
+    __attribute__((constructor)) static void _bench_fixture_##name(void)            \
+    {                                                                               \
+        bench_set_fixture(#name, setup, teardown);                                  \
+    }
+
+#define BENCH_ITERATION_FIXTURE(name, setup, teardown)                              \
+    __attribute__((constructor)) static void _bench_iteration_fixture_##name(void)  \
+    {                                                                               \
+        bench_set_iteration_fixture(#name, setup, teardown);                        \
+    }
+
+#define BENCH_SUITE_FIXTURE(setup, teardown)                                        \
+    __attribute__((constructor)) static void _bench_suite_fixture(void)             \
+    {                                                                               \
+        bench_set_suite_fixture(setup, teardown);                                   \
+    }
+
+#define BENCH_PAUSE() bench_pause()
+#define BENCH_RESUME() bench_resume()
+#define BENCH_SET_BYTES(n) bench_set_bytes((uint64_t)(n))
+#define BENCH_SET_ITEMS(n) bench_set_items((uint64_t)(n))
+#define BENCH_COUNTER(name, value) bench_set_counter(name, (double)(value))
+#define BENCH_COLD_BUFFER(ptr, bytes) bench_set_cold_buffer((ptr), (size_t)(bytes))
+
 #define BENCH_KEEP(x) bench_do_not_optimize((void *)&(x))
 #define BENCH_BARRIER() bench_clobber()
 
@@ -1,7 +1,9 @@
 #ifndef BENCHMARK_SINGLE_H
 #define BENCHMARK_SINGLE_H
 
-#define _POSIX_C_SOURCE 199309L
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <stdint.h>
 #include <stddef.h>
 
@@ -16,30 +18,171 @@ extern "C"
 #ifndef BENCH_WARMUP
 #define BENCH_WARMUP 100
 #endif
-#ifndef BENCH_MAX_BENCHMARKS
-#define BENCH_MAX_BENCHMARKS 256
+#ifndef BENCH_WARMUP_TOLERANCE
+#define BENCH_WARMUP_TOLERANCE 0.03 /* BENCH_WARMUP=auto: recent windows within +-3% */
+#endif
+#ifndef BENCH_WARMUP_MAX_TIME
+#define BENCH_WARMUP_MAX_TIME 1.0 /* seconds before an automatic warmup gives up */
 #endif
+#define BENCH_WARMUP_SAMPLES 32     /* per window of an automatic warmup */
+#define BENCH_WARMUP_WINDOWS 5      /* recent windows that must agree */
+#define BENCH_WARMUP_SAMPLE_NS 1000 /* its samples batch calls up to this long */
 #ifndef BENCH_MAX_NAME
-#define BENCH_MAX_NAME 128
+#define BENCH_MAX_NAME 128 /* of a name in the raw sample index; registered names have no limit */
+#endif
+#ifndef BENCH_BATCH_NS
+#define BENCH_BATCH_NS 0
+#endif
+#ifndef BENCH_MAX_BATCH
+#define BENCH_MAX_BATCH (1ULL << 30)
+#endif
+#ifndef BENCH_OVERHEAD_SAMPLES
+#define BENCH_OVERHEAD_SAMPLES 1000
+#endif
+#ifndef BENCH_HIST_SUB_BITS
+#define BENCH_HIST_SUB_BITS 7 /* histogram relative error <= 2^-bits */
+#endif
+#define BENCH_HIST_SUB (1u << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_BUCKETS ((64 - BENCH_HIST_SUB_BITS + 1) * BENCH_HIST_SUB)
+#define BENCH_STREAM_CHUNK 4096
+#ifndef BENCH_PRECISION
+#define BENCH_PRECISION 0.01 /* adaptive target for median_rel_error */
+#endif
+#define BENCH_MIN_SAMPLES 64 /* first round of an adaptive run */
+#ifndef BENCH_MAX_USER_COUNTERS
+#define BENCH_MAX_USER_COUNTERS 8
 #endif
+#ifndef BENCH_MAX_REPETITIONS
+#define BENCH_MAX_REPETITIONS 64 /* BENCH_REPETITIONS kept per benchmark */
+#endif
+#ifndef BENCH_BOOTSTRAP
+#define BENCH_BOOTSTRAP 1000 /* bootstrap resamples */
+#endif
+#define BENCH_MAX_CACHE_LEVELS 4
+#ifndef BENCH_MACHINE_BYTES
+#define BENCH_MACHINE_BYTES (1ULL << 30) /* largest working set of the machine suite by default */
+#endif
+#ifndef BENCH_COLD_ITERATIONS
+#define BENCH_COLD_ITERATIONS 100 /* samples of a BENCH_COLD run */
+#endif
+#define BENCH_MAX_COLD_BUFFERS 16
+#ifndef BENCH_RATE_TIME
+#define BENCH_RATE_TIME 0.5 /* seconds at each BENCH_RATE rate */
+#endif
+#define BENCH_MAX_RATE_STEPS 16
+#define BENCH_RATE_MIN_CALLS 1000 /* in a sweep's runs, so a p99 is more than the slowest call */
+#define BENCH_BIN_SUB_BITS 10 /* bootstrap bins: exact below 1024 ticks above min */
+#define BENCH_BIN_SUB (1u << BENCH_BIN_SUB_BITS)
 
     typedef void (*bench_fn_t)(void);
     typedef struct
     {
-        double min_ns, max_ns, mean_ns, median_ns, stddev_ns, p95_ns, p99_ns;
-        uint64_t iterations;
+        double min_ns, max_ns, mean_ns, median_ns, stddev_ns, p95_ns, p99_ns, p999_ns, p9999_ns;
+        double min_cycles, median_cycles, mean_cycles, p99_cycles; /* cycle-counter ticks, 0 if none */
+        double overhead_ns, noise_floor_ns; /* empty-body median and p99 per call */
+        uint64_t iterations, batch_size;
+        int optimized_away;      /* median inside the noise floor */
+        double median_rel_error; /* half-width of the median's 95% CI over the median */
+        double mean_ci_low_ns, mean_ci_high_ns, median_ci_low_ns, median_ci_high_ns; /* 95% bootstrap CIs */
+        uint64_t outliers_low_severe, outliers_low_mild, outliers_high_mild, outliers_high_severe; /* Tukey */
+        double outlier_variance; /* share of the variance contributed by outliers */
+        double pauses;            /* BENCH_PAUSE/BENCH_RESUME pairs per call */
+        double pause_overhead_ns; /* their residual timer cost per call */
     } bench_stats_t;
+    typedef struct /* hardware counters per call, NaN when unavailable */
+    {
+        double cycles, instructions, branch_misses, l1d_misses, llc_misses, dtlb_misses;
+        double ipc, branch_mpki, l1d_mpki, llc_mpki, dtlb_mpki; /* mpki: misses per 1000 instructions */
+    } bench_counters_t;
+    typedef struct /* a named amount per call from BENCH_COUNTER */
+    {
+        char name[32];
+        double value, per_second; /* per call; value x throughput */
+    } bench_user_counter_t;
+    typedef struct /* one open-loop run; latency counts from when each call was due */
+    {
+        double rate, achieved; /* calls due and completed per second */
+        double p50_ns, p99_ns, p999_ns, max_ns;
+        uint64_t calls, unsent; /* unsent: due but not started at the end, counted with their wait so far */
+        int met;                /* p99 within BENCH_SLO, or there is none */
+    } bench_rate_step_t;
+    typedef struct /* how an entry was warmed up */
+    {
+        int automatic;       /* BENCH_WARMUP=auto; else the fixed BENCH_WARMUP calls ran */
+        int steady;          /* automatic: a steady state was reached before the cap */
+        uint64_t iterations; /* calls made */
+        int windows;         /* automatic: windows timed */
+        double seconds;
+        double median_ns; /* automatic: per call over the last window */
+    } bench_warmup_t;
     typedef struct
     {
-        char name[BENCH_MAX_NAME];
-        char desc[BENCH_MAX_NAME];
+        const char *name, *desc; /* in an arena that lives as long as the process */
         bench_fn_t fn;
         bench_stats_t stats;
+        bench_counters_t counters;
+        int has_arg; /* a BENCH_PARAM instance, named "name/arg" */
+        int64_t arg;
+        int threads;            /* BENCH_THREADED workers, 0 on the calling thread */
+        double throughput;      /* calls per second over all threads */
+        double efficiency;      /* throughput over threads x the 1-thread instance, NaN if none */
+        double slowest_median_ns, slowest_p99_ns; /* worst thread of a threaded run */
+        double bytes_per_second, items_per_second; /* BENCH_SET_BYTES/ITEMS x throughput, NaN if unset */
+        double ns_per_item;                        /* median over BENCH_SET_ITEMS, NaN if unset */
+        bench_user_counter_t user[BENCH_MAX_USER_COUNTERS];
+        int nuser;
+        int verdict;                /* against BENCH_BASELINE: 0 none, then same, faster, slower, regression */
+        double base_ns, base_change; /* baseline median; median over it, minus 1 */
+        char error[64];                           /* why the run failed, empty if it did not */
+        int skipped;                              /* filtered out or in another shard: not run or reported */
+        int reps;                                 /* BENCH_REPETITIONS pooled into stats, 0 if run once */
+        double rep_ns[BENCH_MAX_REPETITIONS];     /* median of each repetition, in the order they ran */
+        double reps_mean_ns, reps_median_ns, reps_stddev_ns, reps_min_ns, reps_max_ns; /* of rep_ns */
+        int alloc_tracked; /* run under LD_PRELOAD=libbenchalloc.so; the rest are NaN or 0 without it */
+        double allocs, frees, alloc_bytes; /* per call, iteration fixtures included; bytes as requested */
+        uint64_t peak_bytes, leaks; /* most live heap above the start, summed over threads; unfreed */
+        int cold;                   /* BENCH_COLD ran it again, one call per sample after an eviction */
+        int cold_flushed;           /* declared buffers were flushed, rather than a cache-sized buffer swept */
+        bench_stats_t cold_stats;   /* of that run, the eviction left out */
+        double cold_slowdown;       /* its median over the hot one */
+        double evict_ns;            /* median cost of one eviction */
+        uint64_t evict_bytes;       /* swept, or touched after a flush */
+        int open_loop;              /* BENCH_RATE drove it on a schedule that does not wait for each call */
+        bench_rate_step_t run;      /* the fixed rate, or the sweep's highest within BENCH_SLO, else its last */
+        bench_stats_t ol_latency;   /* of that run, from when each call was due */
+        bench_stats_t ol_service;   /* of the same calls, from when each started */
+        double slo_ns, max_rate;    /* p99 target, NaN if none; the sweep's highest rate within it, else NaN */
+        int nsteps;
+        bench_rate_step_t steps[BENCH_MAX_RATE_STEPS]; /* of a sweep, in the order tried */
+        bench_warmup_t warmup;
     } bench_entry_t;
 
+    extern int64_t bench_arg;         /* argument of the BENCH_PARAM instance being run */
+    extern __thread int bench_thread; /* worker index in a BENCH_THREADED body */
+
     void bench_register(bench_fn_t fn, const char *name, const char *desc);
-    int bench_main(void);
+    void bench_register_range(bench_fn_t fn, const char *name, int64_t lo, int64_t hi, int64_t mult);
+    void bench_register_threads(bench_fn_t fn, const char *name, const int *threads, size_t count);
+    /* Setup before, teardown after, either NULL; a name also matches a
+     * BENCH_PARAM family. Iteration fixtures wrap every call, untimed. */
+    void bench_set_suite_fixture(bench_fn_t setup, bench_fn_t teardown);
+    void bench_set_fixture(const char *name, bench_fn_t setup, bench_fn_t teardown);
+    void bench_set_iteration_fixture(const char *name, bench_fn_t setup, bench_fn_t teardown);
+    void bench_pause(void);
+    void bench_resume(void);
+    /* Work per call of the running benchmark, from its body or a fixture. */
+    void bench_set_bytes(uint64_t bytes);
+    void bench_set_items(uint64_t items);
+    /* Lock-free once a name is known, matched by address: pass the same
+     * string every call, such as a literal; a copy elsewhere takes a lock. */
+    void bench_set_counter(const char *name, double value);
+    /* Data the running benchmark works on, from its fixture: BENCH_COLD then
+     * flushes just these lines instead of sweeping the whole cache. A range
+     * declared again counts once. */
+    void bench_set_cold_buffer(const void *ptr, size_t bytes);
+    int bench_main(void); /* returns how many benchmarks failed or regressed */
     uint64_t bench_now(void);
+    uint64_t bench_ticks(void);
     void bench_escape(void *p);
     void bench_clobber(void);
 
@@ -48,6 +191,46 @@ extern "C"
     __attribute__((constructor)) static void _reg_##name(void) { bench_register(_bench_##name, #name, #name); } \
     static void _bench_##name(void)
 
+/* One instance per argument lo, lo * mult, ... up to and including hi; the
+ * body receives it as int64_t n. */
+#define BENCH_PARAM(name, lo, hi, mult)                                                                       \
+    static void _bench_##name(int64_t n);                                                                     \
+    static void _bench_run_##name(void) { _bench_##name(bench_arg); }                                         \
+    __attribute__((constructor)) static void _reg_##name(void)                                                \
+    {                                                                                                         \
+        bench_register_range(_bench_run_##name, #name, lo, hi, mult);                                         \
+    }                                                                                                         \
+    static void _bench_##name(int64_t n)
+
+/* One instance per thread count, named "name/threads:N"; the workers start
+ * together and the body receives its worker index as int thread. */
+#define BENCH_THREADED(name, ...)                                                      \
+    static void _bench_##name(int thread);                                             \
+    static void _bench_run_##name(void) { _bench_##name(bench_thread); }               \
+    __attribute__((constructor)) static void _reg_##name(void)                         \
+    {                                                                                  \
+        static const int threads[] = {__VA_ARGS__};                                    \
+        bench_register_threads(_bench_run_##name, #name, threads,                      \
+                               sizeof(threads) / sizeof(threads[0]));                  \
+    }                                                                                  \
+    static void _bench_##name(int thread)
+
+#define BENCH_SUITE_FIXTURE(setup, teardown) \
+    __attribute__((constructor)) static void _fix_suite(void) { bench_set_suite_fixture(setup, teardown); }
+#define BENCH_FIXTURE(name, setup, teardown) \
+    __attribute__((constructor)) static void _fix_##name(void) { bench_set_fixture(#name, setup, teardown); }
+#define BENCH_ITERATION_FIXTURE(name, setup, teardown)               \
+    __attribute__((constructor)) static void _fix_iter_##name(void) \
+    {                                                               \
+        bench_set_iteration_fixture(#name, setup, teardown);        \
+    }
+#define BENCH_PAUSE() bench_pause()
+#define BENCH_RESUME() bench_resume()
+#define BENCH_SET_BYTES(n) bench_set_bytes((uint64_t)(n))
+#define BENCH_SET_ITEMS(n) bench_set_items((uint64_t)(n))
+#define BENCH_COUNTER(name, value) bench_set_counter(name, (double)(value))
+#define BENCH_COLD_BUFFER(ptr, bytes) bench_set_cold_buffer((ptr), (size_t)(bytes))
+
 #define KEEP(x) bench_escape((void *)&(x))
 #define CLOBBER() bench_clobber()
 
@@ -62,15 +245,221 @@ extern "C"
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <regex.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* Log-linear (HDR-style) histogram of per-batch tick totals with Welford moments. */
+typedef struct
+{
+    uint64_t counts[BENCH_HIST_BUCKETS], n, min, max;
+    double mean, m2;
+} _bench_hist_t;
+
+/* Index record of the raw sample file (BENCH_SAMPLES). The file is a 32-byte
+ * header ("BENCHRAW", u32 version 1, u32 records, f64 ns per tick, u64 index
+ * offset), one 8-byte aligned block of per-batch ticks per benchmark, then
+ * the index. A block is u32 or u64 ticks, or zigzag deltas of consecutive
+ * samples as LEB128 varints when compressed. */
+typedef struct
+{
+    char name[BENCH_MAX_NAME];
+    uint64_t offset, bytes, count, batch;
+    double subtract;                           /* ticks per sample subtracted as overhead */
+    uint32_t width, encoding, threads, unused; /* width 4 or 8 bytes; encoding 1 for varints */
+} _bench_raw_t;
+
+/* Run history (BENCH_HISTORY): an append-only file of 64-byte records, the
+ * format of src/history.h. A header record ("BENCHHST", u32 version 1, u32
+ * record size) is followed by what each run appends: the string records it
+ * needs first (deduplicated across the file; id 0 is none, long strings
+ * continue in part + 1), one run record and one result record per benchmark. */
+typedef struct
+{
+    uint32_t tag, id, part, length; /* tag 1 */
+    char text[48];
+} _bench_str_rec_t;
+typedef struct
+{
+    uint32_t tag, run; /* tag 2; runs are numbered from 1 */
+    int64_t time;
+    uint32_t host, cpu, kernel, compiler, cflags, commit, timer, label, benchmarks, flags;
+    double load_average;
+} _bench_run_rec_t;
+typedef struct
+{
+    uint32_t tag, run, name, flags; /* tag 3; flags 1 failed, verdict in bits 8-15 */
+    double median_ns, ci_low_ns, ci_high_ns, mean_ns, p99_ns;
+    uint64_t iterations;
+} _bench_result_rec_t;
+
+/* Per-thread counters of the allocation tracker, build/lib/libbenchalloc.so
+ * from the library's src/alloc.c; the layout has to match its own. */
+typedef struct
+{
+    uint64_t allocs, frees, bytes;
+    int64_t live, peak; /* usable bytes allocated minus freed; highest since last lowered */
+} _bench_alloc_counters_t;
+
+/* One thread's heap activity over the _measure calls of a run */
+typedef struct
+{
+    _bench_alloc_counters_t *c, start; /* c NULL without the tracker */
+    uint64_t allocs, frees, bytes;
+    int64_t net, peak;
+} _bench_alloc_t;
+
+/* What one entry has collected over its repetitions so far */
+typedef struct
+{
+    uint64_t *v, n, cap; /* samples of every repetition, unless streaming */
+    uint64_t batch;      /* chosen by the first repetition and kept, so samples stay comparable */
+    _bench_hist_t *h;
+    bench_counters_t counters; /* summed, like pauses and throughput */
+    double pauses, throughput;
+    int lost; /* out of memory for the samples: the last repetition stands */
+} _bench_pool_t;
+
+/* What the machine suite found, as the library's bench_machine_t */
+typedef struct
+{
+    int measured, levels, threads; /* latency sweep ran; steps below memory; widest bandwidth run */
+    uint64_t bytes[BENCH_MAX_CACHE_LEVELS];    /* largest working set before each step */
+    double latency_ns[BENCH_MAX_CACHE_LEVELS]; /* at the middle of its plateau */
+    uint64_t reported[BENCH_MAX_CACHE_LEVELS]; /* data cache per level from sysfs, 0 if unknown */
+    double memory_ns;                          /* at the largest working set */
+    uint64_t stream_bytes;                     /* per array of the bandwidth kernels */
+    double single[4], all[4]; /* read, write, copy, triad GB/s on one thread and on threads; NaN if not run */
+} _bench_machine_t;
+
+/* Compiled BENCH_FILTER-style patterns */
+typedef struct
+{
+    struct
+    {
+        const char *glob; /* NULL for a regex */
+        regex_t regex;
+        int exclude;
+    } *patterns;
+    size_t npatterns;
+    int includes; /* including patterns */
+} _bench_filter_t;
+
+/* Open-addressed hash of names to the index they were added with */
+typedef struct
+{
+    struct
+    {
+        const char *name; /* NULL when empty */
+        uint64_t hash;
+        size_t index;
+    } *slots;
+    size_t size, count; /* slots, a power of two at most half full */
+} _bench_names_t;
 
 static struct
 {
-    bench_entry_t entries[BENCH_MAX_BENCHMARKS];
-    size_t count;
-    int quiet;
-    uint64_t iters, warmup;
-    const char *csv_file;
-} _bench = {.iters = BENCH_ITERATIONS, .warmup = BENCH_WARMUP, .csv_file = "benchmark_results.csv"};
+    bench_entry_t *entries; /* registration order, grown by doubling */
+    _bench_hist_t **hist;   /* parallel to entries, allocated by bench_main */
+    size_t count, cap;
+    _bench_names_t names;  /* of the entries */
+    char *arena;           /* every copied name; blocks are never freed */
+    size_t arena_used, arena_size;
+    const char *filter; /* BENCH_FILTER */
+    _bench_filter_t selects;
+    int list;         /* BENCH_LIST */
+    const char *cold; /* BENCH_COLD: "1" or a filter of the entries also run cold, NULL when off */
+    _bench_filter_t colds;
+    uint64_t cold_iters;
+    double rate;        /* BENCH_RATE calls per second, 0 if off */
+    int sweep, poisson; /* BENCH_RATE=sweep; BENCH_ARRIVALS=poisson */
+    double slo_ns, rate_time;
+    int warmup_auto; /* BENCH_WARMUP=auto */
+    double warmup_tol, warmup_max_time;
+    int quiet, use_tsc, subtract, perf, perf_fd[6], stream;
+    uint64_t perf_id[6];
+    uint64_t iters, warmup, batch_ns;
+    double min_time, max_time, precision; /* adaptive run length when max_time > 0 */
+    double tsc_per_ns, ns_per_tick, cyc_per_tick;
+    double overhead[64][2]; /* median, p99 ns per call by log2(batch) */
+    uint64_t overhead_done; /* bit k set once overhead[k] is measured */
+    const char *csv_file, *json_file, *hist_file, *timer;
+    struct
+    {
+        const char *name; /* the family's */
+        int big_o;        /* index into _big_o */
+        double coef, rms;
+    } *fit; /* complexity of each parameter sweep */
+    size_t nfit;
+    struct
+    {
+        const char *name;
+        bench_fn_t setup, teardown;
+        int each; /* per iteration */
+    } *fix;
+    size_t nfix, fix_cap;
+    _bench_names_t fix_names[2]; /* benchmark and iteration fixtures */
+    bench_fn_t suite_setup, suite_teardown, each_fn, each_setup, each_teardown;
+    uint64_t pause_fix; /* ticks removed per pause/resume pair */
+    double pause_cost;  /* residual ticks per pair */
+    int pin;            /* pin BENCH_THREADED workers round-robin */
+    int stable, cpu, fifo; /* stable mode: requested, then in effect (cpu -1, fifo 0 if not) */
+    int locked, smt;       /* mlockall succeeded; SMT siblings of that CPU, -1 if unknown */
+    char governor[32];     /* cpufreq governor, empty if unknown */
+    double load;           /* 1-minute load average, NaN if unknown */
+    int isolate;           /* fork a child per benchmark */
+    double timeout;        /* isolate: seconds before a child is killed, 0 waits forever */
+    int shard, shards;     /* BENCH_SHARD index/count, shards 0 when not sharded */
+    int jobs, orchestrated; /* BENCH_JOBS; orchestrated once its shards ran, on cores[] */
+    int cores[64];
+    double cal_alone, cal_alone_error, cal[64], cal_error[64]; /* calibration kernel ns, CI over median */
+    const char *baseline; /* BENCH_BASELINE results to compare against */
+    double threshold;     /* slowdown that counts as a regression */
+    const char *samples_file; /* BENCH_SAMPLES: every raw sample */
+    int compress, raw_failed;
+    FILE *raw;
+    _bench_raw_t *raw_index; /* one record per block, grown as blocks start */
+    size_t nraw, raw_cap;
+    uint64_t raw_prev; /* last sample written, for varint deltas */
+    const char *history; /* BENCH_HISTORY: append this run */
+    int reps;            /* BENCH_REPETITIONS: rounds that each run every entry once */
+    uint64_t seed;       /* of the shuffle of every round */
+    _bench_pool_t *pool; /* of the entry being repeated, else NULL */
+    _bench_alloc_counters_t *(*alloc)(void); /* the preloaded tracker's, else NULL */
+    uint64_t machine_bytes;                  /* BENCH_MACHINE: the suite's largest working set, 0 if off */
+    _bench_machine_t profile;
+    struct
+    {
+        char host[72], cpu[128], kernel[160], compiler[128], cflags[256], commit[64], label[128];
+    } machine; /* what produced this run, empty when unknown */
+} _bench = {.iters = BENCH_ITERATIONS, .warmup = BENCH_WARMUP, .batch_ns = BENCH_BATCH_NS,
+            .precision = BENCH_PRECISION, .csv_file = "benchmark_results.csv", .timer = "auto", .cpu = -1,
+            .threshold = 0.05, .cold_iters = BENCH_COLD_ITERATIONS, .rate_time = BENCH_RATE_TIME,
+            .warmup_tol = BENCH_WARMUP_TOLERANCE, .warmup_max_time = BENCH_WARMUP_MAX_TIME};
+#ifdef __linux__
+static cpu_set_t _allowed; /* affinity before stable mode pinned the main thread */
+#endif
 
 uint64_t bench_now(void)
 {
@@ -79,115 +468,3834 @@ uint64_t bench_now(void)
     return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
+#if defined(__x86_64__)
+static inline uint64_t _tsc_start(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("lfence\n\trdtsc" : "=a"(lo), "=d"(hi) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+static inline uint64_t _tsc_stop(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("rdtscp\n\tlfence" : "=a"(lo), "=d"(hi) : : "rcx", "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+static int _tsc_invariant(void)
+{
+    unsigned a, b, c, d;
+    if (!__get_cpuid(0x80000001, &a, &b, &c, &d) || !(d & (1u << 27)))
+        return 0;
+    return __get_cpuid(0x80000007, &a, &b, &c, &d) && ((d >> 8) & 1);
+}
+static double _tsc_hz(void) { return 0.0; }
+#elif defined(__aarch64__)
+static inline uint64_t _tsc_start(void)
+{
+    uint64_t v;
+    __asm__ volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(v) : : "memory");
+    return v;
+}
+static inline uint64_t _tsc_stop(void) { return _tsc_start(); }
+static int _tsc_invariant(void) { return 1; }
+static double _tsc_hz(void)
+{
+    uint64_t f;
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(f));
+    return (double)f;
+}
+#else
+static inline uint64_t _tsc_start(void) { return 0; }
+static inline uint64_t _tsc_stop(void) { return 0; }
+static int _tsc_invariant(void) { return 0; }
+static double _tsc_hz(void) { return -1.0; }
+#endif
+
+static inline uint64_t _ticks_start(void) { return _bench.use_tsc ? _tsc_start() : bench_now(); }
+static inline uint64_t _ticks_stop(void) { return _bench.use_tsc ? _tsc_stop() : bench_now(); }
+uint64_t bench_ticks(void) { return _ticks_stop(); }
+
+static void _timer_init(void)
+{
+    double hz = _tsc_hz();
+    if (hz > 0)
+        _bench.tsc_per_ns = hz / 1e9;
+    else if (hz == 0)
+    {
+        uint64_t t0 = bench_now(), c0 = _tsc_start(), t1;
+        do
+            t1 = bench_now();
+        while (t1 - t0 < 20000000ULL);
+        _bench.tsc_per_ns = (double)(_tsc_stop() - c0) / (double)(t1 - t0);
+    }
+    int invariant = _bench.tsc_per_ns > 0 && _tsc_invariant();
+    if (strcmp(_bench.timer, "tsc") == 0)
+    {
+        _bench.use_tsc = _bench.tsc_per_ns > 0;
+        if (!invariant && !_bench.quiet)
+            fprintf(stderr, "warning: cycle counter is %s\n", _bench.use_tsc ? "not invariant" : "unavailable, using clock");
+    }
+    else
+        _bench.use_tsc = strcmp(_bench.timer, "clock") != 0 && invariant;
+    _bench.ns_per_tick = _bench.use_tsc ? 1.0 / _bench.tsc_per_ns : 1.0;
+    _bench.cyc_per_tick = _bench.use_tsc ? 1.0 : _bench.tsc_per_ns;
+}
+
 void bench_escape(void *p) { __asm__ volatile("" : : "r,m"(p) : "memory"); }
 void bench_clobber(void) { __asm__ volatile("" : : : "memory"); }
 
+/* NUL-terminated copy of the first len bytes of text in the arena, which
+ * grows in 64KB blocks that are never freed; NULL when out of memory. */
+static const char *_copy(const char *text, size_t len)
+{
+    if (!_bench.arena || _bench.arena_used + len + 1 > _bench.arena_size)
+    {
+        const size_t size = len + 1 > 65536 ? len + 1 : 65536;
+        if (!(_bench.arena = (char *)malloc(size)))
+            return NULL;
+        _bench.arena_used = 0;
+        _bench.arena_size = size;
+    }
+    char *copy = _bench.arena + _bench.arena_used;
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    _bench.arena_used += len + 1;
+    return copy;
+}
+
+/* FNV-1a a word at a time with the murmur3 finalizer, as src/registry.c */
+static uint64_t _hash(const char *name, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL ^ len, w;
+    for (; len >= 8; name += 8, len -= 8)
+    {
+        memcpy(&w, name, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+    }
+    w = 0;
+    memcpy(&w, name, len);
+    h = (h ^ w) * 0x100000001b3ULL;
+    h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+    return h ^ (h >> 33);
+}
+
+static size_t _probe(const _bench_names_t *t, const char *name, size_t len, uint64_t h)
+{
+    size_t i = h & (t->size - 1);
+    while (t->slots[i].name &&
+           !(t->slots[i].hash == h && strncmp(t->slots[i].name, name, len) == 0 && t->slots[i].name[len] == '\0'))
+        i = (i + 1) & (t->size - 1);
+    return i;
+}
+
+/* Index of the first len bytes of name, or -1 */
+static long _names_find(const _bench_names_t *t, const char *name, size_t len)
+{
+    if (!t->count)
+        return -1;
+    const size_t i = _probe(t, name, len, _hash(name, len));
+    return t->slots[i].name ? (long)t->slots[i].index : -1;
+}
+
+/* Maps name, which must outlive the table, to index unless it is mapped
+ * already; returns the index it maps to, or -1 when out of memory. */
+static long _names_add(_bench_names_t *t, const char *name, size_t index)
+{
+    if ((t->count + 1) * 2 > t->size)
+    {
+        _bench_names_t grown = {NULL, t->size ? t->size * 2 : 1024, t->count};
+        if (!(grown.slots = (__typeof__(grown.slots))calloc(grown.size, sizeof(*grown.slots))))
+            return -1;
+        for (size_t i = 0; i < t->size; i++)
+            if (t->slots[i].name)
+            {
+                size_t k = t->slots[i].hash & (grown.size - 1);
+                while (grown.slots[k].name)
+                    k = (k + 1) & (grown.size - 1);
+                grown.slots[k] = t->slots[i];
+            }
+        free(t->slots);
+        *t = grown;
+    }
+    const size_t len = strlen(name);
+    const uint64_t h = _hash(name, len);
+    const size_t i = _probe(t, name, len, h);
+    if (!t->slots[i].name)
+    {
+        t->slots[i].name = name;
+        t->slots[i].hash = h;
+        t->slots[i].index = index;
+        t->count++;
+    }
+    return (long)t->slots[i].index;
+}
+
 void bench_register(bench_fn_t fn, const char *name, const char *desc)
 {
-    if (_bench.count >= BENCH_MAX_BENCHMARKS)
+    desc = desc ? desc : "";
+    const bench_entry_t *prev = _bench.count ? &_bench.entries[_bench.count - 1] : NULL;
+    const char *copy = _copy(name, strlen(name));
+    /* Instances of a family share one description */
+    const char *desc_copy = prev && strcmp(prev->desc, desc) == 0 ? prev->desc : _copy(desc, strlen(desc));
+    long first = -1;
+    if (copy && desc_copy && _bench.count == _bench.cap)
+    {
+        const size_t cap = _bench.cap ? _bench.cap * 2 : 64;
+        bench_entry_t *grown = (bench_entry_t *)realloc(_bench.entries, cap * sizeof(bench_entry_t));
+        if (grown)
+            _bench.entries = grown, _bench.cap = cap;
+    }
+    if (!copy || !desc_copy || _bench.count == _bench.cap ||
+        (first = _names_add(&_bench.names, copy, _bench.count)) < 0)
+    {
+        fprintf(stderr, "warning: out of memory registering %s; it will not run\n", name);
         return;
+    }
+    if ((size_t)first != _bench.count)
+        fprintf(stderr, "warning: benchmark %s is registered twice\n", name);
     bench_entry_t *e = &_bench.entries[_bench.count++];
+    memset(e, 0, sizeof(*e));
     e->fn = fn;
-    strncpy(e->name, name, BENCH_MAX_NAME - 1);
-    strncpy(e->desc, desc ? desc : "", BENCH_MAX_NAME - 1);
+    e->name = copy;
+    e->desc = desc_copy;
 }
 
-static int _cmp_dbl(const void *a, const void *b)
+int64_t bench_arg;
+__thread int bench_thread;
+
+void bench_register_threads(bench_fn_t fn, const char *name, const int *threads, size_t count)
 {
-    double d = *(double *)a - *(double *)b;
-    return (d > 0) - (d < 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        char *instance;
+        const size_t before = _bench.count;
+        if (asprintf(&instance, "%s/threads:%d", name, threads[i]) < 0)
+            continue;
+        bench_register(fn, instance, name);
+        free(instance);
+        if (_bench.count > before)
+            _bench.entries[before].threads = threads[i] > 0 ? threads[i] : 1;
+    }
 }
 
-static void _run_one(bench_entry_t *e)
+void bench_register_range(bench_fn_t fn, const char *name, int64_t lo, int64_t hi, int64_t mult)
 {
-    for (uint64_t i = 0; i < _bench.warmup; i++)
-        e->fn();
-    double *samples = malloc(_bench.iters * sizeof(double));
-    for (uint64_t i = 0; i < _bench.iters; i++)
+    mult = mult < 2 ? 2 : mult;
+    for (int64_t v = lo, last = 0; !last; v = v < 1 ? 1 : v > hi / mult ? hi : v * mult)
     {
-        uint64_t t0 = bench_now();
-        e->fn();
-        samples[i] = (double)(bench_now() - t0);
+        char *instance;
+        const size_t before = _bench.count;
+        last = v >= hi;
+        v = last ? hi : v;
+        if (asprintf(&instance, "%s/%lld", name, (long long)v) < 0)
+            continue;
+        bench_register(fn, instance, name);
+        free(instance);
+        if (_bench.count > before)
+        {
+            _bench.entries[before].has_arg = 1;
+            _bench.entries[before].arg = v;
+        }
     }
-    qsort(samples, _bench.iters, sizeof(double), _cmp_dbl);
-    bench_stats_t *s = &e->stats;
-    s->iterations = _bench.iters;
-    s->min_ns = samples[0];
-    s->max_ns = samples[_bench.iters - 1];
-    s->median_ns = samples[_bench.iters / 2];
-    s->p95_ns = samples[(size_t)(_bench.iters * 0.95)];
-    s->p99_ns = samples[(size_t)(_bench.iters * 0.99)];
-    double sum = 0;
-    for (size_t i = 0; i < _bench.iters; i++)
-        sum += samples[i];
-    s->mean_ns = sum / _bench.iters;
-    double var = 0;
-    for (size_t i = 0; i < _bench.iters; i++)
-    {
-        double d = samples[i] - s->mean_ns;
-        var += d * d;
-    }
-    s->stddev_ns = sqrt(var / _bench.iters);
-    free(samples);
 }
 
-static void _write_csv(void)
+/* BENCH_FILTER, as the library's: comma-separated globs, or POSIX extended
+ * regexes matched anywhere with the prefix "re:"; a leading '-' excludes. A
+ * glob also matches a family by the name before a '/'. Returns -1 with a
+ * warning naming var for a pattern that does not compile. */
+static int _filter_compile(_bench_filter_t *f, const char *spec, const char *var)
 {
-    FILE *f = fopen(_bench.csv_file, "w");
-    if (!f)
-        return;
-    fprintf(f, "name,description,iterations,min_ns,max_ns,mean_ns,median_ns,stddev_ns,p95_ns,p99_ns\n");
-    for (size_t i = 0; i < _bench.count; i++)
+    char *text = spec && spec[0] ? strdup(spec) : NULL, *save = NULL;
+    size_t max = 1;
+    for (const char *p = text; p && *p; p++)
+        max += *p == ',';
+    if (!text || !(f->patterns = (__typeof__(f->patterns))calloc(max, sizeof(*f->patterns))))
+        return text ? -1 : 0;
+    for (char *p = strtok_r(text, ",", &save); p; p = strtok_r(NULL, ",", &save)) /* text lives on */
     {
-        bench_entry_t *e = &_bench.entries[i];
-        fprintf(f, "%s,\"%s\",%lu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
-                e->name, e->desc, (unsigned long)e->stats.iterations,
-                e->stats.min_ns, e->stats.max_ns, e->stats.mean_ns, e->stats.median_ns,
-                e->stats.stddev_ns, e->stats.p95_ns, e->stats.p99_ns);
+        const int exclude = *p == '-';
+        p += exclude;
+        if (!*p)
+            continue;
+        f->patterns[f->npatterns].exclude = exclude;
+        if (strncmp(p, "re:", 3) == 0)
+        {
+            const int err = regcomp(&f->patterns[f->npatterns].regex, p + 3, REG_EXTENDED | REG_NOSUB);
+            if (err)
+            {
+                char msg[128];
+                regerror(err, &f->patterns[f->npatterns].regex, msg, sizeof(msg));
+                fprintf(stderr, "warning: %s pattern %s: %s\n", var, p, msg);
+                return -1;
+            }
+        }
+        else
+            f->patterns[f->npatterns].glob = p;
+        f->includes += !exclude;
+        f->npatterns++;
     }
-    fclose(f);
+    return 0;
 }
 
-static void _print_results(void)
+static int _glob_family(const char *glob, const char *name)
 {
-    printf("\n%-30s %10s %10s %10s %10s\n", "Benchmark", "Mean(ns)", "Median", "StdDev", "P99");
-    printf("%-30s %10s %10s %10s %10s\n", "─────────", "────────", "──────", "──────", "───");
-    for (size_t i = 0; i < _bench.count; i++)
+    if (fnmatch(glob, name, 0) == 0)
+        return 1;
+    for (const char *slash = strchr(name, '/'); slash; slash = strchr(slash + 1, '/'))
     {
-        bench_entry_t *e = &_bench.entries[i];
-        printf("%-30s %10.1f %10.1f %10.1f %10.1f\n",
-               e->name, e->stats.mean_ns, e->stats.median_ns, e->stats.stddev_ns, e->stats.p99_ns);
+        char *family = strndup(name, (size_t)(slash - name));
+        const int match = family && fnmatch(glob, family, 0) == 0;
+        free(family);
+        if (match)
+            return 1;
     }
-    printf("\n");
+    return 0;
 }
 
-int bench_main(void)
+static int _filter_match(const _bench_filter_t *f, const char *name)
 {
-    char *env;
-    if ((env = getenv("BENCH_ITERS")))
-        _bench.iters = (uint64_t)atol(env);
-    if ((env = getenv("BENCH_WARMUP")))
-        _bench.warmup = (uint64_t)atol(env);
-    if ((env = getenv("BENCH_CSV")))
-        _bench.csv_file = env;
-    if ((env = getenv("BENCH_QUIET")))
-        _bench.quiet = atoi(env);
-    if (!_bench.quiet)
-        printf("Running %zu benchmarks (%lu iterations, %lu warmup)...\n",
-               _bench.count, (unsigned long)_bench.iters, (unsigned long)_bench.warmup);
+    int included = !f->includes;
+    for (size_t i = 0; i < f->npatterns; i++)
+    {
+        const int match = f->patterns[i].glob ? _glob_family(f->patterns[i].glob, name)
+                                              : regexec(&f->patterns[i].regex, name, 0, NULL, 0) == 0;
+        if (match && f->patterns[i].exclude)
+            return 0;
+        included |= match;
+    }
+    return included;
+}
+
+static int _selected(const char *name)
+{
+    return _filter_match(&_bench.selects, name);
+}
+
+static const char *_big_o[] = {"O(1)", "O(log n)", "O(n)", "O(n log n)", "O(n^2)"};
+
+static double _growth(int m, double n)
+{
+    return m == 0 ? 1.0 : m == 1 ? log2(n) : m == 2 ? n : m == 3 ? n * log2(n) : n * n;
+}
+
+static int _same_family(const bench_entry_t *a, const bench_entry_t *b)
+{
+    return b->threads && (a->desc == b->desc || strcmp(a->desc, b->desc) == 0);
+}
+
+/* Efficiency of each BENCH_THREADED instance against the 1-thread one, which
+ * is registered next to it. */
+static void _scaling(void)
+{
+    bench_entry_t *all = _bench.entries;
     for (size_t i = 0; i < _bench.count; i++)
     {
-        if (!_bench.quiet)
-            printf("  %s\r", _bench.entries[i].name);
-        fflush(stdout);
-        _run_one(&_bench.entries[i]);
+        bench_entry_t *e = &all[i];
+        size_t j = i;
+        while (e->threads && j > 0 && _same_family(e, &all[j - 1]))
+            j--;
+        for (; e->threads && !e->error[0] && !e->skipped && j < _bench.count && _same_family(e, &all[j]); j++)
+            if (all[j].threads == 1 && !all[j].error[0] && !all[j].skipped && all[j].throughput > 0)
+                e->efficiency = e->throughput / (e->threads * all[j].throughput);
     }
+}
+
+/* Fits median ~ a * f(arg) by least squares to each run of consecutive
+ * instances of one BENCH_PARAM and keeps the model with the lowest RMS.
+ * A failed or filtered-out instance ends the run. */
+static void _fit_complexity(void)
+{
+    for (size_t i = 0, j; i < _bench.count; i = j)
+    {
+        bench_entry_t *e = _bench.entries;
+        for (j = i + 1; e[i].has_arg && !e[i].error[0] && !e[i].skipped && j < _bench.count && e[j].has_arg && !e[j].error[0] &&
+                        !e[j].skipped && strcmp(e[j].desc, e[i].desc) == 0;
+             j++)
+            ;
+        if (j - i < 2 || strncmp(e[i].name, "machine/", 8) == 0) /* the machine suite's latency is a staircase */
+            continue;
+        double mean = 0, best = INFINITY;
+        for (size_t k = i; k < j; k++)
+            mean += e[k].stats.median_ns / (j - i);
+        for (int m = 0; m < 5; m++)
+        {
+            double tf = 0, ff = 0, err = 0;
+            for (size_t k = i; k < j; k++)
+                tf += e[k].stats.median_ns * _growth(m, e[k].arg), ff += _growth(m, e[k].arg) * _growth(m, e[k].arg);
+            for (size_t k = i; ff > 0 && k < j; k++)
+                err += pow(e[k].stats.median_ns - tf / ff * _growth(m, e[k].arg), 2);
+            if (ff > 0 && sqrt(err / (j - i)) / mean < best)
+            {
+                best = sqrt(err / (j - i)) / mean;
+                _bench.fit[_bench.nfit].big_o = m;
+                _bench.fit[_bench.nfit].coef = tf / ff;
+                _bench.fit[_bench.nfit].rms = best;
+            }
+        }
+        _bench.fit[_bench.nfit++].name = e[i].desc;
+    }
+}
+
+/* Counter group: cycles, instructions, branch misses, L1D/LLC/dTLB read misses. */
+static void _perf_open(void)
+{
+#ifdef __linux__
+    static const uint64_t cfg[6][2] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    };
+    for (int i = 0; i < 6; i++)
+    {
+        struct perf_event_attr a;
+        memset(&a, 0, sizeof(a));
+        a.size = sizeof(a);
+        a.type = (uint32_t)cfg[i][0];
+        a.config = cfg[i][1];
+        a.disabled = i == 0;
+        a.exclude_kernel = a.exclude_hv = 1;
+        a.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        _bench.perf_fd[i] = (int)syscall(SYS_perf_event_open, &a, 0, -1, i ? _bench.perf_fd[0] : -1, 0);
+        if (_bench.perf_fd[0] < 0)
+        {
+            if (!_bench.quiet)
+                fprintf(stderr, "warning: hardware counters unavailable: %s\n", strerror(errno));
+            return;
+        }
+        if (_bench.perf_fd[i] >= 0 && ioctl(_bench.perf_fd[i], PERF_EVENT_IOC_ID, &_bench.perf_id[i]) < 0)
+            _bench.perf_id[i] = 0;
+    }
+#else
     if (!_bench.quiet)
-        _print_results();
-    _write_csv();
-    if (!_bench.quiet)
-        printf("Results: %s\n", _bench.csv_file);
-    return 0;
+        fprintf(stderr, "warning: hardware counters need Linux perf_event_open\n");
+#endif
+}
+
+static void _perf_start(void)
+{
+#ifdef __linux__
+    if (_bench.perf_fd[0] < 0)
+        return;
+    ioctl(_bench.perf_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_bench.perf_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+static void _perf_ctl(int enable)
+{
+#ifdef __linux__
+    if (_bench.perf_fd[0] >= 0)
+        ioctl(_bench.perf_fd[0], enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void)enable;
+#endif
+}
+
+static void _perf_stop(bench_counters_t *c, uint64_t calls)
+{
+    double v[6] = {NAN, NAN, NAN, NAN, NAN, NAN};
+#ifdef __linux__
+    uint64_t buf[3 + 2 * 6];
+    if (_bench.perf_fd[0] >= 0)
+    {
+        ioctl(_bench.perf_fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        /* nr, time_enabled, time_running, {value, id}[nr]; scaled for multiplexing */
+        if (read(_bench.perf_fd[0], buf, sizeof(buf)) >= (ssize_t)(3 * sizeof(uint64_t)) && buf[2] && calls)
+            for (uint64_t k = 0; k < buf[0] && k < 6; k++)
+                for (int i = 0; i < 6; i++)
+                    if (_bench.perf_fd[i] >= 0 && _bench.perf_id[i] == buf[4 + 2 * k])
+                        v[i] = (double)buf[3 + 2 * k] * buf[1] / buf[2] / calls;
+    }
+#else
+    (void)calls;
+#endif
+    c->cycles = v[0];
+    c->instructions = v[1];
+    c->branch_misses = v[2];
+    c->l1d_misses = v[3];
+    c->llc_misses = v[4];
+    c->dtlb_misses = v[5];
+    c->ipc = v[1] / v[0];
+    c->branch_mpki = 1000.0 * v[2] / v[1];
+    c->l1d_mpki = 1000.0 * v[3] / v[1];
+    c->llc_mpki = 1000.0 * v[4] / v[1];
+    c->dtlb_mpki = 1000.0 * v[5] / v[1];
+}
+
+static size_t _hist_index(uint64_t v)
+{
+    if (v < BENCH_HIST_SUB)
+        return (size_t)v;
+    unsigned e = 63u - (unsigned)__builtin_clzll(v) - BENCH_HIST_SUB_BITS;
+    return (size_t)(e + 1) * BENCH_HIST_SUB + (size_t)((v >> e) - BENCH_HIST_SUB);
+}
+
+static void _hist_range(size_t i, uint64_t *lo, uint64_t *hi)
+{
+    unsigned e = i < BENCH_HIST_SUB ? 0 : (unsigned)(i / BENCH_HIST_SUB) - 1;
+    *lo = i < BENCH_HIST_SUB ? i : (uint64_t)(i % BENCH_HIST_SUB + BENCH_HIST_SUB) << e;
+    *hi = *lo + ((1ULL << e) - 1);
+}
+
+static void _hist_record(_bench_hist_t *h, uint64_t v)
+{
+    h->counts[_hist_index(v)]++;
+    h->n++;
+    h->min = v < h->min ? v : h->min;
+    h->max = v > h->max ? v : h->max;
+    double d = (double)v - h->mean;
+    h->mean += d / (double)h->n;
+    h->m2 += d * ((double)v - h->mean);
+}
+
+/* Adds every sample recorded in from to into (Chan et al. for the moments). */
+static void _hist_merge(_bench_hist_t *into, const _bench_hist_t *from)
+{
+    if (!from->n)
+        return;
+    for (size_t i = 0; i < BENCH_HIST_BUCKETS; i++)
+        into->counts[i] += from->counts[i];
+    const double n = (double)into->n, m = (double)from->n, d = from->mean - into->mean;
+    into->mean += d * m / (n + m);
+    into->m2 += from->m2 + d * d * n * m / (n + m);
+    into->n += from->n;
+    into->min = from->min < into->min ? from->min : into->min;
+    into->max = from->max > into->max ? from->max : into->max;
+}
+
+/* Bounds of the bucket holding the sample at rank, clamped to [min, max]. */
+static void _hist_bounds(const _bench_hist_t *h, uint64_t rank, uint64_t *lo, uint64_t *hi)
+{
+    uint64_t seen = 0;
+    size_t i = 0;
+    while (i < BENCH_HIST_BUCKETS - 1 && (seen += h->counts[i]) <= rank)
+        i++;
+    _hist_range(i, lo, hi);
+    *lo = *lo < h->min ? h->min : *lo;
+    *hi = *hi > h->max ? h->max : *hi;
+}
+
+/* Midpoint of the bucket holding rank floor(n*q). */
+static double _hist_quantile(const _bench_hist_t *h, double q)
+{
+    uint64_t lo, hi;
+    _hist_bounds(h, (uint64_t)((double)h->n * q), &lo, &hi);
+    return ((double)lo + (double)hi) / 2.0;
+}
+
+/* Ranks bounding a distribution-free 95% CI of the median: the median's rank
+ * is Binomial(n, 1/2), so n/2 +- 1.96 * sqrt(n/4). */
+static void _median_ci(size_t n, size_t *lo, size_t *hi)
+{
+    const double half = 0.98 * sqrt((double)n), mid = n / 2.0;
+    *lo = mid - half > 0 ? (size_t)floor(mid - half) : 0;
+    *hi = mid + half < n - 1.0 ? (size_t)ceil(mid + half) : n - 1;
+}
+
+/* Half-width over the median, never under half a tick: a CI collapsed onto
+ * one tick value is the timer's resolution, not a precise median. */
+static double _rel_error(double lo, double hi, double median, double tick)
+{
+    return median > 0 ? fmax(hi - lo, tick) / (2.0 * median) : NAN;
+}
+
+/* CI widened to whole buckets, so it never claims more than the histogram holds. */
+static double _hist_error(const _bench_hist_t *h)
+{
+    size_t rlo, rhi;
+    uint64_t lo, hi, unused;
+    _median_ci(h->n, &rlo, &rhi);
+    _hist_bounds(h, rlo, &lo, &unused);
+    _hist_bounds(h, rhi, &unused, &hi);
+    return _rel_error((double)lo, (double)hi, _hist_quantile(h, 0.5), 1.0);
+}
+
+/* Radix selection of up to 11 ascending ranks r[] among the values in
+ * [lo, lo + range]: one pass counts the top 16 bits of the range, a second
+ * gathers only the bins holding a rank, and those are refined recursively.
+ * Tick totals cluster tightly, so the first pass is usually exact. */
+static void _select(const uint64_t *v, size_t n, uint64_t lo, uint64_t range, const size_t *r, size_t nr,
+                    uint64_t *out)
+{
+    unsigned sh = 0;
+    while ((range >> sh) >> 16)
+        sh++;
+    size_t bins = (size_t)(range >> sh) + 1, *cnt = calloc(bins, sizeof(size_t));
+    size_t bin[11], first[12], size[11], below[11], fill[11] = {0}, ng = 0, seen = 0, b = 0, total = 0;
+    for (size_t i = 0; cnt && i < n; i++)
+        if (v[i] - lo <= range)
+            cnt[(v[i] - lo) >> sh]++;
+    for (size_t k = 0; cnt && k < nr; k++)
+    {
+        while (seen + cnt[b] <= r[k])
+            seen += cnt[b++];
+        if (!sh)
+            out[k] = lo + b;
+        else if (!ng || bin[ng - 1] != b)
+            bin[ng] = b, first[ng] = k, size[ng] = cnt[b], below[ng++] = seen, total += cnt[b];
+    }
+    first[ng] = nr;
+    uint64_t *buf = ng ? malloc(total * sizeof(uint64_t)) : NULL, *g[11];
+    if (!cnt || (ng && !buf))
+        for (size_t k = 0; k < nr; k++)
+            out[k] = lo; /* out of memory */
+    if (buf)
+    {
+        memset(cnt, 0, bins * sizeof(size_t));
+        for (size_t j = 0; j < ng; j++)
+            cnt[bin[j]] = j + 1, g[j] = j ? g[j - 1] + size[j - 1] : buf;
+        for (size_t i = 0; i < n; i++)
+        {
+            size_t j = v[i] - lo <= range ? cnt[(v[i] - lo) >> sh] : 0;
+            if (j)
+                g[j - 1][fill[j - 1]++] = v[i];
+        }
+        for (size_t j = 0; j < ng; j++)
+        {
+            size_t sub[11];
+            for (size_t k = first[j]; k < first[j + 1]; k++)
+                sub[k - first[j]] = r[k] - below[j];
+            _select(g[j], size[j], lo + ((uint64_t)bin[j] << sh), (1ULL << sh) - 1, sub, first[j + 1] - first[j],
+                    out + first[j]);
+        }
+        free(buf);
+    }
+    free(cnt);
+}
+
+/* Order statistics at up to 11 ranks in any order (sorted here for _select). */
+static void _quantiles(const uint64_t *v, size_t n, const size_t *r, size_t nr, uint64_t *out)
+{
+    uint64_t lo = UINT64_MAX, hi = 0, sorted_out[11];
+    size_t idx[11], sorted[11];
+    for (size_t i = 0; i < nr; i++)
+    {
+        size_t j = i;
+        for (; j > 0 && r[idx[j - 1]] > r[i]; j--)
+            idx[j] = idx[j - 1];
+        idx[j] = i;
+    }
+    for (size_t i = 0; i < nr; i++)
+        sorted[i] = r[idx[i]];
+    for (size_t i = 0; i < n; i++)
+        lo = v[i] < lo ? v[i] : lo, hi = v[i] > hi ? v[i] : hi;
+    _select(v, n, lo, hi - lo, sorted, nr, sorted_out);
+    for (size_t i = 0; i < nr; i++)
+        out[idx[i]] = sorted_out[i];
+}
+
+static size_t _bin_index(uint64_t d)
+{
+    if (d < BENCH_BIN_SUB)
+        return (size_t)d;
+    unsigned e = 63u - (unsigned)__builtin_clzll(d) - BENCH_BIN_SUB_BITS;
+    return (size_t)(e + 1) * BENCH_BIN_SUB + (size_t)((d >> e) - BENCH_BIN_SUB);
+}
+
+static double _bin_center(size_t i)
+{
+    unsigned e = i < BENCH_BIN_SUB ? 0 : (unsigned)(i / BENCH_BIN_SUB) - 1;
+    uint64_t lo = i < BENCH_BIN_SUB ? i : (uint64_t)(i % BENCH_BIN_SUB + BENCH_BIN_SUB) << e;
+    return (double)lo + (double)((1ULL << e) - 1) / 2.0;
+}
+
+/* xoshiro256**; the state is fixed so reruns resample alike */
+static double _rand(uint64_t *s)
+{
+    uint64_t r = s[1] * 5, t = s[1] << 17;
+    r = ((r << 7) | (r >> 57)) * 9;
+    s[2] ^= s[0], s[3] ^= s[1], s[1] ^= s[2], s[0] ^= s[3], s[2] ^= t, s[3] = (s[3] << 45) | (s[3] >> 19);
+    return (double)(r >> 11) * 0x1.0p-53;
+}
+
+/* Poisson(c): product of uniforms for small c, rounded normal for large c */
+static uint64_t _poisson(uint64_t *s, uint64_t c)
+{
+    static double exp_neg[16];
+    if (exp_neg[0] == 0)
+        for (int i = 0; i < 16; i++)
+            exp_neg[i] = exp(-i);
+    if (c < 16)
+    {
+        uint64_t k = 0;
+        for (double p = _rand(s); p > exp_neg[c]; p *= _rand(s))
+            k++;
+        return k;
+    }
+    double x = c + sqrt((double)c) * sqrt(-2.0 * log(1.0 - _rand(s))) * cos(6.283185307179586 * _rand(s));
+    return x > 0 ? (uint64_t)(x + 0.5) : 0;
+}
+
+static int _cmp_dbl(const void *a, const void *b)
+{
+    double d = *(const double *)a - *(const double *)b;
+    return (d > 0) - (d < 0);
+}
+
+/* Bootstrap CIs and Tukey outliers from a binned distribution: ascending
+ * values in ns per call with their counts, and the quartiles q1, q3. */
+static void _distribution(const double *v, const uint64_t *c, size_t k, double q1, double q3, bench_stats_t *st)
+{
+    const double iqr = q3 - q1, fence[4] = {q1 - 3 * iqr, q1 - 1.5 * iqr, q3 + 1.5 * iqr, q3 + 3 * iqr};
+    double all[3] = {0}, in[3] = {0};
+    st->outliers_low_severe = st->outliers_low_mild = st->outliers_high_mild = st->outliers_high_severe = 0;
+    for (size_t j = 0; j < k; j++)
+    {
+        double d = v[j] - q1, m[3] = {(double)c[j], c[j] * d, c[j] * d * d};
+        int inlier = 0;
+        if (v[j] < fence[0])
+            st->outliers_low_severe += c[j];
+        else if (v[j] < fence[1])
+            st->outliers_low_mild += c[j];
+        else if (v[j] > fence[3])
+            st->outliers_high_severe += c[j];
+        else if (v[j] > fence[2])
+            st->outliers_high_mild += c[j];
+        else
+            inlier = 1;
+        for (int i = 0; i < 3; i++)
+            all[i] += m[i], in[i] += inlier ? m[i] : 0;
+    }
+    double var_all = all[2] / all[0] - (all[1] / all[0]) * (all[1] / all[0]);
+    double var_in = in[0] > 0 ? in[2] / in[0] - (in[1] / in[0]) * (in[1] / in[0]) : 0;
+    st->outlier_variance = var_all > 0 ? fmax(1.0 - var_in / var_all, 0.0) : 0.0;
+
+    /* Poisson bootstrap: each sample's multiplicity is Poisson(1), so a bin
+     * of c samples draws Poisson(c), and a resample is one sweep over bins. */
+    uint64_t rng[4] = {0x9e3779b97f4a7c15ULL, 0xbf58476d1ce4e5b9ULL, 0x94d049bb133111ebULL, 0x2545f4914f6cdd1dULL};
+    uint64_t *w = malloc(k * sizeof(uint64_t));
+    double *mean = malloc(2 * BENCH_BOOTSTRAP * sizeof(double)), *med = mean + BENCH_BOOTSTRAP;
+    for (int b = 0; w && mean && k && b < BENCH_BOOTSTRAP;)
+    {
+        uint64_t total = 0, seen;
+        double sum = 0;
+        for (size_t j = 0; j < k; j++)
+            w[j] = _poisson(rng, c[j]), total += w[j], sum += w[j] * v[j];
+        if (!total)
+            continue;
+        size_t j = 0;
+        for (seen = w[0]; seen <= total / 2; seen += w[++j])
+            ;
+        mean[b] = sum / total, med[b++] = v[j];
+    }
+    if (w && mean && k)
+    {
+        qsort(mean, BENCH_BOOTSTRAP, sizeof(double), _cmp_dbl);
+        qsort(med, BENCH_BOOTSTRAP, sizeof(double), _cmp_dbl);
+        size_t lo = (size_t)(BENCH_BOOTSTRAP * 0.025), hi = (size_t)(BENCH_BOOTSTRAP * 0.975);
+        st->mean_ci_low_ns = mean[lo], st->mean_ci_high_ns = mean[hi];
+        st->median_ci_low_ns = med[lo], st->median_ci_high_ns = med[hi];
+    }
+    free(w);
+    free(mean);
+}
+
+/* Per thread, so threaded bodies can pause too */
+static __thread struct
+{
+    uint64_t t0, paused, n, total;
+} _tp;
+
+void bench_pause(void) { _tp.t0 = _ticks_stop(); }
+void bench_resume(void)
+{
+    _tp.paused += _ticks_start() - _tp.t0;
+    _tp.n++;
+}
+
+/* Work per call declared by the running entry, 0 while undeclared */
+static struct
+{
+    uint64_t bytes, items;
+    bench_user_counter_t user[BENCH_MAX_USER_COUNTERS];
+    int n;
+    const char *key[BENCH_MAX_USER_COUNTERS]; /* the pointer each name was interned from */
+    pthread_mutex_t lock;
+} _work = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+void bench_set_bytes(uint64_t bytes) { __atomic_store_n(&_work.bytes, bytes, __ATOMIC_RELAXED); }
+void bench_set_items(uint64_t items) { __atomic_store_n(&_work.items, items, __ATOMIC_RELAXED); }
+/* A name not yet seen at this address: looked up by content under the
+ * lock, and published only once its slot is filled. */
+static __attribute__((noinline)) void _counter_intern(const char *name, double value)
+{
+    pthread_mutex_lock(&_work.lock);
+    int i = 0;
+    while (i < _work.n && strcmp(_work.user[i].name, name) != 0)
+        i++;
+    if (i < BENCH_MAX_USER_COUNTERS)
+        _work.user[i].value = value;
+    if (i == _work.n && i < BENCH_MAX_USER_COUNTERS)
+    {
+        snprintf(_work.user[i].name, sizeof(_work.user[i].name), "%s", name);
+        _work.key[i] = name;
+        __atomic_store_n(&_work.n, i + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&_work.lock);
+}
+
+/* Lock-free once interned; a value equal to the last is not stored again, so
+ * threads share the line rather than bouncing it. */
+void bench_set_counter(const char *name, double value)
+{
+    const int n = __atomic_load_n(&_work.n, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++)
+        if (_work.key[i] == name)
+        {
+            double *v = &_work.user[i].value, old;
+            __atomic_load(v, &old, __ATOMIC_RELAXED);
+            if (old != value)
+                __atomic_store(v, &value, __ATOMIC_RELAXED);
+            return;
+        }
+    _counter_intern(name, value);
+}
+
+/* Samples are raw tick totals per batch; nothing but the subtraction sits in
+ * the timed loop, and conversion is left to the statistics. Paused ticks come
+ * out after the stop read. */
+static void _measure(bench_fn_t fn, uint64_t batch, uint64_t n, uint64_t *samples)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        _tp.paused = _tp.n = 0;
+        uint64_t t0 = _ticks_start();
+        for (uint64_t j = 0; j < batch; j++)
+            fn();
+        uint64_t t = _ticks_stop() - t0, p = _tp.paused + _tp.n * _bench.pause_fix;
+        samples[i] = t > p ? t - p : 0;
+        _tp.total += _tp.n;
+    }
+}
+
+static __attribute__((noinline)) void _bench_empty(void) { __asm__ volatile(""); }
+
+/* Harness cost per call: an empty body timed through _measure at this batch. */
+static const double *_overhead(uint64_t batch)
+{
+    unsigned k = 0;
+    while ((1ULL << k) < batch)
+        k++;
+    if (!(_bench.overhead_done >> k & 1))
+    {
+        uint64_t samples[BENCH_OVERHEAD_SAMPLES];
+        const size_t r[2] = {BENCH_OVERHEAD_SAMPLES / 2, (size_t)(BENCH_OVERHEAD_SAMPLES * 0.99)};
+        uint64_t q[2];
+        bench_fn_t volatile fn = _bench_empty;
+        _measure(fn, batch, BENCH_OVERHEAD_SAMPLES / 10, samples);
+        _measure(fn, batch, BENCH_OVERHEAD_SAMPLES, samples);
+        _quantiles(samples, BENCH_OVERHEAD_SAMPLES, r, 2, q);
+        _bench.overhead[k][0] = q[0] * _bench.ns_per_tick / batch;
+        _bench.overhead[k][1] = q[1] * _bench.ns_per_tick / batch;
+        _bench.overhead_done |= 1ULL << k;
+    }
+    return _bench.overhead[k];
+}
+
+static __attribute__((noinline)) void _bench_pause_pair(void)
+{
+    bench_pause();
+    bench_resume();
+}
+
+/* Residual ticks of one pause/resume pair over the empty body, at batch 1. */
+static void _pause_cost(void)
+{
+    uint64_t samples[BENCH_OVERHEAD_SAMPLES], q;
+    const size_t r = BENCH_OVERHEAD_SAMPLES / 2;
+    bench_fn_t volatile fn = _bench_pause_pair;
+    const double empty = _overhead(1)[0] / _bench.ns_per_tick;
+    _measure(fn, 1, BENCH_OVERHEAD_SAMPLES / 10, samples);
+    _measure(fn, 1, BENCH_OVERHEAD_SAMPLES, samples);
+    _quantiles(samples, BENCH_OVERHEAD_SAMPLES, &r, 1, &q);
+    _bench.pause_cost = q > empty ? q - empty : 0.0;
+    _bench.pause_fix = _bench.subtract ? (uint64_t)llround(_bench.pause_cost) : 0;
+}
+
+void bench_set_suite_fixture(bench_fn_t setup, bench_fn_t teardown)
+{
+    _bench.suite_setup = setup;
+    _bench.suite_teardown = teardown;
+}
+
+static void _add_fixture(const char *name, bench_fn_t setup, bench_fn_t teardown, int each)
+{
+    const char *copy = _copy(name, strlen(name));
+    if (copy && _bench.nfix == _bench.fix_cap)
+    {
+        const size_t cap = _bench.fix_cap ? _bench.fix_cap * 2 : 16;
+        __typeof__(_bench.fix) grown = (__typeof__(_bench.fix))realloc(_bench.fix, cap * sizeof(*_bench.fix));
+        if (grown)
+            _bench.fix = grown, _bench.fix_cap = cap;
+    }
+    if (!copy || _bench.nfix == _bench.fix_cap || _names_add(&_bench.fix_names[each], copy, _bench.nfix) < 0)
+    {
+        fprintf(stderr, "warning: out of memory for the fixture of %s; it will not run\n", name);
+        return;
+    }
+    _bench.fix[_bench.nfix].name = copy;
+    _bench.fix[_bench.nfix].setup = setup;
+    _bench.fix[_bench.nfix].teardown = teardown;
+    _bench.fix[_bench.nfix++].each = each;
+}
+void bench_set_fixture(const char *name, bench_fn_t setup, bench_fn_t teardown) { _add_fixture(name, setup, teardown, 0); }
+void bench_set_iteration_fixture(const char *name, bench_fn_t setup, bench_fn_t teardown)
+{
+    _add_fixture(name, setup, teardown, 1);
+}
+
+/* Matched at run time, so constructor order does not matter: the first
+ * registered of the fixtures for the name, or for a family of a parameter
+ * instance (each '/'-prefix of its name). */
+static int _find_fixture(const bench_entry_t *e, int each)
+{
+    long found = _names_find(&_bench.fix_names[each], e->name, strlen(e->name));
+    for (const char *slash = strchr(e->name, '/'); e->has_arg && slash; slash = strchr(slash + 1, '/'))
+    {
+        const long i = _names_find(&_bench.fix_names[each], e->name, (size_t)(slash - e->name));
+        found = i >= 0 && (found < 0 || i < found) ? i : found;
+    }
+    return (int)found;
+}
+
+/* One call between the iteration fixture's setup and teardown, both paused. */
+static void _each(void)
+{
+    bench_pause();
+    if (_bench.each_setup)
+        _bench.each_setup();
+    bench_resume();
+    _bench.each_fn();
+    bench_pause();
+    if (_bench.each_teardown)
+        _bench.each_teardown();
+    bench_resume();
+}
+
+static uint64_t _calibrate_batch(bench_fn_t fn)
+{
+    uint64_t batch = 1;
+    while (_bench.batch_ns && batch < BENCH_MAX_BATCH)
+    {
+        uint64_t t0 = bench_now();
+        _tp.paused = 0;
+        for (uint64_t j = 0; j < batch; j++)
+            fn();
+        if (bench_now() - t0 >= _bench.batch_ns + (uint64_t)(_tp.paused * _bench.ns_per_tick))
+            break;
+        batch *= 2;
+    }
+    return batch;
+}
+
+/* Mann-Kendall S: concordant minus discordant pairs, +-n(n-1)/2 when monotonic */
+static int _kendall_s(const double *v, size_t n)
+{
+    int s = 0;
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i + 1; j < n; j++)
+            s += (v[j] > v[i]) - (v[j] < v[i]);
+    return s;
+}
+
+/* Windows agree: medians within +-tolerance of their middle, spreads within
+ * that band or their own mean, and neither strictly rising or falling. */
+static int _steady(const double *medians, const double *spreads, size_t n, double tolerance)
+{
+    double lo = medians[0], hi = medians[0], slo = spreads[0], shi = spreads[0], mean = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        lo = fmin(lo, medians[i]), hi = fmax(hi, medians[i]);
+        slo = fmin(slo, spreads[i]), shi = fmax(shi, spreads[i]);
+        mean += spreads[i] / (double)n;
+    }
+    const int monotonic = (int)(n * (n - 1) / 2);
+    const double band = tolerance * (lo + hi);
+    if (n < 3 || abs(_kendall_s(medians, n)) == monotonic || abs(_kendall_s(spreads, n)) == monotonic)
+        return 0;
+    return hi - lo <= band && shi - slo <= fmax(band, mean);
+}
+
+/* BENCH_WARMUP=auto: windows of BENCH_WARMUP_SAMPLES samples, each about
+ * BENCH_WARMUP_SAMPLE_NS long, until the last BENCH_WARMUP_WINDOWS agree or
+ * BENCH_WARMUP_MAX_TIME passes. Page faults, cache and predictor training
+ * and frequency ramps show up as drifting medians, so a slow start gets a
+ * longer warmup. The batch calibration's calls count too. */
+static void _warmup_auto(bench_fn_t fn, bench_warmup_t *w)
+{
+    const uint64_t saved = _bench.batch_ns, start = bench_now();
+    _bench.batch_ns = BENCH_WARMUP_SAMPLE_NS;
+    const uint64_t batch = _calibrate_batch(fn);
+    _bench.batch_ns = saved;
+    const size_t ranks[3] = {BENCH_WARMUP_SAMPLES / 4, BENCH_WARMUP_SAMPLES / 2, 3 * BENCH_WARMUP_SAMPLES / 4};
+    uint64_t samples[BENCH_WARMUP_SAMPLES], q[3];
+    double medians[BENCH_WARMUP_WINDOWS], spreads[BENCH_WARMUP_WINDOWS];
+    memset(w, 0, sizeof(*w));
+    w->automatic = 1;
+    w->iterations = 2 * batch - 1;
+    w->median_ns = NAN;
+    while (!w->steady && (double)(bench_now() - start) * 1e-9 < _bench.warmup_max_time)
+    {
+        _measure(fn, batch, BENCH_WARMUP_SAMPLES, samples);
+        _quantiles(samples, BENCH_WARMUP_SAMPLES, ranks, 3, q);
+        size_t k = (size_t)w->windows;
+        if (k >= BENCH_WARMUP_WINDOWS) /* full: drop the oldest */
+        {
+            k = BENCH_WARMUP_WINDOWS - 1;
+            memmove(medians, medians + 1, k * sizeof(double));
+            memmove(spreads, spreads + 1, k * sizeof(double));
+        }
+        medians[k] = (double)q[1] / (double)batch;
+        spreads[k] = (double)(q[2] - q[0]) / (double)batch;
+        w->median_ns = medians[k] * _bench.ns_per_tick;
+        w->iterations += BENCH_WARMUP_SAMPLES * batch;
+        w->windows++;
+        w->steady = w->windows >= BENCH_WARMUP_WINDOWS &&
+                    _steady(medians, spreads, BENCH_WARMUP_WINDOWS, _bench.warmup_tol);
+    }
+    w->seconds = (double)(bench_now() - start) * 1e-9;
+}
+
+/* Relative half-width of the median's CI over n raw samples after subtraction. */
+static double _sample_error(const uint64_t *samples, size_t n, double sub_ticks)
+{
+    size_t r[3] = {0, n / 2, 0};
+    uint64_t v[3];
+    _median_ci(n, &r[0], &r[2]);
+    _quantiles(samples, n, r, 3, v);
+    return _rel_error(fmax(v[0] - sub_ticks, 0.0), fmax(v[2] - sub_ticks, 0.0), fmax(v[1] - sub_ticks, 0.0), 1.0);
+}
+
+/* Adaptive run length: how many more samples to take after n, or 0 to stop
+ * once the median is precise enough or the time budget is spent. Rounds grow
+ * geometrically so the precision checks stay linear overall. */
+static uint64_t _next_round(uint64_t n, uint64_t t0, double err)
+{
+    const double elapsed = (bench_now() - t0) * 1e-9;
+    if (elapsed >= _bench.max_time || (elapsed >= _bench.min_time && err <= _bench.precision))
+        return 0;
+    uint64_t more = n / 2 > BENCH_MIN_SAMPLES ? n / 2 : BENCH_MIN_SAMPLES;
+    double fit = elapsed > 0 ? (_bench.max_time - elapsed) / elapsed * n : (double)more;
+    return fit < (double)more ? (uint64_t)fit + 1 : more;
+}
+
+static void _alloc_open(_bench_alloc_t *a)
+{
+    memset(a, 0, sizeof(*a));
+    a->c = _bench.alloc ? _bench.alloc() : NULL;
+}
+
+static void _alloc_begin(_bench_alloc_t *a)
+{
+    if (!a->c)
+        return;
+    a->start = *a->c;
+    a->c->peak = a->c->live;
+}
+
+static void _alloc_end(_bench_alloc_t *a)
+{
+    if (!a->c)
+        return;
+    a->allocs += a->c->allocs - a->start.allocs;
+    a->frees += a->c->frees - a->start.frees;
+    a->bytes += a->c->bytes - a->start.bytes;
+    if (a->net + a->c->peak - a->start.live > a->peak)
+        a->peak = a->net + a->c->peak - a->start.live;
+    a->net += a->c->live - a->start.live;
+}
+
+typedef struct
+{
+    pthread_t id;
+    pthread_barrier_t *bar;
+    pthread_mutex_t *gate; /* held until every worker exists */
+    const int *failed;
+    bench_fn_t fn;
+    uint64_t batch, *samples, t0, t1, pauses;
+    _bench_alloc_t alloc;
+    int index;
+} _bench_worker_t;
+
+#ifdef __linux__
+static int _read_line(const char *path, char *buf, size_t size)
+{
+    FILE *f = fopen(path, "r");
+    char *ok = f ? fgets(buf, (int)size, f) : NULL;
+    if (f)
+        fclose(f);
+    if (ok)
+        buf[strcspn(buf, "\n")] = '\0';
+    return ok ? 0 : -1;
+}
+#endif
+
+/* Stable mode pins the main thread, optionally to SCHED_FIFO, and locks
+ * memory before anything is calibrated; the machine checks run regardless. */
+static void _stabilize(void)
+{
+    const int want_cpu = _bench.cpu, want_fifo = _bench.fifo;
+    _bench.cpu = -1, _bench.fifo = 0, _bench.smt = -1, _bench.load = NAN;
+#ifdef __linux__
+    int cpu = sched_getcpu(), err;
+    char path[96], line[256];
+    if (_bench.stable)
+    {
+        const int target = want_cpu >= 0 ? want_cpu : cpu;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        if (target >= 0 && target < CPU_SETSIZE)
+            CPU_SET(target, &one);
+        if (sched_getaffinity(0, sizeof(_allowed), &_allowed) != 0)
+            CPU_ZERO(&_allowed);
+        if (!(err = pthread_setaffinity_np(pthread_self(), sizeof(one), &one)))
+            _bench.cpu = cpu = target;
+        else
+            fprintf(stderr, "warning: cannot pin to CPU %d: %s\n", target, strerror(err));
+        struct sched_param prio = {.sched_priority = want_fifo};
+        if (want_fifo > 0 && !(err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &prio)))
+            _bench.fifo = want_fifo;
+        else if (want_fifo > 0)
+            fprintf(stderr, "warning: cannot switch to SCHED_FIFO: %s\n", strerror(err));
+        if (!(_bench.locked = mlockall(MCL_CURRENT | MCL_FUTURE) == 0))
+            fprintf(stderr, "warning: mlockall failed: %s (see ulimit -l)\n", strerror(errno));
+    }
+    if (cpu >= 0)
+    {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu);
+        if (_read_line(path, _bench.governor, sizeof(_bench.governor)) != 0)
+            _bench.governor[0] = '\0';
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if (_read_line(path, line, sizeof(line)) == 0)
+        {
+            int lo, hi, used;
+            _bench.smt = -1; /* the list ("2,6" or "0-1") includes cpu itself */
+            for (char *p = line; sscanf(p, "%d%n", &lo, &used) == 1; p += *p == ',')
+            {
+                p += used;
+                hi = lo;
+                if (*p == '-' && sscanf(p + 1, "%d%n", &hi, &used) == 1)
+                    p += 1 + used;
+                _bench.smt += hi - lo + 1;
+            }
+        }
+    }
+    if (_read_line("/proc/loadavg", line, sizeof(line)) == 0)
+        _bench.load = strtod(line, NULL);
+#else
+    (void)want_cpu, (void)want_fifo;
+    if (_bench.stable)
+        fprintf(stderr, "warning: stable mode is Linux-only\n");
+#endif
+    if (!_bench.stable || _bench.quiet)
+        return;
+    if (_bench.governor[0] && strcmp(_bench.governor, "performance") != 0)
+        fprintf(stderr, "warning: CPU frequency governor is '%s'; 'performance' keeps the clock fixed\n",
+                _bench.governor);
+    if (_bench.smt > 0)
+        fprintf(stderr, "warning: %d SMT sibling(s) share this core; keep them idle or disable SMT\n", _bench.smt);
+    if (_bench.load > 1.0)
+        fprintf(stderr, "warning: load average %.2f; other work is competing for the CPUs\n", _bench.load);
+}
+
+/* Touch (and in stable mode lock) a sample buffer so first-touch page faults
+ * are not timed. */
+static void _prefault(void *p, size_t bytes)
+{
+    if (!p)
+        return;
+    memset(p, 0, bytes);
+#ifdef __linux__
+    if (_bench.stable)
+        mlock(p, bytes);
+#endif
+}
+
+/* Round-robin over the CPUs this process may use; when stable mode pinned
+ * the creating thread, over the ones it started with. Without pin only that
+ * inherited pinning is undone. */
+static void _pin(int index)
+{
+#ifdef __linux__
+    cpu_set_t all = _allowed, one;
+    if (_bench.cpu < 0 && sched_getaffinity(0, sizeof(all), &all) != 0)
+        return;
+    if (!_bench.pin || CPU_COUNT(&all) == 0)
+    {
+        if (CPU_COUNT(&all))
+            pthread_setaffinity_np(pthread_self(), sizeof(all), &all);
+        return;
+    }
+    for (int cpu = 0, k = index % CPU_COUNT(&all); cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &all) && k-- == 0)
+        {
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+            return;
+        }
+#else
+    (void)index;
+#endif
+}
+
+static void *_worker(void *arg)
+{
+    _bench_worker_t *w = (_bench_worker_t *)arg;
+    bench_thread = w->index;
+    pthread_mutex_lock(w->gate);
+    pthread_mutex_unlock(w->gate);
+    if (*w->failed)
+        return NULL;
+    if (_bench.pin || _bench.cpu >= 0)
+        _pin(w->index);
+    for (uint64_t i = 0; i < _bench.warmup; i++)
+        w->fn();
+    _alloc_open(&w->alloc);
+    pthread_barrier_wait(w->bar);
+    w->t0 = bench_now();
+    _alloc_begin(&w->alloc);
+    _measure(w->fn, w->batch, _bench.iters, w->samples);
+    _alloc_end(&w->alloc);
+    w->t1 = bench_now();
+    w->pauses = _tp.total;
+    return NULL;
+}
+
+/* Workers warm up, meet on a barrier, then each fills its own slice of
+ * samples, so merging takes no locks. Returns calls per second from the
+ * first start to the last finish, or 0 if a thread could not be started.
+ * Heap activity adds up into alloc, peaks too, as an upper bound. */
+static double _workers(bench_fn_t fn, int threads, uint64_t batch, uint64_t *samples, _bench_alloc_t *alloc)
+{
+    _bench_worker_t *w = (_bench_worker_t *)calloc(threads, sizeof(_bench_worker_t));
+    pthread_barrier_t bar;
+    pthread_mutex_t gate = PTHREAD_MUTEX_INITIALIZER;
+    int made = 0, failed = !w || pthread_barrier_init(&bar, NULL, threads) != 0;
+    if (failed)
+    {
+        free(w);
+        return 0;
+    }
+    pthread_mutex_lock(&gate);
+    for (; made < threads && !failed; made++)
+    {
+        w[made] = (_bench_worker_t){.bar = &bar, .gate = &gate, .failed = &failed, .fn = fn, .batch = batch,
+                                    .samples = samples + made * _bench.iters, .index = made};
+        failed = pthread_create(&w[made].id, NULL, _worker, &w[made]) != 0;
+    }
+    made -= failed;
+    pthread_mutex_unlock(&gate);
+    uint64_t first = UINT64_MAX, last = 0;
+    for (int i = 0; i < made; i++)
+    {
+        pthread_join(w[i].id, NULL);
+        first = w[i].t0 < first ? w[i].t0 : first;
+        last = w[i].t1 > last ? w[i].t1 : last;
+        _tp.total += w[i].pauses;
+        alloc->c = w[i].alloc.c ? w[i].alloc.c : alloc->c;
+        alloc->allocs += w[i].alloc.allocs;
+        alloc->frees += w[i].alloc.frees;
+        alloc->bytes += w[i].alloc.bytes;
+        alloc->net += w[i].alloc.net;
+        alloc->peak += w[i].alloc.peak;
+    }
+    pthread_barrier_destroy(&bar);
+    free(w);
+    return failed || last <= first ? 0 : (double)threads * _bench.iters * batch * 1e9 / (last - first);
+}
+
+static void _raw_put(const void *p, size_t size)
+{
+    if (fwrite(p, 1, size, _bench.raw) != size)
+        _bench.raw_failed = 1;
+}
+
+static void _raw_begin(const char *name, uint64_t batch, double sub_ticks, int threads, int width)
+{
+    static const char pad[8];
+    if (_bench.nraw == _bench.raw_cap)
+    {
+        const size_t cap = _bench.raw_cap ? _bench.raw_cap * 2 : 64;
+        _bench_raw_t *grown = (_bench_raw_t *)realloc(_bench.raw_index, cap * sizeof(_bench_raw_t));
+        if (!grown)
+        {
+            fprintf(stderr, "warning: out of memory for the raw sample index; %s is incomplete\n",
+                    _bench.samples_file);
+            fclose(_bench.raw);
+            _bench.raw = NULL;
+            return;
+        }
+        _bench.raw_index = grown, _bench.raw_cap = cap;
+    }
+    _raw_put(pad, (size_t)((8 - ftello(_bench.raw) % 8) % 8));
+    _bench_raw_t *r = &_bench.raw_index[_bench.nraw++];
+    memset(r, 0, sizeof(*r));
+    strncpy(r->name, name, BENCH_MAX_NAME - 1);
+    if (strlen(name) >= BENCH_MAX_NAME)
+        fprintf(stderr, "warning: raw samples of %s are indexed under its first %d bytes\n", name,
+                BENCH_MAX_NAME - 1);
+    r->offset = (uint64_t)ftello(_bench.raw);
+    r->batch = batch;
+    r->subtract = sub_ticks;
+    r->threads = (uint32_t)(threads > 1 ? threads : 1);
+    r->width = _bench.compress ? 8 : (uint32_t)width;
+    r->encoding = _bench.compress != 0;
+    _bench.raw_prev = 0;
+}
+
+static void _raw_write(const uint64_t *v, size_t n)
+{
+    if (!_bench.raw)
+        return;
+    _bench_raw_t *r = &_bench.raw_index[_bench.nraw - 1];
+    unsigned char buf[4096 + 10];
+    size_t used = 0;
+    r->count += n;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (r->encoding)
+        {
+            const int64_t d = (int64_t)(v[i] - _bench.raw_prev);
+            uint64_t z = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+            _bench.raw_prev = v[i];
+            for (; z >= 0x80; z >>= 7)
+                buf[used++] = (unsigned char)(z | 0x80);
+            buf[used++] = (unsigned char)z;
+        }
+        else
+        {
+            memcpy(buf + used, &v[i], r->width); /* low bytes first */
+            used += r->width;
+        }
+        if (used >= 4096 || i + 1 == n)
+        {
+            _raw_put(buf, used);
+            r->bytes += used;
+            used = 0;
+        }
+    }
+}
+
+/* One whole block, u32 when every sample fits. */
+static void _raw_block(const char *name, uint64_t batch, double sub_ticks, int threads, const uint64_t *v, size_t n)
+{
+    uint64_t max = 0;
+    for (size_t i = 0; i < n; i++)
+        max = v[i] > max ? v[i] : max;
+    _raw_begin(name, batch, sub_ticks, threads, max > UINT32_MAX ? 8 : 4);
+    _raw_write(v, n);
+}
+
+static int _raw_close(void)
+{
+    static const char pad[8];
+    _raw_put(pad, (size_t)((8 - ftello(_bench.raw) % 8) % 8));
+    const uint64_t at = (uint64_t)ftello(_bench.raw);
+    const uint32_t head[2] = {1, (uint32_t)_bench.nraw};
+    _raw_put(_bench.raw_index, _bench.nraw * sizeof(_bench_raw_t));
+    if (fseeko(_bench.raw, 0, SEEK_SET) != 0)
+        _bench.raw_failed = 1;
+    _raw_put("BENCHRAW", 8);
+    _raw_put(head, sizeof(head));
+    _raw_put(&_bench.ns_per_tick, 8);
+    _raw_put(&at, 8);
+    if (fclose(_bench.raw) != 0)
+        _bench.raw_failed = 1;
+    _bench.raw = NULL;
+    free(_bench.raw_index);
+    _bench.raw_index = NULL;
+    return _bench.raw_failed ? -1 : 0;
+}
+
+/* Statistics of a histogram of per-batch ticks, k ns per tick and call. */
+static void _hist_stats(const _bench_hist_t *h, double k, bench_stats_t *s)
+{
+    s->min_ns = h->min * k;
+    s->max_ns = h->max * k;
+    s->mean_ns = h->mean * k;
+    s->stddev_ns = sqrt(h->m2 / h->n) * k;
+    s->median_ns = _hist_quantile(h, 0.5) * k;
+    s->p95_ns = _hist_quantile(h, 0.95) * k;
+    s->p99_ns = _hist_quantile(h, 0.99) * k;
+    s->p999_ns = _hist_quantile(h, 0.999) * k;
+    s->p9999_ns = _hist_quantile(h, 0.9999) * k;
+    s->median_rel_error = _hist_error(h);
+    size_t nb = 0;
+    for (size_t i = 0; i < BENCH_HIST_BUCKETS; i++)
+        nb += h->counts[i] != 0;
+    uint64_t *cnt = malloc(nb * sizeof(uint64_t)), lo, hi;
+    double *val = malloc(nb * sizeof(double));
+    for (size_t i = 0, j = 0; cnt && val && i < BENCH_HIST_BUCKETS; i++)
+        if (h->counts[i])
+        {
+            _hist_range(i, &lo, &hi);
+            lo = lo < h->min ? h->min : lo;
+            hi = hi > h->max ? h->max : hi;
+            val[j] = ((double)lo + (double)hi) / 2.0 * k;
+            cnt[j++] = h->counts[i];
+        }
+    if (cnt && val)
+        _distribution(val, cnt, nb, _hist_quantile(h, 0.25) * k, _hist_quantile(h, 0.75) * k, s);
+    free(cnt);
+    free(val);
+}
+
+/* Exact statistics of n raw per-batch ticks, less sub_ticks each, at k ns
+ * per tick and call. */
+static void _sample_stats(const uint64_t *samples, uint64_t n, double sub_ticks, double k, bench_stats_t *s)
+{
+    size_t r[11] = {0, n / 2, (size_t)(n * 0.95), (size_t)(n * 0.99),
+                    (size_t)(n * 0.999), (size_t)(n * 0.9999), n - 1, 0, 0, n / 4, 3 * n / 4};
+    _median_ci(n, &r[7], &r[8]);
+    uint64_t v[11];
+    _quantiles(samples, n, r, 11, v);
+    double q[11];
+    for (int i = 0; i < 11; i++)
+        q[i] = fmax(v[i] - sub_ticks, 0.0) * k;
+    s->min_ns = q[0], s->median_ns = q[1], s->p95_ns = q[2], s->p99_ns = q[3];
+    s->p999_ns = q[4], s->p9999_ns = q[5], s->max_ns = q[6];
+    s->median_rel_error = _rel_error(q[7], q[8], q[1], k);
+    /* Moments about the median so the one-pass variance does not cancel;
+     * four accumulators break the add chain, and the signed difference
+     * converts cheaply unless the zero clamp is actually needed. */
+    double c = q[1] / k, sum[4] = {0}, sq[4] = {0};
+    int clamp = v[0] < sub_ticks;
+    for (uint64_t i = 0; i < n; i++)
+    {
+        double d = clamp ? fmax(samples[i] - sub_ticks, 0.0) - c : (double)(int64_t)(samples[i] - v[1]);
+        sum[i & 3] += d;
+        sq[i & 3] += d * d;
+    }
+    double m = (sum[0] + sum[1] + sum[2] + sum[3]) / n;
+    double var = (sq[0] + sq[1] + sq[2] + sq[3]) / n - m * m;
+    s->mean_ns = (c + m) * k;
+    s->stddev_ns = sqrt(var > 0 ? var : 0) * k;
+    /* Bootstrap and outliers run over log-linear bins above the minimum */
+    size_t nb = _bin_index(v[6] - v[0]) + 1, j = 0;
+    uint64_t *cnt = calloc(nb, sizeof(uint64_t));
+    double *val = malloc(nb * sizeof(double));
+    for (uint64_t i = 0; cnt && val && i < n; i++)
+        cnt[_bin_index(samples[i] - v[0])]++;
+    for (size_t i = 0; cnt && val && i < nb; i++)
+        if (cnt[i])
+            val[j] = fmax(v[0] + _bin_center(i) - sub_ticks, 0.0) * k, cnt[j++] = cnt[i];
+    if (cnt && val)
+        _distribution(val, cnt, j, q[9], q[10], s);
+    free(cnt);
+    free(val);
+}
+
+/* Keeps a repetition's samples for the pooled statistics. */
+static void _pool_samples(const uint64_t *v, uint64_t n)
+{
+    _bench_pool_t *p = _bench.pool;
+    if (!p || p->lost)
+        return;
+    if (p->n + n > p->cap)
+    {
+        const uint64_t cap = p->cap * 2 > p->n + n ? p->cap * 2 : p->n + n;
+        uint64_t *grown = (uint64_t *)realloc(p->v, (cap ? cap : 1) * sizeof(uint64_t));
+        if (!grown)
+        {
+            free(p->v);
+            p->v = NULL;
+            p->lost = 1;
+            return;
+        }
+        p->v = grown, p->cap = cap;
+    }
+    memcpy(p->v + p->n, v, n * sizeof(uint64_t));
+    p->n += n;
+}
+
+/* Cold runs (BENCH_COLD), as the library's src/cold.c: before every call,
+ * either flush the lines of the buffers the entry declared and touch one
+ * line per page of 32 MB, past any TLB's reach, or sweep a buffer of twice
+ * the last-level cache (32-256 MB, small pages), which does both. */
+#define _BENCH_COLD_LINE 64
+#define _BENCH_COLD_PAGE 4096
+#define _BENCH_COLD_MIN (32ull << 20)
+#define _BENCH_COLD_MAX (256ull << 20)
+
+static struct
+{
+    char *buf;
+    uint64_t bytes;
+    struct
+    {
+        const char *p;
+        size_t bytes;
+    } declared[BENCH_MAX_COLD_BUFFERS];
+    int n;
+} _cold;
+static volatile uint64_t _cold_sink;
+
+static void _reported_caches(uint64_t *bytes);
+
+void bench_set_cold_buffer(const void *ptr, size_t bytes)
+{
+    pthread_mutex_lock(&_work.lock);
+    int known = 0; /* a range declared again counts once */
+    for (int i = 0; i < _cold.n; i++)
+        known |= _cold.declared[i].p == (const char *)ptr && _cold.declared[i].bytes == bytes;
+    if (!known && _cold.n < BENCH_MAX_COLD_BUFFERS && ptr && bytes)
+    {
+        _cold.declared[_cold.n].p = (const char *)ptr;
+        _cold.declared[_cold.n++].bytes = bytes;
+    }
+    pthread_mutex_unlock(&_work.lock);
+}
+
+static int _cold_flushing(void)
+{
+#if defined(__x86_64__) || defined(__aarch64__)
+    return _cold.n > 0;
+#else
+    return 0;
+#endif
+}
+
+static void _cold_sweep(uint64_t bytes, size_t stride)
+{
+    uint64_t sum = 0;
+    for (size_t at = 0; at < bytes; at += stride)
+        sum += *(const volatile uint64_t *)(_cold.buf + at);
+    _cold_sink = sum;
+}
+
+static void _cold_evict(void)
+{
+    if (!_cold_flushing())
+    {
+        _cold_sweep(_cold.bytes, _BENCH_COLD_LINE);
+        return;
+    }
+    for (int i = 0; i < _cold.n; i++)
+        for (uintptr_t at = (uintptr_t)_cold.declared[i].p & ~(uintptr_t)(_BENCH_COLD_LINE - 1);
+             at < (uintptr_t)_cold.declared[i].p + _cold.declared[i].bytes; at += _BENCH_COLD_LINE)
+        {
+#if defined(__x86_64__)
+            __asm__ volatile("clflush (%0)" : : "r"(at) : "memory");
+#elif defined(__aarch64__)
+            __asm__ volatile("dc civac, %0" : : "r"(at) : "memory");
+#endif
+        }
+#if defined(__x86_64__)
+    __asm__ volatile("mfence" : : : "memory");
+#elif defined(__aarch64__)
+    __asm__ volatile("dsb ish" : : : "memory");
+#endif
+    _cold_sweep(_BENCH_COLD_MIN, _BENCH_COLD_PAGE);
+}
+
+/* Every call timed alone right after an eviction, which is timed apart and
+ * left out of the sample. Not with an iteration fixture, whose setup would
+ * run after the eviction and warm the data again. */
+static void _cold_run(bench_entry_t *e, bench_fn_t fn)
+{
+    int err = 0;
+    if (fn == _each)
+    {
+        fprintf(stderr, "warning: %s: not run cold; an iteration fixture would refill the caches after each "
+                        "eviction\n",
+                e->name);
+        return;
+    }
+    if (!_cold.buf)
+    {
+        uint64_t caches[BENCH_MAX_CACHE_LEVELS] = {0}, bytes = 0;
+        void *p = NULL;
+        _reported_caches(caches);
+        for (int i = 0; i < BENCH_MAX_CACHE_LEVELS; i++)
+            bytes = 2 * caches[i] > bytes ? 2 * caches[i] : bytes;
+        bytes = bytes < _BENCH_COLD_MIN ? _BENCH_COLD_MIN : bytes > _BENCH_COLD_MAX ? _BENCH_COLD_MAX : bytes;
+        if ((err = posix_memalign(&p, _BENCH_COLD_PAGE, bytes)) == 0)
+        {
+#ifdef __linux__
+            madvise(p, bytes, MADV_NOHUGEPAGE); /* huge pages would cover it with a few TLB entries */
+#endif
+            _prefault(p, bytes); /* written, so no page is the shared zero page */
+            _cold.buf = (char *)p, _cold.bytes = bytes;
+        }
+    }
+    if (!_cold.buf)
+    {
+        fprintf(stderr, "warning: %s: not run cold; cannot allocate the eviction buffer: %s\n", e->name,
+                strerror(err));
+        return;
+    }
+    const uint64_t n = _bench.cold_iters ? _bench.cold_iters : 1;
+    uint64_t *samples = (uint64_t *)malloc(2 * n * sizeof(uint64_t));
+    if (!samples)
+    {
+        fprintf(stderr, "warning: %s: out of memory for the cold run\n", e->name);
+        return;
+    }
+    uint64_t *evictions = samples + n;
+    _prefault(samples, 2 * n * sizeof(uint64_t));
+    const double *ovh = _overhead(1), sub_ticks = _bench.subtract ? ovh[0] / _bench.ns_per_tick : 0.0;
+    const uint64_t pauses = _tp.total; /* the hot run's */
+    for (uint64_t i = 0; i < n; i++)
+    {
+        const uint64_t t = _ticks_start();
+        _cold_evict();
+        evictions[i] = _ticks_stop() - t;
+        _measure(fn, 1, 1, samples + i);
+    }
+    _tp.total = pauses;
+    if (_bench.raw)
+    {
+        char name[BENCH_MAX_NAME];
+        snprintf(name, sizeof(name), "%s [cold]", e->name);
+        _raw_block(name, 1, sub_ticks, 0, samples, n);
+    }
+    const size_t mid = n / 2;
+    uint64_t evict;
+    _quantiles(evictions, n, &mid, 1, &evict);
+    bench_stats_t *s = &e->cold_stats;
+    _sample_stats(samples, n, sub_ticks, _bench.ns_per_tick, s);
+    free(samples);
+    s->iterations = n;
+    s->batch_size = 1;
+    s->overhead_ns = ovh[0];
+    s->noise_floor_ns = ovh[1];
+    const double cyc = _bench.cyc_per_tick / _bench.ns_per_tick;
+    s->min_cycles = s->min_ns * cyc;
+    s->median_cycles = s->median_ns * cyc;
+    s->mean_cycles = s->mean_ns * cyc;
+    s->p99_cycles = s->p99_ns * cyc;
+    s->optimized_away = s->median_ns + (_bench.subtract ? ovh[0] : 0.0) <= ovh[1];
+    e->cold = 1;
+    e->cold_flushed = _cold_flushing();
+    e->cold_slowdown = e->stats.median_ns > 0 ? s->median_ns / e->stats.median_ns : NAN;
+    e->evict_ns = (double)evict * _bench.ns_per_tick;
+    e->evict_bytes = e->cold_flushed ? _BENCH_COLD_MIN : _cold.bytes;
+}
+
+/* splitmix64; the same seed gives the library's schedule and arrivals */
+static uint64_t _splitmix(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Ticks to the next call due, mean apart on average. */
+static double _arrival(double mean, uint64_t *state)
+{
+    return _bench.poisson ? -log(((double)(_splitmix(state) >> 11) + 0.5) * 0x1.0p-53) * mean : mean;
+}
+
+/* Open-loop runs (BENCH_RATE), as the library's: calls come due on a fixed
+ * schedule, evenly spaced or with exponential gaps, and are served in order,
+ * so one that has to wait behind a slow call records the wait (latency from
+ * when it was due, the coordinated omission correction). Calls still queued
+ * at the end are recorded with their wait so far; paused time shifts the
+ * rest of the schedule. Both histograms are in ticks. */
+static void _open_loop(bench_fn_t fn, double rate, double sub_ticks, uint64_t *state, _bench_hist_t *lat,
+                       _bench_hist_t *svc, bench_rate_step_t *step)
+{
+    const double mean = 1e9 / rate / _bench.ns_per_tick, ns = _bench.ns_per_tick;
+    const uint64_t sub = (uint64_t)llround(sub_ticks), t0 = _ticks_start();
+    uint64_t end = t0 + (uint64_t)(_bench.rate_time * 1e9 / ns), now = t0, last = t0, shift = 0;
+    memset(lat, 0, sizeof(*lat));
+    memset(svc, 0, sizeof(*svc));
+    lat->min = svc->min = UINT64_MAX;
+    memset(step, 0, sizeof(*step));
+    for (double due = (double)t0; due < (double)end; due += _arrival(mean, state))
+    {
+        const uint64_t at = (uint64_t)due;
+        while ((now = _ticks_start()) < at)
+            ;
+        if (now >= end)
+        {
+            _hist_record(lat, now - at);
+            step->unsent++;
+            continue;
+        }
+        _tp.paused = _tp.n = 0;
+        fn();
+        last = _ticks_stop();
+        const uint64_t p = _tp.paused + _tp.n * _bench.pause_fix;
+        _hist_record(lat, last - at > p + sub ? last - at - p - sub : 0);
+        _hist_record(svc, last - now > p + sub ? last - now - p - sub : 0);
+        step->calls++;
+        due += (double)p, end += p, shift += p;
+    }
+    step->rate = rate;
+    step->achieved = (double)step->calls * 1e9 / ((double)((last > end ? last : end) - t0 - shift) * ns);
+    step->p50_ns = lat->n ? _hist_quantile(lat, 0.5) * ns : 0.0;
+    step->p99_ns = lat->n ? _hist_quantile(lat, 0.99) * ns : 0.0;
+    step->p999_ns = lat->n ? _hist_quantile(lat, 0.999) * ns : 0.0;
+    step->max_ns = lat->n ? (double)lat->max * ns : 0.0;
+}
+
+/* One run at BENCH_RATE, or a sweep: halve from half the closed-loop
+ * throughput until a rate meets the SLO, then bisect to within 2%; give up
+ * below BENCH_RATE_MIN_CALLS calls a run. */
+static void _open_loop_run(bench_entry_t *e, bench_fn_t fn)
+{
+    _bench_hist_t *h = (_bench_hist_t *)calloc(4, sizeof(_bench_hist_t)), *run = h, *kept = h + 2;
+    if (!h)
+    {
+        fprintf(stderr, "warning: %s: out of memory for the open-loop run\n", e->name);
+        return;
+    }
+    const double *ovh = _overhead(1), sub_ticks = _bench.subtract ? ovh[0] / _bench.ns_per_tick : 0.0;
+    e->slo_ns = _bench.slo_ns > 0 ? _bench.slo_ns : _bench.sweep ? 10.0 * (e->stats.p99_ns + ovh[1]) : NAN;
+    e->max_rate = NAN;
+    e->nsteps = 0;
+    uint64_t state = _bench.seed;
+    const uint64_t pauses = _tp.total; /* the hot run's */
+    if (!_bench.sweep)
+    {
+        _open_loop(fn, _bench.rate, sub_ticks, &state, kept, kept + 1, &e->run);
+        e->run.met = isnan(e->slo_ns) || e->run.p99_ns <= e->slo_ns;
+    }
+    else if (e->stats.mean_ns > 0)
+    {
+        double lo = 0.0, hi = 1e9 / e->stats.mean_ns, rate = hi / 2;
+        while (e->nsteps < BENCH_MAX_RATE_STEPS && (lo == 0.0 || hi - lo > 0.02 * hi) &&
+               (e->nsteps == 0 || rate * _bench.rate_time >= BENCH_RATE_MIN_CALLS))
+        {
+            bench_rate_step_t *step = &e->steps[e->nsteps++];
+            _open_loop(fn, rate, sub_ticks, &state, run, run + 1, step);
+            step->met = step->p99_ns <= e->slo_ns;
+            if (step->met || lo == 0.0)
+            {
+                _bench_hist_t *t = kept;
+                kept = run, run = t;
+                e->run = *step;
+            }
+            if (step->met)
+                lo = rate;
+            else
+                hi = rate;
+            rate = lo > 0.0 ? (lo + hi) / 2 : rate / 2;
+        }
+        e->max_rate = lo;
+    }
+    _tp.total = pauses;
+    if (kept->n)
+    {
+        _hist_stats(kept, _bench.ns_per_tick, &e->ol_latency);
+        _hist_stats(kept + 1, _bench.ns_per_tick, &e->ol_service);
+        e->ol_latency.iterations = kept->n;
+        e->ol_service.iterations = kept[1].n;
+        e->ol_latency.batch_size = e->ol_service.batch_size = 1;
+        e->ol_latency.overhead_ns = e->ol_service.overhead_ns = ovh[0];
+        e->ol_latency.noise_floor_ns = e->ol_service.noise_floor_ns = ovh[1];
+        e->open_loop = e->run.rate > 0;
+    }
+    free(h);
+}
+
+static void _run_one(bench_entry_t *e)
+{
+    bench_arg = e->arg;
+    _work.bytes = _work.items = 0;
+    _work.n = 0;
+    _cold.n = 0;
+    e->cold = e->open_loop = 0;
+    if (!_bench.pool)
+        e->reps = 0;
+    const int fix = _find_fixture(e, 0), each = _find_fixture(e, 1);
+    bench_fn_t fn = e->fn;
+    if (each >= 0)
+    {
+        _bench.each_fn = e->fn;
+        _bench.each_setup = _bench.fix[each].setup;
+        _bench.each_teardown = _bench.fix[each].teardown;
+        fn = _each;
+    }
+    if (fix >= 0 && _bench.fix[fix].setup)
+        _bench.fix[fix].setup();
+    if (_bench.warmup_auto)
+        _warmup_auto(fn, &e->warmup);
+    else
+    {
+        const uint64_t warmup_start = bench_now();
+        for (uint64_t i = 0; i < _bench.warmup; i++)
+            fn();
+        e->warmup = (bench_warmup_t){.iterations = _bench.warmup, .median_ns = NAN,
+                                     .seconds = (double)(bench_now() - warmup_start) * 1e-9};
+    }
+    const uint64_t batch = _bench.pool && _bench.pool->batch ? _bench.pool->batch : _calibrate_batch(fn);
+    const double *ovh = _overhead(batch), sub = _bench.subtract ? ovh[0] : 0.0;
+    const double to_ticks = (double)batch / _bench.ns_per_tick, sub_ticks = sub * to_ticks;
+    bench_stats_t *s = &e->stats;
+    _bench_hist_t *h = NULL;
+    if (_bench.stream || _bench.hist_file)
+    {
+        free(_bench.hist[e - _bench.entries]);
+        if (!(h = _bench.hist[e - _bench.entries] = (_bench_hist_t *)calloc(1, sizeof(_bench_hist_t))))
+        {
+            fprintf(stderr, "warning: %s: out of memory for the histogram\n", e->name);
+            snprintf(e->error, sizeof(e->error), "out of memory for the histogram");
+            if (fix >= 0 && _bench.fix[fix].teardown)
+                _bench.fix[fix].teardown();
+            return;
+        }
+        h->min = UINT64_MAX;
+    }
+    const int adaptive = _bench.max_time > 0 && !e->threads;
+    const uint64_t t0 = bench_now();
+    uint64_t n = 0;
+    _bench_alloc_t alloc;
+    _alloc_open(&alloc);
+    _tp.total = 0;
+    e->efficiency = NAN;
+    if (_bench.stream && !e->threads)
+    {
+        uint64_t chunk[BENCH_STREAM_CHUNK];
+        _prefault(chunk, sizeof(chunk));
+        if (_bench.raw)
+            _raw_begin(e->name, batch, sub_ticks, 1, 8); /* the largest sample is not known up front */
+        _perf_start();
+        for (uint64_t want = adaptive ? BENCH_MIN_SAMPLES : _bench.iters, m; want; want -= m)
+        {
+            m = want < BENCH_STREAM_CHUNK ? want : BENCH_STREAM_CHUNK;
+            _alloc_begin(&alloc);
+            _measure(fn, batch, m, chunk);
+            _alloc_end(&alloc);
+            _perf_ctl(0);
+            if (_bench.raw)
+                _raw_write(chunk, m);
+            for (uint64_t i = 0; i < m; i++)
+                _hist_record(h, chunk[i] > sub_ticks ? (uint64_t)llround(chunk[i] - sub_ticks) : 0);
+            n += m;
+            if (want == m && adaptive)
+                want += _next_round(n, t0, _hist_error(h));
+            _perf_ctl(1);
+        }
+        _perf_stop(&e->counters, n * batch);
+        _hist_stats(h, 1.0 / to_ticks, s);
+    }
+    else
+    {
+        uint64_t cap = e->threads ? _bench.iters * e->threads : adaptive ? BENCH_MIN_SAMPLES : _bench.iters;
+        uint64_t *samples = malloc(cap * sizeof(uint64_t));
+        if (!samples)
+        {
+            fprintf(stderr, "warning: %s: out of memory for %llu samples\n", e->name, (unsigned long long)cap);
+            snprintf(e->error, sizeof(e->error), "out of memory for samples");
+            if (fix >= 0 && _bench.fix[fix].teardown)
+                _bench.fix[fix].teardown();
+            return;
+        }
+        _prefault(samples, cap * sizeof(uint64_t));
+        _perf_start();
+        if (e->threads && !(e->throughput = _workers(fn, e->threads, batch, samples, &alloc)))
+        {
+            fprintf(stderr, "warning: %s: could not start %d threads\n", e->name, e->threads);
+            snprintf(e->error, sizeof(e->error), "could not start %d threads", e->threads);
+            free(samples);
+            if (fix >= 0 && _bench.fix[fix].teardown)
+                _bench.fix[fix].teardown();
+            return;
+        }
+        n = e->threads ? cap : 0;
+        for (uint64_t t = 0; t < (uint64_t)e->threads; t++)
+        {
+            const size_t r[2] = {_bench.iters / 2, (size_t)(_bench.iters * 0.99)};
+            uint64_t q[2];
+            _quantiles(samples + t * _bench.iters, _bench.iters, r, 2, q);
+            e->slowest_median_ns = fmax(e->slowest_median_ns, fmax(q[0] - sub_ticks, 0.0) / to_ticks);
+            e->slowest_p99_ns = fmax(e->slowest_p99_ns, fmax(q[1] - sub_ticks, 0.0) / to_ticks);
+        }
+        for (uint64_t want = e->threads ? 0 : cap; want;)
+        {
+            _alloc_begin(&alloc);
+            _measure(fn, batch, want, samples + n);
+            _alloc_end(&alloc);
+            n += want;
+            if (!adaptive)
+                break;
+            _perf_ctl(0);
+            want = _next_round(n, t0, _sample_error(samples, n, sub_ticks));
+            if (n + want > cap)
+            {
+                const uint64_t old = cap;
+                uint64_t *grown = realloc(samples, (cap = cap * 2 > n + want ? cap * 2 : n + want) * sizeof(uint64_t));
+                if (grown)
+                    samples = grown, _prefault(grown + old, (cap - old) * sizeof(uint64_t));
+                else
+                    want = 0; /* keep what was collected */
+            }
+            _perf_ctl(1);
+        }
+        _perf_stop(&e->counters, e->threads ? 0 : n * batch); /* counters follow the calling thread */
+        if (_bench.raw)
+            _raw_block(e->name, batch, sub_ticks, e->threads, samples, n);
+        for (uint64_t i = 0; h && i < n; i++)
+            _hist_record(h, samples[i] > sub_ticks ? (uint64_t)llround(samples[i] - sub_ticks) : 0);
+        _pool_samples(samples, n);
+        _sample_stats(samples, n, sub_ticks, 1.0 / to_ticks, s);
+        free(samples);
+    }
+    if (_bench.cold && !e->threads && _filter_match(&_bench.colds, e->name))
+        _cold_run(e, fn);
+    if ((_bench.rate > 0 || _bench.sweep) && !e->threads)
+        _open_loop_run(e, fn);
+    if (fix >= 0 && _bench.fix[fix].teardown)
+        _bench.fix[fix].teardown();
+    s->iterations = n;
+    s->batch_size = batch;
+    s->pauses = _tp.total ? (double)_tp.total / (double)(n * batch) : 0.0;
+    s->pause_overhead_ns = s->pauses * _bench.pause_cost * _bench.ns_per_tick;
+    if (!e->threads)
+        e->throughput = s->mean_ns > 0 ? 1e9 / s->mean_ns : NAN;
+    e->bytes_per_second = _work.bytes ? (double)_work.bytes * e->throughput : NAN;
+    e->items_per_second = _work.items ? (double)_work.items * e->throughput : NAN;
+    e->ns_per_item = _work.items ? s->median_ns / (double)_work.items : NAN;
+    for (e->nuser = 0; e->nuser < _work.n; e->nuser++)
+    {
+        e->user[e->nuser] = _work.user[e->nuser];
+        e->user[e->nuser].per_second = _work.user[e->nuser].value * e->throughput;
+    }
+    s->overhead_ns = ovh[0];
+    s->noise_floor_ns = ovh[1];
+    const double cyc = _bench.cyc_per_tick / _bench.ns_per_tick;
+    s->min_cycles = s->min_ns * cyc;
+    s->median_cycles = s->median_ns * cyc;
+    s->mean_cycles = s->mean_ns * cyc;
+    s->p99_cycles = s->p99_ns * cyc;
+    s->optimized_away = s->median_ns + sub <= ovh[1];
+    const double per_call = n ? 1.0 / (double)(n * batch) : NAN;
+    e->alloc_tracked = alloc.c != NULL;
+    e->allocs = alloc.c ? (double)alloc.allocs * per_call : NAN;
+    e->frees = alloc.c ? (double)alloc.frees * per_call : NAN;
+    e->alloc_bytes = alloc.c ? (double)alloc.bytes * per_call : NAN;
+    e->peak_bytes = alloc.peak > 0 ? (uint64_t)alloc.peak : 0;
+    e->leaks = alloc.allocs > alloc.frees ? alloc.allocs - alloc.frees : 0;
+}
+
+/* Pipe helpers for _isolate: 0 on success, -1 on EOF or error, -2 once the
+ * deadline (bench_now() time, 0 for none) has passed. */
+static int _read_all(int fd, void *buf, size_t size, uint64_t deadline)
+{
+    for (char *p = (char *)buf; size;)
+    {
+        const uint64_t now = bench_now();
+        if (deadline && now >= deadline)
+            return -2;
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, deadline ? (int)((deadline - now) / 1000000) + 1 : -1);
+        if (ready < 0 && errno != EINTR)
+            return -1;
+        if (ready <= 0)
+            continue;
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+static int _write_all(int fd, const void *buf, size_t size)
+{
+    for (const char *p = (const char *)buf; size;)
+    {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/* State a forked child has to take again for itself. */
+static void _after_fork(void)
+{
+#ifdef __linux__
+    if (_bench.locked) /* memory locks are not inherited */
+        mlockall(MCL_CURRENT | MCL_FUTURE);
+    if (_bench.perf_fd[0] >= 0) /* the inherited group counts the parent */
+    {
+        for (int i = 0; i < 6; i++)
+            if (_bench.perf_fd[i] >= 0)
+                close(_bench.perf_fd[i]);
+        _bench.perf_fd[0] = -1;
+        _perf_open();
+    }
+#endif
+}
+
+/* An entry whose error is set has no counters or throughput. */
+static void _fail(bench_entry_t *e)
+{
+    e->throughput = e->efficiency = NAN;
+    e->bytes_per_second = e->items_per_second = e->ns_per_item = NAN;
+    e->nuser = e->alloc_tracked = 0;
+    bench_counters_t *c = &e->counters;
+    c->cycles = c->instructions = c->branch_misses = c->l1d_misses = c->llc_misses = c->dtlb_misses = NAN;
+    c->ipc = c->branch_mpki = c->l1d_mpki = c->llc_mpki = c->dtlb_mpki = NAN;
+    fprintf(stderr, "warning: %s: %s\n", e->name, e->error);
+}
+
+/* BENCH_ISOLATE: the entry runs in a forked child that writes it and its
+ * histogram back over a pipe, so heap and cache state do not carry over and
+ * a crash, exit() or BENCH_TIMEOUT only fails this entry. */
+static void _isolate(bench_entry_t *e)
+{
+    const size_t idx = e - _bench.entries;
+    const int want_hist = _bench.stream || _bench.hist_file;
+    int fds[2], status = 0, got = -1;
+    pid_t pid = -1;
+    fflush(stdout);
+    fflush(stderr);
+    if (pipe(fds) == 0 && (pid = fork()) < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        _after_fork();
+        _run_one(e);
+        fflush(stdout);
+        status = _write_all(fds[1], e, sizeof(*e)) != 0 ||
+                 (want_hist && _write_all(fds[1], _bench.hist[idx], sizeof(_bench_hist_t)) != 0);
+        _exit(status);
+    }
+    if (pid > 0)
+    {
+        close(fds[1]);
+        const uint64_t deadline = _bench.timeout > 0 ? bench_now() + (uint64_t)(_bench.timeout * 1e9) : 0;
+        bench_entry_t *r = (bench_entry_t *)malloc(sizeof(bench_entry_t));
+        _bench_hist_t *h = want_hist ? (_bench_hist_t *)malloc(sizeof(_bench_hist_t)) : NULL;
+        got = r ? _read_all(fds[0], r, sizeof(*r), deadline) : -1;
+        if (!got && want_hist)
+            got = h ? _read_all(fds[0], h, sizeof(*h), deadline) : -1;
+        close(fds[0]);
+        if (got == -2)
+            kill(pid, SIGKILL);
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+            ;
+        if (!got && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        {
+            *e = *r;
+            free(_bench.hist[idx]);
+            _bench.hist[idx] = h;
+            free(r);
+            return;
+        }
+        free(r);
+        free(h);
+    }
+    if (pid < 0)
+        snprintf(e->error, sizeof(e->error), "fork failed: %s", strerror(errno));
+    else if (got == -2)
+        snprintf(e->error, sizeof(e->error), "timed out after %.3g s", _bench.timeout);
+    else if (WIFSIGNALED(status))
+        snprintf(e->error, sizeof(e->error), "killed by signal %d (%s)", WTERMSIG(status), strsignal(WTERMSIG(status)));
+    else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+        snprintf(e->error, sizeof(e->error), "exited with status %d", WEXITSTATUS(status));
+    else
+        snprintf(e->error, sizeof(e->error), "exited without a result");
+    _fail(e);
+}
+
+/* Shard of every entry BENCH_FILTER selects, -1 for the others: selected
+ * families (consecutive BENCH_PARAM or BENCH_THREADED instances) are dealt
+ * out round-robin in registration order, so fits and scaling never need an
+ * entry from another shard. Everything selected is in shard 0 when
+ * count < 2. Returns how many are selected. */
+static size_t _assign_shards(int count, int *shard)
+{
+    const bench_entry_t *prev = NULL;
+    size_t selected = 0;
+    for (size_t i = 0, family = 0; i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        if (!_selected(e->name))
+        {
+            shard[i] = -1;
+            continue;
+        }
+        if (prev && !((e->has_arg || e->threads) && (prev->has_arg || prev->threads) &&
+                      strcmp(prev->desc, e->desc) == 0))
+            family++;
+        shard[i] = count > 1 ? (int)(family % (size_t)count) : 0;
+        prev = e;
+        selected++;
+    }
+    return selected;
+}
+
+/* Replaces the last repetition's statistics with those of every repetition
+ * pooled, and the spread of their medians. */
+static void _finish_repeated(bench_entry_t *e, _bench_pool_t *p)
+{
+    bench_stats_t *s = &e->stats;
+    const double last_median = s->median_ns, last_throughput = e->throughput;
+    const double *ovh = _overhead(p->batch), sub = _bench.subtract ? ovh[0] : 0.0;
+    const double to_ticks = (double)p->batch / _bench.ns_per_tick;
+    const int stream = _bench.stream && !e->threads;
+    if (stream ? !p->h : p->lost)
+        fprintf(stderr, "warning: %s: out of memory pooling repetitions; reporting the last one\n", e->name);
+    else
+    {
+        if (stream)
+            _hist_stats(p->h, 1.0 / to_ticks, s);
+        else
+            _sample_stats(p->v, p->n, sub * to_ticks, 1.0 / to_ticks, s);
+        s->iterations = stream ? p->h->n : p->n;
+        s->pauses = p->pauses / (double)(s->iterations * p->batch);
+        s->pause_overhead_ns = s->pauses * _bench.pause_cost * _bench.ns_per_tick;
+        const double cyc = _bench.cyc_per_tick / _bench.ns_per_tick;
+        s->min_cycles = s->min_ns * cyc;
+        s->median_cycles = s->median_ns * cyc;
+        s->mean_cycles = s->mean_ns * cyc;
+        s->p99_cycles = s->p99_ns * cyc;
+        s->optimized_away = s->median_ns + sub <= ovh[1];
+    }
+    const size_t idx = e - _bench.entries;
+    if (p->h)
+    {
+        free(_bench.hist[idx]);
+        _bench.hist[idx] = p->h;
+        p->h = NULL;
+    }
+    double *c = (double *)&e->counters; /* bench_counters_t is all doubles */
+    const double *sum = (const double *)&p->counters;
+    for (size_t i = 0; i < sizeof(e->counters) / sizeof(double); i++)
+        c[i] = sum[i] / e->reps;
+    e->throughput = e->threads ? p->throughput / e->reps : s->mean_ns > 0 ? 1e9 / s->mean_ns : NAN;
+    /* The work per call is the same in every repetition; only the rates move */
+    const double rate = last_throughput > 0 ? e->throughput / last_throughput : NAN;
+    e->bytes_per_second *= rate;
+    e->items_per_second *= rate;
+    e->ns_per_item *= last_median > 0 ? s->median_ns / last_median : NAN;
+    for (int k = 0; k < e->nuser; k++)
+        e->user[k].per_second *= rate;
+
+    double sorted[BENCH_MAX_REPETITIONS], total = 0.0, squares = 0.0;
+    memcpy(sorted, e->rep_ns, e->reps * sizeof(double));
+    qsort(sorted, e->reps, sizeof(double), _cmp_dbl);
+    for (int i = 0; i < e->reps; i++)
+        total += sorted[i];
+    e->reps_mean_ns = total / e->reps;
+    for (int i = 0; i < e->reps; i++)
+        squares += (sorted[i] - e->reps_mean_ns) * (sorted[i] - e->reps_mean_ns);
+    e->reps_stddev_ns = e->reps > 1 ? sqrt(squares / (e->reps - 1)) : 0.0;
+    e->reps_median_ns = e->reps % 2 ? sorted[e->reps / 2] : (sorted[e->reps / 2 - 1] + sorted[e->reps / 2]) / 2.0;
+    e->reps_min_ns = sorted[0];
+    e->reps_max_ns = sorted[e->reps - 1];
+}
+
+/* BENCH_REPETITIONS: every round runs each selected entry once in a new
+ * seeded shuffle, so drift over the suite (thermal throttling, turbo decay,
+ * a background job) lands on all of them alike rather than on whichever ran
+ * meanwhile. Entries keep their first batch; stats pool every repetition. */
+static int _run_repeated(const size_t *sel, size_t n)
+{
+    _bench_pool_t *pools = (_bench_pool_t *)calloc(n ? n : 1, sizeof(_bench_pool_t));
+    size_t *order = (size_t *)malloc((n ? n : 1) * sizeof(size_t));
+    uint64_t state = _bench.seed;
+    int failed = 0;
+    if (!pools || !order)
+    {
+        free(pools);
+        free(order);
+        return (int)n;
+    }
+    for (size_t k = 0; k < n; k++)
+        order[k] = k, _bench.entries[sel[k]].reps = 0;
+    for (int round = 0; round < _bench.reps; round++)
+    {
+        for (size_t k = n; k > 1; k--)
+        {
+            const size_t j = (size_t)(_splitmix(&state) % k), t = order[k - 1];
+            order[k - 1] = order[j], order[j] = t;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            _bench_pool_t *p = &pools[order[i]];
+            bench_entry_t *e = &_bench.entries[sel[order[i]]];
+            if (e->error[0])
+                continue;
+            if (!_bench.quiet)
+                printf("  %d/%d %s\r", round + 1, _bench.reps, e->name);
+            fflush(stdout);
+            _bench.pool = p;
+            _run_one(e);
+            _bench.pool = NULL;
+            if (e->error[0])
+                continue;
+            e->rep_ns[e->reps++] = e->stats.median_ns;
+            p->batch = e->stats.batch_size;
+            p->pauses += e->stats.pauses * (double)(e->stats.iterations * e->stats.batch_size);
+            p->throughput += e->throughput;
+            double *sum = (double *)&p->counters;
+            const double *c = (const double *)&e->counters;
+            for (size_t k = 0; k < sizeof(p->counters) / sizeof(double); k++)
+                sum[k] += c[k];
+            const _bench_hist_t *h = _bench.hist[e - _bench.entries];
+            if (h && !p->h && (p->h = (_bench_hist_t *)calloc(1, sizeof(_bench_hist_t))))
+                p->h->min = UINT64_MAX;
+            if (h && p->h)
+                _hist_merge(p->h, h);
+        }
+    }
+    for (size_t k = 0; k < n; k++)
+    {
+        bench_entry_t *e = &_bench.entries[sel[k]];
+        if (e->error[0])
+            failed++;
+        else
+            _finish_repeated(e, &pools[k]);
+        free(pools[k].v);
+        free(pools[k].h);
+    }
+    free(pools);
+    free(order);
+    return failed;
+}
+
+/* Runs the selected entries of shard index out of count, or all of them
+ * when count < 2. */
+static int _run_selected(int index, int count)
+{
+    int failed = 0, *shard = (int *)malloc((_bench.count ? _bench.count : 1) * sizeof(int));
+    size_t *sel = (size_t *)malloc((_bench.count ? _bench.count : 1) * sizeof(size_t)), n = 0;
+    if (!shard || !sel)
+    {
+        fprintf(stderr, "warning: out of memory selecting benchmarks\n");
+        free(shard);
+        free(sel);
+        return 1;
+    }
+    _assign_shards(count, shard);
+    for (size_t i = 0; i < _bench.count; i++)
+        if (!(_bench.entries[i].skipped = shard[i] != (count > 1 ? index : 0)))
+            sel[n++] = i;
+    free(shard);
+    if (_bench.reps > 1 && !_bench.isolate)
+    {
+        failed = _run_repeated(sel, n);
+        free(sel);
+        return failed;
+    }
+    for (size_t k = 0; k < n; k++)
+    {
+        bench_entry_t *e = &_bench.entries[sel[k]];
+        if (!_bench.quiet)
+            printf("  %s\r", e->name);
+        fflush(stdout);
+        if (_bench.isolate)
+            _isolate(e);
+        else
+            _run_one(e);
+        failed += e->error[0] != 0;
+    }
+    free(sel);
+    return failed;
+}
+
+/* Names of the entries a run would execute, one per line (BENCH_LIST) */
+static int _list_selected(void)
+{
+    int *shard = (int *)malloc((_bench.count ? _bench.count : 1) * sizeof(int));
+    if (!shard)
+        return 1;
+    _assign_shards(_bench.shards, shard);
+    for (size_t i = 0; i < _bench.count; i++)
+        if (shard[i] == (_bench.shards > 1 ? _bench.shard : 0))
+            printf("%s\n", _bench.entries[i].name);
+    free(shard);
+    return 0;
+}
+
+/* One CPU per physical core that this process may use, named by the first
+ * CPU of its sibling list; before stable mode pinned it, if it did. */
+static int _cores(int *cpus, int max)
+{
+    int n = 0;
+#ifdef __linux__
+    cpu_set_t all = _allowed;
+    int core[CPU_SETSIZE];
+    if (_bench.cpu < 0 && sched_getaffinity(0, sizeof(all), &all) != 0)
+        return 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && n < max; cpu++)
+    {
+        char path[96], line[256];
+        int first = cpu, seen = 0;
+        if (!CPU_ISSET(cpu, &all))
+            continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if (_read_line(path, line, sizeof(line)) != 0 || sscanf(line, "%d", &first) != 1)
+            first = cpu;
+        for (int i = 0; i < n; i++)
+            seen |= core[i] == first;
+        if (!seen)
+            core[n] = first, cpus[n++] = cpu;
+    }
+#else
+    (void)cpus, (void)max;
+#endif
+    return n;
+}
+
+/* Median ns of a fixed kernel, a dependent multiply chain (clock speed) and a
+ * sweep over 4 MB (shared cache, memory bandwidth), and its CI over median. */
+static double _calibrate(double *rel_error)
+{
+    enum { samples = 33, words = (4 << 20) / sizeof(uint64_t) };
+    uint64_t *buf = (uint64_t *)malloc(words * sizeof(uint64_t)), t[samples], median;
+    const size_t rank = samples / 2;
+    *rel_error = NAN;
+    if (!buf)
+        return NAN;
+    for (size_t i = 0; i < words; i++)
+        buf[i] = i;
+    for (int s = -1; s < samples; s++) /* the first pass warms up */
+    {
+        const uint64_t start = bench_now();
+        uint64_t x = 1;
+        for (int i = 0; i < 200000; i++)
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        for (size_t i = 0; i < words; i += 8)
+            x += buf[i];
+        bench_escape(&x);
+        if (s >= 0)
+            t[s] = bench_now() - start;
+    }
+    free(buf);
+    _quantiles(t, samples, &rank, 1, &median);
+    *rel_error = _sample_error(t, samples, 0.0);
+    return (double)median;
+}
+
+/* Header of the shared memory of BENCH_JOBS; the arrays follow it */
+typedef struct
+{
+    bench_entry_t *entries;
+    int *done;
+    _bench_hist_t *hists; /* NULL unless streaming or writing histograms */
+    double cal[64], cal_error[64];
+} _bench_shared_t;
+
+/* BENCH_JOBS: a forked child per shard, pinned to its own physical core,
+ * writes its entries in place into shared memory, so merging is just
+ * registration order. The calibration kernel, timed alone and inside every
+ * shard, shows whether the shards disturbed each other. */
+static int _run_shards(void)
+{
+    const int jobs = _cores(_bench.cores, _bench.jobs < 64 ? _bench.jobs : 64);
+    const size_t n = _bench.count, hist_bytes = _bench.stream || _bench.hist_file ? n * sizeof(_bench_hist_t) : 0;
+    const size_t done_at = sizeof(_bench_shared_t) + n * sizeof(bench_entry_t);
+    const size_t hist_at = (done_at + n * sizeof(int) + 63) & ~(size_t)63, bytes = hist_at + hist_bytes;
+    _bench_shared_t *shared = (_bench_shared_t *)MAP_FAILED;
+    int failed = 0, *shard = (int *)malloc((n ? n : 1) * sizeof(int));
+    pid_t pids[64];
+    char status[64][64];
+    if (jobs < _bench.jobs)
+        fprintf(stderr, "warning: %d shards requested but only %d physical cores are available\n", _bench.jobs,
+                jobs);
+    if (jobs > 1 && shard)
+        shared = (_bench_shared_t *)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+    {
+        free(shard);
+        return _run_selected(0, 0);
+    }
+    shared->entries = (bench_entry_t *)(shared + 1);
+    shared->done = (int *)((char *)shared + done_at);
+    shared->hists = hist_bytes ? (_bench_hist_t *)((char *)shared + hist_at) : NULL;
+    _bench_hist_t *hists = shared->hists;
+
+    _bench.shards = jobs;
+    _bench.orchestrated = 1;
+    _bench.cal_alone = _calibrate(&_bench.cal_alone_error);
+    fflush(stdout);
+    fflush(stderr);
+    for (int s = 0; s < jobs; s++)
+    {
+        if ((pids[s] = fork()) != 0)
+            continue;
+        _bench.quiet = 1;
+#ifdef __linux__
+        CPU_ZERO(&_allowed); /* unpinned threaded workers stay on this core too */
+        CPU_SET(_bench.cores[s], &_allowed);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(_allowed), &_allowed) == 0)
+            _bench.cpu = _bench.cores[s];
+#endif
+        _after_fork();
+        shared->cal[s] = _calibrate(&shared->cal_error[s]);
+        _run_selected(s, jobs);
+        for (size_t i = 0; i < _bench.count; i++)
+        {
+            if (_bench.entries[i].skipped)
+                continue;
+            shared->entries[i] = _bench.entries[i];
+            if (hists && _bench.hist[i])
+                hists[i] = *_bench.hist[i];
+            shared->done[i] = 1;
+        }
+        _exit(0);
+    }
+
+    for (int s = 0; s < jobs; s++)
+    {
+        int st = 0;
+        if (pids[s] < 0)
+            snprintf(status[s], sizeof(status[s]), "shard %d could not fork", s);
+        else if (waitpid(pids[s], &st, 0) == pids[s] && WIFSIGNALED(st))
+            snprintf(status[s], sizeof(status[s]), "shard %d killed by signal %d (%s)", s, WTERMSIG(st),
+                     strsignal(WTERMSIG(st)));
+        else if (WIFEXITED(st) && WEXITSTATUS(st) != 0)
+            snprintf(status[s], sizeof(status[s]), "shard %d exited with status %d", s, WEXITSTATUS(st));
+        else
+            snprintf(status[s], sizeof(status[s]), "shard %d exited without a result", s);
+        _bench.cal[s] = shared->cal[s];
+        _bench.cal_error[s] = shared->cal_error[s];
+    }
+    _assign_shards(jobs, shard);
+    for (size_t i = 0; i < _bench.count; i++)
+    {
+        bench_entry_t *e = &_bench.entries[i];
+        if ((e->skipped = shard[i] < 0))
+            continue;
+        if (shared->done[i])
+        {
+            *e = shared->entries[i];
+            if (hists && (_bench.hist[i] || (_bench.hist[i] = (_bench_hist_t *)malloc(sizeof(_bench_hist_t)))))
+                *_bench.hist[i] = hists[i];
+        }
+        else
+        {
+            snprintf(e->error, sizeof(e->error), "%s", status[shard[i]]);
+            _fail(e);
+        }
+        failed += e->error[0] != 0;
+    }
+    munmap(shared, bytes);
+    free(shard);
+
+    if (!_bench.quiet)
+    {
+        printf("Shards: %d on CPUs", jobs);
+        for (int s = 0; s < jobs; s++)
+            printf("%s%d", s ? "," : " ", _bench.cores[s]);
+        printf("; calibration %.0f ns alone", _bench.cal_alone);
+        for (int s = 0; s < jobs; s++)
+            printf(", %+.1f%% in shard %d", (_bench.cal[s] / _bench.cal_alone - 1.0) * 100.0, s);
+        printf("\n");
+    }
+    /* A change beyond 5% and both CIs: the shards competed for clock, cache or bandwidth */
+    for (int s = 0; s < jobs; s++)
+    {
+        const double change = _bench.cal[s] / _bench.cal_alone - 1.0;
+        if (fabs(change) > 0.05 && fabs(change) > _bench.cal_alone_error + _bench.cal_error[s])
+            fprintf(stderr, "warning: shard %d calibration %+.1f%% against a serial run; "
+                            "parallel shards are disturbing each other\n",
+                    s, change * 100.0);
+    }
+    return failed;
+}
+
+static const char *_verdicts[] = {"", "same", "faster", "slower", "regression"};
+
+/* Field k of a CSV line into buf, quotes stripped; NULL past the last field. */
+static const char *_csv_field(const char *line, int k, char *buf, size_t size)
+{
+    for (int i = 0;; i++)
+    {
+        const int quoted = *line == '"';
+        const char *p = line + quoted;
+        size_t n = 0;
+        for (; *p && (quoted ? *p != '"' : *p != ',' && *p != '\n' && *p != '\r'); p++)
+            if (n + 1 < size)
+                buf[n++] = *p;
+        buf[n] = '\0';
+        p += quoted && *p == '"';
+        if (i == k)
+            return buf;
+        if (*p != ',')
+            return NULL;
+        line = p + 1;
+    }
+}
+
+/* A benchmark of a results CSV or JSON from an earlier run */
+typedef struct
+{
+    char *name;
+    double median, lo, hi; /* median and its 95% CI */
+    double batch, reps_sd; /* calls per sample, 0 if unknown; stddev of repetition medians, 0 if run once */
+    int failed;
+} _bench_base_t;
+
+/* Reads every benchmark of a baseline (one per line) into base, indexed by
+ * name in names; the first of a name counts. Returns how many, or -1 when
+ * out of memory. */
+static long _baseline_load(FILE *f, _bench_base_t **base, _bench_names_t *names)
+{
+    char *line = NULL, *buf = NULL;
+    size_t size = 0, n = 0, cap = 0;
+    /* name, median, ci low, ci high, error, batch, repetitions and their stddev */
+    int col[8] = {-1, -1, -1, -1, -1, -1, -1, -1}, ok = 1;
+    const char *keys[8] = {"name",  "median_ns",  "median_ci_low_ns",    "median_ci_high_ns",
+                           "error", "batch_size", "repetitions", "repetition_stddev_ns"};
+    ssize_t len;
+    for (int first = 1; ok && (len = getline(&line, &size, f)) > 0; first = 0)
+    {
+        _bench_base_t b = {NULL, 0, 0, 0, 0, 0, 0};
+        char *grown = (char *)realloc(buf, (size_t)len + 1);
+        if (!(ok = grown != NULL))
+            break;
+        buf = grown;
+        if (line[0] == '{' || (!first && col[0] < 0)) /* JSON */
+        {
+            const char *at = strstr(line, "{\"name\":\""), *m = strstr(line, "\"median_ns\":");
+            const char *ci = strstr(line, "\"median_ci_ns\":[");
+            if (!at || !m || !strchr(at + 9, '"'))
+                continue;
+            b.name = strndup(at + 9, (size_t)(strchr(at + 9, '"') - at - 9));
+            b.median = b.lo = b.hi = strtod(m + 12, NULL);
+            if (ci && sscanf(ci + 16, "%lf,%lf", &b.lo, &b.hi) != 2)
+                b.lo = b.hi = b.median;
+            const char *batch = strstr(line, "\"batch_size\":"), *reps = strstr(line, "\"repetitions\":{");
+            int nreps = 0;
+            b.batch = batch ? strtod(batch + 13, NULL) : 0;
+            if (reps && sscanf(reps, "\"repetitions\":{\"count\":%d", &nreps) == 1 && nreps > 1 &&
+                (reps = strstr(reps, "\"stddev_ns\":")))
+                b.reps_sd = strtod(reps + 12, NULL);
+            b.failed = strstr(line, "\"error\":\"") != NULL;
+        }
+        else if (first)
+        {
+            for (int k = 0; _csv_field(line, k, buf, (size_t)len + 1); k++)
+                for (int c = 0; c < 8; c++)
+                    col[c] = strcmp(buf, keys[c]) == 0 ? k : col[c];
+            continue;
+        }
+        else if (col[1] >= 0 && _csv_field(line, col[0], buf, (size_t)len + 1))
+        {
+            b.name = strdup(buf);
+            b.median = b.lo = b.hi = strtod(_csv_field(line, col[1], buf, (size_t)len + 1) ? buf : "0", NULL);
+            if (col[2] >= 0 && _csv_field(line, col[2], buf, (size_t)len + 1))
+                b.lo = strtod(buf, NULL);
+            if (col[3] >= 0 && _csv_field(line, col[3], buf, (size_t)len + 1))
+                b.hi = strtod(buf, NULL);
+            b.failed = col[4] >= 0 && _csv_field(line, col[4], buf, (size_t)len + 1) && buf[0];
+            if (col[5] >= 0 && _csv_field(line, col[5], buf, (size_t)len + 1))
+                b.batch = strtod(buf, NULL);
+            if (col[6] >= 0 && _csv_field(line, col[6], buf, (size_t)len + 1) && atoi(buf) > 1 && col[7] >= 0 &&
+                _csv_field(line, col[7], buf, (size_t)len + 1))
+                b.reps_sd = strtod(buf, NULL);
+        }
+        else
+            continue;
+        if (b.name && n == cap)
+        {
+            _bench_base_t *more = (_bench_base_t *)realloc(*base, (cap = cap ? cap * 2 : 256) * sizeof(*more));
+            if (more)
+                *base = more;
+            else
+                cap = n;
+        }
+        if (!(ok = b.name && n < cap && _names_add(names, b.name, n) >= 0))
+            free(b.name);
+        else
+            (*base)[n++] = b;
+    }
+    free(line);
+    free(buf);
+    return ok ? (long)n : -1;
+}
+
+/* A median's interval for the baseline gate: its 95% CI, at least half a
+ * tick per call either side (samples are whole ticks, so a CI can collapse
+ * onto one value), and with repetitions at least two standard deviations of
+ * their medians, as one run's CI leaves out run-to-run variance. */
+static void _gate_interval(double median, double lo, double hi, double batch, double reps_sd, double out[2])
+{
+    const double half = fmax(0.5 * _bench.ns_per_tick / (batch > 0 ? batch : 1.0), 2.0 * reps_sd);
+    out[0] = fmin(lo, median - half);
+    out[1] = fmax(hi, median + half);
+}
+
+/* BENCH_BASELINE: significant when the medians' gate intervals do not
+ * overlap, a regression when also slower than BENCH_THRESHOLD. Returns the
+ * regressions. */
+static int _compare_baseline(void)
+{
+    FILE *f = fopen(_bench.baseline, "r");
+    _bench_base_t *base = NULL;
+    _bench_names_t names = {NULL, 0, 0};
+    int regressions = 0;
+    if (!f)
+    {
+        fprintf(stderr, "warning: cannot read baseline %s\n", _bench.baseline);
+        return 0;
+    }
+    const long count = _baseline_load(f, &base, &names);
+    fclose(f);
+    if (count < 0)
+        fprintf(stderr, "warning: out of memory reading baseline %s\n", _bench.baseline);
+    for (size_t i = 0; count >= 0 && i < _bench.count; i++)
+    {
+        bench_entry_t *e = &_bench.entries[i];
+        const long k = e->skipped || e->error[0] ? -1 : _names_find(&names, e->name, strlen(e->name));
+        e->verdict = 0;
+        if (k < 0 || base[k].failed || base[k].median <= 0)
+            continue;
+        e->base_ns = base[k].median;
+        e->base_change = e->stats.median_ns / e->base_ns - 1.0;
+        double was[2], now[2];
+        _gate_interval(base[k].median, base[k].lo, base[k].hi, base[k].batch ? base[k].batch : e->stats.batch_size,
+                       base[k].reps_sd, was);
+        _gate_interval(e->stats.median_ns, e->stats.median_ci_low_ns, e->stats.median_ci_high_ns,
+                       (double)e->stats.batch_size, e->reps > 1 ? e->reps_stddev_ns : 0.0, now);
+        if (now[0] <= was[1] && now[1] >= was[0])
+            e->verdict = 1;
+        else
+            e->verdict = e->base_change > _bench.threshold ? 4 : e->base_change > 0 ? 3 : 2;
+        regressions += e->verdict == 4;
+    }
+    for (long k = 0; k < count; k++)
+        free(base[k].name);
+    free(base);
+    free(names.slots);
+    return regressions;
+}
+
+static void _write_csv(void)
+{
+    FILE *f = fopen(_bench.csv_file, "w");
+    if (!f)
+        return;
+    fprintf(f, "name,description,iterations,min_ns,max_ns,mean_ns,median_ns,stddev_ns,p95_ns,p99_ns,batch_size,"
+               "min_cycles,median_cycles,mean_cycles,p99_cycles,overhead_ns,noise_floor_ns,optimized_away,"
+               "hw_cycles,hw_instructions,hw_branch_misses,hw_l1d_misses,hw_llc_misses,hw_dtlb_misses,"
+               "ipc,branch_mpki,l1d_mpki,llc_mpki,dtlb_mpki,p999_ns,p9999_ns,median_rel_error,"
+               "mean_ci_low_ns,mean_ci_high_ns,median_ci_low_ns,median_ci_high_ns,"
+               "outliers_low_severe,outliers_low_mild,outliers_high_mild,outliers_high_severe,outlier_variance,arg,"
+               "pauses,pause_overhead_ns,threads,throughput,scaling_efficiency,error,index,"
+               "bytes_per_second,items_per_second,ns_per_item,user_counters,baseline_change,verdict,"
+               "repetitions,repetition_mean_ns,repetition_median_ns,repetition_stddev_ns,"
+               "allocs_per_call,frees_per_call,alloc_bytes_per_call,peak_heap_bytes,leaked_allocs,"
+               "cold_median_ns,cold_mean_ns,cold_p99_ns,cold_min_ns,cold_slowdown,cold_evict_ns,"
+               "open_loop_rate,open_loop_achieved,open_loop_p50_ns,open_loop_p99_ns,open_loop_p999_ns,"
+               "open_loop_max_ns,open_loop_service_p99_ns,open_loop_slo_ns,open_loop_max_rate,"
+               "warmup_iterations,warmup_steady\n");
+    for (size_t i = 0; i < _bench.count; i++)
+    {
+        bench_entry_t *e = &_bench.entries[i];
+        bench_counters_t *c = &e->counters;
+        if (e->skipped)
+            continue;
+        fprintf(f, "%s,\"%s\",%lu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%lu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%d,"
+                   "%.2f,%.2f,%.4f,%.4f,%.4f,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2f,%.2f,%.5f,"
+                   "%.2f,%.2f,%.2f,%.2f,%lu,%lu,%lu,%lu,%.4f,",
+                e->name, e->desc, (unsigned long)e->stats.iterations,
+                e->stats.min_ns, e->stats.max_ns, e->stats.mean_ns, e->stats.median_ns,
+                e->stats.stddev_ns, e->stats.p95_ns, e->stats.p99_ns, (unsigned long)e->stats.batch_size,
+                e->stats.min_cycles, e->stats.median_cycles, e->stats.mean_cycles, e->stats.p99_cycles,
+                e->stats.overhead_ns, e->stats.noise_floor_ns, e->stats.optimized_away,
+                c->cycles, c->instructions, c->branch_misses, c->l1d_misses, c->llc_misses, c->dtlb_misses,
+                c->ipc, c->branch_mpki, c->l1d_mpki, c->llc_mpki, c->dtlb_mpki, e->stats.p999_ns, e->stats.p9999_ns,
+                e->stats.median_rel_error, e->stats.mean_ci_low_ns, e->stats.mean_ci_high_ns,
+                e->stats.median_ci_low_ns, e->stats.median_ci_high_ns, (unsigned long)e->stats.outliers_low_severe,
+                (unsigned long)e->stats.outliers_low_mild, (unsigned long)e->stats.outliers_high_mild,
+                (unsigned long)e->stats.outliers_high_severe, e->stats.outlier_variance);
+        if (e->has_arg)
+            fprintf(f, "%lld", (long long)e->arg);
+        fprintf(f, ",%.3f,%.2f,%d,%.2f,%.4f,\"%s\",%zu,%.6g,%.6g,%.4f,\"", e->stats.pauses, e->stats.pause_overhead_ns,
+                e->threads ? e->threads : 1, e->throughput, e->efficiency, e->error, i, e->bytes_per_second,
+                e->items_per_second, e->ns_per_item);
+        for (int k = 0; k < e->nuser; k++) /* name=rate per second */
+            fprintf(f, "%s%s=%.6g", k ? ";" : "", e->user[k].name, e->user[k].per_second);
+        if (e->verdict)
+            fprintf(f, "\",%.5f,%s,", e->base_change, _verdicts[e->verdict]);
+        else
+            fprintf(f, "\",,,");
+        if (e->reps)
+            fprintf(f, "%d,%.2f,%.2f,%.2f,", e->reps, e->reps_mean_ns, e->reps_median_ns, e->reps_stddev_ns);
+        else
+            fprintf(f, ",,,,");
+        if (e->alloc_tracked)
+            fprintf(f, "%.4f,%.4f,%.2f,%llu,%llu,", e->allocs, e->frees, e->alloc_bytes,
+                    (unsigned long long)e->peak_bytes, (unsigned long long)e->leaks);
+        else
+            fprintf(f, ",,,,,");
+        if (e->cold)
+            fprintf(f, "%.2f,%.2f,%.2f,%.2f,%.4f,%.1f,", e->cold_stats.median_ns, e->cold_stats.mean_ns,
+                    e->cold_stats.p99_ns, e->cold_stats.min_ns, e->cold_slowdown, e->evict_ns);
+        else
+            fprintf(f, ",,,,,,");
+        if (e->open_loop)
+        {
+            fprintf(f, "%.6g,%.6g,%.2f,%.2f,%.2f,%.2f,%.2f,", e->run.rate, e->run.achieved, e->ol_latency.median_ns,
+                    e->ol_latency.p99_ns, e->ol_latency.p999_ns, e->ol_latency.max_ns, e->ol_service.p99_ns);
+            if (!isnan(e->slo_ns))
+                fprintf(f, "%.2f", e->slo_ns);
+            fprintf(f, ",");
+            if (!isnan(e->max_rate))
+                fprintf(f, "%.6g", e->max_rate);
+            fprintf(f, ",");
+        }
+        else
+            fprintf(f, ",,,,,,,,,");
+        fprintf(f, "%llu,", (unsigned long long)e->warmup.iterations);
+        if (e->warmup.automatic)
+            fprintf(f, "%d", e->warmup.steady);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+
+static void _write_json(void)
+{
+    FILE *f = fopen(_bench.json_file, "w");
+    if (!f)
+        return;
+    fprintf(f, "{\n  \"timer\": {\"backend\":\"%s\",\"ticks_per_ns\":%.6f},\n",
+            _bench.use_tsc ? "tsc" : "clock", 1.0 / _bench.ns_per_tick);
+    fprintf(f, "  \"environment\": {\"stable\":%s,\"cpu\":%d,\"fifo_priority\":%d,\"memory_locked\":%s,"
+               "\"governor\":\"%s\",\"smt_siblings\":%d,",
+            _bench.stable ? "true" : "false", _bench.cpu, _bench.fifo, _bench.locked ? "true" : "false",
+            _bench.governor, _bench.smt);
+    if (!isfinite(_bench.load))
+        fprintf(f, "\"load_average\":null},\n");
+    else
+        fprintf(f, "\"load_average\":%.4f},\n", _bench.load);
+    if (_bench.orchestrated)
+    {
+        fprintf(f, "  \"shards\": {\"count\":%d,\"cpus\":[", _bench.shards);
+        for (int s = 0; s < _bench.shards; s++)
+            fprintf(f, "%s%d", s ? "," : "", _bench.cores[s]);
+        fprintf(f, "],\"calibration_alone_ns\":%.1f,\"calibration_ns\":[", _bench.cal_alone);
+        for (int s = 0; s < _bench.shards; s++)
+            fprintf(f, "%s%.1f", s ? "," : "", _bench.cal[s]);
+        fprintf(f, "]},\n");
+    }
+    else if (_bench.shards)
+        fprintf(f, "  \"shards\": {\"index\":%d,\"count\":%d},\n", _bench.shard, _bench.shards);
+    if (_bench.reps > 1)
+        fprintf(f, "  \"repetitions\": {\"count\":%d,\"seed\":%llu},\n", _bench.reps,
+                (unsigned long long)_bench.seed);
+    const _bench_machine_t *m = &_bench.profile;
+    if (m->measured || m->threads)
+    {
+        fprintf(f, "  \"machine\": {\"caches\":[");
+        for (int i = 0; i < m->levels; i++)
+            fprintf(f, "%s{\"level\":%d,\"bytes\":%llu,\"latency_ns\":%.3f}", i ? "," : "", i + 1,
+                    (unsigned long long)m->bytes[i], m->latency_ns[i]);
+        fprintf(f, "],\"reported_bytes\":[");
+        for (int i = 0; i < BENCH_MAX_CACHE_LEVELS; i++)
+            fprintf(f, "%s%llu", i ? "," : "", (unsigned long long)m->reported[i]);
+        fprintf(f, m->measured ? "],\"memory_latency_ns\":%.4f," : "],\"memory_latency_ns\":null,", m->memory_ns);
+        fprintf(f, "\"stream_bytes\":%llu,\"threads\":%d", (unsigned long long)m->stream_bytes, m->threads);
+        const char *keys[] = {"read", "write", "copy", "triad"};
+        for (int k = 0; k < 8; k++)
+        {
+            const double v = k < 4 ? m->single[k] : m->all[k - 4];
+            fprintf(f, k % 4 ? "," : k ? "},\"bandwidth_all_gbs\":{" : ",\"bandwidth_single_gbs\":{");
+            fprintf(f, !isfinite(v) ? "\"%s\":null" : "\"%s\":%.4f", keys[k % 4], v);
+        }
+        fprintf(f, "}},\n");
+    }
+    fprintf(f, "  \"benchmarks\": [\n");
+    size_t last = 0;
+    for (size_t i = 0; i < _bench.count; i++)
+        last = _bench.entries[i].skipped ? last : i;
+    for (size_t i = 0; i < _bench.count; i++)
+    {
+        bench_entry_t *e = &_bench.entries[i];
+        if (e->skipped)
+            continue;
+        fprintf(f, "    {\"name\":\"%s\",\"description\":\"%s\",\"iterations\":%lu,"
+                   "\"min_ns\":%.2f,\"max_ns\":%.2f,\"mean_ns\":%.2f,\"median_ns\":%.2f,"
+                   "\"stddev_ns\":%.2f,\"p95_ns\":%.2f,\"p99_ns\":%.2f,\"p999_ns\":%.2f,\"p9999_ns\":%.2f,\"batch_size\":%lu,"
+                   "\"min_cycles\":%.2f,\"median_cycles\":%.2f,\"mean_cycles\":%.2f,\"p99_cycles\":%.2f,"
+                   "\"overhead_ns\":%.2f,\"noise_floor_ns\":%.2f,\"optimized_away\":%s,",
+                e->name, e->desc, (unsigned long)e->stats.iterations,
+                e->stats.min_ns, e->stats.max_ns, e->stats.mean_ns, e->stats.median_ns,
+                e->stats.stddev_ns, e->stats.p95_ns, e->stats.p99_ns, e->stats.p999_ns, e->stats.p9999_ns,
+                (unsigned long)e->stats.batch_size,
+                e->stats.min_cycles, e->stats.median_cycles, e->stats.mean_cycles, e->stats.p99_cycles,
+                e->stats.overhead_ns, e->stats.noise_floor_ns, e->stats.optimized_away ? "true" : "false");
+        if (!isfinite(e->stats.median_rel_error))
+            fprintf(f, "\"median_rel_error\":null,");
+        else
+            fprintf(f, "\"median_rel_error\":%.5f,", e->stats.median_rel_error);
+        fprintf(f, "\"mean_ci_ns\":[%.2f,%.2f],\"median_ci_ns\":[%.2f,%.2f],\"outliers\":{\"low_severe\":%lu,"
+                   "\"low_mild\":%lu,\"high_mild\":%lu,\"high_severe\":%lu,\"variance\":%.4f},\"counters\":{",
+                e->stats.mean_ci_low_ns, e->stats.mean_ci_high_ns, e->stats.median_ci_low_ns,
+                e->stats.median_ci_high_ns, (unsigned long)e->stats.outliers_low_severe,
+                (unsigned long)e->stats.outliers_low_mild, (unsigned long)e->stats.outliers_high_mild,
+                (unsigned long)e->stats.outliers_high_severe, e->stats.outlier_variance);
+        const bench_counters_t *c = &e->counters;
+        const char *keys[] = {"cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses", "dtlb_misses",
+                              "ipc", "branch_mpki", "l1d_mpki", "llc_mpki", "dtlb_mpki"};
+        const double v[] = {c->cycles, c->instructions, c->branch_misses, c->l1d_misses, c->llc_misses,
+                            c->dtlb_misses, c->ipc, c->branch_mpki, c->l1d_mpki, c->llc_mpki, c->dtlb_mpki};
+        for (int k = 0; k < 11; k++)
+        {
+            if (!isfinite(v[k]))
+                fprintf(f, "%s\"%s\":null", k ? "," : "", keys[k]);
+            else
+                fprintf(f, "%s\"%s\":%.4f", k ? "," : "", keys[k], v[k]);
+        }
+        fprintf(f, "}");
+        if (e->has_arg)
+            fprintf(f, ",\"arg\":%lld", (long long)e->arg);
+        fprintf(f, ",\"pauses\":%.3f,\"pause_overhead_ns\":%.2f,\"threads\":%d,\"index\":%zu", e->stats.pauses,
+                e->stats.pause_overhead_ns, e->threads ? e->threads : 1, i);
+        if (!isfinite(e->throughput))
+            fprintf(f, ",\"throughput\":null");
+        else
+            fprintf(f, ",\"throughput\":%.2f", e->throughput);
+        if (!isfinite(e->efficiency))
+            fprintf(f, ",\"scaling_efficiency\":null");
+        else
+            fprintf(f, ",\"scaling_efficiency\":%.4f", e->efficiency);
+        const char *rate_keys[] = {"bytes_per_second", "items_per_second", "ns_per_item"};
+        const double rates[] = {e->bytes_per_second, e->items_per_second, e->ns_per_item};
+        for (int k = 0; k < 3; k++)
+        {
+            if (!isfinite(rates[k]))
+                fprintf(f, ",\"%s\":null", rate_keys[k]);
+            else
+                fprintf(f, ",\"%s\":%.4f", rate_keys[k], rates[k]);
+        }
+        fprintf(f, ",\"user_counters\":{");
+        for (int k = 0; k < e->nuser; k++)
+        {
+            fprintf(f, "%s\"%s\":{\"value\":%.6g,\"per_second\":", k ? "," : "", e->user[k].name, e->user[k].value);
+            fprintf(f, !isfinite(e->user[k].per_second) ? "null}" : "%.6g}", e->user[k].per_second);
+        }
+        fprintf(f, "}");
+        if (e->error[0])
+            fprintf(f, ",\"error\":\"%s\"", e->error);
+        if (e->verdict)
+            fprintf(f, ",\"baseline\":{\"change\":%.5f,\"verdict\":\"%s\"}", e->base_change, _verdicts[e->verdict]);
+        if (e->reps)
+        {
+            fprintf(f, ",\"repetitions\":{\"count\":%d,\"mean_ns\":%.2f,\"median_ns\":%.2f,\"stddev_ns\":%.2f,"
+                       "\"min_ns\":%.2f,\"max_ns\":%.2f,\"medians_ns\":[",
+                    e->reps, e->reps_mean_ns, e->reps_median_ns, e->reps_stddev_ns, e->reps_min_ns, e->reps_max_ns);
+            for (int k = 0; k < e->reps; k++)
+                fprintf(f, "%s%.2f", k ? "," : "", e->rep_ns[k]);
+            fprintf(f, "]}");
+        }
+        if (e->alloc_tracked)
+            fprintf(f, ",\"alloc\":{\"allocs_per_call\":%.4f,\"frees_per_call\":%.4f,\"bytes_per_call\":%.2f,"
+                       "\"peak_bytes\":%llu,\"leaks\":%llu}",
+                    e->allocs, e->frees, e->alloc_bytes, (unsigned long long)e->peak_bytes,
+                    (unsigned long long)e->leaks);
+        if (e->cold)
+        {
+            const bench_stats_t *cs = &e->cold_stats;
+            fprintf(f, !isfinite(e->cold_slowdown) ? ",\"cold\":{\"slowdown\":null," : ",\"cold\":{\"slowdown\":%.4f,",
+                    e->cold_slowdown);
+            fprintf(f, "\"iterations\":%lu,\"min_ns\":%.2f,\"max_ns\":%.2f,\"mean_ns\":%.2f,\"median_ns\":%.2f,"
+                       "\"stddev_ns\":%.2f,\"p95_ns\":%.2f,\"p99_ns\":%.2f,\"median_ci_ns\":[%.2f,%.2f],"
+                       "\"eviction\":\"%s\",\"evict_bytes\":%llu,\"evict_ns\":%.1f}",
+                    (unsigned long)cs->iterations, cs->min_ns, cs->max_ns, cs->mean_ns, cs->median_ns, cs->stddev_ns,
+                    cs->p95_ns, cs->p99_ns, cs->median_ci_low_ns, cs->median_ci_high_ns,
+                    e->cold_flushed ? "flush" : "sweep", (unsigned long long)e->evict_bytes, e->evict_ns);
+        }
+        if (e->open_loop)
+        {
+            fprintf(f, ",\"open_loop\":{\"arrivals\":\"%s\",\"rate\":%.6g,\"achieved\":%.6g,\"calls\":%lu,\"unsent\":%lu,",
+                    _bench.poisson ? "poisson" : "constant", e->run.rate, e->run.achieved, (unsigned long)e->run.calls,
+                    (unsigned long)e->run.unsent);
+            const bench_stats_t *st[2] = {&e->ol_latency, &e->ol_service};
+            for (int k = 0; k < 2; k++)
+                fprintf(f, "\"%s\":{\"min_ns\":%.2f,\"mean_ns\":%.2f,\"median_ns\":%.2f,\"p95_ns\":%.2f,"
+                           "\"p99_ns\":%.2f,\"p999_ns\":%.2f,\"p9999_ns\":%.2f,\"max_ns\":%.2f},",
+                        k ? "service" : "latency", st[k]->min_ns, st[k]->mean_ns, st[k]->median_ns, st[k]->p95_ns,
+                        st[k]->p99_ns, st[k]->p999_ns, st[k]->p9999_ns, st[k]->max_ns);
+            fprintf(f, !isfinite(e->slo_ns) ? "\"slo_ns\":null," : "\"slo_ns\":%.4f,", e->slo_ns);
+            fprintf(f, "\"met\":%s,", e->run.met ? "true" : "false");
+            fprintf(f, !isfinite(e->max_rate) ? "\"max_rate\":null,\"steps\":[" : "\"max_rate\":%.4f,\"steps\":[",
+                    e->max_rate);
+            for (int k = 0; k < e->nsteps; k++)
+            {
+                const bench_rate_step_t *sp = &e->steps[k];
+                fprintf(f, "%s{\"rate\":%.6g,\"achieved\":%.6g,\"p50_ns\":%.2f,\"p99_ns\":%.2f,\"p999_ns\":%.2f,"
+                           "\"max_ns\":%.2f,\"calls\":%lu,\"unsent\":%lu,\"met\":%s}",
+                        k ? "," : "", sp->rate, sp->achieved, sp->p50_ns, sp->p99_ns, sp->p999_ns, sp->max_ns,
+                        (unsigned long)sp->calls, (unsigned long)sp->unsent, sp->met ? "true" : "false");
+            }
+            fprintf(f, "]}");
+        }
+        const bench_warmup_t *w = &e->warmup;
+        fprintf(f, ",\"warmup\":{\"auto\":%s,\"iterations\":%llu,\"seconds\":%.6f,", w->automatic ? "true" : "false",
+                (unsigned long long)w->iterations, w->seconds);
+        if (w->automatic)
+            fprintf(f, !isfinite(w->median_ns) ? "\"steady\":%s,\"windows\":%d,\"median_ns\":null}"
+                                           : "\"steady\":%s,\"windows\":%d,\"median_ns\":%.2f}",
+                    w->steady ? "true" : "false", w->windows, w->median_ns);
+        else
+            fprintf(f, "\"steady\":null}");
+        fprintf(f, "}%s\n", i < last ? "," : "");
+    }
+    fprintf(f, "  ],\n  \"complexity\": [\n");
+    for (size_t i = 0; i < _bench.nfit; i++)
+        fprintf(f, "    {\"name\":\"%s\",\"big_o\":\"%s\",\"coefficient_ns\":%.6g,\"rms\":%.4f}%s\n",
+                _bench.fit[i].name, _big_o[_bench.fit[i].big_o], _bench.fit[i].coef, _bench.fit[i].rms,
+                i + 1 < _bench.nfit ? "," : "");
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+static void _write_hist(void)
+{
+    FILE *f = fopen(_bench.hist_file, "w");
+    if (!f)
+        return;
+    fprintf(f, "name,lower_ns,upper_ns,count\n");
+    for (size_t i = 0; i < _bench.count; i++)
+    {
+        const _bench_hist_t *h = _bench.hist[i];
+        const double k = _bench.ns_per_tick / (double)_bench.entries[i].stats.batch_size;
+        for (size_t b = 0; h && b < BENCH_HIST_BUCKETS; b++)
+        {
+            uint64_t lo, hi;
+            if (!h->counts[b])
+                continue;
+            _hist_range(b, &lo, &hi);
+            fprintf(f, "%s,%.4f,%.4f,%lu\n", _bench.entries[i].name, lo * k, (hi + 1) * k, (unsigned long)h->counts[b]);
+        }
+    }
+    fclose(f);
+}
+
+/* Host, CPU, kernel and this file's compiler; BENCH_COMPILER, BENCH_CFLAGS,
+ * BENCH_COMMIT and BENCH_LABEL override or add to it. Without BENCH_COMMIT
+ * the commit comes from git describe in the working directory. */
+static void _capture(void)
+{
+    struct utsname u;
+    char line[256], *v;
+    if (uname(&u) == 0)
+    {
+        snprintf(_bench.machine.host, sizeof(_bench.machine.host), "%s", u.nodename);
+        snprintf(_bench.machine.kernel, sizeof(_bench.machine.kernel), "%s %s", u.sysname, u.release);
+        snprintf(_bench.machine.cpu, sizeof(_bench.machine.cpu), "%s", u.machine);
+    }
+    FILE *fp = fopen("/proc/cpuinfo", "r");
+    while (fp && fgets(line, sizeof(line), fp))
+        if (strncmp(line, "model name", 10) == 0 && (v = strchr(line, ':')))
+        {
+            v += 1 + strspn(v + 1, " \t");
+            v[strcspn(v, "\n")] = '\0';
+            snprintf(_bench.machine.cpu, sizeof(_bench.machine.cpu), "%s", v);
+            break;
+        }
+    if (fp)
+        fclose(fp);
+#if defined(__clang__)
+    snprintf(_bench.machine.compiler, sizeof(_bench.machine.compiler), "clang %s", __clang_version__);
+#elif defined(__GNUC__)
+    snprintf(_bench.machine.compiler, sizeof(_bench.machine.compiler), "gcc %s", __VERSION__);
+#endif
+#ifdef BENCH_CFLAGS
+    snprintf(_bench.machine.cflags, sizeof(_bench.machine.cflags), "%s", BENCH_CFLAGS);
+#endif
+    if ((v = getenv("BENCH_COMPILER")))
+        snprintf(_bench.machine.compiler, sizeof(_bench.machine.compiler), "%s", v);
+    if ((v = getenv("BENCH_CFLAGS")))
+        snprintf(_bench.machine.cflags, sizeof(_bench.machine.cflags), "%s", v);
+    if ((v = getenv("BENCH_LABEL")))
+        snprintf(_bench.machine.label, sizeof(_bench.machine.label), "%s", v);
+    if ((v = getenv("BENCH_COMMIT")))
+        snprintf(_bench.machine.commit, sizeof(_bench.machine.commit), "%s", v);
+    else if ((fp = popen("git describe --always --dirty 2>/dev/null", "r")))
+    {
+        if (fgets(_bench.machine.commit, sizeof(_bench.machine.commit), fp))
+            _bench.machine.commit[strcspn(_bench.machine.commit, "\n")] = '\0';
+        pclose(fp);
+    }
+}
+
+/* The history's string table (id - 1) and the records being appended */
+typedef struct
+{
+    char **str;
+    size_t n, cap;
+    _bench_names_t ids; /* string to id - 1, for interning */
+    char *out;
+    size_t used, size;
+    int failed;
+} _bench_log_t;
+
+static void _log_emit(_bench_log_t *l, const void *rec)
+{
+    if (l->used + 64 > l->size)
+    {
+        char *grown = realloc(l->out, l->size = l->size ? l->size * 2 : 4096);
+        if (!grown)
+        {
+            l->failed = 1, l->size = l->used;
+            return;
+        }
+        l->out = grown;
+    }
+    memcpy(l->out + l->used, rec, 64);
+    l->used += 64;
+}
+
+static int _log_add(_bench_log_t *l, char *s)
+{
+    char **grown = l->n < l->cap ? l->str : realloc(l->str, (l->cap = l->cap ? l->cap * 2 : 256) * sizeof(char *));
+    if (!s || !grown)
+        return -1;
+    l->str = grown;
+    l->str[l->n++] = s;
+    return 0;
+}
+
+static uint32_t _intern(_bench_log_t *l, const char *s)
+{
+    if (!s[0])
+        return 0;
+    const long found = _names_find(&l->ids, s, strlen(s));
+    if (found >= 0)
+        return (uint32_t)(found + 1);
+    char *dup = strdup(s);
+    if (_log_add(l, dup) != 0)
+    {
+        free(dup);
+        l->failed = 1;
+        return 0;
+    }
+    if (_names_add(&l->ids, dup, l->n - 1) < 0)
+        l->failed = 1;
+    for (size_t at = 0, len = strlen(s); at < len; at += 48)
+    {
+        _bench_str_rec_t r = {1, (uint32_t)l->n, (uint32_t)(at / 48), (uint32_t)(len - at < 48 ? len - at : 48), {0}};
+        memcpy(r.text, s + at, r.length);
+        _log_emit(l, &r);
+    }
+    return (uint32_t)l->n;
+}
+
+static void _write_history(void)
+{
+    const int fd = open(_bench.history, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0 || flock(fd, LOCK_EX) != 0)
+    {
+        fprintf(stderr, "warning: cannot open history %s: %s\n", _bench.history, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+    /* Read the string table and the last run number under the lock */
+    _bench_log_t l = {0};
+    struct stat st;
+    uint32_t run = 0;
+    size_t size = fstat(fd, &st) == 0 ? (size_t)st.st_size : 0, got = 0;
+    char *buf = malloc(size ? size : 64);
+    for (ssize_t k; buf && got < size; got += (size_t)k)
+        if ((k = pread(fd, buf + got, size - got, (off_t)got)) <= 0)
+            break;
+    int ok = buf && got == size && size % 64 == 0 && (size == 0 || memcmp(buf, "BENCHHST\1\0\0\0@\0\0\0", 16) == 0);
+    if (ok && size == 0)
+    {
+        char header[64] = "BENCHHST\1\0\0\0@"; /* version 1, 64-byte records */
+        _log_emit(&l, header);
+    }
+    for (size_t at = 64; ok && at < size; at += 64)
+    {
+        _bench_str_rec_t r;
+        _bench_run_rec_t rr;
+        memcpy(&r, buf + at, 64);
+        const size_t len = r.length < 48 ? r.length : 48;
+        if (r.tag == 2)
+            memcpy(&rr, buf + at, 64), run = rr.run > run ? rr.run : run;
+        else if (r.tag == 1 && r.part == 0 && r.id == l.n + 1)
+            ok = _log_add(&l, strndup(r.text, len)) == 0;
+        else if (r.tag == 1 && r.part > 0 && r.id == l.n)
+        {
+            const size_t old = strlen(l.str[l.n - 1]);
+            char *grown = realloc(l.str[l.n - 1], old + len + 1);
+            if ((ok = grown != NULL))
+                memcpy(grown + old, r.text, len), grown[old + len] = '\0', l.str[l.n - 1] = grown;
+        }
+        else if (r.tag == 1)
+            ok = 0;
+    }
+    free(buf);
+    for (size_t i = 0; ok && i < l.n; i++) /* strings continue over records, so only now */
+        ok = _names_add(&l.ids, l.str[i], i) >= 0;
+    if (!ok)
+        fprintf(stderr, "warning: %s is not a benchmark history file, or is damaged\n", _bench.history);
+    _bench_run_rec_t r = {2, ++run, (int64_t)time(NULL), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, _bench.load};
+    r.host = _intern(&l, _bench.machine.host);
+    r.cpu = _intern(&l, _bench.machine.cpu);
+    r.kernel = _intern(&l, _bench.machine.kernel);
+    r.compiler = _intern(&l, _bench.machine.compiler);
+    r.cflags = _intern(&l, _bench.machine.cflags);
+    r.commit = _intern(&l, _bench.machine.commit);
+    r.timer = _intern(&l, _bench.use_tsc ? "tsc" : "clock");
+    r.label = _intern(&l, _bench.machine.label);
+    r.flags = (_bench.stable ? 1u : 0) | (_bench.stream ? 2u : 0) | (_bench.isolate ? 4u : 0) |
+              (_bench.shards || _bench.orchestrated ? 8u : 0);
+    uint32_t *names = (uint32_t *)calloc(_bench.count ? _bench.count : 1, sizeof(uint32_t));
+    l.failed |= !names;
+    for (size_t i = 0; names && i < _bench.count; i++)
+        if (!_bench.entries[i].skipped)
+            names[i] = _intern(&l, _bench.entries[i].name), r.benchmarks++;
+    _log_emit(&l, &r);
+    for (size_t i = 0; names && i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        if (e->skipped)
+            continue;
+        _bench_result_rec_t x = {3, run, names[i], (e->error[0] ? 1u : 0) | (uint32_t)e->verdict << 8,
+                                 e->stats.median_ns, e->stats.median_ci_low_ns, e->stats.median_ci_high_ns,
+                                 e->stats.mean_ns, e->stats.p99_ns, e->stats.iterations};
+        _log_emit(&l, &x);
+    }
+    for (size_t at = 0; ok && !l.failed && at < l.used;)
+    {
+        const ssize_t k = write(fd, l.out + at, l.used - at);
+        if (k <= 0)
+            fprintf(stderr, "warning: cannot append to history %s: %s\n", _bench.history, strerror(errno)), ok = 0;
+        else
+            at += (size_t)k;
+    }
+    close(fd); /* releases the lock */
+    for (size_t i = 0; i < l.n; i++)
+        free(l.str[i]);
+    free(l.str);
+    free(l.ids.slots);
+    free(l.out);
+    free(names);
+    if (ok && !l.failed && !_bench.quiet)
+        printf("History: run %u appended to %s\n", run, _bench.history);
+}
+
+/* BENCH_MACHINE: the machine characterization suite, registered as
+ * ordinary entries. machine/latency/<bytes> chases a random single-cycle
+ * pointer ring over working sets from 4 KB up, two per octave, and
+ * machine/<kernel>/threads:N streams read, write, copy and triad over
+ * arrays well past the last cache at 1, 2, 4 ... up to the online CPUs. */
+#define _BENCH_LINE 64                   /* bytes between chased pointers */
+#define _BENCH_LOADS 1024                /* dependent loads per call */
+#define _BENCH_CHUNK (1u << 20)          /* bytes of each array one bandwidth call streams */
+#define _BENCH_CHUNK_WORDS (_BENCH_CHUNK / sizeof(double))
+#define _BENCH_STREAM_MIN (64ull << 20)  /* per array, however small the caches look */
+#define _BENCH_STREAM_MAX (256ull << 20) /* per array, however large */
+#define _BENCH_STEP 1.3 /* latency over a plateau's first that ends the plateau */
+#define _BENCH_FLAT 1.1 /* growth between neighbouring sizes that starts the next */
+
+static struct
+{
+    void **chase; /* where the chase stands */
+    char *ring;
+    double *a, *b, *c;
+    size_t words, stride; /* doubles per array; between the workers' starting points */
+} _mach;
+
+static void *_mach_self = &_mach_self; /* a one-line ring, when the working set cannot be allocated */
+static __thread uint64_t _mach_calls;  /* bandwidth calls by this worker */
+
+/* Sattolo's shuffle links every line into one cycle, so the prefetcher
+ * cannot follow it and no shorter cycle leaves part of the set cold. */
+static void _chase_setup(void)
+{
+    const size_t lines = (size_t)bench_arg / _BENCH_LINE;
+    uint32_t *order = (uint32_t *)malloc(lines * sizeof(uint32_t));
+    void *ring = NULL;
+    if (!order || posix_memalign(&ring, 4096, lines * _BENCH_LINE) != 0)
+    {
+        fprintf(stderr, "warning: out of memory for a %lld-byte working set; its latency is meaningless\n",
+                (long long)bench_arg);
+        free(order);
+        _mach.chase = (void **)&_mach_self;
+        return;
+    }
+    _prefault(ring, lines * _BENCH_LINE);
+    for (size_t i = 0; i < lines; i++)
+        order[i] = (uint32_t)i;
+    uint64_t state = lines;
+    for (size_t i = lines - 1; i > 0; i--)
+    {
+        const size_t j = (size_t)(_splitmix(&state) % i);
+        const uint32_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    _mach.ring = (char *)ring;
+    for (size_t i = 0; i < lines; i++)
+        *(void **)(_mach.ring + i * _BENCH_LINE) = _mach.ring + (size_t)order[i] * _BENCH_LINE;
+    free(order);
+    _mach.chase = (void **)_mach.ring;
+    bench_set_items(_BENCH_LOADS);
+}
+
+static void _chase_teardown(void)
+{
+    free(_mach.ring);
+    _mach.ring = NULL;
+}
+
+static void _chase(void)
+{
+    void **p = _mach.chase;
+    for (int i = 0; i < _BENCH_LOADS; i++)
+        p = (void **)*p;
+    _mach.chase = p;
+}
+
+static void _stream_teardown(void)
+{
+    free(_mach.a);
+    free(_mach.b);
+    free(_mach.c);
+    _mach.a = _mach.b = _mach.c = NULL;
+}
+
+/* Bytes per call count what the kernel reads plus writes, as STREAM does */
+static void _stream_setup(uint64_t bytes_per_call)
+{
+    const size_t bytes = _mach.words * sizeof(double);
+    void *a = NULL, *b = NULL, *c = NULL;
+    if (posix_memalign(&a, 4096, bytes) || posix_memalign(&b, 4096, bytes) || posix_memalign(&c, 4096, bytes))
+        fprintf(stderr, "warning: out of memory for the %zu-byte bandwidth arrays; skipping the kernel\n", bytes);
+    _mach.a = (double *)a, _mach.b = (double *)b, _mach.c = (double *)c;
+    if (!a || !b || !c)
+    {
+        _stream_teardown();
+        return;
+    }
+    _prefault(a, bytes);
+    _prefault(b, bytes);
+    _prefault(c, bytes);
+    bench_set_bytes(bytes_per_call);
+}
+
+static void _read_setup(void) { _stream_setup(_BENCH_CHUNK); }
+static void _write_setup(void) { _stream_setup(_BENCH_CHUNK); }
+static void _copy_setup(void) { _stream_setup(2 * _BENCH_CHUNK); }
+static void _triad_setup(void) { _stream_setup(3 * _BENCH_CHUNK); }
+
+/* Workers start a stride apart and walk on, wrapping, each over its own part */
+static size_t _next_chunk(void)
+{
+    return ((size_t)bench_thread * _mach.stride + (size_t)_mach_calls++ * _BENCH_CHUNK_WORDS) % _mach.words;
+}
+
+static void _stream_read(void)
+{
+    if (!_mach.a)
+        return;
+    const double *a = _mach.a + _next_chunk();
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    for (size_t i = 0; i < _BENCH_CHUNK_WORDS; i += 4)
+    {
+        s0 += a[i];
+        s1 += a[i + 1];
+        s2 += a[i + 2];
+        s3 += a[i + 3];
+    }
+    double sum = s0 + s1 + s2 + s3;
+    KEEP(sum);
+}
+
+static void _stream_write(void)
+{
+    if (!_mach.a)
+        return;
+    double *a = _mach.a + _next_chunk();
+    for (size_t i = 0; i < _BENCH_CHUNK_WORDS; i++)
+        a[i] = 1.0;
+    CLOBBER();
+}
+
+static void _stream_copy(void)
+{
+    if (!_mach.a)
+        return;
+    const size_t at = _next_chunk();
+    double *a = _mach.a + at;
+    const double *b = _mach.b + at;
+    for (size_t i = 0; i < _BENCH_CHUNK_WORDS; i++)
+        a[i] = b[i];
+    CLOBBER();
+}
+
+static void _stream_triad(void)
+{
+    if (!_mach.a)
+        return;
+    const size_t at = _next_chunk();
+    double *a = _mach.a + at;
+    const double *b = _mach.b + at, *c = _mach.c + at;
+    for (size_t i = 0; i < _BENCH_CHUNK_WORDS; i++)
+        a[i] = b[i] + 3.0 * c[i];
+    CLOBBER();
+}
+
+static const struct
+{
+    const char *name;
+    bench_fn_t fn, setup;
+} _kernels[] = {{"read", _stream_read, _read_setup},
+                {"write", _stream_write, _write_setup},
+                {"copy", _stream_copy, _copy_setup},
+                {"triad", _stream_triad, _triad_setup}};
+
+static uint64_t _parse_size(const char *text)
+{
+    char *end;
+    uint64_t v = strtoull(text, &end, 10);
+    switch (*end)
+    {
+    case 'G': v <<= 10; /* fall through */
+    case 'M': v <<= 10; /* fall through */
+    case 'K': v <<= 10; break;
+    }
+    return v;
+}
+
+/* Data or unified cache bytes by level, as the kernel reports them for CPU 0 */
+static void _reported_caches(uint64_t *bytes)
+{
+#ifdef __linux__
+    for (int i = 0; i < 16; i++)
+    {
+        char path[96], line[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", i);
+        if (_read_line(path, line, sizeof(line)) != 0)
+            break;
+        if (strcmp(line, "Instruction") == 0)
+            continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", i);
+        const int level = _read_line(path, line, sizeof(line)) == 0 ? atoi(line) : 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", i);
+        if (level >= 1 && level <= BENCH_MAX_CACHE_LEVELS && _read_line(path, line, sizeof(line)) == 0)
+            bytes[level - 1] = _parse_size(line);
+    }
+#else
+    (void)bytes;
+#endif
+}
+
+static void _machine_register(void)
+{
+    const long pages = sysconf(_SC_PHYS_PAGES), page = sysconf(_SC_PAGESIZE);
+    const uint64_t memory = pages > 0 && page > 0 ? (uint64_t)pages * (uint64_t)page : UINT64_MAX;
+    uint64_t max = _bench.machine_bytes;
+    if (max > memory / 2)
+    {
+        max = memory / 2;
+        fprintf(stderr, "warning: the machine suite sweeps to %llu MB, half of physical memory\n",
+                (unsigned long long)(max >> 20));
+    }
+    for (uint64_t v = 4096; v <= max; v *= 2)
+        for (uint64_t size = v; size <= max && size <= v / 2 * 3; size += v / 2)
+        {
+            char name[48];
+            const size_t before = _bench.count;
+            snprintf(name, sizeof(name), "machine/latency/%llu", (unsigned long long)size);
+            bench_register(_chase, name, "machine/latency"); /* a parameter family, as bench_register_range */
+            if (_bench.count > before)
+                _bench.entries[before].has_arg = 1, _bench.entries[before].arg = (int64_t)size;
+        }
+    bench_set_fixture("machine/latency", _chase_setup, _chase_teardown);
+
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    const int most = cpus < 1 ? 1 : cpus > 256 ? 256 : (int)cpus;
+    int threads[16], nthreads = 0;
+    for (int t = 1; t < most; t *= 2)
+        threads[nthreads++] = t;
+    threads[nthreads++] = most;
+    uint64_t reported[BENCH_MAX_CACHE_LEVELS] = {0}, stream = _BENCH_STREAM_MIN;
+    _reported_caches(reported);
+    for (int i = 0; i < BENCH_MAX_CACHE_LEVELS; i++)
+        stream = 4 * reported[i] > stream ? 4 * reported[i] : stream;
+    stream = stream < _BENCH_STREAM_MAX ? stream : _BENCH_STREAM_MAX;
+    stream = stream < max ? stream : max;
+    stream = stream < memory / 6 ? stream : memory / 6; /* three arrays in half the memory */
+    stream = stream > (uint64_t)_BENCH_CHUNK * most ? stream : (uint64_t)_BENCH_CHUNK * most;
+    const size_t chunks = (size_t)(stream / _BENCH_CHUNK);
+    _bench.profile.stream_bytes = (uint64_t)chunks * _BENCH_CHUNK;
+    _mach.words = chunks * _BENCH_CHUNK_WORDS;
+    _mach.stride = chunks / (size_t)most * _BENCH_CHUNK_WORDS;
+    for (size_t k = 0; k < sizeof(_kernels) / sizeof(_kernels[0]); k++)
+    {
+        char name[48];
+        snprintf(name, sizeof(name), "machine/%s", _kernels[k].name);
+        bench_register_threads(_kernels[k].fn, name, threads, (size_t)nthreads);
+        for (int t = 0; t < nthreads; t++)
+        {
+            snprintf(name, sizeof(name), "machine/%s/threads:%d", _kernels[k].name, threads[t]);
+            bench_set_fixture(name, _kernels[k].setup, _stream_teardown);
+        }
+    }
+}
+
+/* The cache levels are the plateaus of the latency curve: one ends at the
+ * last size within _BENCH_STEP of its first, and the next starts where the
+ * curve flattens out again. The last plateau is memory. */
+static void _machine_profile(void)
+{
+    _bench_machine_t *m = &_bench.profile;
+    const uint64_t stream_bytes = m->stream_bytes;
+    memset(m, 0, sizeof(*m));
+    m->stream_bytes = stream_bytes;
+    for (int k = 0; k < 4; k++)
+        m->single[k] = m->all[k] = NAN;
+    uint64_t bytes[64];
+    double ns[64];
+    int n = 0;
+    for (size_t i = 0; i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        int threads;
+        char kernel[16];
+        if (e->skipped || e->error[0])
+            continue;
+        if (strncmp(e->name, "machine/latency/", 16) == 0 && e->has_arg && !isnan(e->ns_per_item) && n < 64)
+        {
+            int at = n++;
+            for (; at > 0 && bytes[at - 1] > (uint64_t)e->arg; at--) /* keep them sorted */
+                bytes[at] = bytes[at - 1], ns[at] = ns[at - 1];
+            bytes[at] = (uint64_t)e->arg;
+            ns[at] = e->ns_per_item;
+        }
+        else if (sscanf(e->name, "machine/%15[a-z]/threads:%d", kernel, &threads) == 2)
+            for (int k = 0; k < 4; k++)
+                if (strcmp(kernel, _kernels[k].name) == 0)
+                {
+                    if (threads == 1)
+                        m->single[k] = e->bytes_per_second * 1e-9;
+                    if (threads >= m->threads)
+                        m->threads = threads, m->all[k] = e->bytes_per_second * 1e-9;
+                }
+    }
+    for (int i = 0; i < n && m->levels < BENCH_MAX_CACHE_LEVELS;)
+    {
+        int end = i;
+        while (end + 1 < n && ns[end + 1] <= ns[i] * _BENCH_STEP)
+            end++;
+        if (end + 1 >= n)
+            break;
+        m->bytes[m->levels] = bytes[end];
+        m->latency_ns[m->levels++] = ns[i + (end - i) / 2];
+        for (i = end + 1; i + 1 < n && ns[i + 1] > ns[i] * _BENCH_FLAT;)
+            i++;
+    }
+    m->measured = n > 0;
+    m->memory_ns = n ? ns[n - 1] : NAN;
+    _reported_caches(m->reported);
+}
+
+static const char *_human(char *buf, size_t size, uint64_t bytes)
+{
+    static const char *units[] = {"B", "KB", "MB", "GB", "TB"};
+    double v = (double)bytes;
+    int u = 0;
+    for (; v >= 1024.0 && u < 4; u++)
+        v /= 1024.0;
+    snprintf(buf, size, "%.4g %s", v, units[u]);
+    return buf;
+}
+
+static void _print_machine(void)
+{
+    const _bench_machine_t *m = &_bench.profile;
+    char size[32];
+    if (m->measured)
+    {
+        printf("\n%-30s %10s %10s %10s\n", "Machine", "Level", "Bytes", "ns/load");
+        for (int i = 0; i < m->levels; i++)
+            printf("%-30s %10d %10s %10.2f\n", "", i + 1, _human(size, sizeof(size), m->bytes[i]),
+                   m->latency_ns[i]);
+        printf("%-30s %10s %10s %10.1f\n", "", "memory", "", m->memory_ns);
+        printf("%-30s", "Reported caches");
+        for (int i = 0; i < BENCH_MAX_CACHE_LEVELS; i++)
+            if (m->reported[i])
+                printf(" L%d %s", i + 1, _human(size, sizeof(size), m->reported[i]));
+        printf("\n");
+    }
+    if (m->threads)
+    {
+        printf("\n%-30s %10s %10s %10s %10s\n", "Bandwidth GB/s", "Read", "Write", "Copy", "Triad");
+        printf("%-30s %10.1f %10.1f %10.1f %10.1f\n", "1 thread", m->single[0], m->single[1], m->single[2],
+               m->single[3]);
+        snprintf(size, sizeof(size), "%d threads", m->threads);
+        if (m->threads > 1)
+            printf("%-30s %10.1f %10.1f %10.1f %10.1f\n", size, m->all[0], m->all[1], m->all[2], m->all[3]);
+    }
+}
+
+static void _print_results(void)
+{
+    int flagged = 0;
+    printf("\n%-30s %10s %10s %10s %10s %10s %7s\n", "Benchmark", "Mean(ns)", "Median", "StdDev", "P99", "Iters",
+           "+-Med%");
+    printf("%-30s %10s %10s %10s %10s %10s %7s\n", "─────────", "────────", "──────", "──────", "───", "─────",
+           "──────");
+    for (size_t i = 0; i < _bench.count; i++)
+    {
+        bench_entry_t *e = &_bench.entries[i];
+        if (e->skipped)
+            continue;
+        if (e->error[0])
+        {
+            printf("%-30s FAILED: %s\n", e->name, e->error);
+            continue;
+        }
+        printf("%-30s %10.1f %10.1f %10.1f %10.1f %10lu %7.2f%s\n",
+               e->name, e->stats.mean_ns, e->stats.median_ns, e->stats.stddev_ns, e->stats.p99_ns,
+               (unsigned long)e->stats.iterations, e->stats.median_rel_error * 100.0,
+               e->stats.optimized_away ? " !" : "");
+        flagged |= e->stats.optimized_away;
+    }
+    if (flagged)
+        printf("! median within the timer noise floor; body may have been optimized away (missing KEEP?)\n");
+    for (size_t i = 0; i < _bench.count; i++)
+        if (_bench.entries[i].stats.pauses > 0)
+        {
+            printf("Paused benchmarks include %.1f ns per BENCH_PAUSE/RESUME pair%s\n",
+                   _bench.pause_cost * _bench.ns_per_tick, _bench.subtract ? " (subtracted)" : "");
+            break;
+        }
+    for (size_t i = 0, first = 1; i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        if (!e->threads || e->error[0] || e->skipped)
+            continue;
+        if (first)
+            printf("\n%-30s %10s %10s %8s %10s %10s\n", "Scaling", "Calls/s", "Speedup", "Effic%", "SlowMed",
+                   "SlowP99");
+        first = 0;
+        if (isnan(e->efficiency))
+            printf("%-30s %10.4g %10s %8s %10.1f %10.1f\n", e->name, e->throughput, "-", "-", e->slowest_median_ns,
+                   e->slowest_p99_ns);
+        else
+            printf("%-30s %10.4g %9.2fx %8.0f %10.1f %10.1f\n", e->name, e->throughput, e->efficiency * e->threads,
+                   e->efficiency * 100.0, e->slowest_median_ns, e->slowest_p99_ns);
+    }
+    for (size_t i = 0, first = 1; i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        if (e->error[0] || e->skipped || (isnan(e->bytes_per_second) && isnan(e->items_per_second) && !e->nuser))
+            continue;
+        if (first)
+            printf("\n%-30s %10s %10s %10s  %s\n", "Throughput", "GB/s", "Mitems/s", "ns/item", "Counters/s");
+        first = 0;
+        char cell[3][16];
+        const double v[3] = {e->bytes_per_second * 1e-9, e->items_per_second * 1e-6, e->ns_per_item};
+        for (int k = 0; k < 3; k++)
+            snprintf(cell[k], sizeof(cell[k]), isnan(v[k]) ? "-" : k < 2 ? "%.3f" : "%.2f", v[k]);
+        printf("%-30s %10s %10s %10s ", e->name, cell[0], cell[1], cell[2]);
+        for (int k = 0; k < e->nuser; k++)
+            printf(" %s %.4g", e->user[k].name, e->user[k].per_second);
+        printf("\n");
+    }
+    for (size_t i = 0, first = 1; i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        if (!e->reps || e->error[0] || e->skipped)
+            continue;
+        if (first)
+            printf("\n%-30s %10s %10s %10s %7s %10s %10s\n", "Repetition medians", "Mean(ns)", "Median", "StdDev",
+                   "CV%", "Min", "Max");
+        first = 0;
+        printf("%-30s %10.1f %10.1f %10.1f %7.2f %10.1f %10.1f\n", e->name, e->reps_mean_ns, e->reps_median_ns,
+               e->reps_stddev_ns, e->reps_mean_ns > 0 ? e->reps_stddev_ns / e->reps_mean_ns * 100.0 : 0.0,
+               e->reps_min_ns, e->reps_max_ns);
+    }
+    for (size_t i = 0, first = 1; i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        if (!e->alloc_tracked || e->error[0] || e->skipped || !(e->allocs > 0 || e->frees > 0))
+            continue;
+        if (first)
+            printf("\n%-30s %10s %10s %10s %10s %10s\n", "Heap per call", "Allocs", "Frees", "Bytes", "Peak",
+                   "Unfreed");
+        first = 0;
+        printf("%-30s %10.2f %10.2f %10.1f %10llu %10llu\n", e->name, e->allocs, e->frees, e->alloc_bytes,
+               (unsigned long long)e->peak_bytes, (unsigned long long)e->leaks);
+    }
+    for (size_t i = 0, first = 1; i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        if (!e->cold || e->error[0] || e->skipped)
+            continue;
+        if (first)
+            printf("\n%-30s %10s %10s %9s %10s %10s %10s\n", "Hot vs cold", "HotMed", "ColdMed", "Slowdown",
+                   "HotP99", "ColdP99", "Evict(ms)");
+        first = 0;
+        printf("%-30s %10.1f %10.1f %8.2fx %10.1f %10.1f %10.2f%s\n", e->name, e->stats.median_ns,
+               e->cold_stats.median_ns, e->cold_slowdown, e->stats.p99_ns, e->cold_stats.p99_ns, e->evict_ns * 1e-6,
+               e->cold_flushed ? " flush" : "");
+    }
+    for (size_t i = 0, first = 1; i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        if (!e->open_loop || e->error[0] || e->skipped)
+            continue;
+        if (first)
+            printf("\n%-30s %10s %10s %10s %10s %10s %10s %10s\n", "Open loop (ns from due)", "Rate/s", "Done/s",
+                   "P50", "P99", "P99.9", "Max", "SvcP99");
+        first = 0;
+        printf("%-30s %10.4g %10.4g %10.1f %10.1f %10.1f %10.1f %10.1f", e->name, e->run.rate, e->run.achieved,
+               e->ol_latency.median_ns, e->ol_latency.p99_ns, e->ol_latency.p999_ns, e->ol_latency.max_ns,
+               e->ol_service.p99_ns);
+        if (!isnan(e->max_rate))
+            printf(" %s p99 <= %.1f after %d rates", e->max_rate > 0 ? "max with" : "none met", e->slo_ns,
+                   e->nsteps);
+        else if (!isnan(e->slo_ns))
+            printf(" SLO %s", e->run.met ? "met" : "missed");
+        if (e->run.unsent)
+            printf(", %lu never started", (unsigned long)e->run.unsent);
+        printf("\n");
+    }
+    for (size_t i = 0, first = 1; i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        if (!e->warmup.automatic || e->error[0] || e->skipped)
+            continue;
+        if (first)
+            printf("\n%-30s %12s %8s %10s %10s  %s\n", "Warmup (auto)", "Calls", "Windows", "Time(ms)", "Median",
+                   "State");
+        first = 0;
+        printf("%-30s %12lu %8d %10.2f %10.1f  %s\n", e->name, (unsigned long)e->warmup.iterations,
+               e->warmup.windows, e->warmup.seconds * 1e3, e->warmup.median_ns,
+               e->warmup.steady ? "steady" : "NOT steady: raise BENCH_WARMUP_MAX_TIME or BENCH_WARMUP_TOL");
+    }
+    for (size_t i = 0, first = 1; i < _bench.count; i++)
+    {
+        const bench_entry_t *e = &_bench.entries[i];
+        if (!e->verdict)
+            continue;
+        if (first)
+            printf("\n%-30s %10s %10s %8s  %s\n", "Baseline", "Base(ns)", "New(ns)", "Change", "Verdict");
+        first = 0;
+        printf("%-30s %10.1f %10.1f %+7.1f%%  %s\n", e->name, e->base_ns, e->stats.median_ns, e->base_change * 100.0,
+               _verdicts[e->verdict]);
+    }
+    for (size_t i = 0; i < _bench.nfit; i++)
+        printf("%s%-30s %s, %.4g ns * f(n), RMS %.1f%%\n", i ? "" : "\nComplexity\n", _bench.fit[i].name,
+               _big_o[_bench.fit[i].big_o], _bench.fit[i].coef, _bench.fit[i].rms * 100.0);
+    _print_machine();
+    printf("\n");
+}
+
+int bench_main(void)
+{
+    char *env;
+    if ((env = getenv("BENCH_ITERS")))
+        _bench.iters = (uint64_t)atol(env);
+    if ((env = getenv("BENCH_WARMUP")) && !(_bench.warmup_auto = strcmp(env, "auto") == 0))
+        _bench.warmup = (uint64_t)atol(env);
+    if ((env = getenv("BENCH_WARMUP_TOL")))
+        _bench.warmup_tol = atof(env);
+    if ((env = getenv("BENCH_WARMUP_MAX_TIME")))
+        _bench.warmup_max_time = atof(env);
+    if ((env = getenv("BENCH_CSV")))
+        _bench.csv_file = env;
+    if ((env = getenv("BENCH_QUIET")))
+        _bench.quiet = atoi(env);
+    if ((env = getenv("BENCH_BATCH_NS")))
+        _bench.batch_ns = (uint64_t)atol(env);
+    if ((env = getenv("BENCH_TIMER")))
+        _bench.timer = env;
+    if ((env = getenv("BENCH_JSON")))
+        _bench.json_file = env;
+    if ((env = getenv("BENCH_SUBTRACT_OVERHEAD")))
+        _bench.subtract = atoi(env);
+    if ((env = getenv("BENCH_PERF")))
+        _bench.perf = atoi(env);
+    if ((env = getenv("BENCH_STREAM")))
+        _bench.stream = atoi(env);
+    if ((env = getenv("BENCH_HIST")))
+        _bench.hist_file = env;
+    if ((env = getenv("BENCH_SAMPLES")))
+        _bench.samples_file = env;
+    if ((env = getenv("BENCH_SAMPLES_COMPRESS")))
+        _bench.compress = atoi(env);
+    if ((env = getenv("BENCH_HISTORY")) && *env)
+        _bench.history = env;
+    if ((env = getenv("BENCH_MIN_TIME")))
+        _bench.min_time = atof(env);
+    if ((env = getenv("BENCH_MAX_TIME")))
+        _bench.max_time = atof(env);
+    if ((env = getenv("BENCH_PRECISION")) && atof(env) > 0)
+        _bench.precision = atof(env);
+    if ((env = getenv("BENCH_PIN_THREADS")))
+        _bench.pin = atoi(env);
+    if ((env = getenv("BENCH_ISOLATE")))
+        _bench.isolate = atoi(env);
+    if ((env = getenv("BENCH_TIMEOUT")))
+        _bench.timeout = atof(env);
+    if ((env = getenv("BENCH_STABLE")))
+        _bench.stable = atoi(env);
+    if ((env = getenv("BENCH_CPU")))
+        _bench.stable = 1, _bench.cpu = atoi(env);
+    if ((env = getenv("BENCH_FIFO")))
+        _bench.stable = 1, _bench.fifo = atoi(env);
+    if ((env = getenv("BENCH_SHARD")) && sscanf(env, "%d/%d", &_bench.shard, &_bench.shards) != 2)
+        fprintf(stderr, "warning: BENCH_SHARD=%s is not i/N\n", env), _bench.shards = 0;
+    if (_bench.shards > 1 && (_bench.shard < 0 || _bench.shard >= _bench.shards))
+        fprintf(stderr, "warning: shard %d/%d does not exist; running every benchmark\n", _bench.shard,
+                _bench.shards);
+    if (_bench.shards < 2 || _bench.shard < 0 || _bench.shard >= _bench.shards)
+        _bench.shards = 0;
+    if ((env = getenv("BENCH_JOBS")))
+        _bench.jobs = atoi(env);
+    if ((env = getenv("BENCH_BASELINE")))
+        _bench.baseline = env;
+    if ((env = getenv("BENCH_THRESHOLD")) && atof(env) > 0)
+        _bench.threshold = atof(env) / 100.0;
+    if ((env = getenv("BENCH_REPETITIONS")))
+        _bench.reps = atoi(env);
+    if ((env = getenv("BENCH_SEED")))
+        _bench.seed = strtoull(env, NULL, 0);
+    if ((env = getenv("BENCH_FILTER")))
+        _bench.filter = env;
+    if ((env = getenv("BENCH_LIST")))
+        _bench.list = atoi(env);
+    if ((env = getenv("BENCH_MACHINE")) && (_bench.machine_bytes = _parse_size(env)))
+    {
+        _bench.machine_bytes = _bench.machine_bytes < 4096 ? BENCH_MACHINE_BYTES : _bench.machine_bytes;
+        _machine_register();
+    }
+    if (_filter_compile(&_bench.selects, _bench.filter, "BENCH_FILTER") != 0)
+        return 1;
+    if ((env = getenv("BENCH_COLD")) && env[0] && strcmp(env, "0") != 0 &&
+        _filter_compile(&_bench.colds, strcmp(env, "1") == 0 ? NULL : env, "BENCH_COLD") == 0)
+        _bench.cold = env;
+    if ((env = getenv("BENCH_COLD_ITERS")))
+        _bench.cold_iters = (uint64_t)atol(env);
+    if ((env = getenv("BENCH_RATE")))
+    {
+        char *unit;
+        _bench.sweep = strcmp(env, "sweep") == 0;
+        _bench.rate = strtod(env, &unit);
+        _bench.rate *= *unit == 'k' ? 1e3 : *unit == 'M' ? 1e6 : 1.0;
+    }
+    if ((env = getenv("BENCH_ARRIVALS")))
+        _bench.poisson = strcmp(env, "poisson") == 0;
+    if ((env = getenv("BENCH_SLO")))
+        _bench.slo_ns = atof(env);
+    if ((env = getenv("BENCH_RATE_TIME")) && atof(env) > 0)
+        _bench.rate_time = atof(env);
+    if (_bench.list)
+        return _list_selected();
+    size_t selected = 0;
+    for (size_t i = 0; i < _bench.count; i++)
+        selected += _selected(_bench.entries[i].name);
+    _bench.hist = (_bench_hist_t **)calloc(_bench.count ? _bench.count : 1, sizeof(_bench_hist_t *));
+    _bench.fit = (__typeof__(_bench.fit))calloc(_bench.count ? _bench.count : 1, sizeof(*_bench.fit));
+    if (!_bench.hist || !_bench.fit)
+    {
+        fprintf(stderr, "warning: out of memory for %zu benchmarks\n", _bench.count);
+        return 1;
+    }
+    if (_bench.reps > BENCH_MAX_REPETITIONS)
+    {
+        fprintf(stderr, "warning: at most %d repetitions are kept; running %d\n", BENCH_MAX_REPETITIONS,
+                BENCH_MAX_REPETITIONS);
+        _bench.reps = BENCH_MAX_REPETITIONS;
+    }
+    if (_bench.reps > 1 && _bench.isolate)
+    {
+        fprintf(stderr, "warning: repetitions pool samples in one process; isolated benchmarks run once\n");
+        _bench.reps = 0;
+    }
+    if (_bench.reps > 1 && !_bench.seed)
+        _bench.seed = bench_now();
+    if (_bench.history)
+        _capture(); /* runs git, so before the process is pinned and locked */
+    _stabilize(); /* before calibration, so it runs where the benchmarks will */
+    _timer_init();
+    void *tracker = dlsym(RTLD_DEFAULT, "bench_alloc_counters");
+    memcpy(&_bench.alloc, &tracker, sizeof(_bench.alloc)); /* ISO C has no object-to-function cast */
+    _bench.perf_fd[0] = -1;
+    if (_bench.perf)
+        _perf_open();
+    const double *ovh = _overhead(1);
+    _pause_cost();
+    if (!_bench.quiet)
+    {
+        char runs[64];
+        if (_bench.max_time > 0)
+            snprintf(runs, sizeof(runs), "%.2f-%.2f s to median +-%.2f%%", _bench.min_time, _bench.max_time,
+                     _bench.precision * 100.0);
+        else
+            snprintf(runs, sizeof(runs), "%lu iterations", (unsigned long)_bench.iters);
+        if (selected < _bench.count)
+            printf("Running %zu of %zu benchmarks", selected, _bench.count);
+        else
+            printf("Running %zu benchmarks", _bench.count);
+        printf(" (%s, %lu warmup, %s timer, %.1f ns overhead, %.1f ns floor, %.1f ns pause%s)...\n", runs,
+               (unsigned long)_bench.warmup, _bench.use_tsc ? "tsc" : "clock", ovh[0], ovh[1],
+               _bench.pause_cost * _bench.ns_per_tick, _bench.alloc ? ", tracking allocations" : "");
+        if (_bench.reps > 1)
+            printf("Repetitions: %d interleaved rounds, seed %llu\n", _bench.reps, (unsigned long long)_bench.seed);
+        if (_bench.stable)
+            printf("Stable: CPU %d, %s, memory %s; governor %s, %d SMT siblings, load %.2f\n", _bench.cpu,
+                   _bench.fifo ? "SCHED_FIFO" : "normal scheduling", _bench.locked ? "locked" : "unlocked",
+                   _bench.governor[0] ? _bench.governor : "unknown", _bench.smt, _bench.load);
+    }
+    if (_bench.suite_setup)
+        _bench.suite_setup();
+    const int orchestrate = _bench.jobs > 1 && !_bench.shards;
+    if (_bench.samples_file && (_bench.isolate || orchestrate))
+        fprintf(stderr, "warning: raw samples stay in the child processes of isolated and BENCH_JOBS runs; "
+                        "not writing %s\n", _bench.samples_file);
+    else if (_bench.samples_file && !(_bench.raw = fopen(_bench.samples_file, "wb")))
+        fprintf(stderr, "warning: cannot write raw samples to %s: %s\n", _bench.samples_file, strerror(errno));
+    else if (_bench.samples_file)
+    {
+        static const char header[32]; /* filled in by _raw_close */
+        _raw_put(header, sizeof(header));
+    }
+    const int failed = orchestrate ? _run_shards() : _run_selected(_bench.shard, _bench.shards);
+    if (_bench.suite_teardown)
+        _bench.suite_teardown();
+    const int sampled = _bench.raw != NULL;
+    if (sampled && _raw_close() != 0)
+        fprintf(stderr, "warning: could not write all raw samples to %s\n", _bench.samples_file);
+    _fit_complexity();
+    _scaling();
+    _machine_profile();
+    const int regressed = _bench.baseline ? _compare_baseline() : 0;
+    if (!_bench.quiet)
+        _print_results();
+    _write_csv();
+    if (_bench.json_file)
+        _write_json();
+    if (_bench.hist_file)
+        _write_hist();
+    if (_bench.history)
+        _write_history();
+    if (!_bench.quiet && failed)
+        printf("%d of %zu benchmarks failed\n", failed, selected);
+    if (!_bench.quiet && _bench.baseline)
+        printf("%d regression(s) slower than %.3g%% with disjoint 95%% CIs against %s%s\n", regressed,
+               _bench.threshold * 100.0, _bench.baseline,
+               _bench.reps > 1 ? "" : "; without BENCH_REPETITIONS these exclude run-to-run variance");
+    if (!_bench.quiet && sampled && !_bench.raw_failed)
+        printf("Raw samples: %s\n", _bench.samples_file);
+    if (!_bench.quiet)
+        printf("Results: %s\n", _bench.csv_file);
+    return failed + regressed;
 }
 
 #endif
@@ -7,6 +7,7 @@
 #   1. Compiles your benchmark file (single-header or linked)
 #   2. Runs benchmarks with configurable iterations
 #   3. Outputs CSV (and optionally generates Jupyter notebook)
+#   4. Appends the run to bench_history.bin in the output directory
 
 set -e
 
@@ -18,34 +19,99 @@ RED='\033[0;31m'; GREEN='\033[0;32m'; YELLOW='\033[1;33m'; NC='\033[0m'
 usage() {
     cat << EOF
 Usage: $0 <source.c> [options]
+       $0 compare <base.csv|json> <new.csv|json> [-t PCT] [--base-hist F --new-hist F]
+       $0 history <bench_history.bin> runs|show [RUN]|trend [GLOB...] [--host H] [--last N]
 
 Options:
   -n, --notebook     Generate Jupyter notebook
   -o, --output DIR   Output directory (default: .)
   -i, --iters N      Iteration count (default: 1000)
-  -w, --warmup N     Warmup iterations (default: 100)
+  -w, --warmup N     Warmup iterations (default: 100), or 'auto' to warm up until steady
+  -b, --batch-ns NS  Batch calls so each sample spans NS nanoseconds
   -q, --quiet        Minimal output
   -s, --single       Use single-header mode (no library linking)
+  --shard I/N        Run only shard I of N (merge with scripts/merge_results.py)
+  -j, --jobs K       Run K shards in parallel, one per physical core
+  -r, --repetitions R  Run every benchmark R times in shuffled, interleaved rounds
+  --seed S           Seed of the round order (default: time; printed with the run)
+  -f, --filter PATS  Run only matching benchmarks: comma-separated globs, re:REGEX, -PAT excludes
+  -l, --list         Print the names a run would execute, and exit
+  -a, --alloc        Count heap allocations per call (preloads build/lib/libbenchalloc.so)
+  -m, --machine      Also measure cache latencies and memory bandwidth (machine/*)
+  -c, --cold         Also run every benchmark with its data evicted before each call
+  --rate R           Also drive every benchmark open loop at R calls/s (50k, 2M), or 'sweep'
+  --slo NS           Open loop: p99 target in ns; a sweep finds the highest rate meeting it
   --venv             Create venv with notebook deps
   -h, --help         Show this help
 
 Environment variables:
   BENCH_ITERS        Override iteration count
-  BENCH_WARMUP       Override warmup count
+  BENCH_WARMUP       Override warmup count, or auto (set by -w)
+  BENCH_WARMUP_TOL   Automatic warmup: relative agreement of recent windows (default 0.03)
+  BENCH_WARMUP_MAX_TIME  Automatic warmup: seconds before giving up (default 1)
   BENCH_CSV          Override output CSV path
   BENCH_QUIET        Set to 1 for quiet mode
+  BENCH_BATCH_NS     Target duration of one timed sample (batched mode)
+  BENCH_TIMER        Timer backend: auto, tsc, clock
+  BENCH_SUBTRACT_OVERHEAD  Set to 1 to subtract measured harness overhead
+  BENCH_PERF         Set to 1 to read hardware counters (perf_event_open)
+  BENCH_STREAM       Set to 1 for constant-memory histogram statistics
+  BENCH_HIST         Write latency histograms to this CSV (set by -n)
+  BENCH_SAMPLES      Write every raw sample to this binary file (plotted by -n)
+  BENCH_SAMPLES_COMPRESS  Set to 1 to delta+varint encode the raw samples
+  BENCH_MAX_TIME     Seconds per benchmark; runs adaptively instead of BENCH_ITERS
+  BENCH_MIN_TIME     Minimum seconds per benchmark in adaptive mode
+  BENCH_PRECISION    Adaptive target for the median's relative CI (default 0.01)
+  BENCH_PIN_THREADS  Set to 1 to pin threaded benchmark workers to CPUs
+  BENCH_STABLE       Set to 1 to pin, lock memory and check the machine first
+  BENCH_CPU          CPU for stable mode (implies BENCH_STABLE=1)
+  BENCH_FIFO         SCHED_FIFO priority for stable mode (implies BENCH_STABLE=1)
+  BENCH_ISOLATE      Set to 1 to run each benchmark in its own forked child
+  BENCH_TIMEOUT      Seconds before an isolated benchmark is killed (0: no limit)
+  BENCH_SHARD        I/N: run only the benchmark families of shard I (set by --shard)
+  BENCH_JOBS         Shards to run in parallel on separate cores (set by -j)
+  BENCH_REPETITIONS  Interleaved repetitions of the whole suite (set by -r, at most 64)
+  BENCH_SEED         Seed of the repetition order, to replay a run (set by --seed)
+  BENCH_FILTER       Benchmarks to run, e.g. "sort*,re:^hash/[0-9]+\$,-*slow*" (set by -f)
+  BENCH_LIST         Set to 1 to list the selected benchmarks instead of running (set by -l)
+  BENCH_MACHINE      1, or the largest working set like 256M, to run the machine suite (set by -m)
+  BENCH_COLD         1, or a filter like BENCH_FILTER's, to also run those benchmarks cold (set by -c)
+  BENCH_COLD_ITERS   Samples of a cold run (default 100); each one sweeps the last-level cache
+  BENCH_RATE         Calls per second of an open-loop run, or sweep (set by --rate)
+  BENCH_SLO          p99 target of the open loop in ns (set by --slo)
+  BENCH_ARRIVALS     constant (default) or poisson gaps between open-loop calls
+  BENCH_RATE_TIME    Seconds at each open-loop rate (default 0.5)
+  BENCH_BASELINE     Earlier results CSV/JSON; regressions count toward the exit status
+  BENCH_THRESHOLD    Percent slowdown that counts as a regression (default 5)
+  BENCH_HISTORY      Append each run to this history (default: OUTPUT_DIR/bench_history.bin,
+                     empty to disable)
+  BENCH_LABEL        Free-text note stored with the run in the history
+  BENCH_COMMIT, BENCH_COMPILER, BENCH_CFLAGS
+                     Recorded in the history (set from git and the compile below)
 
 Examples:
   $0 mybench.c                    # Quick run
   $0 mybench.c -n                 # Run + notebook
   $0 mybench.c -i 10000 -n        # More iterations + notebook
   BENCH_ITERS=50000 $0 mybench.c  # Via env var
+  $0 mybench.c -j 4               # Four shards on four cores, one merged CSV
+  $0 mybench.c -f 'sort*,-*/1024' -l  # What the filter selects
+  $0 mybench.c -a                 # Also allocations, bytes and leaks per call
+  $0 mybench.c -w auto            # Warm each benchmark up until its timings settle
+  $0 mybench.c -m -f 'machine/*'  # Only the machine profile: caches and bandwidth
+  BENCH_COLD='bst_*' $0 mybench.c # Hot and cold side by side for the bst_ benchmarks
+  $0 mybench.c --rate sweep --slo 5000  # Highest rate per benchmark with p99 <= 5 us
+  $0 compare base.json new.json   # Exit 1 on a significant slowdown over 5%
 EOF
     exit 1
 }
 
+# Comparing runs or querying the history needs no build
+[[ "$1" == "compare" ]] && { shift; exec python3 "${SCRIPT_DIR}/compare.py" "$@"; }
+[[ "$1" == "history" ]] && { shift; exec python3 "${SCRIPT_DIR}/history.py" "$@"; }
+
 # Defaults
-NOTEBOOK=0; OUTPUT_DIR="."; QUIET=0; SINGLE=0; VENV=0; ITERS=""; WARMUP=""; SOURCE=""
+NOTEBOOK=0; OUTPUT_DIR="."; QUIET=0; SINGLE=0; VENV=0; ITERS=""; WARMUP=""; BATCH_NS=""; SHARD=""; JOBS=""; REPS=""; SEED=""; FILTER=""; LIST=0; ALLOC=0; MACHINE=0; COLD=0; RATE=""; SLO=""; SOURCE=""
 
 while [[ $# -gt 0 ]]; do
     case $1 in
@@ -53,8 +119,20 @@ while [[ $# -gt 0 ]]; do
         -o|--output) OUTPUT_DIR="$2"; shift 2 ;;
         -i|--iters) ITERS="$2"; shift 2 ;;
         -w|--warmup) WARMUP="$2"; shift 2 ;;
+        -b|--batch-ns) BATCH_NS="$2"; shift 2 ;;
         -q|--quiet) QUIET=1; shift ;;
         -s|--single) SINGLE=1; shift ;;
+        --shard) SHARD="$2"; shift 2 ;;
+        -j|--jobs) JOBS="$2"; shift 2 ;;
+        -r|--repetitions) REPS="$2"; shift 2 ;;
+        --seed) SEED="$2"; shift 2 ;;
+        -f|--filter) FILTER="$2"; shift 2 ;;
+        -l|--list) LIST=1; shift ;;
+        -a|--alloc) ALLOC=1; shift ;;
+        -m|--machine) MACHINE=1; shift ;;
+        -c|--cold) COLD=1; shift ;;
+        --rate) RATE="$2"; shift 2 ;;
+        --slo) SLO="$2"; shift 2 ;;
         --venv) VENV=1; shift ;;
         -h|--help) usage ;;
         -*) echo -e "${RED}Unknown option: $1${NC}"; usage ;;
@@ -74,13 +152,32 @@ mkdir -p "$OUTPUT_DIR"
 # Set env vars for runtime config
 [[ -n "$ITERS" ]] && export BENCH_ITERS="$ITERS"
 [[ -n "$WARMUP" ]] && export BENCH_WARMUP="$WARMUP"
+[[ -n "$BATCH_NS" ]] && export BENCH_BATCH_NS="$BATCH_NS"
 [[ $QUIET -eq 1 ]] && export BENCH_QUIET=1
+[[ -n "$SHARD" ]] && export BENCH_SHARD="$SHARD"
+[[ -n "$JOBS" ]] && export BENCH_JOBS="$JOBS"
+[[ -n "$REPS" ]] && export BENCH_REPETITIONS="$REPS"
+[[ -n "$SEED" ]] && export BENCH_SEED="$SEED"
+[[ -n "$FILTER" ]] && export BENCH_FILTER="$FILTER"
+[[ $LIST -eq 1 ]] && { export BENCH_LIST=1; QUIET=1; } # just the names
+[[ $MACHINE -eq 1 && -z "$BENCH_MACHINE" ]] && export BENCH_MACHINE=1
+[[ $COLD -eq 1 && -z "$BENCH_COLD" ]] && export BENCH_COLD=1
+[[ -n "$RATE" ]] && export BENCH_RATE="$RATE"
+[[ -n "$SLO" ]] && export BENCH_SLO="$SLO"
+[[ $NOTEBOOK -eq 1 && -z "$BENCH_HIST" ]] && export BENCH_HIST="$(cd "$OUTPUT_DIR" && pwd)/benchmark_histograms.csv"
+
+# What produced the numbers, for the run history
+CFLAGS="-O2"
+[[ -z "${BENCH_HISTORY+x}" ]] && export BENCH_HISTORY="$(cd "$OUTPUT_DIR" && pwd)/bench_history.bin"
+[[ -z "$BENCH_CFLAGS" ]] && export BENCH_CFLAGS="$CFLAGS"
+[[ -z "$BENCH_COMPILER" ]] && export BENCH_COMPILER="$(gcc --version | head -n 1)"
+[[ -z "$BENCH_COMMIT" ]] && export BENCH_COMMIT="$(git -C "$(dirname "$SOURCE")" describe --always --dirty 2>/dev/null || true)"
 
 # Compile
 if [[ $SINGLE -eq 1 ]] || grep -q "BENCHMARK_IMPLEMENTATION" "$SOURCE" 2>/dev/null; then
     # Single-header mode - no library needed
     [[ $QUIET -eq 0 ]] && echo -e "${GREEN}Compiling (single-header)...${NC}"
-    gcc -O2 -I"${ROOT_DIR}/include" "$SOURCE" -lm -o "$BINARY"
+    gcc $CFLAGS -I"${ROOT_DIR}/include" "$SOURCE" -lm -lpthread -ldl -o "$BINARY"
 else
     # Library mode - build lib if needed
     LIB="${ROOT_DIR}/build/lib/libbenchmark.a"
@@ -89,18 +186,35 @@ else
         make -C "$ROOT_DIR" lib >/dev/null 2>&1
     fi
     [[ $QUIET -eq 0 ]] && echo -e "${GREEN}Compiling...${NC}"
-    gcc -O2 -I"${ROOT_DIR}/include" "$SOURCE" -L"${ROOT_DIR}/build/lib" -lbenchmark -lm -o "$BINARY"
+    gcc $CFLAGS -I"${ROOT_DIR}/include" "$SOURCE" -L"${ROOT_DIR}/build/lib" -lbenchmark -lm -lpthread -ldl -o "$BINARY"
+fi
+
+# The allocation tracker replaces malloc and friends in the benchmark process only
+PRELOAD=""
+if [[ $ALLOC -eq 1 ]]; then
+    PRELOAD="${ROOT_DIR}/build/lib/libbenchalloc.so"
+    [[ -f "$PRELOAD" ]] || make -C "$ROOT_DIR" lib >/dev/null 2>&1
 fi
 
-# Run
-(cd "$OUTPUT_DIR" && "./$BASENAME")
+# Run; the exit status is the number of failed benchmarks, reported after the notebook
+STATUS=0
+if [[ -n "$PRELOAD" ]]; then
+    (cd "$OUTPUT_DIR" && LD_PRELOAD="$PRELOAD" "./$BASENAME") || STATUS=$?
+else
+    (cd "$OUTPUT_DIR" && "./$BASENAME") || STATUS=$?
+fi
 
-# Notebook
-if [[ $NOTEBOOK -eq 1 ]]; then
+# Notebook; a listing writes no results
+if [[ $NOTEBOOK -eq 1 && $LIST -eq 0 ]]; then
     NB="${OUTPUT_DIR}/benchmark_analysis.ipynb"
     VENV_FLAG=""
     [[ $VENV -eq 1 ]] && VENV_FLAG="--venv"
-    python3 "${ROOT_DIR}/scripts/generate_notebook.py" "$CSV" -o "$NB" $VENV_FLAG
+    HIST_FLAG=""
+    [[ -f "$BENCH_HIST" ]] && HIST_FLAG="--hist $BENCH_HIST"
+    [[ -n "$BENCH_SAMPLES" && -f "$BENCH_SAMPLES" ]] && HIST_FLAG="$HIST_FLAG --samples $BENCH_SAMPLES"
+    [[ -n "$BENCH_HISTORY" && -f "$BENCH_HISTORY" ]] && HIST_FLAG="$HIST_FLAG --history $BENCH_HISTORY"
+    python3 "${ROOT_DIR}/scripts/generate_notebook.py" "$CSV" -o "$NB" $VENV_FLAG $HIST_FLAG
     [[ $QUIET -eq 0 ]] && echo -e "${GREEN}Notebook: ${NB}${NC}"
 fi
 
+exit $STATUS
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""Compare two benchmark runs and gate on regressions.
+
+Benchmarks are matched by name. With latency histograms of both runs
+(BENCH_HIST) a two-sided Mann-Whitney U test decides whether the
+distributions differ; otherwise the 95% CIs of the medians must not overlap.
+Each CI is widened to at least half a timer tick per call, and with
+repetitions to two standard deviations of their medians: one run's CI
+leaves out run-to-run variance. Exits 1 when a significant slowdown exceeds
+the threshold.
+"""
+import sys, csv, json, math, argparse
+from pathlib import Path
+
+
+def gate_interval(median, lo, hi, ns_per_tick, batch, reps_stddev):
+    """The CI, at least half a tick per call either side (samples are whole
+    ticks, so a CI can collapse onto one value), and at least two standard
+    deviations of the repetition medians when the run was repeated."""
+    half = max(0.5 * ns_per_tick / max(batch, 1), 2.0 * reps_stddev)
+    return min(lo, median - half), max(hi, median + half)
+
+
+def load_results(path):
+    """name -> (median, ci_low, ci_high) from a results CSV or JSON. The CSV
+    does not record the timer, so a tick counts as 1 ns, the clock's."""
+    out = {}
+    if Path(path).suffix.lower() == '.json':
+        data = json.load(open(path))
+        ticks_per_ns = data.get('timer', {}).get('ticks_per_ns') or 1.0
+        for b in data['benchmarks']:
+            if b.get('error'):
+                continue
+            lo, hi = b.get('median_ci_ns', [b['median_ns'], b['median_ns']])
+            reps = b.get('repetitions', {})
+            sd = reps.get('stddev_ns', 0.0) if reps.get('count', 0) > 1 else 0.0
+            out[b['name']] = (b['median_ns'],) + gate_interval(b['median_ns'], lo, hi, 1.0 / ticks_per_ns,
+                                                               b.get('batch_size', 1), sd)
+    else:
+        for r in csv.DictReader(open(path, newline='')):
+            if r.get('error'):
+                continue
+            median = float(r['median_ns'])
+            sd = float(r.get('repetition_stddev_ns') or 0) if int(r.get('repetitions') or 0) > 1 else 0.0
+            out[r['name']] = (median,) + gate_interval(median, float(r.get('median_ci_low_ns') or median),
+                                                       float(r.get('median_ci_high_ns') or median), 1.0,
+                                                       int(r.get('batch_size') or 1), sd)
+    return out
+
+
+def load_histograms(path):
+    """name -> [(bucket midpoint ns, count)] from a BENCH_HIST CSV."""
+    out = {}
+    for r in csv.DictReader(open(path, newline='')):
+        mid = (float(r['lower_ns']) + float(r['upper_ns'])) / 2.0
+        out.setdefault(r['name'], []).append((mid, int(r['count'])))
+    return out
+
+
+def mann_whitney(a, b):
+    """Two-sided p-value of Mann-Whitney U for binned samples, normal
+    approximation with tie correction; every bucket is one tied value. Also
+    returns the sign of the shift: 1 when b tends to be larger than a."""
+    values = sorted({v for v, _ in a} | {v for v, _ in b})
+    ca, cb = dict(), dict()
+    for v, c in a:
+        ca[v] = ca.get(v, 0) + c
+    for v, c in b:
+        cb[v] = cb.get(v, 0) + c
+    n1, n2 = sum(ca.values()), sum(cb.values())
+    if n1 == 0 or n2 == 0:
+        return float('nan'), 0
+    rank, r1, ties = 0, 0.0, 0.0
+    for v in values:
+        t = ca.get(v, 0) + cb.get(v, 0)
+        r1 += ca.get(v, 0) * (rank + (t + 1) / 2.0)
+        ties += t ** 3 - t
+        rank += t
+    n = n1 + n2
+    u = r1 - n1 * (n1 + 1) / 2.0
+    shift = (u < n1 * n2 / 2.0) - (u > n1 * n2 / 2.0)
+    var = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if var <= 0:
+        return 1.0, shift
+    z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(var)
+    return math.erfc(max(z, 0.0) / math.sqrt(2.0)), shift
+
+
+def compare(base, new, base_hist, new_hist, threshold, alpha):
+    rows, regressions = [], 0
+    for name in new:
+        if name not in base:
+            continue
+        (bm, blo, bhi), (nm, nlo, nhi) = base[name], new[name]
+        change = nm / bm - 1.0 if bm > 0 else float('nan')
+        # Range of the change with each median anywhere in its CI
+        low = nlo / bhi - 1.0 if bhi > 0 else float('nan')
+        high = nhi / blo - 1.0 if blo > 0 else float('nan')
+        # Direction of the change: from the rank test when there is one, as
+        # bucketed medians can tie while the distributions still differ
+        direction = (change > 0) - (change < 0)
+        if base_hist is not None and name in base_hist and name in new_hist:
+            p, shift = mann_whitney(base_hist[name], new_hist[name])
+            significant, test = p < alpha, f"p={p:.2g}"
+            direction = shift or direction
+        else:
+            significant, test = nlo > bhi or nhi < blo, "CI"
+        if not significant or direction == 0:
+            verdict = "same"
+        elif direction > 0 and change > threshold:
+            verdict, regressions = "REGRESSION", regressions + 1
+        else:
+            verdict = "slower" if direction > 0 else "faster"
+        rows.append((name, bm, nm, change, low, high, test, verdict))
+    return rows, regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare benchmark results against a baseline")
+    parser.add_argument("base", help="Baseline results (CSV or JSON)")
+    parser.add_argument("new", help="New results (CSV or JSON)")
+    parser.add_argument("--base-hist", help="Baseline histogram CSV (BENCH_HIST) for Mann-Whitney U")
+    parser.add_argument("--new-hist", help="New histogram CSV (BENCH_HIST) for Mann-Whitney U")
+    parser.add_argument("-t", "--threshold", type=float, default=5.0,
+                        help="Percent slowdown that fails the comparison (default 5)")
+    parser.add_argument("--alpha", type=float, default=0.05, help="Significance level (default 0.05)")
+    args = parser.parse_args()
+    if bool(args.base_hist) != bool(args.new_hist):
+        parser.error("--base-hist and --new-hist go together")
+
+    base, new = load_results(args.base), load_results(args.new)
+    base_hist = load_histograms(args.base_hist) if args.base_hist else None
+    new_hist = load_histograms(args.new_hist) if args.new_hist else None
+    rows, regressions = compare(base, new, base_hist, new_hist, args.threshold / 100.0, args.alpha)
+
+    print(f"{'Benchmark':<30} {'Base(ns)':>10} {'New(ns)':>10} {'Change':>8} {'95% range':>19} {'Test':>8}  Verdict")
+    for name, bm, nm, change, low, high, test, verdict in rows:
+        span = f"[{low * 100:+.1f}%, {high * 100:+.1f}%]"
+        print(f"{name:<30} {bm:>10.1f} {nm:>10.1f} {change * 100:>+7.1f}% {span:>19} {test:>8}  {verdict}")
+    for name in sorted(set(base) - set(new)):
+        print(f"{name:<30} only in {args.base}")
+    for name in sorted(set(new) - set(base)):
+        print(f"{name:<30} only in {args.new}")
+    if regressions:
+        print(f"{regressions} regression(s) slower than {args.threshold:g}%")
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -13,7 +13,8 @@ def ensure_venv(outdir: Path):
     subprocess.run([str(pip), "install", "-q", "-r", str(req)], check=True)
     print(f"Installed deps. Activate: source {venv}/bin/activate")
 
-def create_notebook_cells(csv_path: str) -> list:
+def create_notebook_cells(csv_path: str, hist_path: str = None, samples_path: str = None,
+                          history_path: str = None) -> list:
     """Create notebook cells for benchmark analysis."""
     cells = []
 
@@ -55,6 +56,10 @@ def create_notebook_cells(csv_path: str) -> list:
         "source": [
             f"# Load benchmark data\n",
             f"df = pd.read_csv('{csv_path}')\n",
+            "# Benchmarks that failed under BENCH_ISOLATE have an error and no statistics\n",
+            "if 'error' in df and df['error'].notna().any():\n",
+            "    display(df[df['error'].notna()][['name', 'error']])\n",
+            "    df = df[df['error'].isna()].reset_index(drop=True)\n",
             "print(f'Loaded {len(df)} benchmark results')\n",
             "df"
         ]
@@ -156,6 +161,182 @@ def create_notebook_cells(csv_path: str) -> list:
         ]
     })
 
+    # Throughput (BENCH_SET_BYTES / BENCH_SET_ITEMS); older CSVs have no rate columns
+    cells.append({
+        "cell_type": "markdown",
+        "metadata": {},
+        "source": ["## Throughput\n", "\n",
+                   "Declared bytes and items per call at the measured call rate."]
+    })
+
+    cells.append({
+        "cell_type": "code",
+        "metadata": {},
+        "execution_count": None,
+        "outputs": [],
+        "source": [
+            "rates = [(col, scale, label) for col, scale, label in\n",
+            "         [('bytes_per_second', 1e-9, 'GB/s'), ('items_per_second', 1e-6, 'M items/s'), ('ns_per_item', 1, 'ns/item')]\n",
+            "         if col in df and df[col].notna().any()]\n",
+            "if rates:\n",
+            "    fig, axes = plt.subplots(1, len(rates), figsize=(6 * len(rates), 5), squeeze=False)\n",
+            "    for ax, (col, scale, label) in zip(axes[0], rates):\n",
+            "        d = df[df[col].notna()]\n",
+            "        ax.barh(d['name'], d[col] * scale)\n",
+            "        ax.set_xlabel(label)\n",
+            "        ax.invert_yaxis()\n",
+            "    plt.tight_layout()\n",
+            "    plt.show()\n",
+            "    display(df[df[[c for c, _, _ in rates]].notna().any(axis=1)][['name'] + [c for c, _, _ in rates]])\n",
+            "# BENCH_COUNTER rates per second, stored as 'name=rate;...'\n",
+            "user = {}\n",
+            "for name, cell in zip(df['name'], df['user_counters'].fillna('') if 'user_counters' in df else []):\n",
+            "    for pair in filter(None, str(cell).split(';')):\n",
+            "        key, value = pair.split('=', 1)\n",
+            "        user.setdefault(name, {})[key] = float(value)\n",
+            "if user:\n",
+            "    display(pd.DataFrame.from_dict(user, orient='index'))"
+        ]
+    })
+
+    # Hot vs cold (BENCH_COLD); older CSVs and runs without it have no cold columns
+    cells.append({
+        "cell_type": "markdown",
+        "metadata": {},
+        "source": ["## Hot vs Cold\n", "\n",
+                   "Benchmarks run again with their data evicted from the caches and the TLB before every call."]
+    })
+
+    cells.append({
+        "cell_type": "code",
+        "metadata": {},
+        "execution_count": None,
+        "outputs": [],
+        "source": [
+            "if 'cold_median_ns' in df and df['cold_median_ns'].notna().any():\n",
+            "    d = df[df['cold_median_ns'].notna()]\n",
+            "    fig, axes = plt.subplots(1, 2, figsize=(14, max(3, 0.4 * len(d))))\n",
+            "    for ax, (hot, cold, label) in zip(axes, [('median_ns', 'cold_median_ns', 'Median'), ('p99_ns', 'cold_p99_ns', 'P99')]):\n",
+            "        y = range(len(d))\n",
+            "        ax.barh([i - 0.2 for i in y], d[hot], 0.4, label='hot')\n",
+            "        ax.barh([i + 0.2 for i in y], d[cold], 0.4, label='cold')\n",
+            "        ax.set_yticks(list(y))\n",
+            "        ax.set_yticklabels(d['name'])\n",
+            "        ax.set_xscale('log')\n",
+            "        ax.set_xlabel(f'{label} (ns)')\n",
+            "        ax.invert_yaxis()\n",
+            "        ax.legend()\n",
+            "    plt.tight_layout()\n",
+            "    plt.show()\n",
+            "    display(d[['name', 'median_ns', 'cold_median_ns', 'cold_slowdown', 'p99_ns', 'cold_p99_ns', 'cold_evict_ns']])\n",
+            "else:\n",
+            "    print('No cold runs; set BENCH_COLD=1 or bench.sh -c')"
+        ]
+    })
+
+    if hist_path:
+        cells.extend(create_histogram_cells(hist_path))
+
+    if samples_path:
+        cells.extend(create_samples_cells(samples_path))
+
+    if history_path:
+        cells.extend(create_history_cells(history_path))
+
+    # Parameter sweeps (BENCH_PARAM); older CSVs have no arg column
+    cells.append({
+        "cell_type": "markdown",
+        "metadata": {},
+        "source": ["## Parameter Sweeps\n", "\n",
+                   "Median time per call against the argument, log-log. Kinks show crossovers and cache levels."]
+    })
+
+    cells.append({
+        "cell_type": "code",
+        "metadata": {},
+        "execution_count": None,
+        "outputs": [],
+        "source": [
+            "sweeps = df[df['arg'].notna()].copy() if 'arg' in df else df.iloc[0:0]\n",
+            "sweeps['family'] = sweeps['name'].str.rsplit('/', n=1).str[0]\n",
+            "if len(sweeps):\n",
+            "    fig, ax = plt.subplots(figsize=(12, 6))\n",
+            "    for family, g in sweeps.groupby('family', sort=False):\n",
+            "        ax.plot(g['arg'], g['median_ns'], marker='o', label=family)\n",
+            "    ax.set_xscale('log')\n",
+            "    ax.set_yscale('log')\n",
+            "    ax.set_xlabel('arg')\n",
+            "    ax.set_ylabel('Median (ns)')\n",
+            "    ax.legend(fontsize='small', ncol=2)\n",
+            "    plt.tight_layout()\n",
+            "    plt.show()"
+        ]
+    })
+
+    # Thread scaling (BENCH_THREADED); older CSVs have no threads column
+    cells.append({
+        "cell_type": "markdown",
+        "metadata": {},
+        "source": ["## Thread Scaling\n", "\n",
+                   "Aggregate throughput against thread count; the dashed line is perfect scaling from 1 thread."]
+    })
+
+    cells.append({
+        "cell_type": "code",
+        "metadata": {},
+        "execution_count": None,
+        "outputs": [],
+        "source": [
+            "threaded = df[df['name'].str.contains('/threads:')].copy() if 'threads' in df else df.iloc[0:0]\n",
+            "threaded['family'] = threaded['name'].str.rsplit('/threads:', n=1).str[0]\n",
+            "if len(threaded):\n",
+            "    fig, ax = plt.subplots(figsize=(12, 6))\n",
+            "    for family, g in threaded.groupby('family', sort=False):\n",
+            "        line, = ax.plot(g['threads'], g['throughput'], marker='o', label=family)\n",
+            "        base = g[g['threads'] == 1]['throughput']\n",
+            "        if len(base):\n",
+            "            ax.plot(g['threads'], g['threads'] * base.iloc[0], '--', color=line.get_color(), alpha=0.5)\n",
+            "    ax.set_xscale('log', base=2)\n",
+            "    ax.set_xlabel('threads')\n",
+            "    ax.set_ylabel('calls/s')\n",
+            "    ax.legend(fontsize='small', ncol=2)\n",
+            "    plt.tight_layout()\n",
+            "    plt.show()\n",
+            "    display(threaded[['name', 'threads', 'throughput', 'scaling_efficiency', 'median_ns', 'p99_ns']])"
+        ]
+    })
+
+    # Repetitions (BENCH_REPETITIONS); older CSVs have no repetitions column
+    cells.append({
+        "cell_type": "markdown",
+        "metadata": {},
+        "source": ["## Repetitions\n", "\n",
+                   "Spread of the per-repetition medians: bars are their mean, whiskers one standard deviation, ",
+                   "dots the pooled median. A wide whisker means run-to-run noise, not sample noise."]
+    })
+
+    cells.append({
+        "cell_type": "code",
+        "metadata": {},
+        "execution_count": None,
+        "outputs": [],
+        "source": [
+            "repeated = df[df['repetitions'] > 1] if 'repetitions' in df else df.iloc[0:0]\n",
+            "if len(repeated):\n",
+            "    fig, ax = plt.subplots(figsize=(max(8, 0.6 * len(repeated)), 6))\n",
+            "    x = range(len(repeated))\n",
+            "    ax.bar(x, repeated['repetition_mean_ns'], yerr=repeated['repetition_stddev_ns'], capsize=4, alpha=0.6)\n",
+            "    ax.plot(x, repeated['median_ns'], 'o', color='black', label='pooled median')\n",
+            "    ax.set_xticks(x, repeated['name'], rotation=45, ha='right')\n",
+            "    ax.set_ylabel('Median per repetition (ns)')\n",
+            "    ax.legend()\n",
+            "    plt.tight_layout()\n",
+            "    plt.show()\n",
+            "    cv = 100 * repeated['repetition_stddev_ns'] / repeated['repetition_mean_ns']\n",
+            "    display(repeated[['name', 'repetitions', 'repetition_median_ns', 'repetition_stddev_ns']].assign(cv_pct=cv))"
+        ]
+    })
+
     # Custom analysis section
     cells.append({
         "cell_type": "markdown",
@@ -174,7 +355,300 @@ def create_notebook_cells(csv_path: str) -> list:
     return cells
 
 
-def create_notebook(csv_path: str) -> dict:
+def create_histogram_cells(hist_path: str) -> list:
+    """Cells plotting the per-benchmark latency histograms (BENCH_HIST output)."""
+    return [
+        {
+            "cell_type": "markdown",
+            "metadata": {},
+            "source": ["## Latency Distributions\n", "\n",
+                       "Log-linear histogram buckets; bounds are ns per call."]
+        },
+        {
+            "cell_type": "code",
+            "metadata": {},
+            "execution_count": None,
+            "outputs": [],
+            "source": [
+                f"hist = pd.read_csv('{hist_path}')\n",
+                "names = hist['name'].unique()\n",
+                "fig, axes = plt.subplots(len(names), 1, figsize=(12, 2.5 * len(names)), squeeze=False)\n",
+                "for ax, name in zip(axes[:, 0], names):\n",
+                "    h = hist[hist['name'] == name]\n",
+                "    density = h['count'] / (h['upper_ns'] - h['lower_ns']) / h['count'].sum()\n",
+                "    ax.bar(h['lower_ns'], density, width=h['upper_ns'] - h['lower_ns'], align='edge')\n",
+                "    ax.set_xscale('log')\n",
+                "    ax.set_title(name)\n",
+                "    ax.set_ylabel('density')\n",
+                "axes[-1, 0].set_xlabel('Time (ns)')\n",
+                "plt.tight_layout()\n",
+                "plt.show()"
+            ]
+        },
+        {
+            "cell_type": "code",
+            "metadata": {},
+            "execution_count": None,
+            "outputs": [],
+            "source": [
+                "# Cumulative distribution per benchmark\n",
+                "fig, ax = plt.subplots(figsize=(12, 6))\n",
+                "for name in names:\n",
+                "    h = hist[hist['name'] == name]\n",
+                "    ax.step(h['upper_ns'], h['count'].cumsum() / h['count'].sum(), where='post', label=name)\n",
+                "ax.set_xscale('log')\n",
+                "ax.set_xlabel('Time (ns)')\n",
+                "ax.set_ylabel('Fraction of samples')\n",
+                "ax.legend(fontsize='small', ncol=2)\n",
+                "plt.tight_layout()\n",
+                "plt.show()"
+            ]
+        },
+    ]
+
+
+def create_samples_cells(samples_path: str) -> list:
+    """Cells plotting every raw sample (BENCH_SAMPLES output) from a memory map."""
+    return [
+        {
+            "cell_type": "markdown",
+            "metadata": {},
+            "source": ["## Raw Samples\n", "\n",
+                       "Every timed sample, memory-mapped: raw blocks are never copied whole, histograms are ",
+                       "built chunk by chunk, and the violin and time-series plots use evenly spaced samples, ",
+                       "so 100M+ sample runs stay fast. Times are ns per call after overhead subtraction."]
+        },
+        {
+            "cell_type": "code",
+            "metadata": {},
+            "execution_count": None,
+            "outputs": [],
+            "source": [
+                "import numpy as np\n",
+                "\n",
+                "CHUNK = 1 << 24        # samples converted at a time\n",
+                "MAX_POINTS = 200_000   # per benchmark in the violin and time-series plots\n",
+                "\n",
+                "# Layout in src/samples.h: header, 8-byte aligned blocks, then the index\n",
+                f"raw = np.memmap('{samples_path}', dtype=np.uint8, mode='r')\n",
+                "header = raw[:32].view([('magic', 'S8'), ('version', '<u4'), ('count', '<u4'),\n",
+                "                        ('ns_per_tick', '<f8'), ('index', '<u8')])[0]\n",
+                "assert header['magic'] == b'BENCHRAW' and header['version'] == 1, 'not a BENCH_SAMPLES file'\n",
+                "record = np.dtype([('name', 'S128'), ('offset', '<u8'), ('bytes', '<u8'), ('count', '<u8'),\n",
+                "                   ('batch', '<u8'), ('subtract', '<f8'), ('width', '<u4'), ('encoding', '<u4'),\n",
+                "                   ('threads', '<u4'), ('reserved', '<u4')])\n",
+                "start = int(header['index'])\n",
+                "index = raw[start:start + int(header['count']) * record.itemsize].view(record)\n",
+                "names = [r['name'].decode() for r in index]\n",
+                "# With BENCH_REPETITIONS a benchmark has one block per repetition, in run order\n",
+                "groups = {}\n",
+                "for rec, name in zip(index, names):\n",
+                "    groups.setdefault(name, []).append(rec)\n",
+                "\n",
+                "def varint_decode(b):\n",
+                "    \"\"\"Zigzag LEB128 deltas back to samples, vectorised a chunk at a time.\"\"\"\n",
+                "    out, prev, pos = [], 0, 0\n",
+                "    while pos < len(b):\n",
+                "        part = np.asarray(b[pos:pos + CHUNK])\n",
+                "        last = np.flatnonzero(part < 0x80)\n",
+                "        part = part[:last[-1] + 1]\n",
+                "        first = np.r_[0, last[:-1] + 1]\n",
+                "        shift = ((np.arange(len(part)) - np.repeat(first, last - first + 1)) * 7).astype(np.uint64)\n",
+                "        z = np.add.reduceat((part & 0x7f).astype(np.uint64) << shift, first)\n",
+                "        d = (z >> np.uint64(1)).astype(np.int64) ^ -(z & np.uint64(1)).astype(np.int64)\n",
+                "        v = np.cumsum(d) + prev\n",
+                "        prev = v[-1]\n",
+                "        out.append(v.astype(np.uint64))\n",
+                "        pos += len(part)\n",
+                "    return np.concatenate(out) if out else np.zeros(0, np.uint64)\n",
+                "\n",
+                "def ticks(rec):\n",
+                "    \"\"\"Per-batch ticks of one benchmark; raw blocks are a view of the map.\"\"\"\n",
+                "    block = raw[int(rec['offset']):int(rec['offset']) + int(rec['bytes'])]\n",
+                "    return block.view(f\"<u{rec['width']}\") if rec['encoding'] == 0 else varint_decode(block)\n",
+                "\n",
+                "def to_ns(rec, t):\n",
+                "    return np.maximum(t.astype(np.float64) - rec['subtract'], 0.0) * header['ns_per_tick'] / rec['batch']\n",
+                "\n",
+                "def chunks(recs):\n",
+                "    for rec in recs:\n",
+                "        t = ticks(rec)\n",
+                "        for i in range(0, len(t), CHUNK):\n",
+                "            yield to_ns(rec, t[i:i + CHUNK])\n",
+                "\n",
+                "def thin(recs):\n",
+                "    \"\"\"Sample numbers and ns of at most MAX_POINTS evenly spaced samples of the blocks.\"\"\"\n",
+                "    step = max(1, int(sum(r['count'] for r in recs)) // MAX_POINTS)\n",
+                "    i, ns, base = [], [], 0\n",
+                "    for rec in recs:\n",
+                "        t = ticks(rec)\n",
+                "        i.append(base + np.arange(0, len(t), step))\n",
+                "        ns.append(to_ns(rec, t[::step]))\n",
+                "        base += len(t)\n",
+                "    return np.concatenate(i), np.concatenate(ns)\n",
+                "\n",
+                "display(pd.DataFrame({'name': names, 'samples': index['count'], 'batch': index['batch'],\n",
+                "                      'threads': index['threads'],\n",
+                "                      'encoding': np.where(index['encoding'] == 0, 'u' + (8 * index['width']).astype(str), 'varint'),\n",
+                "                      'MB': index['bytes'] / 1e6}))"
+            ]
+        },
+        {
+            "cell_type": "code",
+            "metadata": {},
+            "execution_count": None,
+            "outputs": [],
+            "source": [
+                "# Exact histograms and CDFs over every sample, two passes over the map\n",
+                "fig, (ax, cx) = plt.subplots(2, 1, figsize=(12, 10))\n",
+                "for name, recs in groups.items():\n",
+                "    if not sum(r['count'] for r in recs):\n",
+                "        continue\n",
+                "    lo, hi = np.inf, 0.0\n",
+                "    for ns in chunks(recs):\n",
+                "        lo, hi = min(lo, ns.min()), max(hi, ns.max())\n",
+                "    lo = max(lo, 1e-3)\n",
+                "    edges = np.geomspace(lo, max(hi, lo * 1.01), 201)\n",
+                "    counts = sum(np.histogram(np.clip(ns, lo, None), edges)[0] for ns in chunks(recs))\n",
+                "    ax.stairs(counts / counts.sum(), edges, label=name)\n",
+                "    cx.plot(edges[1:], np.cumsum(counts) / counts.sum(), label=name)\n",
+                "ax.set_xscale('log')\n",
+                "ax.set_ylabel('Fraction of samples')\n",
+                "cx.set_xscale('log')\n",
+                "cx.set_xlabel('Time (ns)')\n",
+                "cx.set_ylabel('Cumulative fraction')\n",
+                "ax.legend(fontsize='small', ncol=2)\n",
+                "plt.tight_layout()\n",
+                "plt.show()"
+            ]
+        },
+        {
+            "cell_type": "code",
+            "metadata": {},
+            "execution_count": None,
+            "outputs": [],
+            "source": [
+                "# Violins of log10(ns) from evenly spaced samples\n",
+                "kept = [(name, thin(recs)[1]) for name, recs in groups.items() if sum(r['count'] for r in recs)]\n",
+                "fig, ax = plt.subplots(figsize=(max(8, 0.8 * len(kept)), 6))\n",
+                "ax.violinplot([np.log10(np.maximum(ns, 1e-3)) for _, ns in kept], showmedians=True)\n",
+                "ax.set_xticks(range(1, len(kept) + 1), [name for name, _ in kept], rotation=45, ha='right')\n",
+                "ax.set_ylabel('log10 time (ns)')\n",
+                "plt.tight_layout()\n",
+                "plt.show()"
+            ]
+        },
+        {
+            "cell_type": "code",
+            "metadata": {},
+            "execution_count": None,
+            "outputs": [],
+            "source": [
+                "# Samples in the order they were taken: drift, warmup and periodic interference.\n",
+                "# Threaded runs hold each thread's samples in turn, split by dotted lines;\n",
+                "# dashed lines split repetitions.\n",
+                "fig, axes = plt.subplots(len(groups), 1, figsize=(12, 2.5 * len(groups)), squeeze=False)\n",
+                "for ax, (name, recs) in zip(axes[:, 0], groups.items()):\n",
+                "    i, ns = thin(recs)\n",
+                "    ax.plot(i, ns, '.', markersize=1, alpha=0.3)\n",
+                "    w = max(1, len(ns) // 200)\n",
+                "    if len(ns) >= 2 * w:\n",
+                "        m = len(ns) // w\n",
+                "        ax.plot(i[:m * w].reshape(m, w).mean(axis=1), np.median(ns[:m * w].reshape(m, w), axis=1),\n",
+                "                color='black', linewidth=1, label='rolling median')\n",
+                "    base = 0\n",
+                "    for rec in recs:\n",
+                "        if base:\n",
+                "            ax.axvline(base, color='gray', linestyle='--')\n",
+                "        for t in range(1, int(rec['threads'])):\n",
+                "            ax.axvline(base + t * int(rec['count']) // int(rec['threads']), color='gray', linestyle=':')\n",
+                "        base += int(rec['count'])\n",
+                "    ax.set_yscale('log')\n",
+                "    ax.set_title(name)\n",
+                "    ax.set_ylabel('ns')\n",
+                "axes[-1, 0].set_xlabel('Sample')\n",
+                "plt.tight_layout()\n",
+                "plt.show()"
+            ]
+        },
+    ]
+
+
+def create_history_cells(history_path: str) -> list:
+    """Cells plotting per-benchmark trends from the run history (BENCH_HISTORY)."""
+    return [
+        {
+            "cell_type": "markdown",
+            "metadata": {},
+            "source": ["## History\n", "\n",
+                       "Median per benchmark over the last 50 runs recorded from the newest run's host, ",
+                       "oldest first, labelled by run and commit. Error bars are the medians' 95% CIs. ",
+                       "`scripts/history.py` queries the same file from the shell."]
+        },
+        {
+            "cell_type": "code",
+            "metadata": {},
+            "execution_count": None,
+            "outputs": [],
+            "source": [
+                "import sys\n",
+                f"sys.path.insert(0, '{Path(__file__).resolve().parent}')\n",
+                "from history import History\n",
+                "\n",
+                f"history = History('{history_path}')\n",
+                "host = history.strings[history.runs['host'][-1]] if len(history.runs) else None\n",
+                "trend = pd.DataFrame(history.table(host=host, last=50))\n",
+                "trend = trend[~trend['failed']]\n",
+                "runs = history.select_runs(host, 50)\n",
+                "display(pd.DataFrame({'run': runs['run'],\n",
+                "                      'date': pd.to_datetime(runs['time'], unit='s'),\n",
+                "                      'commit': history.text[runs['commit']], 'label': history.text[runs['label']],\n",
+                "                      'compiler': history.text[runs['compiler']], 'cflags': history.text[runs['cflags']],\n",
+                "                      'benchmarks': runs['benchmarks']}))"
+            ]
+        },
+        {
+            "cell_type": "code",
+            "metadata": {},
+            "execution_count": None,
+            "outputs": [],
+            "source": [
+                "# Every benchmark relative to its first run in the window, then the first 12 in detail\n",
+                "order = {r: i for i, r in enumerate(sorted(trend['run'].unique()))}\n",
+                "ticks = trend.drop_duplicates('run').sort_values('run')\n",
+                "labels = [f\"{r}:{c[:10]}\" if c else str(r) for r, c in zip(ticks['run'], ticks['commit'])]\n",
+                "names = list(dict.fromkeys(trend['name']))\n",
+                "if names:\n",
+                "    fig, ax = plt.subplots(figsize=(12, 6))\n",
+                "    for name in names:\n",
+                "        g = trend[trend['name'] == name]\n",
+                "        ax.plot(g['run'].map(order), g['median_ns'] / g['median_ns'].iloc[0], marker='.', label=name)\n",
+                "    ax.axhline(1.0, color='gray', linestyle=':')\n",
+                "    ax.set_xticks(range(len(labels)), labels, rotation=45, ha='right', fontsize='small')\n",
+                "    ax.set_ylabel('Median / first median')\n",
+                "    if len(names) <= 20:\n",
+                "        ax.legend(fontsize='small', ncol=2)\n",
+                "    plt.tight_layout()\n",
+                "    plt.show()\n",
+                "\n",
+                "    shown = names[:12]\n",
+                "    fig, axes = plt.subplots(len(shown), 1, figsize=(12, 2.5 * len(shown)), sharex=True, squeeze=False)\n",
+                "    for ax, name in zip(axes[:, 0], shown):\n",
+                "        g = trend[trend['name'] == name]\n",
+                "        ax.errorbar(g['run'].map(order), g['median_ns'],\n",
+                "                    yerr=[g['median_ns'] - g['ci_low_ns'], g['ci_high_ns'] - g['median_ns']], marker='o', capsize=3)\n",
+                "        ax.set_title(name)\n",
+                "        ax.set_ylabel('Median (ns)')\n",
+                "    axes[-1, 0].set_xticks(range(len(labels)), labels, rotation=45, ha='right', fontsize='small')\n",
+                "    plt.tight_layout()\n",
+                "    plt.show()"
+            ]
+        },
+    ]
+
+
+def create_notebook(csv_path: str, hist_path: str = None, samples_path: str = None,
+                    history_path: str = None) -> dict:
     """Create a complete Jupyter notebook structure."""
     return {
         "nbformat": 4,
@@ -190,7 +664,7 @@ def create_notebook(csv_path: str) -> dict:
                 "version": "3.10.0"
             }
         },
-        "cells": create_notebook_cells(csv_path)
+        "cells": create_notebook_cells(csv_path, hist_path, samples_path, history_path)
     }
 
 
@@ -198,6 +672,9 @@ def main():
     parser = argparse.ArgumentParser(description="Generate notebook for benchmark analysis")
     parser.add_argument("csv_file", help="Path to benchmark results CSV")
     parser.add_argument("-o", "--output", help="Output notebook path", default="benchmark_analysis.ipynb")
+    parser.add_argument("--hist", help="Histogram CSV written via BENCH_HIST")
+    parser.add_argument("--samples", help="Raw sample file written via BENCH_SAMPLES")
+    parser.add_argument("--history", help="Run history written via BENCH_HISTORY")
     parser.add_argument("--venv", action="store_true", help="Create venv with deps")
     args = parser.parse_args()
 
@@ -208,7 +685,10 @@ def main():
         ensure_venv(output_path.parent.resolve())
 
     with open(output_path, 'w') as f:
-        json.dump(create_notebook(str(csv_path)), f, indent=2)
+        hist_path = str(Path(args.hist).resolve()) if args.hist else None
+        samples_path = str(Path(args.samples).resolve()) if args.samples else None
+        history_path = str(Path(args.history).resolve()) if args.history else None
+        json.dump(create_notebook(str(csv_path), hist_path, samples_path, history_path), f, indent=2)
 
     print(f"Generated: {output_path}")
 
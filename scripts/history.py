@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Query the run history written via BENCH_HISTORY.
+
+The file is an array of 64-byte records (layout in src/history.h), so it is
+memory-mapped and sliced with numpy; thousands of runs load in milliseconds.
+Trends should compare runs from one machine, so most commands take --host.
+"""
+import sys, csv, argparse, datetime, fnmatch
+import numpy as np
+
+RECORD = 64
+STRING = np.dtype([('tag', '<u4'), ('id', '<u4'), ('part', '<u4'), ('length', '<u4'), ('text', 'S48')])
+RUN = np.dtype([('tag', '<u4'), ('run', '<u4'), ('time', '<i8'), ('host', '<u4'), ('cpu', '<u4'),
+                ('kernel', '<u4'), ('compiler', '<u4'), ('cflags', '<u4'), ('commit', '<u4'), ('timer', '<u4'),
+                ('label', '<u4'), ('benchmarks', '<u4'), ('flags', '<u4'), ('load_average', '<f8')])
+RESULT = np.dtype([('tag', '<u4'), ('run', '<u4'), ('name', '<u4'), ('flags', '<u4'), ('median_ns', '<f8'),
+                   ('ci_low_ns', '<f8'), ('ci_high_ns', '<f8'), ('mean_ns', '<f8'), ('p99_ns', '<f8'),
+                   ('iterations', '<u8')])
+TAG_STRING, TAG_RUN, TAG_RESULT = 1, 2, 3
+RUN_FLAGS = {1: 'stable', 2: 'streaming', 4: 'isolated', 8: 'sharded'}
+VERDICTS = ['', 'same', 'faster', 'slower', 'regression']
+
+
+class History:
+    """Runs and results of a history file; *_id fields index strings."""
+
+    def __init__(self, path):
+        try:
+            raw = np.memmap(path, dtype=np.uint8, mode='r')
+        except (OSError, ValueError) as e:
+            sys.exit(f"error: {path}: {e}")
+        if len(raw) < RECORD or bytes(raw[:8]) != b'BENCHHST' or int(raw[8:12].view('<u4')[0]) != 1:
+            sys.exit(f"error: {path} is not a benchmark history file")
+        records = raw[RECORD:len(raw) - len(raw) % RECORD].reshape(-1, RECORD)
+        tags = np.ascontiguousarray(records[:, :4]).view('<u4').ravel()
+        self.runs = records[tags == TAG_RUN].reshape(-1).view(RUN)
+        self.results = records[tags == TAG_RESULT].reshape(-1).view(RESULT)
+        strings = records[tags == TAG_STRING].reshape(-1).view(STRING)
+        self.strings = ['']
+        for part, length, text in zip(strings['part'].tolist(), strings['length'].tolist(),
+                                      strings['text'].tolist()):
+            text = text[:length].decode(errors='replace')
+            if part == 0:
+                self.strings.append(text)
+            else:
+                self.strings[-1] += text
+        self.text = np.array(self.strings, dtype=object)
+
+    def select_runs(self, host=None, last=None):
+        """Run records, oldest first, optionally of one host and only the last N."""
+        runs = self.runs
+        if host is not None:
+            runs = runs[self.text[runs['host']] == host]
+        return runs[-last:] if last else runs
+
+    def table(self, patterns=('*',), host=None, last=None):
+        """Column dict with one row per result of the selected runs whose
+        name matches one of the glob patterns."""
+        runs = self.select_runs(host, last)
+        res = self.results[np.isin(self.results['run'], runs['run'])]
+        names = self.text[res['name']]
+        wanted = {n for n in set(names) if any(fnmatch.fnmatchcase(n, p) for p in patterns)}
+        res = res[np.isin(names, list(wanted))]
+        row = np.searchsorted(runs['run'], res['run'])
+        return {
+            'run': res['run'], 'time': runs['time'][row], 'commit': self.text[runs['commit'][row]],
+            'label': self.text[runs['label'][row]], 'host': self.text[runs['host'][row]],
+            'name': self.text[res['name']], 'median_ns': res['median_ns'], 'ci_low_ns': res['ci_low_ns'],
+            'ci_high_ns': res['ci_high_ns'], 'p99_ns': res['p99_ns'],
+            'failed': (res['flags'] & 1).astype(bool),
+        }
+
+
+def when(t):
+    return datetime.datetime.fromtimestamp(int(t)).strftime('%Y-%m-%d %H:%M')
+
+
+def cmd_runs(h, args):
+    print(f"{'Run':>5}  {'Date':<16}  {'Commit':<14} {'Host':<16} {'Compiler':<22} {'Flags':<14} {'#':>4}  Label")
+    for r in h.select_runs(args.host, args.last):
+        flags = ','.join(v for k, v in RUN_FLAGS.items() if r['flags'] & k) or '-'
+        print(f"{r['run']:>5}  {when(r['time']):<16}  {h.strings[r['commit']] or '-':<14.14} "
+              f"{h.strings[r['host']]:<16.16} {h.strings[r['compiler']]:<22.22} {flags:<14} "
+              f"{r['benchmarks']:>4}  {h.strings[r['label']]}")
+
+
+def cmd_show(h, args):
+    runs = h.runs[h.runs['run'] == args.run] if args.run else h.runs[-1:]
+    if not len(runs):
+        sys.exit(f"error: no run {args.run}")
+    r = runs[0]
+    for key in ('host', 'cpu', 'kernel', 'compiler', 'cflags', 'commit', 'timer', 'label'):
+        print(f"{key + ':':<10}{h.strings[r[key]]}")
+    print(f"{'date:':<10}{when(r['time'])}, load {r['load_average']:.2f}\n")
+    print(f"{'Benchmark':<30} {'Median(ns)':>11} {'95% CI':>23} {'p99(ns)':>11} {'Iters':>10}  Verdict")
+    for x in h.results[h.results['run'] == r['run']]:
+        ci = f"[{x['ci_low_ns']:.1f}, {x['ci_high_ns']:.1f}]"
+        verdict = 'FAILED' if x['flags'] & 1 else VERDICTS[min((x['flags'] >> 8) & 0xff, 4)]
+        print(f"{h.strings[x['name']]:<30} {x['median_ns']:>11.1f} {ci:>23} {x['p99_ns']:>11.1f} "
+              f"{x['iterations']:>10}  {verdict}")
+
+
+def cmd_trend(h, args):
+    t = h.table(args.patterns or ['*'], args.host, args.last)
+    if args.csv:
+        with open(args.csv, 'w', newline='') as f:
+            w = csv.writer(f, lineterminator='\n')
+            w.writerow(list(t))
+            w.writerows(zip(*t.values()))
+        print(f"Wrote {len(t['run'])} rows: {args.csv}")
+        return
+    # '*' marks a change whose CIs do not overlap those of the previous run
+    for name in dict.fromkeys(t['name']):
+        rows = np.flatnonzero((t['name'] == name) & ~t['failed'])
+        print(f"\n{name}")
+        prev = None
+        for i in rows:
+            change = ''
+            if prev is not None and t['median_ns'][prev] > 0:
+                disjoint = t['ci_low_ns'][i] > t['ci_high_ns'][prev] or t['ci_high_ns'][i] < t['ci_low_ns'][prev]
+                change = f"{(t['median_ns'][i] / t['median_ns'][prev] - 1) * 100:+7.1f}%{'*' if disjoint else ' '}"
+            print(f"  {t['run'][i]:>5}  {when(t['time'][i])}  {t['commit'][i] or '-':<14.14} "
+                  f"{t['median_ns'][i]:>11.1f} ns  [{t['ci_low_ns'][i]:.1f}, {t['ci_high_ns'][i]:.1f}]  {change}")
+            prev = i
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Query a benchmark run history (BENCH_HISTORY)")
+    parser.add_argument("history", help="History file")
+    sub = parser.add_subparsers(dest="command", required=True)
+    runs = sub.add_parser("runs", help="List runs with their environment")
+    show = sub.add_parser("show", help="Environment and results of one run")
+    show.add_argument("run", type=int, nargs='?', help="Run number (default: the last)")
+    trend = sub.add_parser("trend", help="Median of each benchmark across runs")
+    trend.add_argument("patterns", nargs='*', help="Benchmark name globs (default: all)")
+    trend.add_argument("--csv", help="Write the rows to this CSV instead")
+    for p in (runs, trend):
+        p.add_argument("--host", help="Only runs from this host")
+        p.add_argument("--last", type=int, help="Only the last N runs")
+    args = parser.parse_args()
+
+    h = History(args.history)
+    {'runs': cmd_runs, 'show': cmd_show, 'trend': cmd_trend}[args.command](h, args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Merge per-shard benchmark results (BENCH_SHARD=i/N) into one file.
+
+Rows are ordered by their `index` column (registration order), so the merged
+file is the same whichever order the shards finished or are listed in.
+"""
+import sys, csv, json, argparse
+from pathlib import Path
+
+
+def merge_csv(paths, output):
+    header, rows = None, []
+    for path in paths:
+        with open(path, newline='') as f:
+            reader = csv.reader(f)
+            h = next(reader)
+            if header is None:
+                header = h
+            elif h != header:
+                sys.exit(f"error: {path}: columns differ from {paths[0]}")
+            rows.extend(reader)
+    if 'index' not in header:
+        sys.exit("error: no index column; rebuild the benchmarks with sharding support")
+    key = header.index('index')
+    rows.sort(key=lambda r: int(r[key]))
+    check_unique([int(r[key]) for r in rows])
+    with open(output, 'w', newline='') as f:
+        writer = csv.writer(f, lineterminator='\n')
+        writer.writerow(header)
+        writer.writerows(rows)
+    return len(rows)
+
+
+def merge_json(paths, output):
+    docs = [json.load(open(p)) for p in paths]
+    shards = [d.get('shards', {}) for d in docs]
+    counts = {s.get('count') for s in shards}
+    if len(counts) != 1 or None in counts:
+        print(f"warning: inputs disagree on the shard count: {sorted(map(str, counts))}", file=sys.stderr)
+    missing = set(range(max(c or 0 for c in counts))) - {s.get('index') for s in shards}
+    if missing:
+        print(f"warning: shards {sorted(missing)} are missing", file=sys.stderr)
+
+    benchmarks = sorted((b for d in docs for b in d['benchmarks']), key=lambda b: b['index'])
+    check_unique([b['index'] for b in benchmarks])
+    # A family never spans shards, so each fit is kept whole, ordered by its first instance
+    first = {}
+    for b in benchmarks:
+        first.setdefault(b['name'].rsplit('/', 1)[0], b['index'])
+    complexity = sorted((c for d in docs for c in d.get('complexity', [])),
+                        key=lambda c: first.get(c['name'], len(benchmarks)))
+
+    merged = {k: v for k, v in docs[0].items() if k not in ('shards', 'benchmarks', 'complexity')}
+    merged['shards'] = {'count': len(docs), 'merged': shards,
+                        'environment': [d.get('environment') for d in docs]}
+    merged['benchmarks'] = benchmarks
+    merged['complexity'] = complexity
+    with open(output, 'w') as f:
+        json.dump(merged, f, indent=2)
+        f.write('\n')
+    return len(benchmarks)
+
+
+def check_unique(indexes):
+    dups = sorted({i for i in indexes if indexes.count(i) > 1})
+    if dups:
+        print(f"warning: benchmarks {dups} appear in more than one input", file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Merge per-shard benchmark CSV or JSON results")
+    parser.add_argument("inputs", nargs='+', help="Per-shard result files, all CSV or all JSON")
+    parser.add_argument("-o", "--output", required=True, help="Merged output file")
+    args = parser.parse_args()
+
+    kinds = {Path(p).suffix.lower() for p in args.inputs}
+    if kinds == {'.csv'}:
+        n = merge_csv(args.inputs, args.output)
+    elif kinds == {'.json'}:
+        n = merge_json(args.inputs, args.output)
+    else:
+        sys.exit("error: inputs must be all .csv or all .json")
+    print(f"Merged {n} results from {len(args.inputs)} shards: {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,101 @@
+#define _GNU_SOURCE
+
+#include "alloc.h"
+#include <errno.h>
+#include <malloc.h>
+#include <stddef.h>
+
+/* glibc's own entry points; calling them directly needs no dlsym(RTLD_NEXT),
+ * which itself allocates, during startup. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+
+/* Initial-exec, so reaching them never calls __tls_get_addr, which may allocate */
+static __thread bench_alloc_counters_t t_counters __attribute__((tls_model("initial-exec")));
+
+bench_alloc_counters_t *bench_alloc_counters(void)
+{
+    return &t_counters;
+}
+
+static void *counted(void *ptr, size_t size)
+{
+    if (ptr)
+    {
+        t_counters.allocs++;
+        t_counters.bytes += size;
+        t_counters.live += (int64_t)malloc_usable_size(ptr);
+        if (t_counters.live > t_counters.peak)
+            t_counters.peak = t_counters.live;
+    }
+    return ptr;
+}
+
+void *malloc(size_t size)
+{
+    return counted(__libc_malloc(size), size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    return counted(__libc_calloc(count, size), count * size);
+}
+
+/* A resize counts as a free and an allocation, as it may move the block */
+void *realloc(void *ptr, size_t size)
+{
+    const size_t old = ptr ? malloc_usable_size(ptr) : 0;
+    void *grown = __libc_realloc(ptr, size);
+    if (ptr && (grown || size == 0))
+    {
+        t_counters.frees++;
+        t_counters.live -= (int64_t)old;
+    }
+    return counted(grown, size);
+}
+
+void free(void *ptr)
+{
+    if (ptr)
+    {
+        t_counters.frees++;
+        t_counters.live -= (int64_t)malloc_usable_size(ptr);
+    }
+    __libc_free(ptr);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    return counted(__libc_memalign(alignment, size), size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return counted(__libc_memalign(alignment, size), size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    if (alignment == 0 || alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    void *ptr = counted(__libc_memalign(alignment, size), size);
+    if (!ptr && size)
+        return ENOMEM;
+    *out = ptr;
+    return 0;
+}
+
+void *valloc(size_t size)
+{
+    return counted(__libc_valloc(size), size);
+}
+
+void *pvalloc(size_t size)
+{
+    return counted(__libc_pvalloc(size), size);
+}
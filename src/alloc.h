@@ -0,0 +1,23 @@
+#ifndef BENCH_ALLOC_H
+#define BENCH_ALLOC_H
+
+#include <stdint.h>
+
+/* Allocation tracker: build/lib/libbenchalloc.so, loaded with LD_PRELOAD,
+ * replaces malloc and friends with wrappers that forward to glibc and count
+ * into the calling thread's counters. The harness looks the counters up by
+ * name at startup, so nothing links against the shim and a run without it
+ * pays nothing. */
+#define BENCH_ALLOC_SYMBOL "bench_alloc_counters"
+
+typedef struct
+{
+    uint64_t allocs, frees, bytes; /* bytes as requested */
+    int64_t live;                  /* usable bytes allocated minus freed by this thread */
+    int64_t peak;                  /* highest live since the harness last lowered it */
+} bench_alloc_counters_t;
+
+/* The calling thread's counters */
+typedef bench_alloc_counters_t *(*bench_alloc_counters_fn)(void);
+
+#endif
@@ -0,0 +1,152 @@
+#define _GNU_SOURCE
+
+#include "baseline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Field k of a CSV line into buf, quotes stripped; NULL past the last field. */
+static const char *csv_field(const char *line, int k, char *buf, size_t size)
+{
+    for (int i = 0;; i++)
+    {
+        const int quoted = *line == '"';
+        const char *p = line + quoted;
+        size_t n = 0;
+        for (; *p && (quoted ? *p != '"' : *p != ',' && *p != '\n' && *p != '\r'); p++)
+            if (n + 1 < size)
+                buf[n++] = *p;
+        buf[n] = '\0';
+        p += quoted && *p == '"';
+        if (i == k)
+            return buf;
+        if (*p != ',')
+            return NULL;
+        line = p + 1;
+    }
+}
+
+/* Column of a CSV header, or -1 */
+static int csv_column(const char *header, const char *name)
+{
+    char buf[64];
+    for (int k = 0; csv_field(header, k, buf, sizeof(buf)); k++)
+        if (strcmp(buf, name) == 0)
+            return k;
+    return -1;
+}
+
+typedef struct
+{
+    int name, median, low, high, error, batch, reps, reps_stddev;
+} csv_columns_t;
+
+static int parse_csv(const char *line, const csv_columns_t *col, baseline_entry_t *e)
+{
+    char buf[64];
+    const size_t size = strlen(line) + 1; /* no field is longer than the line */
+    if (col->error >= 0 && csv_field(line, col->error, buf, sizeof(buf)) && buf[0])
+        return -1;
+    if (!csv_field(line, col->median, buf, sizeof(buf)) || !(e->name = malloc(size)))
+        return -1;
+    if (!csv_field(line, col->name, e->name, size))
+    {
+        free(e->name);
+        return -1;
+    }
+    e->median_ns = e->ci_low_ns = e->ci_high_ns = strtod(buf, NULL);
+    if (col->low >= 0 && csv_field(line, col->low, buf, sizeof(buf)))
+        e->ci_low_ns = strtod(buf, NULL);
+    if (col->high >= 0 && csv_field(line, col->high, buf, sizeof(buf)))
+        e->ci_high_ns = strtod(buf, NULL);
+    e->batch = col->batch >= 0 && csv_field(line, col->batch, buf, sizeof(buf)) ? strtoull(buf, NULL, 10) : 0;
+    e->reps_stddev_ns = 0.0;
+    if (col->reps >= 0 && csv_field(line, col->reps, buf, sizeof(buf)) && atoi(buf) > 1 &&
+        col->reps_stddev >= 0 && csv_field(line, col->reps_stddev, buf, sizeof(buf)))
+        e->reps_stddev_ns = strtod(buf, NULL);
+    return 0;
+}
+
+/* bench_write_json puts each benchmark on one line. */
+static int parse_json(char *line, baseline_entry_t *e)
+{
+    const char *name = strstr(line, "{\"name\":\""), *median = strstr(line, "\"median_ns\":");
+    const char *ci = strstr(line, "\"median_ci_ns\":["), *batch = strstr(line, "\"batch_size\":");
+    const char *reps = strstr(line, "\"repetitions\":{");
+    if (!name || !median || strstr(line, "\"error\":\""))
+        return -1;
+    name += strlen("{\"name\":\"");
+    if (!(e->name = strndup(name, strcspn(name, "\""))))
+        return -1;
+    e->median_ns = e->ci_low_ns = e->ci_high_ns = strtod(median + strlen("\"median_ns\":"), NULL);
+    if (ci && sscanf(ci + strlen("\"median_ci_ns\":["), "%lf,%lf", &e->ci_low_ns, &e->ci_high_ns) != 2)
+        e->ci_low_ns = e->ci_high_ns = e->median_ns;
+    e->batch = batch ? strtoull(batch + strlen("\"batch_size\":"), NULL, 10) : 0;
+    e->reps_stddev_ns = 0.0;
+    int count = 0;
+    if (reps && sscanf(reps, "\"repetitions\":{\"count\":%d", &count) == 1 && count > 1 &&
+        (reps = strstr(reps, "\"stddev_ns\":")))
+        e->reps_stddev_ns = strtod(reps + strlen("\"stddev_ns\":"), NULL);
+    return 0;
+}
+
+int baseline_load(const char *path, baseline_entry_t **entries)
+{
+    FILE *fp = fopen(path, "r");
+    char *line = NULL;
+    size_t size = 0;
+    int count = 0, json = -1;
+    csv_columns_t col = {-1, -1, -1, -1, -1, -1, -1, -1};
+    *entries = NULL;
+    if (!fp)
+        return -1;
+    baseline_entry_t *all = NULL;
+    size_t cap = 0;
+    int failed = 0;
+    while (getline(&line, &size, fp) > 0)
+    {
+        if (json < 0) /* the first line tells the format */
+        {
+            json = line[0] == '{';
+            col.name = csv_column(line, "name");
+            col.median = csv_column(line, "median_ns");
+            col.low = csv_column(line, "median_ci_low_ns");
+            col.high = csv_column(line, "median_ci_high_ns");
+            col.error = csv_column(line, "error");
+            col.batch = csv_column(line, "batch_size");
+            col.reps = csv_column(line, "repetitions");
+            col.reps_stddev = csv_column(line, "repetition_stddev_ns");
+            if (!json && (col.name < 0 || col.median < 0))
+                break;
+            continue;
+        }
+        if ((size_t)count == cap)
+        {
+            baseline_entry_t *grown = realloc(all, (cap = cap ? cap * 2 : 256) * sizeof(*all));
+            if (!grown)
+            {
+                failed = 1;
+                break;
+            }
+            all = grown;
+        }
+        if ((json ? parse_json(line, &all[count]) : parse_csv(line, &col, &all[count])) == 0)
+            count++;
+    }
+    free(line);
+    fclose(fp);
+    if (failed)
+    {
+        baseline_free(all, count);
+        return -1;
+    }
+    *entries = all;
+    return count;
+}
+
+void baseline_free(baseline_entry_t *entries, int count)
+{
+    for (int i = 0; i < count; i++)
+        free(entries[i].name);
+    free(entries);
+}
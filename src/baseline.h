@@ -0,0 +1,21 @@
+#ifndef BENCH_BASELINE_H
+#define BENCH_BASELINE_H
+
+#include "benchmark.h"
+
+/* A benchmark's median and its 95% CI from an earlier run */
+typedef struct
+{
+    char *name;
+    double median_ns, ci_low_ns, ci_high_ns;
+    uint64_t batch;        /* calls per sample, 0 if not recorded */
+    double reps_stddev_ns; /* of the repetitions' medians, 0 unless repeated */
+} baseline_entry_t;
+
+/* Reads the benchmarks of a CSV or JSON file written by bench_write_csv or
+ * bench_write_json, skipping failed ones, into a malloc'ed array. Returns
+ * how many, or -1 if the file cannot be read. */
+int baseline_load(const char *path, baseline_entry_t **entries);
+void baseline_free(baseline_entry_t *entries, int count);
+
+#endif
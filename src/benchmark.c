@@ -1,57 +1,188 @@
-#define _POSIX_C_SOURCE 199309L
+#define _GNU_SOURCE
 
 #include "benchmark.h"
+#include "alloc.h"
+#include "baseline.h"
+#include "cold.h"
+#include "environment.h"
+#include "histogram.h"
+#include "machine.h"
+#include "history.h"
+#include "samples.h"
+#include "perf.h"
+#include "registry.h"
+#include "stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#include <pthread.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#define BENCH_HAVE_COUNTER 1
+#elif defined(__aarch64__)
+#define BENCH_HAVE_COUNTER 1
+#else
+#define BENCH_HAVE_COUNTER 0
+#endif
+
+#define BENCH_OVERHEAD_SAMPLES 1000
+#define BENCH_STREAM_CHUNK 4096
+#define BENCH_MIN_SAMPLES 64 /* first round of an adaptive run */
+#define BENCH_MAX_SHARDS 64
+#define BENCH_WARMUP_SAMPLES 32    /* per window of an automatic warmup */
+#define BENCH_WARMUP_WINDOWS 5     /* recent windows that must agree */
+#define BENCH_WARMUP_SAMPLE_NS 1000 /* its samples batch calls up to this long */
+#define BENCH_RATE_MIN_CALLS 1000 /* in a sweep's runs, so a p99 is more than the slowest call */
 
 typedef struct
 {
     bench_fn_t fn;
-    char name[BENCH_MAX_NAME_LEN];
-    char description[BENCH_MAX_NAME_LEN];
+    const char *name, *description; /* in the registry's arena */
+    int has_arg;
+    int64_t arg;
+    int threads; /* 0 runs on the calling thread */
 } bench_entry_t;
 
+/* What one benchmark has collected over its repetitions so far */
+typedef struct
+{
+    uint64_t *samples; /* of every repetition, in exact mode */
+    uint64_t n, cap;
+    uint64_t batch; /* chosen by the first repetition and kept, so samples stay comparable */
+    histogram_t *hist;
+    bench_counters_t counters; /* summed, like the three below */
+    double pauses, throughput, elapsed;
+    int failed; /* a repetition failed, so the benchmark did */
+    int lost;   /* out of memory for the samples; the last repetition stands */
+} repeat_pool_t;
+
+typedef struct
+{
+    const char *name; /* benchmark or family name */
+    bench_fn_t setup, teardown;
+    int per_iteration;
+} bench_fixture_t;
+
+int64_t bench_current_arg;
+__thread int bench_current_thread;
+
 static struct
 {
-    bench_entry_t benchmarks[BENCH_MAX_BENCHMARKS];
-    bench_result_t results[BENCH_MAX_BENCHMARKS];
-    size_t count;
-    size_t result_count;
+    bench_entry_t *benchmarks; /* registration order; every array here grows by doubling */
+    bench_result_t *results;
+    histogram_t **histograms; /* parallel to results */
+    bench_complexity_t *complexity;
+    bench_fixture_t *fixtures;
+    registry_t names;            /* benchmark names, and the arena of every copied name */
+    registry_t fixture_names[2]; /* benchmark and iteration fixtures */
+    registry_filter_t filter;
+    int filter_invalid; /* selects nothing rather than the whole suite */
+    registry_filter_t cold; /* benchmarks also run cold, when cold_on */
+    int cold_on;
+    bench_fn_t suite_setup, suite_teardown;
+    const bench_fixture_t *iteration; /* fixture of the benchmark being run */
+    bench_fn_t iteration_fn;
+    size_t count, cap;
+    size_t fixture_count, fixture_cap;
+    size_t result_count, result_cap; /* result_cap also sizes histograms and complexity */
+    size_t complexity_count;
     bench_config_t config;
+    bench_environment_t environment;
     int initialized;
+    int use_counter;
+    int sampling; /* the raw sample file is open */
+    bench_alloc_counters_fn alloc; /* the preloaded allocation tracker's, else NULL */
+    int machine_registered;
+    bench_machine_t profile; /* of the machine suite's last run */
+    history_machine_t machine; /* what produced this run, for the history */
+    int captured;
+    struct
+    {
+        uint64_t seed;        /* of the schedule in effect */
+        repeat_pool_t *pool; /* of the benchmark being repeated, else NULL */
+    } repeat;
+    double counter_per_ns, ns_per_tick, cycles_per_tick;
+    struct
+    {
+        double median, floor; /* ticks per call */
+        int measured;
+    } overhead[64]; /* indexed by log2(batch) */
+    struct
+    {
+        double cost;         /* residual ticks per pair */
+        uint64_t correction; /* ticks removed per pair, 0 unless subtracting */
+    } pause;
+    struct
+    {
+        int index, count; /* output metadata; count 0 when not sharded */
+        int orchestrated; /* the fields below describe a BENCH_JOBS run */
+        int cpus[BENCH_MAX_SHARDS];
+        double alone_ns, alone_error, calibration_ns[BENCH_MAX_SHARDS], calibration_error[BENCH_MAX_SHARDS];
+    } shards;
 } g_bench = {0};
 
-static int compare_double(const void *a, const void *b)
+/* Work per call declared by the running benchmark, 0 while undeclared;
+ * threaded bodies may set it from any worker. */
+static struct
 {
-    double da = *(const double *)a, db = *(const double *)b;
-    return (da > db) - (da < db);
-}
+    uint64_t bytes, items;
+    bench_user_counter_t user[BENCH_MAX_USER_COUNTERS];
+    int user_count;
+    const char *key[BENCH_MAX_USER_COUNTERS]; /* the pointer each name was interned from */
+    pthread_mutex_t lock;
+} g_processed = {.lock = PTHREAD_MUTEX_INITIALIZER};
 
-static void calculate_stats(double *samples, size_t n, bench_stats_t *stats)
+/* Pause state of the calling thread, so threaded bodies can pause too */
+static __thread struct
 {
-    if (n == 0)
-        return;
-    qsort(samples, n, sizeof(double), compare_double);
-    stats->min_ns = samples[0];
-    stats->max_ns = samples[n - 1];
-    stats->median_ns = samples[n / 2];
-    stats->iterations = n;
-    double sum = 0.0;
-    for (size_t i = 0; i < n; i++)
-        sum += samples[i];
-    stats->mean_ns = sum / n;
-    double sq_diff_sum = 0.0;
-    for (size_t i = 0; i < n; i++)
-    {
-        double diff = samples[i] - stats->mean_ns;
-        sq_diff_sum += diff * diff;
-    }
-    stats->stddev_ns = sqrt(sq_diff_sum / n);
-    stats->p95_ns = samples[(size_t)(n * 0.95)];
-    stats->p99_ns = samples[(size_t)(n * 0.99)];
+    uint64_t start, ticks, count; /* within the current sample */
+    uint64_t total;               /* pairs over the current run */
+} t_pause;
+
+/* Heap activity of one thread over the measure() calls of a run, so that
+ * neither warmup nor the harness's own allocations between rounds count. */
+typedef struct
+{
+    bench_alloc_counters_t *counters; /* NULL without the tracker */
+    bench_alloc_counters_t start;     /* at alloc_begin */
+    uint64_t allocs, frees, bytes;
+    int64_t net, peak; /* live bytes gained so far, and the most at any point */
+} alloc_window_t;
+
+/* stats_compute works in timer ticks; convert to nanoseconds and cycles. */
+static void convert_ticks(bench_stats_t *stats)
+{
+    const double ns = g_bench.ns_per_tick, cyc = g_bench.cycles_per_tick;
+    stats->min_cycles = stats->min_ns * cyc;
+    stats->median_cycles = stats->median_ns * cyc;
+    stats->mean_cycles = stats->mean_ns * cyc;
+    stats->p99_cycles = stats->p99_ns * cyc;
+    stats->min_ns *= ns;
+    stats->max_ns *= ns;
+    stats->mean_ns *= ns;
+    stats->median_ns *= ns;
+    stats->stddev_ns *= ns;
+    stats->p95_ns *= ns;
+    stats->p99_ns *= ns;
+    stats->p999_ns *= ns;
+    stats->p9999_ns *= ns;
+    stats->mean_ci_low_ns *= ns;
+    stats->mean_ci_high_ns *= ns;
+    stats->median_ci_low_ns *= ns;
+    stats->median_ci_high_ns *= ns;
+    stats->overhead_ns *= ns;
+    stats->noise_floor_ns *= ns;
+    stats->pause_overhead_ns *= ns;
 }
 
 uint64_t bench_timestamp_ns(void)
@@ -61,6 +192,110 @@ uint64_t bench_timestamp_ns(void)
     return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 }
 
+#if defined(__x86_64__)
+/* lfence keeps earlier instructions from drifting past the start read;
+ * rdtscp+lfence waits for the body to retire and blocks later work. */
+static inline uint64_t counter_start(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("lfence\n\trdtsc" : "=a"(lo), "=d"(hi) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t counter_stop(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("rdtscp\n\tlfence" : "=a"(lo), "=d"(hi) : : "rcx", "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static int counter_invariant(void)
+{
+    unsigned a, b, c, d;
+    if (!__get_cpuid(0x80000001, &a, &b, &c, &d) || !(d & (1u << 27)))
+        return 0;
+    if (!__get_cpuid(0x80000007, &a, &b, &c, &d))
+        return 0;
+    return (d >> 8) & 1;
+}
+
+static double counter_hz(void) { return 0.0; }
+#elif defined(__aarch64__)
+static inline uint64_t counter_start(void)
+{
+    uint64_t v;
+    __asm__ volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(v) : : "memory");
+    return v;
+}
+
+static inline uint64_t counter_stop(void) { return counter_start(); }
+
+/* The generic timer runs at a fixed architectural rate. */
+static int counter_invariant(void) { return 1; }
+
+static double counter_hz(void)
+{
+    uint64_t f;
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(f));
+    return (double)f;
+}
+#else
+static inline uint64_t counter_start(void) { return 0; }
+static inline uint64_t counter_stop(void) { return 0; }
+static int counter_invariant(void) { return 0; }
+static double counter_hz(void) { return 0.0; }
+#endif
+
+static inline uint64_t ticks_start(void)
+{
+    return g_bench.use_counter ? counter_start() : bench_timestamp_ns();
+}
+
+static inline uint64_t ticks_stop(void)
+{
+    return g_bench.use_counter ? counter_stop() : bench_timestamp_ns();
+}
+
+/* Counter ticks per nanosecond, measured against CLOCK_MONOTONIC over ~20ms
+ * when the architecture does not report the counter frequency. */
+static double counter_calibrate(void)
+{
+    if (!BENCH_HAVE_COUNTER)
+        return 0.0;
+    double hz = counter_hz();
+    if (hz > 0.0)
+        return hz / 1e9;
+    uint64_t t0 = bench_timestamp_ns(), c0 = counter_start(), t1;
+    do
+        t1 = bench_timestamp_ns();
+    while (t1 - t0 < 20000000ULL);
+    uint64_t c1 = counter_stop();
+    return (double)(c1 - c0) / (double)(t1 - t0);
+}
+
+static void timer_select(bench_timer_t timer)
+{
+    g_bench.counter_per_ns = counter_calibrate();
+    int invariant = g_bench.counter_per_ns > 0.0 && counter_invariant();
+    if (timer == BENCH_TIMER_TSC)
+    {
+        g_bench.use_counter = g_bench.counter_per_ns > 0.0;
+        if (!invariant && g_bench.config.verbose)
+            fprintf(stderr, "warning: cycle counter is %s; ticks may not track wall time\n",
+                    g_bench.use_counter ? "not invariant" : "unavailable, using clock");
+    }
+    else
+        g_bench.use_counter = timer == BENCH_TIMER_AUTO && invariant;
+    g_bench.ns_per_tick = g_bench.use_counter ? 1.0 / g_bench.counter_per_ns : 1.0;
+    g_bench.cycles_per_tick = g_bench.use_counter ? 1.0 : g_bench.counter_per_ns;
+}
+
+uint64_t bench_ticks(void) { return ticks_stop(); }
+
+double bench_ticks_per_ns(void) { return g_bench.ns_per_tick > 0.0 ? 1.0 / g_bench.ns_per_tick : 1.0; }
+
+const char *bench_timer_name(void) { return g_bench.use_counter ? "tsc" : "clock"; }
+
 void bench_do_not_optimize(void *ptr)
 {
     __asm__ volatile("" : : "r,m"(ptr) : "memory");
@@ -71,22 +306,299 @@ void bench_clobber(void)
     __asm__ volatile("" : : : "memory");
 }
 
+/* The paused region runs between the two reads; only the fenced reads and
+ * the accumulation stay in the sample, and calibration measures those. */
+void bench_pause(void)
+{
+    t_pause.start = ticks_stop();
+}
+
+void bench_resume(void)
+{
+    t_pause.ticks += ticks_start() - t_pause.start;
+    t_pause.count++;
+}
+
+void bench_set_bytes(uint64_t bytes)
+{
+    __atomic_store_n(&g_processed.bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void bench_set_items(uint64_t items)
+{
+    __atomic_store_n(&g_processed.items, items, __ATOMIC_RELAXED);
+}
+
+/* First use of a name in this benchmark, or a copy of one at another
+ * address: looked up by content under the lock. A new name is published
+ * after its slot is filled, so the lock-free lookup never sees it half set. */
+static __attribute__((noinline)) void counter_intern(const char *name, double value)
+{
+    pthread_mutex_lock(&g_processed.lock);
+    int i = 0;
+    while (i < g_processed.user_count && strcmp(g_processed.user[i].name, name) != 0)
+        i++;
+    if (i < BENCH_MAX_USER_COUNTERS)
+        g_processed.user[i].value = value;
+    if (i == g_processed.user_count && i < BENCH_MAX_USER_COUNTERS)
+    {
+        snprintf(g_processed.user[i].name, sizeof(g_processed.user[i].name), "%s", name);
+        g_processed.key[i] = name;
+        __atomic_store_n(&g_processed.user_count, i + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_processed.lock);
+}
+
+/* Matches the name by address and stores only a changed value, so threads
+ * setting the same one per call share its line instead of bouncing it. */
+void bench_set_counter(const char *name, double value)
+{
+    const int n = __atomic_load_n(&g_processed.user_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++)
+        if (g_processed.key[i] == name)
+        {
+            double *v = &g_processed.user[i].value, old;
+            __atomic_load(v, &old, __ATOMIC_RELAXED);
+            if (old != value)
+                __atomic_store(v, &value, __ATOMIC_RELAXED);
+            return;
+        }
+    counter_intern(name, value);
+}
+
+void bench_set_cold_buffer(const void *ptr, size_t bytes)
+{
+    pthread_mutex_lock(&g_processed.lock);
+    cold_add(ptr, bytes);
+    pthread_mutex_unlock(&g_processed.lock);
+}
+
+/* Rates of the work declared since the benchmark started, at its throughput. */
+static void processed_rates(bench_result_t *result)
+{
+    const double bytes = (double)g_processed.bytes, items = (double)g_processed.items;
+    result->bytes_per_second = bytes > 0 ? bytes * result->throughput : NAN;
+    result->items_per_second = items > 0 ? items * result->throughput : NAN;
+    result->ns_per_item = items > 0 ? result->stats.median_ns / items : NAN;
+    result->user_counter_count = g_processed.user_count;
+    for (int i = 0; i < g_processed.user_count; i++)
+    {
+        result->user_counters[i] = g_processed.user[i];
+        result->user_counters[i].per_second = g_processed.user[i].value * result->throughput;
+    }
+}
+
+static void alloc_open(alloc_window_t *w)
+{
+    memset(w, 0, sizeof(*w));
+    w->counters = g_bench.alloc ? g_bench.alloc() : NULL;
+}
+
+static void alloc_begin(alloc_window_t *w)
+{
+    if (!w->counters)
+        return;
+    w->start = *w->counters;
+    w->counters->peak = w->counters->live;
+}
+
+static void alloc_end(alloc_window_t *w)
+{
+    const bench_alloc_counters_t *c = w->counters;
+    if (!c)
+        return;
+    w->allocs += c->allocs - w->start.allocs;
+    w->frees += c->frees - w->start.frees;
+    w->bytes += c->bytes - w->start.bytes;
+    if (w->net + c->peak - w->start.live > w->peak)
+        w->peak = w->net + c->peak - w->start.live;
+    w->net += c->live - w->start.live;
+}
+
+/* Adds a worker's window into the run's; peaks add up as an upper bound */
+static void alloc_merge(alloc_window_t *sum, const alloc_window_t *w)
+{
+    sum->counters = w->counters ? w->counters : sum->counters;
+    sum->allocs += w->allocs;
+    sum->frees += w->frees;
+    sum->bytes += w->bytes;
+    sum->net += w->net;
+    sum->peak += w->peak;
+}
+
+static void alloc_result(const alloc_window_t *w, uint64_t calls, bench_alloc_t *alloc)
+{
+    const double per_call = calls ? 1.0 / (double)calls : NAN;
+    alloc->tracked = w->counters != NULL;
+    alloc->allocs = alloc->tracked ? (double)w->allocs * per_call : NAN;
+    alloc->frees = alloc->tracked ? (double)w->frees * per_call : NAN;
+    alloc->bytes = alloc->tracked ? (double)w->bytes * per_call : NAN;
+    alloc->peak_bytes = w->peak > 0 ? (uint64_t)w->peak : 0;
+    alloc->leaks = w->allocs > w->frees ? w->allocs - w->frees : 0;
+}
+
+/* The timed loop, shared by benchmarks and overhead calibration. */
+/* Samples are raw tick totals for a whole batch; dividing by the batch is
+ * left to the statistics so nothing but the subtraction sits in the loop.
+ * Paused ticks are taken out per sample, after the stop read. */
+static void measure(bench_fn_t fn, uint64_t batch, uint64_t iters, uint64_t *samples)
+{
+    for (uint64_t i = 0; i < iters; i++)
+    {
+        t_pause.ticks = t_pause.count = 0;
+        uint64_t start = ticks_start();
+        for (uint64_t j = 0; j < batch; j++)
+            fn();
+        uint64_t elapsed = ticks_stop() - start;
+        uint64_t paused = t_pause.ticks + t_pause.count * g_bench.pause.correction;
+        samples[i] = elapsed > paused ? elapsed - paused : 0;
+        t_pause.total += t_pause.count;
+    }
+}
+
+static __attribute__((noinline)) void empty_benchmark(void) { __asm__ volatile(""); }
+
+/* Median and p99 per call of an empty body timed through measure() at this
+ * batch size. Batches are powers of two, so results are cached by log2. */
+static void harness_overhead(uint64_t batch, double *median, double *noise_floor)
+{
+    unsigned k = 0;
+    while ((1ULL << k) < batch)
+        k++;
+    if (!g_bench.overhead[k].measured)
+    {
+        uint64_t samples[BENCH_OVERHEAD_SAMPLES];
+        const size_t ranks[2] = {BENCH_OVERHEAD_SAMPLES / 2, (size_t)(BENCH_OVERHEAD_SAMPLES * 0.99)};
+        uint64_t q[2];
+        bench_fn_t volatile fn = empty_benchmark;
+        measure(fn, batch, BENCH_OVERHEAD_SAMPLES / 10, samples);
+        measure(fn, batch, BENCH_OVERHEAD_SAMPLES, samples);
+        stats_select(samples, BENCH_OVERHEAD_SAMPLES, ranks, 2, q);
+        g_bench.overhead[k].median = (double)q[0] / (double)batch;
+        g_bench.overhead[k].floor = (double)q[1] / (double)batch;
+        g_bench.overhead[k].measured = 1;
+    }
+    *median = g_bench.overhead[k].median;
+    *noise_floor = g_bench.overhead[k].floor;
+}
+
+static __attribute__((noinline)) void pause_benchmark(void)
+{
+    bench_pause();
+    bench_resume();
+}
+
+/* Residual ticks of one pause/resume pair: the median of a body that only
+ * pauses and resumes, less the empty body's. */
+static void pause_overhead(void)
+{
+    uint64_t samples[BENCH_OVERHEAD_SAMPLES], q;
+    const size_t rank = BENCH_OVERHEAD_SAMPLES / 2;
+    double overhead, noise_floor;
+    bench_fn_t volatile fn = pause_benchmark;
+    harness_overhead(1, &overhead, &noise_floor);
+    g_bench.pause.correction = 0;
+    measure(fn, 1, BENCH_OVERHEAD_SAMPLES / 10, samples);
+    measure(fn, 1, BENCH_OVERHEAD_SAMPLES, samples);
+    stats_select(samples, BENCH_OVERHEAD_SAMPLES, &rank, 1, &q);
+    g_bench.pause.cost = (double)q > overhead ? (double)q - overhead : 0.0;
+    g_bench.pause.correction = g_bench.config.subtract_overhead ? (uint64_t)llround(g_bench.pause.cost) : 0;
+}
+
 void bench_init(void)
 {
     bench_config_t config = {
         .iterations = BENCH_DEFAULT_ITERATIONS,
         .warmup_iterations = BENCH_DEFAULT_WARMUP,
         .output_file = "benchmark_results.csv",
-        .verbose = 1};
+        .verbose = 1,
+        .cpu = -1};
     char *env;
     if ((env = getenv("BENCH_ITERS")))
         config.iterations = (uint64_t)atol(env);
-    if ((env = getenv("BENCH_WARMUP")))
+    if ((env = getenv("BENCH_WARMUP")) && !(config.warmup_auto = strcmp(env, "auto") == 0))
         config.warmup_iterations = (uint64_t)atol(env);
+    if ((env = getenv("BENCH_WARMUP_TOL")))
+        config.warmup_tolerance = atof(env);
+    if ((env = getenv("BENCH_WARMUP_MAX_TIME")))
+        config.warmup_max_time = atof(env);
     if ((env = getenv("BENCH_CSV")))
         config.output_file = env;
     if ((env = getenv("BENCH_QUIET")))
         config.verbose = !atoi(env);
+    if ((env = getenv("BENCH_BATCH_NS")))
+        config.batch_ns = (uint64_t)atol(env);
+    if ((env = getenv("BENCH_SUBTRACT_OVERHEAD")))
+        config.subtract_overhead = atoi(env);
+    if ((env = getenv("BENCH_STREAM")))
+        config.streaming = atoi(env);
+    if ((env = getenv("BENCH_HIST")))
+        config.histogram_file = env;
+    if ((env = getenv("BENCH_SAMPLES")))
+        config.samples_file = env;
+    if ((env = getenv("BENCH_SAMPLES_COMPRESS")))
+        config.compress_samples = atoi(env);
+    if ((env = getenv("BENCH_HISTORY")) && *env)
+        config.history_file = env;
+    if ((env = getenv("BENCH_PERF")))
+        config.perf_counters = atoi(env);
+    if ((env = getenv("BENCH_MIN_TIME")))
+        config.min_time = atof(env);
+    if ((env = getenv("BENCH_MAX_TIME")))
+        config.max_time = atof(env);
+    if ((env = getenv("BENCH_PRECISION")))
+        config.precision = atof(env);
+    if ((env = getenv("BENCH_PIN_THREADS")))
+        config.pin_threads = atoi(env);
+    if ((env = getenv("BENCH_STABLE")))
+        config.stable = atoi(env);
+    if ((env = getenv("BENCH_CPU")))
+        config.stable = 1, config.cpu = atoi(env);
+    if ((env = getenv("BENCH_FIFO")))
+        config.stable = 1, config.fifo_priority = atoi(env);
+    if ((env = getenv("BENCH_ISOLATE")))
+        config.isolate = atoi(env);
+    if ((env = getenv("BENCH_TIMEOUT")))
+        config.timeout = atof(env);
+    if ((env = getenv("BENCH_SHARD")) && sscanf(env, "%d/%d", &config.shard_index, &config.shard_count) != 2)
+        fprintf(stderr, "warning: BENCH_SHARD=%s is not i/N\n", env);
+    if ((env = getenv("BENCH_JOBS")))
+        config.jobs = atoi(env);
+    if ((env = getenv("BENCH_BASELINE")))
+        config.baseline_file = env;
+    if ((env = getenv("BENCH_THRESHOLD")))
+        config.regression_threshold = atof(env) / 100.0;
+    if ((env = getenv("BENCH_REPETITIONS")))
+        config.repetitions = atoi(env);
+    if ((env = getenv("BENCH_SEED")))
+        config.seed = strtoull(env, NULL, 0);
+    if ((env = getenv("BENCH_FILTER")))
+        config.filter = env;
+    if ((env = getenv("BENCH_LIST")))
+        config.list = atoi(env);
+    if ((env = getenv("BENCH_MACHINE")))
+        config.machine_bytes = machine_parse(env);
+    if ((env = getenv("BENCH_COLD")))
+        config.cold = env;
+    if ((env = getenv("BENCH_COLD_ITERS")))
+        config.cold_iterations = (uint64_t)atol(env);
+    if ((env = getenv("BENCH_RATE")))
+    {
+        char *unit;
+        config.rate_sweep = strcmp(env, "sweep") == 0;
+        config.rate = strtod(env, &unit);
+        config.rate *= *unit == 'k' ? 1e3 : *unit == 'M' ? 1e6 : 1.0;
+    }
+    if ((env = getenv("BENCH_ARRIVALS")))
+        config.rate_poisson = strcmp(env, "poisson") == 0;
+    if ((env = getenv("BENCH_SLO")))
+        config.rate_slo_ns = atof(env);
+    if ((env = getenv("BENCH_RATE_TIME")))
+        config.rate_time = atof(env);
+    if ((env = getenv("BENCH_TIMER")))
+        config.timer = strcmp(env, "tsc") == 0     ? BENCH_TIMER_TSC
+                       : strcmp(env, "clock") == 0 ? BENCH_TIMER_CLOCK
+                                                   : BENCH_TIMER_AUTO;
     bench_init_config(&config);
 }
 
@@ -95,17 +607,697 @@ void bench_init_config(const bench_config_t *config)
     g_bench.result_count = 0;
     if (config)
         g_bench.config = *config;
+    if (g_bench.config.precision <= 0)
+        g_bench.config.precision = BENCH_DEFAULT_PRECISION;
+    if (g_bench.config.shard_count > 1 &&
+        (g_bench.config.shard_index < 0 || g_bench.config.shard_index >= g_bench.config.shard_count))
+    {
+        fprintf(stderr, "warning: shard %d/%d does not exist; running every benchmark\n",
+                g_bench.config.shard_index, g_bench.config.shard_count);
+        g_bench.config.shard_count = 0;
+    }
+    if (g_bench.config.repetitions > BENCH_MAX_REPETITIONS)
+    {
+        fprintf(stderr, "warning: at most %d repetitions are kept; running %d\n", BENCH_MAX_REPETITIONS,
+                BENCH_MAX_REPETITIONS);
+        g_bench.config.repetitions = BENCH_MAX_REPETITIONS;
+    }
+    registry_filter_free(&g_bench.filter);
+    g_bench.filter_invalid = registry_filter_compile(&g_bench.filter, g_bench.config.filter) != 0;
+    const char *cold = g_bench.config.cold;
+    registry_filter_free(&g_bench.cold);
+    g_bench.cold_on = cold && cold[0] && strcmp(cold, "0") != 0 &&
+                      registry_filter_compile(&g_bench.cold, strcmp(cold, "1") == 0 ? NULL : cold) == 0;
+    if (g_bench.config.machine_bytes && !g_bench.machine_registered)
+        machine_register(g_bench.config.machine_bytes), g_bench.machine_registered = 1;
+    memset(&g_bench.shards, 0, sizeof(g_bench.shards));
+    if (g_bench.config.shard_count > 1)
+    {
+        g_bench.shards.index = g_bench.config.shard_index;
+        g_bench.shards.count = g_bench.config.shard_count;
+    }
+    /* Runs git, so before the process is pinned and locked */
+    if (g_bench.config.history_file && !g_bench.captured)
+        history_capture(&g_bench.machine), g_bench.captured = 1;
+    /* Before timer calibration, so it runs where the benchmarks will */
+    environment_apply(&g_bench.config, &g_bench.environment);
+    if (g_bench.config.stable && g_bench.config.verbose)
+        environment_warn(&g_bench.environment);
+    timer_select(g_bench.config.timer);
+    void *tracker = dlsym(RTLD_DEFAULT, BENCH_ALLOC_SYMBOL);
+    memcpy(&g_bench.alloc, &tracker, sizeof(g_bench.alloc)); /* ISO C has no object-to-function cast */
+    memset(g_bench.overhead, 0, sizeof(g_bench.overhead));
+    perf_close();
+    if (g_bench.config.perf_counters && perf_open() != 0 && g_bench.config.verbose)
+        fprintf(stderr, "warning: hardware counters unavailable: %s\n", perf_error());
     g_bench.initialized = 1;
+    double overhead, noise_floor;
+    harness_overhead(1, &overhead, &noise_floor);
+    pause_overhead();
+    if (g_bench.config.verbose && !g_bench.config.list)
+        printf("Timer: %s, overhead %.2f ns, noise floor %.2f ns, pause/resume %.2f ns%s\n", bench_timer_name(),
+               overhead * g_bench.ns_per_tick, noise_floor * g_bench.ns_per_tick,
+               g_bench.pause.cost * g_bench.ns_per_tick, g_bench.alloc ? "; tracking allocations" : "");
+    const bench_environment_t *env = &g_bench.environment;
+    if (g_bench.config.verbose && !g_bench.config.list && env->stable)
+        printf("Stable: CPU %d, %s, memory %s; governor %s, %d SMT siblings, load %.2f\n", env->cpu,
+               env->fifo_priority ? "SCHED_FIFO" : "normal scheduling", env->memory_locked ? "locked" : "unlocked",
+               env->governor[0] ? env->governor : "unknown", env->smt_siblings, env->load_average);
+}
+
+/* Grows *items, an array of *cap elements of size bytes, to hold at least
+ * need, zeroing the new elements. Returns 0, or -1 when out of memory. */
+static int grow(void **items, size_t *cap, size_t need, size_t size)
+{
+    if (need <= *cap)
+        return 0;
+    size_t n = *cap ? *cap : 64;
+    while (n < need)
+        n *= 2;
+    char *grown = realloc(*items, n * size);
+    if (!grown)
+        return -1;
+    memset(grown + *cap * size, 0, (n - *cap) * size);
+    *items = grown, *cap = n;
+    return 0;
+}
+
+/* Room for n results, with their histograms and complexity fits */
+static int reserve_results(size_t n)
+{
+    size_t cap = g_bench.result_cap, hist_cap = cap, fit_cap = cap;
+    if (grow((void **)&g_bench.histograms, &hist_cap, n, sizeof(histogram_t *)) != 0 ||
+        grow((void **)&g_bench.complexity, &fit_cap, n, sizeof(bench_complexity_t)) != 0 ||
+        grow((void **)&g_bench.results, &cap, n, sizeof(bench_result_t)) != 0)
+    {
+        fprintf(stderr, "warning: out of memory for %zu results\n", n);
+        return -1;
+    }
+    g_bench.result_cap = cap;
+    return 0;
 }
 
 void bench_register(bench_fn_t fn, const char *name, const char *description)
 {
-    if (g_bench.count >= BENCH_MAX_BENCHMARKS)
+    const char *desc = description ? description : "";
+    const bench_entry_t *prev = g_bench.count ? &g_bench.benchmarks[g_bench.count - 1] : NULL;
+    const char *copy = registry_copy(&g_bench.names, name, strlen(name));
+    /* Instances of a family share one description */
+    const char *desc_copy = prev && strcmp(prev->description, desc) == 0
+                                ? prev->description
+                                : registry_copy(&g_bench.names, desc, strlen(desc));
+    long first = -1;
+    if (!copy || !desc_copy ||
+        grow((void **)&g_bench.benchmarks, &g_bench.cap, g_bench.count + 1, sizeof(bench_entry_t)) != 0 ||
+        (first = registry_add(&g_bench.names, copy, g_bench.count)) < 0)
+    {
+        fprintf(stderr, "warning: out of memory registering %s; it will not run\n", name);
         return;
+    }
+    if ((size_t)first != g_bench.count)
+        fprintf(stderr, "warning: benchmark %s is registered twice; bench_run runs the first\n", name);
     bench_entry_t *entry = &g_bench.benchmarks[g_bench.count++];
     entry->fn = fn;
-    strncpy(entry->name, name, BENCH_MAX_NAME_LEN - 1);
-    strncpy(entry->description, description ? description : "", BENCH_MAX_NAME_LEN - 1);
+    entry->name = copy;
+    entry->description = desc_copy;
+}
+
+void bench_register_args(bench_fn_t fn, const char *name, const char *description, const int64_t *args,
+                         size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        char *instance;
+        const size_t before = g_bench.count;
+        if (asprintf(&instance, "%s/%lld", name, (long long)args[i]) < 0)
+        {
+            fprintf(stderr, "warning: out of memory registering %s; it will not run\n", name);
+            continue;
+        }
+        bench_register(fn, instance, description);
+        free(instance);
+        if (g_bench.count > before)
+        {
+            g_bench.benchmarks[before].has_arg = 1;
+            g_bench.benchmarks[before].arg = args[i];
+        }
+    }
+}
+
+void bench_register_range(bench_fn_t fn, const char *name, const char *description, int64_t lo, int64_t hi,
+                          int64_t mult)
+{
+    int64_t args[64];
+    size_t count = 0;
+    if (mult < 2)
+        mult = 2;
+    for (int64_t v = lo; v < hi && count < 63; v = v < 1 ? 1 : v > hi / mult ? hi : v * mult)
+        args[count++] = v;
+    args[count++] = hi;
+    bench_register_args(fn, name, description, args, count);
+}
+
+void bench_register_threads(bench_fn_t fn, const char *name, const char *description, const int *threads,
+                            size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        char *instance;
+        const size_t before = g_bench.count;
+        if (asprintf(&instance, "%s/threads:%d", name, threads[i]) < 0)
+        {
+            fprintf(stderr, "warning: out of memory registering %s; it will not run\n", name);
+            continue;
+        }
+        bench_register(fn, instance, description);
+        free(instance);
+        if (g_bench.count > before)
+            g_bench.benchmarks[before].threads = threads[i] > 0 ? threads[i] : 1;
+    }
+}
+
+static void add_fixture(const char *name, bench_fn_t setup, bench_fn_t teardown, int per_iteration)
+{
+    const char *copy = registry_copy(&g_bench.names, name, strlen(name));
+    const size_t n = g_bench.fixture_count;
+    if (!copy || grow((void **)&g_bench.fixtures, &g_bench.fixture_cap, n + 1, sizeof(bench_fixture_t)) != 0 ||
+        registry_add(&g_bench.fixture_names[per_iteration], copy, n) < 0)
+    {
+        fprintf(stderr, "warning: out of memory for the fixture of %s; it will not run\n", name);
+        return;
+    }
+    bench_fixture_t *f = &g_bench.fixtures[g_bench.fixture_count++];
+    f->name = copy;
+    f->setup = setup;
+    f->teardown = teardown;
+    f->per_iteration = per_iteration;
+}
+
+void bench_set_suite_fixture(bench_fn_t setup, bench_fn_t teardown)
+{
+    g_bench.suite_setup = setup;
+    g_bench.suite_teardown = teardown;
+}
+
+void bench_set_fixture(const char *name, bench_fn_t setup, bench_fn_t teardown)
+{
+    add_fixture(name, setup, teardown, 0);
+}
+
+void bench_set_iteration_fixture(const char *name, bench_fn_t setup, bench_fn_t teardown)
+{
+    add_fixture(name, setup, teardown, 1);
+}
+
+/* Fixtures are matched at run time, so registration order does not matter.
+ * A parameter instance also matches by every prefix ending before a '/';
+ * the fixture registered first wins. */
+static const bench_fixture_t *find_fixture(const bench_entry_t *entry, int per_iteration)
+{
+    const registry_t *names = &g_bench.fixture_names[per_iteration];
+    long found = registry_find(names, entry->name, strlen(entry->name));
+    for (const char *slash = entry->has_arg ? strchr(entry->name, '/') : NULL; slash; slash = strchr(slash + 1, '/'))
+    {
+        const long k = registry_find(names, entry->name, (size_t)(slash - entry->name));
+        if (k >= 0 && (found < 0 || k < found))
+            found = k;
+    }
+    return found >= 0 ? &g_bench.fixtures[found] : NULL;
+}
+
+/* Runs one call between the iteration fixture's setup and teardown, both
+ * paused so neither reaches the sample. */
+static void iteration_fixture(void)
+{
+    const bench_fixture_t *f = g_bench.iteration;
+    bench_pause();
+    if (f->setup)
+        f->setup();
+    bench_resume();
+    g_bench.iteration_fn();
+    bench_pause();
+    if (f->teardown)
+        f->teardown();
+    bench_resume();
+}
+
+typedef struct
+{
+    pthread_t thread;
+    pthread_barrier_t *barrier;
+    pthread_mutex_t *gate; /* held while workers are being created */
+    const int *failed;
+    bench_fn_t fn;
+    uint64_t batch, iters, *samples;
+    uint64_t start_ns, end_ns, pauses;
+    alloc_window_t alloc;
+    int index;
+} bench_worker_t;
+
+static void *worker_main(void *arg)
+{
+    bench_worker_t *w = arg;
+    bench_current_thread = w->index;
+    pthread_mutex_lock(w->gate);
+    pthread_mutex_unlock(w->gate);
+    if (*w->failed)
+        return NULL;
+    environment_pin_worker(w->index, g_bench.config.pin_threads);
+    for (uint64_t i = 0; i < g_bench.config.warmup_iterations; i++)
+        w->fn();
+    alloc_open(&w->alloc);
+    pthread_barrier_wait(w->barrier);
+    w->start_ns = bench_timestamp_ns();
+    alloc_begin(&w->alloc);
+    measure(w->fn, w->batch, w->iters, w->samples);
+    alloc_end(&w->alloc);
+    w->end_ns = bench_timestamp_ns();
+    w->pauses = t_pause.total;
+    return NULL;
+}
+
+/* Runs fn on threads workers that warm up, meet on a barrier and then take
+ * iters samples each into their own slice of samples, so the merge needs no
+ * locks. The wall time spans the first start to the last finish. */
+static int run_workers(bench_fn_t fn, int threads, uint64_t batch, uint64_t iters, uint64_t *samples,
+                       uint64_t *wall_ns, uint64_t *pauses, alloc_window_t *alloc)
+{
+    bench_worker_t *workers = calloc((size_t)threads, sizeof(*workers));
+    pthread_barrier_t barrier;
+    pthread_mutex_t gate = PTHREAD_MUTEX_INITIALIZER;
+    int created = 0, failed = 0;
+    if (!workers || pthread_barrier_init(&barrier, NULL, (unsigned)threads) != 0)
+    {
+        free(workers);
+        return -1;
+    }
+    pthread_mutex_lock(&gate);
+    for (; created < threads; created++)
+    {
+        bench_worker_t *w = &workers[created];
+        *w = (bench_worker_t){.barrier = &barrier, .gate = &gate, .failed = &failed, .fn = fn, .batch = batch,
+                              .iters = iters, .samples = samples + (uint64_t)created * iters, .index = created};
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0)
+        {
+            failed = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gate);
+    uint64_t first = UINT64_MAX, last = 0;
+    *pauses = 0;
+    for (int i = 0; i < created; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        first = workers[i].start_ns < first ? workers[i].start_ns : first;
+        last = workers[i].end_ns > last ? workers[i].end_ns : last;
+        *pauses += workers[i].pauses;
+        alloc_merge(alloc, &workers[i].alloc);
+    }
+    pthread_barrier_destroy(&barrier);
+    free(workers);
+    *wall_ns = last > first ? last - first : 0;
+    return failed ? -1 : 0;
+}
+
+/* Doubles the inner repeat count until one timed batch spans at least target_ns. */
+static uint64_t calibrate_batch(bench_fn_t fn, uint64_t target_ns)
+{
+    uint64_t batch = 1;
+    if (target_ns == 0)
+        return batch;
+    while (batch < BENCH_MAX_BATCH)
+    {
+        uint64_t start = bench_timestamp_ns();
+        t_pause.ticks = 0;
+        for (uint64_t j = 0; j < batch; j++)
+            fn();
+        uint64_t paused = (uint64_t)((double)t_pause.ticks * g_bench.ns_per_tick);
+        if (bench_timestamp_ns() - start >= target_ns + paused)
+            break;
+        batch *= 2;
+    }
+    return batch;
+}
+
+/* Automatic warmup: windows of BENCH_WARMUP_SAMPLES samples, each about
+ * BENCH_WARMUP_SAMPLE_NS long, until the last BENCH_WARMUP_WINDOWS agree
+ * (stats_steady) or the time cap is reached. First-touch page faults, cache
+ * and branch predictor training and frequency ramps all show up as a drift
+ * of the window medians, so a slow start gets more warmup than a trivial
+ * body. The batch calibration's calls count too. */
+static void warmup_auto(bench_fn_t fn, bench_warmup_t *w)
+{
+    const double tolerance = g_bench.config.warmup_tolerance > 0 ? g_bench.config.warmup_tolerance
+                                                                 : BENCH_DEFAULT_WARMUP_TOLERANCE;
+    const double cap = g_bench.config.warmup_max_time > 0 ? g_bench.config.warmup_max_time
+                                                          : BENCH_DEFAULT_WARMUP_MAX_TIME;
+    const uint64_t start = bench_timestamp_ns(), batch = calibrate_batch(fn, BENCH_WARMUP_SAMPLE_NS);
+    const size_t ranks[3] = {BENCH_WARMUP_SAMPLES / 4, BENCH_WARMUP_SAMPLES / 2, 3 * BENCH_WARMUP_SAMPLES / 4};
+    uint64_t samples[BENCH_WARMUP_SAMPLES], q[3];
+    double medians[BENCH_WARMUP_WINDOWS], spreads[BENCH_WARMUP_WINDOWS];
+    memset(w, 0, sizeof(*w));
+    w->automatic = 1;
+    w->iterations = 2 * batch - 1;
+    w->median_ns = NAN;
+    while (!w->steady && (double)(bench_timestamp_ns() - start) * 1e-9 < cap)
+    {
+        measure(fn, batch, BENCH_WARMUP_SAMPLES, samples);
+        stats_select(samples, BENCH_WARMUP_SAMPLES, ranks, 3, q);
+        size_t k = (size_t)w->windows;
+        if (k >= BENCH_WARMUP_WINDOWS) /* full: drop the oldest */
+        {
+            k = BENCH_WARMUP_WINDOWS - 1;
+            memmove(medians, medians + 1, k * sizeof(double));
+            memmove(spreads, spreads + 1, k * sizeof(double));
+        }
+        medians[k] = (double)q[1] / (double)batch;
+        spreads[k] = (double)(q[2] - q[0]) / (double)batch;
+        w->median_ns = medians[k] * g_bench.ns_per_tick;
+        w->iterations += BENCH_WARMUP_SAMPLES * batch;
+        w->windows++;
+        w->steady = w->windows >= BENCH_WARMUP_WINDOWS &&
+                    stats_steady(medians, spreads, BENCH_WARMUP_WINDOWS, tolerance);
+    }
+    w->seconds = (double)(bench_timestamp_ns() - start) * 1e-9;
+}
+
+/* Adaptive run length: given n samples taken since start_ns and the current
+ * precision of the median, returns how many more to take, or 0 to stop. */
+static uint64_t next_round(uint64_t n, uint64_t start_ns, double rel_error)
+{
+    const double elapsed = (double)(bench_timestamp_ns() - start_ns) * 1e-9;
+    const double max_time = g_bench.config.max_time;
+    if (elapsed >= max_time)
+        return 0;
+    if (elapsed >= g_bench.config.min_time && rel_error <= g_bench.config.precision)
+        return 0;
+    /* Grow geometrically so precision checks stay linear overall, but do not
+     * overshoot the remaining budget at the current rate. */
+    uint64_t more = n / 2 > BENCH_MIN_SAMPLES ? n / 2 : BENCH_MIN_SAMPLES;
+    if (elapsed > 0)
+    {
+        double fit = (max_time - elapsed) / elapsed * (double)n;
+        if (fit < (double)more)
+            more = (uint64_t)fit + 1;
+    }
+    return more;
+}
+
+/* Keeps a repetition's samples for the pooled statistics. */
+static void pool_samples(const uint64_t *samples, uint64_t n)
+{
+    repeat_pool_t *p = g_bench.repeat.pool;
+    if (!p || p->lost)
+        return;
+    if (p->n + n > p->cap)
+    {
+        const uint64_t cap = p->cap * 2 > p->n + n ? p->cap * 2 : p->n + n;
+        uint64_t *grown = realloc(p->samples, (cap ? cap : 1) * sizeof(uint64_t));
+        if (!grown)
+        {
+            free(p->samples);
+            p->samples = NULL;
+            p->lost = 1;
+            return;
+        }
+        p->samples = grown, p->cap = cap;
+    }
+    memcpy(p->samples + p->n, samples, n * sizeof(uint64_t));
+    p->n += n;
+}
+
+/* The verbose summary of one result, elapsed seconds after its start. */
+static void report(const bench_result_t *result, double elapsed)
+{
+    printf("  Mean: %.2f ns, Median: %.2f ns, StdDev: %.2f ns\n",
+           result->stats.mean_ns, result->stats.median_ns, result->stats.stddev_ns);
+    printf("  Min: %.2f ns, Max: %.2f ns\n", result->stats.min_ns, result->stats.max_ns);
+    printf("  P95: %.2f ns, P99: %.2f ns, P99.9: %.2f ns, P99.99: %.2f ns\n", result->stats.p95_ns,
+           result->stats.p99_ns, result->stats.p999_ns, result->stats.p9999_ns);
+    printf("  Precision: median +-%.2f%% (95%% CI) from %lu iterations in %.2f s\n",
+           result->stats.median_rel_error * 100.0, (unsigned long)result->stats.iterations, elapsed);
+    printf("  Bootstrap 95%% CI: mean [%.2f, %.2f] ns, median [%.2f, %.2f] ns\n", result->stats.mean_ci_low_ns,
+           result->stats.mean_ci_high_ns, result->stats.median_ci_low_ns, result->stats.median_ci_high_ns);
+    const bench_stats_t *st = &result->stats;
+    if (st->outliers_low_severe + st->outliers_low_mild + st->outliers_high_mild + st->outliers_high_severe)
+        printf("  Outliers: %lu low severe, %lu low mild, %lu high mild, %lu high severe "
+               "(%.0f%% of variance)\n",
+               (unsigned long)st->outliers_low_severe, (unsigned long)st->outliers_low_mild,
+               (unsigned long)st->outliers_high_mild, (unsigned long)st->outliers_high_severe,
+               st->outlier_variance * 100.0);
+    printf("  Cycles: median %.1f, mean %.1f\n", result->stats.median_cycles, result->stats.mean_cycles);
+    printf("  Overhead: %.2f ns/call%s, noise floor %.2f ns\n", result->stats.overhead_ns,
+           g_bench.config.subtract_overhead ? " (subtracted)" : "", result->stats.noise_floor_ns);
+    if (result->stats.pauses > 0)
+        printf("  Paused: %.2f times/call, %.2f ns/call residual%s\n", result->stats.pauses,
+               result->stats.pause_overhead_ns, g_bench.config.subtract_overhead ? " (subtracted)" : "");
+    if (result->stats.optimized_away)
+        printf("  WARNING: median is within the timer noise floor; was BENCH_KEEP missed?\n");
+    if (!isnan(result->bytes_per_second))
+        printf("  Bytes: %.3f GB/s\n", result->bytes_per_second * 1e-9);
+    if (!isnan(result->items_per_second))
+        printf("  Items: %.3f M/s, %.2f ns/item\n", result->items_per_second * 1e-6, result->ns_per_item);
+    for (int i = 0; i < result->user_counter_count; i++)
+        printf("  %s: %.4g per call, %.4g/s\n", result->user_counters[i].name, result->user_counters[i].value,
+               result->user_counters[i].per_second);
+    const bench_counters_t *c = &result->counters;
+    if (!isnan(c->cycles))
+        printf("  Counters/call: %.1f cycles, %.1f instr (IPC %.2f), misses: branch %.2f, L1D %.2f, "
+               "LLC %.2f, dTLB %.2f\n",
+               c->cycles, c->instructions, c->ipc, c->branch_misses, c->l1d_misses, c->llc_misses,
+               c->dtlb_misses);
+    const bench_alloc_t *a = &result->alloc;
+    if (a->tracked && (a->allocs > 0 || a->frees > 0))
+        printf("  Heap/call: %.2f allocs, %.2f frees, %.1f bytes; peak +%llu bytes, %llu unfreed\n", a->allocs,
+               a->frees, a->bytes, (unsigned long long)a->peak_bytes, (unsigned long long)a->leaks);
+    const bench_cold_t *cold = &result->cold;
+    if (cold->measured)
+        printf("  Cold: median %.2f ns (%.2fx hot), p99 %.2f ns, mean %.2f ns from %lu calls; %s of %.0f MB, "
+               "%.2f ms each, excluded\n",
+               cold->stats.median_ns, cold->slowdown, cold->stats.p99_ns, cold->stats.mean_ns,
+               (unsigned long)cold->stats.iterations, cold->flushed ? "flush and TLB sweep" : "sweep",
+               (double)cold->evict_bytes / (1 << 20), cold->evict_ns * 1e-6);
+    const bench_open_loop_t *ol = &result->open_loop;
+    for (int k = 0; k < ol->steps; k++)
+        printf("  Rate %.4g/s: achieved %.4g/s, p50 %.2f ns, p99 %.2f ns, max %.2f ns from due, %s\n",
+               ol->step[k].rate, ol->step[k].achieved, ol->step[k].p50_ns, ol->step[k].p99_ns, ol->step[k].max_ns,
+               ol->step[k].met ? "met" : "missed");
+    if (ol->measured && !isnan(ol->max_rate))
+        printf("  Max rate: %.4g/s with p99 <= %.2f ns\n", ol->max_rate, ol->slo_ns);
+    if (ol->measured)
+        printf("  Open loop: %.4g/s %s, achieved %.4g/s over %lu calls; from due p50 %.2f ns, p99 %.2f ns, "
+               "p99.9 %.2f ns, max %.2f ns; service p99 %.2f ns\n",
+               ol->run.rate, ol->poisson ? "poisson" : "constant", ol->run.achieved, (unsigned long)ol->run.calls,
+               ol->latency.median_ns, ol->latency.p99_ns, ol->latency.p999_ns, ol->latency.max_ns,
+               ol->service.p99_ns);
+    if (ol->measured && ol->run.unsent)
+        printf("  WARNING: %lu calls were still queued at the end; the rate is past what one thread serves\n",
+               (unsigned long)ol->run.unsent);
+    const bench_repetitions_t *r = &result->repetitions;
+    if (r->count)
+        printf("  Repetitions: %d medians, mean %.2f ns, median %.2f ns, stddev %.2f ns (%.2f%%), range "
+               "[%.2f, %.2f] ns\n",
+               r->count, r->mean_ns, r->median_ns, r->stddev_ns,
+               r->mean_ns > 0 ? r->stddev_ns / r->mean_ns * 100.0 : 0.0, r->min_ns, r->max_ns);
+    printf("\n");
+}
+
+/* The cold run: every call is timed alone, right after an eviction that is
+ * timed apart, so the sample holds the misses of the call but not the cost
+ * of causing them. Iteration fixtures still run untimed around each call. */
+static void run_cold(const bench_entry_t *entry, bench_fn_t fn, double hot_median, bench_cold_t *cold)
+{
+    const uint64_t n = g_bench.config.cold_iterations ? g_bench.config.cold_iterations : BENCH_DEFAULT_COLD_ITERATIONS;
+    memset(cold, 0, sizeof(*cold));
+    if (g_bench.iteration) /* its setup would run after the eviction and warm the data again */
+    {
+        fprintf(stderr, "warning: %s: not run cold; an iteration fixture would refill the caches after each "
+                        "eviction\n",
+                entry->name);
+        return;
+    }
+    const int err = cold_open();
+    if (err != 0)
+    {
+        fprintf(stderr, "warning: %s: not run cold; cannot allocate the eviction buffer: %s\n", entry->name,
+                strerror(err));
+        return;
+    }
+    uint64_t *samples = malloc(2 * n * sizeof(uint64_t));
+    if (!samples)
+    {
+        fprintf(stderr, "warning: %s: out of memory for the cold run\n", entry->name);
+        return;
+    }
+    uint64_t *evictions = samples + n;
+    environment_prefault(samples, 2 * n * sizeof(uint64_t));
+    double overhead, noise_floor;
+    harness_overhead(1, &overhead, &noise_floor);
+    const double subtract = g_bench.config.subtract_overhead ? overhead : 0.0;
+    const uint64_t pauses = t_pause.total; /* the hot run's */
+    for (uint64_t i = 0; i < n; i++)
+    {
+        const uint64_t start = ticks_start();
+        cold_evict();
+        evictions[i] = ticks_stop() - start;
+        measure(fn, 1, 1, samples + i);
+    }
+    t_pause.total = pauses;
+    if (g_bench.sampling)
+    {
+        char name[BENCH_MAX_NAME_LEN];
+        snprintf(name, sizeof(name), "%s [cold]", entry->name);
+        samples_block(name, 1, subtract, 1, samples, n);
+    }
+    const size_t rank = n / 2;
+    uint64_t evict;
+    stats_select(evictions, n, &rank, 1, &evict);
+    stats_compute(samples, n, 1, subtract, &cold->stats);
+    free(samples);
+    cold->stats.overhead_ns = overhead;
+    cold->stats.noise_floor_ns = noise_floor;
+    cold->stats.optimized_away = cold->stats.median_ns + subtract <= noise_floor;
+    cold->slowdown = hot_median > 0 ? cold->stats.median_ns / hot_median : NAN; /* both still in ticks */
+    convert_ticks(&cold->stats);
+    cold->stats.batch_size = 1;
+    cold->measured = 1;
+    cold->flushed = cold_flushing();
+    cold->evict_bytes = cold_bytes();
+    cold->evict_ns = (double)evict * g_bench.ns_per_tick;
+}
+
+/* splitmix64; shuffles and arrival times only need to be reproducible from a seed */
+static uint64_t next_random(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Gap to the next call due, in ticks, for a mean gap of mean ticks. */
+static double next_arrival(double mean, int poisson, uint64_t *state)
+{
+    if (!poisson)
+        return mean;
+    const double u = ((double)(next_random(state) >> 11) + 0.5) * 0x1.0p-53; /* in (0, 1) */
+    return -log(u) * mean;
+}
+
+/* One open-loop run at rate calls per second for seconds. Calls come due on
+ * a schedule that ignores how long earlier ones took and are served in
+ * order, so a slow call delays the ones queued behind it, and they record
+ * that delay: latency runs from when a call was due (the coordinated
+ * omission correction), service time from when it started. Calls still
+ * queued at the end are recorded with their wait so far. Paused time
+ * shifts the rest of the schedule, as if it had not passed. */
+static void open_loop(bench_fn_t fn, double rate, double seconds, int poisson, double subtract, uint64_t *state,
+                      histogram_t *latency, histogram_t *service, bench_rate_step_t *step)
+{
+    const double mean = 1e9 / rate / g_bench.ns_per_tick;
+    const uint64_t sub = (uint64_t)llround(subtract);
+    histogram_reset(latency);
+    histogram_reset(service);
+    memset(step, 0, sizeof(*step));
+    const uint64_t start = ticks_start();
+    uint64_t end = start + (uint64_t)(seconds * 1e9 / g_bench.ns_per_tick), now = start, last = start, shift = 0;
+    double due = (double)start;
+    for (; due < (double)end; due += next_arrival(mean, poisson, state))
+    {
+        const uint64_t at = (uint64_t)due;
+        while ((now = ticks_start()) < at)
+            ;
+        if (now >= end)
+            break;
+        t_pause.ticks = t_pause.count = 0;
+        fn();
+        last = ticks_stop();
+        const uint64_t paused = t_pause.ticks + t_pause.count * g_bench.pause.correction + sub;
+        histogram_record(latency, last - at > paused ? last - at - paused : 0);
+        histogram_record(service, last - now > paused ? last - now - paused : 0);
+        step->calls++;
+        due += (double)(paused - sub), end += paused - sub, shift += paused - sub;
+    }
+    for (; due < (double)end; due += next_arrival(mean, poisson, state), step->unsent++)
+        histogram_record(latency, now - (uint64_t)due);
+    const double ns = g_bench.ns_per_tick;
+    step->rate = rate;
+    step->achieved = (double)step->calls * 1e9 / ((double)((last > end ? last : end) - start - shift) * ns);
+    step->p50_ns = histogram_quantile(latency, 0.5) * ns;
+    step->p99_ns = histogram_quantile(latency, 0.99) * ns;
+    step->p999_ns = histogram_quantile(latency, 0.999) * ns;
+    step->max_ns = latency->total ? (double)latency->max * ns : 0.0;
+}
+
+/* The open-loop pass: one run at the configured rate, or a sweep that
+ * halves the rate from half the closed-loop throughput until one meets the
+ * SLO and then bisects between the highest that did and the lowest that did
+ * not, to within 2%. It gives up below BENCH_RATE_MIN_CALLS calls a run.
+ * hot holds the closed-loop stats, still in ticks. */
+static void run_open_loop(const bench_entry_t *entry, bench_fn_t fn, const bench_stats_t *hot,
+                          bench_open_loop_t *ol)
+{
+    const bench_config_t *c = &g_bench.config;
+    histogram_t *h = malloc(4 * sizeof(histogram_t)), *run = h, *kept = h + 2;
+    memset(ol, 0, sizeof(*ol));
+    if (!h)
+    {
+        fprintf(stderr, "warning: %s: out of memory for the open-loop run\n", entry->name);
+        return;
+    }
+    histogram_reset(kept);
+    histogram_reset(kept + 1);
+    double overhead, noise_floor;
+    harness_overhead(1, &overhead, &noise_floor);
+    const double subtract = c->subtract_overhead ? overhead : 0.0;
+    const double seconds = c->rate_time > 0 ? c->rate_time : BENCH_DEFAULT_RATE_TIME;
+    ol->poisson = c->rate_poisson;
+    ol->slo_ns = c->rate_slo_ns > 0  ? c->rate_slo_ns
+                 : c->rate_sweep ? 10.0 * (hot->p99_ns + noise_floor) * g_bench.ns_per_tick
+                                   : NAN;
+    ol->max_rate = NAN;
+    uint64_t state = c->seed;
+    const uint64_t pauses = t_pause.total; /* the hot run's */
+    if (!c->rate_sweep)
+    {
+        open_loop(fn, c->rate, seconds, ol->poisson, subtract, &state, kept, kept + 1, &ol->run);
+        ol->run.met = isnan(ol->slo_ns) || ol->run.p99_ns <= ol->slo_ns;
+    }
+    else if (hot->mean_ns > 0)
+    {
+        const double capacity = 1e9 / (hot->mean_ns * g_bench.ns_per_tick);
+        double lo = 0.0, hi = capacity, rate = capacity / 2;
+        while (ol->steps < BENCH_MAX_RATE_STEPS && (lo == 0.0 || hi - lo > 0.02 * hi) &&
+               (ol->steps == 0 || rate * seconds >= BENCH_RATE_MIN_CALLS))
+        {
+            bench_rate_step_t *step = &ol->step[ol->steps++];
+            open_loop(fn, rate, seconds, ol->poisson, subtract, &state, run, run + 1, step);
+            step->met = step->p99_ns <= ol->slo_ns;
+            if (step->met || lo == 0.0)
+            {
+                histogram_t *t = kept;
+                kept = run, run = t;
+                ol->run = *step;
+            }
+            if (step->met)
+                lo = rate;
+            else
+                hi = rate;
+            rate = lo > 0.0 ? (lo + hi) / 2 : rate / 2;
+        }
+        ol->max_rate = lo;
+    }
+    t_pause.total = pauses;
+    histogram_stats(kept, 1, &ol->latency);
+    histogram_stats(kept + 1, 1, &ol->service);
+    free(h);
+    ol->latency.overhead_ns = ol->service.overhead_ns = overhead;
+    ol->latency.noise_floor_ns = ol->service.noise_floor_ns = noise_floor;
+    convert_ticks(&ol->latency);
+    convert_ticks(&ol->service);
+    ol->latency.batch_size = ol->service.batch_size = 1;
+    ol->measured = ol->run.rate > 0;
 }
 
 static int run_single_benchmark(bench_entry_t *entry, bench_result_t *result)
@@ -114,71 +1306,1097 @@ static int run_single_benchmark(bench_entry_t *entry, bench_result_t *result)
     const uint64_t iters = g_bench.config.iterations;
 
     if (g_bench.config.verbose)
-    {
         printf("Running: %s (%s)\n", entry->name, entry->description);
+
+    bench_current_arg = entry->arg;
+    g_processed.bytes = g_processed.items = 0;
+    g_processed.user_count = 0;
+    cold_clear();
+    const bench_fixture_t *fixture = find_fixture(entry, 0);
+    bench_fn_t fn = entry->fn;
+    if ((g_bench.iteration = find_fixture(entry, 1)))
+    {
+        g_bench.iteration_fn = entry->fn;
+        fn = iteration_fixture;
+    }
+    if (fixture && fixture->setup)
+        fixture->setup();
+
+    bench_warmup_t *w = &result->warmup;
+    if (g_bench.config.warmup_auto)
+        warmup_auto(fn, w);
+    else
+    {
+        const uint64_t warmup_start = bench_timestamp_ns();
+        for (uint64_t i = 0; i < warmup; i++)
+            fn();
+        *w = (bench_warmup_t){.iterations = warmup, .median_ns = NAN,
+                              .seconds = (double)(bench_timestamp_ns() - warmup_start) * 1e-9};
+    }
+    if (g_bench.config.verbose && !w->automatic)
         printf("  Warmup: %lu iterations\n", (unsigned long)warmup);
+    else if (g_bench.config.verbose)
+        printf("  Warmup: %s after %lu calls in %d windows, %.2f ms; median %.2f ns\n",
+               w->steady ? "steady" : "NOT steady (time cap)", (unsigned long)w->iterations, w->windows,
+               w->seconds * 1e3, w->median_ns);
+
+    const repeat_pool_t *pool = g_bench.repeat.pool;
+    const uint64_t batch = pool && pool->batch ? pool->batch : calibrate_batch(fn, g_bench.config.batch_ns);
+    double overhead, noise_floor;
+    harness_overhead(batch, &overhead, &noise_floor);
+    const double subtract = g_bench.config.subtract_overhead ? overhead : 0.0;
+
+    histogram_t *hist = NULL;
+    if (g_bench.config.streaming || g_bench.config.histogram_file)
+    {
+        if (!(hist = malloc(sizeof(*hist))))
+        {
+            if (fixture && fixture->teardown)
+                fixture->teardown();
+            return -1;
+        }
+        histogram_reset(hist);
     }
+    free(g_bench.histograms[result - g_bench.results]);
+    g_bench.histograms[result - g_bench.results] = hist;
 
-    for (uint64_t i = 0; i < warmup; i++)
-        entry->fn();
+    const int adaptive = g_bench.config.max_time > 0 && !entry->threads;
+    if (g_bench.config.verbose && entry->threads)
+        printf("  Timing: %d threads x %lu iterations x %lu calls (%s%s)\n", entry->threads, (unsigned long)iters,
+               (unsigned long)batch, bench_timer_name(), g_bench.config.pin_threads ? ", pinned" : "");
+    else if (g_bench.config.verbose && adaptive)
+        printf("  Timing: adaptive, %.2f-%.2f s to median +-%.2f%% x %lu calls (%s%s)\n", g_bench.config.min_time,
+               g_bench.config.max_time, g_bench.config.precision * 100.0, (unsigned long)batch, bench_timer_name(),
+               g_bench.config.streaming ? ", streaming" : "");
+    else if (g_bench.config.verbose)
+        printf("  Timing: %lu iterations x %lu calls (%s%s)\n", (unsigned long)iters, (unsigned long)batch,
+               bench_timer_name(), g_bench.config.streaming ? ", streaming" : "");
 
-    double *samples = malloc(iters * sizeof(double));
-    if (!samples)
-        return -1;
+    const uint64_t start = bench_timestamp_ns();
+    alloc_window_t alloc;
+    alloc_open(&alloc);
+    t_pause.total = 0;
+    result->throughput = NAN;
+    if (entry->threads)
+    {
+        const uint64_t n = iters * (uint64_t)entry->threads;
+        uint64_t *samples = malloc((n ? n : 1) * sizeof(uint64_t)), wall_ns = 0;
+        if (samples)
+            environment_prefault(samples, n * sizeof(uint64_t));
+        if (!samples ||
+            run_workers(fn, entry->threads, batch, iters, samples, &wall_ns, &t_pause.total, &alloc) != 0)
+        {
+            free(samples);
+            if (fixture && fixture->teardown)
+                fixture->teardown();
+            return -1;
+        }
+        perf_stop(&result->counters, 0); /* counters only follow the calling thread */
+        const double sub = subtract * (double)batch;
+        if (g_bench.sampling)
+            samples_block(entry->name, batch, sub, entry->threads, samples, n);
+        for (int t = 0; g_bench.config.verbose && t < entry->threads; t++)
+        {
+            const size_t ranks[2] = {iters / 2, (size_t)(iters * 0.99)};
+            uint64_t q[2];
+            if (!iters)
+                break;
+            stats_select(samples + (uint64_t)t * iters, iters, ranks, 2, q);
+            printf("  Thread %d: median %.2f ns, p99 %.2f ns\n", t,
+                   fmax((double)q[0] - sub, 0.0) * g_bench.ns_per_tick / (double)batch,
+                   fmax((double)q[1] - sub, 0.0) * g_bench.ns_per_tick / (double)batch);
+        }
+        for (uint64_t i = 0; hist && i < n; i++)
+            histogram_record(hist, samples[i] > sub ? (uint64_t)llround((double)samples[i] - sub) : 0);
+        pool_samples(samples, n);
+        stats_compute(samples, n, batch, subtract, &result->stats);
+        free(samples);
+        if (wall_ns)
+            result->throughput = (double)(n * batch) * 1e9 / (double)wall_ns;
+    }
+    else if (g_bench.config.streaming)
+    {
+        /* Samples pass through a fixed chunk into the histogram, so memory
+         * does not grow with the iteration count. */
+        const double sub = subtract * (double)batch;
+        uint64_t chunk[BENCH_STREAM_CHUNK], done = 0;
+        environment_prefault(chunk, sizeof(chunk));
+        if (g_bench.sampling)
+            samples_begin(entry->name, batch, sub, 1, 8); /* the largest sample is not known up front */
+        perf_start();
+        for (uint64_t want = adaptive ? BENCH_MIN_SAMPLES : iters; want;)
+        {
+            uint64_t n = want < BENCH_STREAM_CHUNK ? want : BENCH_STREAM_CHUNK;
+            alloc_begin(&alloc);
+            measure(fn, batch, n, chunk);
+            alloc_end(&alloc);
+            perf_pause();
+            if (g_bench.sampling)
+                samples_write(chunk, n);
+            for (uint64_t i = 0; i < n; i++)
+                histogram_record(hist, chunk[i] > sub ? (uint64_t)llround((double)chunk[i] - sub) : 0);
+            done += n;
+            want -= n;
+            if (want == 0 && adaptive)
+                want = next_round(done, start, histogram_median_error(hist));
+            perf_resume();
+        }
+        perf_stop(&result->counters, done * batch);
+        if (g_bench.sampling)
+            samples_end();
+        histogram_stats(hist, batch, &result->stats);
+    }
+    else
+    {
+        uint64_t n = 0, cap = adaptive ? BENCH_MIN_SAMPLES : iters;
+        uint64_t *samples = malloc(cap * sizeof(uint64_t));
+        if (!samples)
+        {
+            if (fixture && fixture->teardown)
+                fixture->teardown();
+            return -1;
+        }
+        environment_prefault(samples, cap * sizeof(uint64_t));
+        perf_start();
+        for (uint64_t want = cap; want;)
+        {
+            alloc_begin(&alloc);
+            measure(fn, batch, want, samples + n);
+            alloc_end(&alloc);
+            n += want;
+            if (!adaptive)
+                break;
+            perf_pause();
+            want = next_round(n, start, stats_median_error(samples, n, batch, subtract));
+            if (n + want > cap)
+            {
+                /* Out of memory ends the run with what was collected */
+                uint64_t grown = cap * 2 > n + want ? cap * 2 : n + want;
+                uint64_t *more = realloc(samples, grown * sizeof(uint64_t));
+                if (more)
+                {
+                    environment_prefault(more + cap, (grown - cap) * sizeof(uint64_t));
+                    samples = more, cap = grown;
+                }
+                else
+                    want = 0;
+            }
+            perf_resume();
+        }
+        perf_stop(&result->counters, n * batch);
+        if (g_bench.sampling)
+            samples_block(entry->name, batch, subtract * (double)batch, 1, samples, n);
+        if (hist)
+        {
+            const double sub = subtract * (double)batch;
+            for (uint64_t i = 0; i < n; i++)
+                histogram_record(hist, samples[i] > sub ? (uint64_t)llround((double)samples[i] - sub) : 0);
+        }
+        pool_samples(samples, n);
+        stats_compute(samples, n, batch, subtract, &result->stats);
+        free(samples);
+    }
+    const double elapsed = (double)(bench_timestamp_ns() - start) * 1e-9;
+    result->cold.measured = 0;
+    if (g_bench.cold_on && !entry->threads && registry_filter_match(&g_bench.cold, entry->name))
+        run_cold(entry, fn, result->stats.median_ns, &result->cold);
+    result->open_loop = (bench_open_loop_t){.slo_ns = NAN, .max_rate = NAN};
+    if ((g_bench.config.rate > 0 || g_bench.config.rate_sweep) && !entry->threads)
+        run_open_loop(entry, fn, &result->stats, &result->open_loop);
+    if (fixture && fixture->teardown)
+        fixture->teardown();
+
+    result->name = entry->name;
+    result->description = entry->description;
+    result->has_arg = entry->has_arg;
+    result->arg = entry->arg;
+    result->threads = entry->threads ? entry->threads : 1;
+    result->scaling_efficiency = NAN;
+    result->error[0] = '\0';
+    result->verdict = BENCH_VERDICT_NONE;
+    if (!pool)
+        result->repetitions.count = 0;
+    result->stats.overhead_ns = overhead;
+    result->stats.noise_floor_ns = noise_floor;
+    result->stats.pauses =
+        t_pause.total ? (double)t_pause.total / (double)(result->stats.iterations * batch) : 0.0;
+    result->stats.pause_overhead_ns = result->stats.pauses * g_bench.pause.cost;
+    result->stats.optimized_away =
+        result->stats.median_ns + subtract <= noise_floor;
+    convert_ticks(&result->stats);
+    result->stats.batch_size = batch;
+    if (!entry->threads && result->stats.mean_ns > 0)
+        result->throughput = 1e9 / result->stats.mean_ns;
+    processed_rates(result);
+    alloc_result(&alloc, result->stats.iterations * batch, &result->alloc);
 
     if (g_bench.config.verbose)
-        printf("  Timing: %lu iterations\n", (unsigned long)iters);
+        report(result, elapsed);
+    return 0;
+}
 
-    for (uint64_t i = 0; i < iters; i++)
+/* Reads size bytes from a child's pipe. Returns -1 on EOF or error and -2
+ * once deadline (in bench_timestamp_ns time, 0 for none) has passed. */
+static int read_child(int fd, void *buf, size_t size, uint64_t deadline)
+{
+    char *p = buf;
+    while (size)
     {
-        uint64_t start = bench_timestamp_ns();
-        entry->fn();
-        samples[i] = (double)(bench_timestamp_ns() - start);
+        int wait_ms = -1;
+        if (deadline)
+        {
+            const uint64_t now = bench_timestamp_ns();
+            if (now >= deadline)
+                return -2;
+            wait_ms = (int)((deadline - now) / 1000000) + 1;
+        }
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        const int ready = poll(&pfd, 1, wait_ms);
+        if (ready < 0 && errno != EINTR)
+            return -1;
+        if (ready <= 0)
+            continue;
+        const ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= (size_t)n;
     }
+    return 0;
+}
 
-    strncpy(result->name, entry->name, BENCH_MAX_NAME_LEN - 1);
-    strncpy(result->description, entry->description, BENCH_MAX_NAME_LEN - 1);
-    calculate_stats(samples, iters, &result->stats);
-    free(samples);
+static int write_all(int fd, const void *buf, size_t size)
+{
+    const char *p = buf;
+    while (size)
+    {
+        const ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
 
+/* State a forked child has to take again for itself. */
+static void after_fork(void)
+{
+    environment_after_fork();
+    if (g_bench.config.perf_counters)
+    {
+        perf_close(); /* the inherited group counts the parent */
+        perf_open();
+    }
+}
+
+/* Fills a result whose error is set: the entry's identity, zero statistics
+ * and NaN counters. */
+static void fail_result(const bench_entry_t *entry, bench_result_t *result)
+{
+    result->name = entry->name;
+    result->description = entry->description;
+    result->has_arg = entry->has_arg;
+    result->arg = entry->arg;
+    result->threads = entry->threads ? entry->threads : 1;
+    result->throughput = result->scaling_efficiency = NAN;
+    result->verdict = BENCH_VERDICT_NONE;
+    result->repetitions.count = 0;
+    result->bytes_per_second = result->items_per_second = result->ns_per_item = NAN;
+    result->user_counter_count = 0;
+    bench_counters_t *c = &result->counters;
+    c->cycles = c->instructions = c->branch_misses = c->l1d_misses = c->llc_misses = c->dtlb_misses = NAN;
+    c->ipc = c->branch_mpki = c->l1d_mpki = c->llc_mpki = c->dtlb_mpki = NAN;
     if (g_bench.config.verbose)
+        printf("  FAILED: %s: %s\n\n", result->name, result->error);
+}
+
+/* Runs one benchmark in a forked child that sends its result and histogram
+ * back over a pipe. Heap and cache state it leaves behind die with the
+ * child; a crash, a hang past the timeout or an exit() in the body becomes
+ * result->error instead of ending the suite. Returns 0 if the child
+ * reported a result. */
+static int run_isolated(bench_entry_t *entry, bench_result_t *result)
+{
+    histogram_t **slot = &g_bench.histograms[result - g_bench.results];
+    const int want_hist = g_bench.config.streaming || g_bench.config.histogram_file;
+    int fds[2];
+    pid_t pid = -1;
+    fflush(stdout);
+    fflush(stderr);
+    if (pipe(fds) == 0 && (pid = fork()) < 0)
     {
-        printf("  Mean: %.2f ns, Median: %.2f ns, StdDev: %.2f ns\n",
-               result->stats.mean_ns, result->stats.median_ns, result->stats.stddev_ns);
-        printf("  Min: %.2f ns, Max: %.2f ns\n", result->stats.min_ns, result->stats.max_ns);
-        printf("  P95: %.2f ns, P99: %.2f ns\n\n", result->stats.p95_ns, result->stats.p99_ns);
+        close(fds[0]);
+        close(fds[1]);
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        after_fork();
+        int status = run_single_benchmark(entry, result) == 0 ? 0 : 1;
+        if (status == 0 && (write_all(fds[1], result, sizeof(*result)) != 0 ||
+                            (want_hist && write_all(fds[1], *slot, sizeof(**slot)) != 0)))
+            status = 1;
+        fflush(stdout);
+        _exit(status);
     }
 
-    return 0;
+    memset(result, 0, sizeof(*result));
+    if (pid < 0)
+        snprintf(result->error, sizeof(result->error), "fork failed: %s", strerror(errno));
+    else
+    {
+        close(fds[1]);
+        const uint64_t deadline =
+            g_bench.config.timeout > 0 ? bench_timestamp_ns() + (uint64_t)(g_bench.config.timeout * 1e9) : 0;
+        histogram_t *hist = want_hist ? malloc(sizeof(*hist)) : NULL;
+        int got = read_child(fds[0], result, sizeof(*result), deadline);
+        if (got == 0 && want_hist)
+            got = hist ? read_child(fds[0], hist, sizeof(*hist), deadline) : -1;
+        close(fds[0]);
+        if (got == -2)
+            kill(pid, SIGKILL);
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+            ;
+        if (got == -2)
+            snprintf(result->error, sizeof(result->error), "timed out after %.3g s", g_bench.config.timeout);
+        else if (WIFSIGNALED(status))
+            snprintf(result->error, sizeof(result->error), "killed by signal %d (%s)", WTERMSIG(status),
+                     strsignal(WTERMSIG(status)));
+        else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+            snprintf(result->error, sizeof(result->error), "exited with status %d", WEXITSTATUS(status));
+        else if (got != 0)
+            snprintf(result->error, sizeof(result->error), "exited without a result");
+        free(*slot);
+        *slot = result->error[0] ? NULL : hist;
+        if (result->error[0])
+            free(hist);
+    }
+    if (!result->error[0])
+        return 0;
+    fail_result(entry, result);
+    return -1;
+}
+
+/* Family name of a parameterized result: its name up to the last '/'.
+ * Failed isolated runs belong to no family. */
+static size_t family_length(const bench_result_t *r)
+{
+    const char *slash = strrchr(r->name, '/');
+    return r->has_arg && slash && !r->error[0] ? (size_t)(slash - r->name) : 0;
+}
+
+/* Fits a growth model to each run of consecutive results from one family. */
+static void fit_complexity(void)
+{
+    double *n = malloc((g_bench.result_count + 1) * sizeof(double));
+    double *t = malloc((g_bench.result_count + 1) * sizeof(double));
+    g_bench.complexity_count = 0;
+    for (size_t i = 0, j; n && t && i < g_bench.result_count; i = j)
+    {
+        const bench_result_t *first = &g_bench.results[i];
+        const size_t len = family_length(first);
+        for (j = i + 1; len && j < g_bench.result_count && family_length(&g_bench.results[j]) == len &&
+                        strncmp(g_bench.results[j].name, first->name, len) == 0;
+             j++)
+            ;
+        if (j - i < 2 || strncmp(first->name, "machine/", 8) == 0) /* the machine suite's latency is a staircase */
+            continue;
+        for (size_t k = i; k < j; k++)
+        {
+            n[k - i] = (double)g_bench.results[k].arg;
+            t[k - i] = g_bench.results[k].stats.median_ns;
+        }
+        const char *name = registry_copy(&g_bench.names, first->name, len);
+        if (!name)
+            break;
+        bench_complexity_t *fit = &g_bench.complexity[g_bench.complexity_count++];
+        memset(fit, 0, sizeof(*fit));
+        fit->name = name;
+        stats_fit_complexity(n, t, j - i, fit);
+        if (g_bench.config.verbose)
+            printf("Complexity: %s ~ %s, %.4g ns * f(n), RMS %.1f%%\n", fit->name, bench_big_o_name(fit->big_o),
+                   fit->coefficient_ns, fit->rms * 100.0);
+    }
+    free(n);
+    free(t);
+}
+
+static int threaded_family(const bench_result_t *r, const char *family, size_t len)
+{
+    return strncmp(r->name, family, len) == 0 && strncmp(r->name + len, "/threads:", 9) == 0;
+}
+
+/* Threaded results are compared with the 1-thread instance of their family:
+ * efficiency = throughput / (threads x 1-thread throughput). Instances of a
+ * family are registered, and so reported, next to each other. */
+static void fit_scaling(void)
+{
+    for (size_t i = 0; i < g_bench.result_count; i++)
+    {
+        bench_result_t *r = &g_bench.results[i];
+        const char *suffix = strstr(r->name, "/threads:");
+        if (!suffix || r->error[0])
+            continue;
+        const size_t len = (size_t)(suffix - r->name);
+        size_t j = i;
+        while (j > 0 && threaded_family(&g_bench.results[j - 1], r->name, len))
+            j--;
+        for (; j < g_bench.result_count && threaded_family(&g_bench.results[j], r->name, len); j++)
+        {
+            const bench_result_t *base = &g_bench.results[j];
+            if (strcmp(base->name + len, "/threads:1") == 0 && !base->error[0])
+                r->scaling_efficiency = r->throughput / ((double)r->threads * base->throughput);
+        }
+        if (g_bench.config.verbose && isnan(r->scaling_efficiency))
+            printf("Scaling: %s, %.4g calls/s\n", r->name, r->throughput);
+        else if (g_bench.config.verbose)
+            printf("Scaling: %s, %.4g calls/s, %.2fx of 1 thread, %.0f%% efficient\n", r->name, r->throughput,
+                   r->scaling_efficiency * r->threads, r->scaling_efficiency * 100.0);
+    }
+}
+
+/* Hot and cold side by side, for every result that has a cold run. */
+static void report_cold(void)
+{
+    for (size_t i = 0; g_bench.config.verbose && i < g_bench.result_count; i++)
+    {
+        const bench_result_t *r = &g_bench.results[i];
+        if (r->cold.measured && !r->error[0])
+            printf("Cold: %s, median %.2f / %.2f ns hot / cold (%.2fx), p99 %.2f / %.2f ns\n", r->name,
+                   r->stats.median_ns, r->cold.stats.median_ns, r->cold.slowdown, r->stats.p99_ns,
+                   r->cold.stats.p99_ns);
+    }
+}
+
+/* Open-loop latency against the closed-loop figures, for every result that
+ * was run open loop. */
+static void report_open_loop(void)
+{
+    for (size_t i = 0; g_bench.config.verbose && i < g_bench.result_count; i++)
+    {
+        const bench_result_t *r = &g_bench.results[i];
+        const bench_open_loop_t *ol = &r->open_loop;
+        if (!ol->measured || r->error[0])
+            continue;
+        if (!isnan(ol->max_rate))
+            printf("Open loop: %s, max %.4g calls/s with p99 <= %.2f ns, %.0f%% of closed-loop throughput\n",
+                   r->name, ol->max_rate, ol->slo_ns, r->throughput > 0 ? ol->max_rate / r->throughput * 100.0 : NAN);
+        else
+            printf("Open loop: %s, %.4g calls/s, p99 %.2f ns from due / %.2f ns service / %.2f ns closed loop%s\n",
+                   r->name, ol->run.rate, ol->latency.p99_ns, ol->service.p99_ns, r->stats.p99_ns,
+                   isnan(ol->slo_ns) ? "" : ol->run.met ? ", SLO met" : ", SLO missed");
+    }
+}
+
+/* Benchmarks whose automatic warmup hit its time cap were measured before
+ * they settled, so their early samples may still be drifting. */
+static void report_warmup(void)
+{
+    for (size_t i = 0; g_bench.config.verbose && i < g_bench.result_count; i++)
+    {
+        const bench_result_t *r = &g_bench.results[i];
+        if (r->warmup.automatic && !r->warmup.steady && !r->error[0])
+            printf("Warmup: %s did not settle within %.2f s (%lu calls); raise BENCH_WARMUP_MAX_TIME or "
+                   "BENCH_WARMUP_TOL\n",
+                   r->name, r->warmup.seconds, (unsigned long)r->warmup.iterations);
+    }
+}
+
+/* Length of an entry's family name: up to the last '/' for parameter and
+ * thread-count instances, the whole name otherwise. */
+static size_t entry_family(const bench_entry_t *e)
+{
+    const char *slash = strrchr(e->name, '/');
+    return (e->has_arg || e->threads) && slash ? (size_t)(slash - e->name) : strlen(e->name);
+}
+
+/* Shard of every entry the filter selects, -1 for the others: selected
+ * families are dealt out round-robin in registration order, so fits and
+ * scaling never need results from another shard. Everything selected is in
+ * shard 0 when count < 2. Returns how many are selected. */
+static size_t assign_shards(int count, int *shard)
+{
+    const bench_entry_t *prev = NULL;
+    size_t selected = 0;
+    int family = -1;
+    for (size_t i = 0; i < g_bench.count; i++)
+    {
+        const bench_entry_t *e = &g_bench.benchmarks[i];
+        shard[i] = -1;
+        if (!bench_selected(e->name))
+            continue;
+        const size_t len = entry_family(e);
+        if (!prev || entry_family(prev) != len || strncmp(prev->name, e->name, len) != 0)
+            family++;
+        shard[i] = count > 1 ? family % count : 0;
+        prev = e;
+        selected++;
+    }
+    return selected;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Adds one finished repetition, in result, to its benchmark's pool. */
+static void pool_repetition(repeat_pool_t *p, bench_result_t *result, histogram_t *hist, double elapsed)
+{
+    bench_repetitions_t *r = &result->repetitions;
+    r->medians_ns[r->count++] = result->stats.median_ns;
+    p->batch = result->stats.batch_size;
+    p->pauses += result->stats.pauses * (double)(result->stats.iterations * result->stats.batch_size);
+    p->throughput += result->throughput;
+    p->elapsed += elapsed;
+    double *sum = (double *)&p->counters; /* bench_counters_t is all doubles */
+    const double *c = (const double *)&result->counters;
+    for (size_t i = 0; i < sizeof(p->counters) / sizeof(double); i++)
+        sum[i] += c[i];
+    if (hist && (p->hist || (p->hist = malloc(sizeof(*p->hist)))))
+    {
+        if (r->count == 1)
+            histogram_reset(p->hist);
+        histogram_merge(p->hist, hist);
+    }
+}
+
+/* Replaces the last repetition's statistics in result with those of every
+ * repetition pooled, and fills in the spread of their medians. */
+static void finish_repeated(repeat_pool_t *p, const bench_entry_t *entry, bench_result_t *result, size_t slot)
+{
+    bench_repetitions_t *r = &result->repetitions;
+    const double last_median = result->stats.median_ns, last_throughput = result->throughput;
+    double overhead, noise_floor;
+    harness_overhead(p->batch, &overhead, &noise_floor);
+    const double subtract = g_bench.config.subtract_overhead ? overhead : 0.0;
+    if (g_bench.config.streaming ? !p->hist : p->lost)
+        fprintf(stderr, "warning: %s: out of memory pooling repetitions; reporting the last one\n", entry->name);
+    else
+    {
+        bench_stats_t s = {0};
+        if (g_bench.config.streaming)
+            histogram_stats(p->hist, p->batch, &s);
+        else
+            stats_compute(p->samples, p->n, p->batch, subtract, &s);
+        s.overhead_ns = overhead;
+        s.noise_floor_ns = noise_floor;
+        s.pauses = p->pauses / (double)(s.iterations * p->batch);
+        s.pause_overhead_ns = s.pauses * g_bench.pause.cost;
+        s.optimized_away = s.median_ns + subtract <= noise_floor;
+        convert_ticks(&s);
+        s.batch_size = p->batch;
+        result->stats = s;
+    }
+    if (p->hist)
+    {
+        free(g_bench.histograms[slot]);
+        g_bench.histograms[slot] = p->hist;
+        p->hist = NULL;
+    }
+
+    double *c = (double *)&result->counters;
+    const double *sum = (const double *)&p->counters;
+    for (size_t i = 0; i < sizeof(result->counters) / sizeof(double); i++)
+        c[i] = sum[i] / r->count;
+    if (entry->threads)
+        result->throughput = p->throughput / r->count;
+    else
+        result->throughput = result->stats.mean_ns > 0 ? 1e9 / result->stats.mean_ns : NAN;
+    /* The work per call is the same in every repetition; only the rates move */
+    const double rate = last_throughput > 0 ? result->throughput / last_throughput : NAN;
+    result->bytes_per_second *= rate;
+    result->items_per_second *= rate;
+    result->ns_per_item *= last_median > 0 ? result->stats.median_ns / last_median : NAN;
+    for (int i = 0; i < result->user_counter_count; i++)
+        result->user_counters[i].per_second *= rate;
+
+    double sorted[BENCH_MAX_REPETITIONS], sum_ns = 0.0, squares = 0.0;
+    memcpy(sorted, r->medians_ns, (size_t)r->count * sizeof(double));
+    qsort(sorted, (size_t)r->count, sizeof(double), compare_double);
+    for (int i = 0; i < r->count; i++)
+        sum_ns += sorted[i];
+    r->mean_ns = sum_ns / r->count;
+    for (int i = 0; i < r->count; i++)
+        squares += (sorted[i] - r->mean_ns) * (sorted[i] - r->mean_ns);
+    r->stddev_ns = r->count > 1 ? sqrt(squares / (r->count - 1)) : 0.0;
+    r->median_ns = r->count % 2 ? sorted[r->count / 2] : (sorted[r->count / 2 - 1] + sorted[r->count / 2]) / 2.0;
+    r->min_ns = sorted[0];
+    r->max_ns = sorted[r->count - 1];
+    if (g_bench.config.verbose)
+    {
+        printf("Result: %s (%s), %d repetitions\n", entry->name, entry->description, r->count);
+        report(result, p->elapsed);
+    }
+}
+
+/* Repetitions: each round runs every selected benchmark once, in a new
+ * shuffle of a seeded generator, so drift during the suite (thermal
+ * throttling, turbo decay, a background job) lands on every benchmark
+ * alike instead of shifting whichever ran while it lasted. A benchmark keeps
+ * the batch of its first repetition, and its result pools their samples. */
+static int run_repeated(const size_t *selected, size_t n)
+{
+    const int reps = g_bench.config.repetitions, verbose = g_bench.config.verbose;
+    const size_t base = g_bench.result_count;
+    repeat_pool_t *pools = calloc(n ? n : 1, sizeof(*pools));
+    size_t *order = malloc((n ? n : 1) * sizeof(size_t));
+    uint64_t state = g_bench.repeat.seed;
+    int failed = 0;
+    if (!pools || !order)
+    {
+        free(pools);
+        free(order);
+        return (int)n;
+    }
+    for (size_t k = 0; k < n; k++)
+    {
+        order[k] = k;
+        memset(&g_bench.results[base + k].repetitions, 0, sizeof(bench_repetitions_t));
+    }
+    for (int round = 0; round < reps; round++)
+    {
+        for (size_t k = n; k > 1; k--)
+        {
+            const size_t j = (size_t)(next_random(&state) % k), t = order[k - 1];
+            order[k - 1] = order[j], order[j] = t;
+        }
+        if (verbose)
+            printf("Repetition %d of %d\n", round + 1, reps);
+        for (size_t i = 0; i < n; i++)
+        {
+            const size_t k = order[i];
+            repeat_pool_t *p = &pools[k];
+            bench_result_t *result = &g_bench.results[base + k];
+            if (p->failed)
+                continue;
+            g_bench.repeat.pool = p;
+            g_bench.config.verbose = 0;
+            const uint64_t start = bench_timestamp_ns();
+            p->failed = run_single_benchmark(&g_bench.benchmarks[selected[k]], result) != 0;
+            const double elapsed = (double)(bench_timestamp_ns() - start) * 1e-9;
+            g_bench.config.verbose = verbose;
+            g_bench.repeat.pool = NULL;
+            if (p->failed)
+                continue;
+            pool_repetition(p, result, g_bench.histograms[base + k], elapsed);
+            if (verbose)
+                printf("  %-40s median %.2f ns +-%.2f%%\n", result->name, result->stats.median_ns,
+                       result->stats.median_rel_error * 100.0);
+        }
+    }
+    if (verbose)
+        printf("\n");
+
+    /* Failed benchmarks are dropped as in a serial run */
+    for (size_t k = 0; k < n; k++)
+    {
+        repeat_pool_t *p = &pools[k];
+        const size_t slot = g_bench.result_count;
+        if (p->failed)
+            failed++;
+        else
+        {
+            if (slot != base + k)
+            {
+                histogram_t *moved = g_bench.histograms[base + k];
+                g_bench.histograms[base + k] = g_bench.histograms[slot];
+                g_bench.histograms[slot] = moved;
+                g_bench.results[slot] = g_bench.results[base + k];
+            }
+            finish_repeated(p, &g_bench.benchmarks[selected[k]], &g_bench.results[slot], slot);
+            g_bench.results[slot].index = (int)selected[k];
+            g_bench.result_count++;
+        }
+        free(p->samples);
+        free(p->hist);
+    }
+    free(pools);
+    free(order);
+    return failed;
+}
+
+/* Registration indexes of the selected entries in shard index out of
+ * count, or of every selected entry when count < 2; NULL when out of
+ * memory. */
+static size_t *select_entries(int index, int count, size_t *n)
+{
+    int *shard = malloc((g_bench.count + 1) * sizeof(int));
+    size_t *selected = malloc((g_bench.count + 1) * sizeof(size_t));
+    *n = 0;
+    if (shard && selected)
+    {
+        assign_shards(count, shard);
+        for (size_t i = 0; i < g_bench.count; i++)
+            if (shard[i] == (count > 1 ? index : 0))
+                selected[(*n)++] = i;
+    }
+    else
+    {
+        fprintf(stderr, "warning: out of memory selecting benchmarks\n");
+        free(selected);
+        selected = NULL;
+    }
+    free(shard);
+    return selected;
+}
+
+/* Runs every selected benchmark of shard index out of count, or all of them
+ * when count < 2. */
+static int run_selected(int index, int count)
+{
+    size_t n, *selected = select_entries(index, count, &n);
+    int failed = 0;
+    if (!selected || reserve_results(g_bench.result_count + n) != 0)
+        failed = selected ? (int)n : 1;
+    else if (g_bench.config.repetitions > 1 && !g_bench.config.isolate)
+        failed = run_repeated(selected, n);
+    else
+        for (size_t k = 0; k < n; k++)
+        {
+            const size_t i = selected[k];
+            /* An isolated failure keeps its slot so the error is reported */
+            bench_result_t *result = &g_bench.results[g_bench.result_count];
+            if (g_bench.config.isolate)
+            {
+                failed += run_isolated(&g_bench.benchmarks[i], result) != 0;
+                result->index = (int)i;
+                g_bench.result_count++;
+            }
+            else if (run_single_benchmark(&g_bench.benchmarks[i], result) == 0)
+            {
+                result->index = (int)i;
+                g_bench.result_count++;
+            }
+            else
+                failed++;
+        }
+    free(selected);
+    return failed;
+}
+
+/* Header of the shared mapping; the arrays it points to follow it there,
+ * one element per registered entry */
+typedef struct
+{
+    double calibration_ns[BENCH_MAX_SHARDS], calibration_error[BENCH_MAX_SHARDS];
+    bench_result_t *results; /* by registration index */
+    histogram_t *hists;      /* NULL unless histograms are kept */
+    int *done;
+} shard_shared_t;
+
+/* BENCH_JOBS: one forked process per shard, each pinned to its own physical
+ * core, writes its results by registration index into shared memory; the
+ * merge is then just registration order. A fixed calibration kernel timed
+ * alone and again inside every shard shows whether running in parallel
+ * changed the machine (clock, shared cache, memory bandwidth). */
+static int run_shards(void)
+{
+    int jobs = environment_cores(g_bench.shards.cpus,
+                                 g_bench.config.jobs < BENCH_MAX_SHARDS ? g_bench.config.jobs : BENCH_MAX_SHARDS);
+    if (jobs < g_bench.config.jobs)
+        fprintf(stderr, "warning: %d shards requested but only %d physical cores are available\n",
+                g_bench.config.jobs, jobs);
+    const size_t n = g_bench.count;
+    const size_t hist_bytes = g_bench.config.streaming || g_bench.config.histogram_file ? n * sizeof(histogram_t) : 0;
+    const size_t bytes = sizeof(shard_shared_t) + n * sizeof(bench_result_t) + hist_bytes + n * sizeof(int);
+    shard_shared_t *shared = MAP_FAILED;
+    int *shard = malloc((n + 1) * sizeof(int));
+    if (jobs > 1 && shard)
+        shared = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+    {
+        free(shard);
+        return run_selected(0, 0);
+    }
+    shared->results = (bench_result_t *)(shared + 1);
+    shared->hists = hist_bytes ? (histogram_t *)(shared->results + n) : NULL;
+    shared->done = (int *)((char *)(shared->results + n) + hist_bytes);
+    histogram_t *hists = shared->hists;
+
+    g_bench.shards.count = jobs;
+    g_bench.shards.orchestrated = 1;
+    g_bench.shards.alone_ns = environment_calibrate(&g_bench.shards.alone_error);
+    pid_t pids[BENCH_MAX_SHARDS];
+    fflush(stdout);
+    fflush(stderr);
+    for (int s = 0; s < jobs; s++)
+    {
+        if ((pids[s] = fork()) != 0)
+            continue;
+        g_bench.config.verbose = 0;
+        environment_pin_cpu(g_bench.shards.cpus[s]);
+        after_fork();
+        shared->calibration_ns[s] = environment_calibrate(&shared->calibration_error[s]);
+        run_selected(s, jobs);
+        for (size_t k = 0; k < g_bench.result_count; k++)
+        {
+            const int i = g_bench.results[k].index;
+            shared->results[i] = g_bench.results[k];
+            if (hists && g_bench.histograms[k])
+                hists[i] = *g_bench.histograms[k];
+            shared->done[i] = 1;
+        }
+        _exit(0);
+    }
+
+    char status[BENCH_MAX_SHARDS][64];
+    for (int s = 0; s < jobs; s++)
+    {
+        int st = 0;
+        status[s][0] = '\0';
+        if (pids[s] < 0)
+            snprintf(status[s], sizeof(status[s]), "shard %d could not fork", s);
+        else if (waitpid(pids[s], &st, 0) == pids[s] && WIFSIGNALED(st))
+            snprintf(status[s], sizeof(status[s]), "shard %d killed by signal %d (%s)", s, WTERMSIG(st),
+                     strsignal(WTERMSIG(st)));
+        else if (WIFEXITED(st) && WEXITSTATUS(st) != 0)
+            snprintf(status[s], sizeof(status[s]), "shard %d exited with status %d", s, WEXITSTATUS(st));
+        g_bench.shards.calibration_ns[s] = shared->calibration_ns[s];
+        g_bench.shards.calibration_error[s] = shared->calibration_error[s];
+    }
+
+    int failed = 0;
+    if (reserve_results(g_bench.result_count + assign_shards(jobs, shard)) != 0)
+    {
+        munmap(shared, bytes);
+        free(shard);
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        if (shard[i] < 0)
+            continue;
+        bench_result_t *result = &g_bench.results[g_bench.result_count];
+        histogram_t **slot = &g_bench.histograms[g_bench.result_count];
+        if (shared->done[i])
+            *result = shared->results[i];
+        else if (status[shard[i]][0])
+        {
+            memset(result, 0, sizeof(*result));
+            snprintf(result->error, sizeof(result->error), "%s", status[shard[i]]);
+            fail_result(&g_bench.benchmarks[i], result);
+        }
+        else
+        {
+            failed++; /* failed in-process, dropped as in a serial run */
+            continue;
+        }
+        free(*slot);
+        *slot = NULL;
+        if (hists && shared->done[i] && (*slot = malloc(sizeof(**slot))))
+            **slot = hists[i];
+        failed += result->error[0] != 0;
+        result->index = (int)i;
+        g_bench.result_count++;
+        if (g_bench.config.verbose && !result->error[0])
+            printf("%-40s shard %d, median %.2f ns +-%.2f%%\n", result->name, shard[i], result->stats.median_ns,
+                   result->stats.median_rel_error * 100.0);
+    }
+    munmap(shared, bytes);
+    free(shard);
+
+    /* Parallel runs changed the machine if a shard's calibration median
+     * moved by more than 5% and by more than both 95% CIs. */
+    const double alone = g_bench.shards.alone_ns;
+    if (g_bench.config.verbose)
+        printf("\nShards: %d on CPUs", jobs);
+    for (int s = 0; g_bench.config.verbose && s < jobs; s++)
+        printf("%s%d", s ? "," : " ", g_bench.shards.cpus[s]);
+    if (g_bench.config.verbose)
+        printf("; calibration %.0f ns alone\n", alone);
+    for (int s = 0; s < jobs; s++)
+    {
+        const double ns = g_bench.shards.calibration_ns[s], change = ns / alone - 1.0;
+        const double noise = g_bench.shards.alone_error + g_bench.shards.calibration_error[s];
+        if (g_bench.config.verbose)
+            printf("  shard %d: calibration %.0f ns (%+.1f%%)\n", s, ns, change * 100.0);
+        if (fabs(change) > 0.05 && fabs(change) > noise)
+            fprintf(stderr, "warning: shard %d calibration %+.1f%% against a serial run; "
+                            "parallel shards are disturbing each other\n",
+                    s, change * 100.0);
+    }
+    return failed;
+}
+
+/* The interval a median is gated by: its 95% CI, widened to at least half a
+ * timer tick per call either side, since samples are whole ticks and a CI
+ * can collapse onto one value, and with repetitions to two standard
+ * deviations of their medians, since one run's CI leaves out run-to-run
+ * variance. The baseline is assumed to come from the same timer. */
+static void gate_interval(double median, double lo, double hi, uint64_t batch, double reps_stddev, double out[2])
+{
+    const double tick = 0.5 * g_bench.ns_per_tick / (double)(batch ? batch : 1);
+    const double half = fmax(tick, reps_stddev > 0 ? 2.0 * reps_stddev : 0.0);
+    out[0] = fmin(lo, median - half);
+    out[1] = fmax(hi, median + half);
+}
+
+/* Verdict of every result found in the baseline file. Returns how many
+ * regressed. */
+static int compare_baseline(const char *path)
+{
+    baseline_entry_t *base;
+    const int n = baseline_load(path, &base);
+    const double threshold = g_bench.config.regression_threshold > 0 ? g_bench.config.regression_threshold : 0.05;
+    int regressions = 0;
+    registry_t names = {0};
+    if (n < 0)
+    {
+        fprintf(stderr, "warning: cannot read baseline %s\n", path);
+        return 0;
+    }
+    for (int k = 0; k < n; k++)
+        if (registry_add(&names, base[k].name, (size_t)k) < 0)
+        {
+            fprintf(stderr, "warning: out of memory reading baseline %s\n", path);
+            break;
+        }
+    if (g_bench.config.verbose)
+        printf("=== Baseline %s ===\n%-40s %10s %10s %8s  %s\n", path, "Benchmark", "Base(ns)", "New(ns)", "Change",
+               "Verdict");
+    for (size_t i = 0; i < g_bench.result_count; i++)
+    {
+        bench_result_t *r = &g_bench.results[i];
+        const long k = r->error[0] ? -1 : registry_find(&names, r->name, strlen(r->name));
+        const baseline_entry_t *b = k >= 0 ? &base[k] : NULL;
+        r->verdict = BENCH_VERDICT_NONE;
+        if (!b || b->median_ns <= 0)
+            continue;
+        r->baseline_change = r->stats.median_ns / b->median_ns - 1.0;
+        const bench_repetitions_t *rep = &r->repetitions;
+        double was[2], now[2];
+        gate_interval(b->median_ns, b->ci_low_ns, b->ci_high_ns, b->batch ? b->batch : r->stats.batch_size,
+                      b->reps_stddev_ns, was);
+        gate_interval(r->stats.median_ns, r->stats.median_ci_low_ns, r->stats.median_ci_high_ns,
+                      r->stats.batch_size, rep->count > 1 ? rep->stddev_ns : 0.0, now);
+        if (now[0] <= was[1] && now[1] >= was[0])
+            r->verdict = BENCH_VERDICT_SAME;
+        else if (r->baseline_change > threshold)
+            r->verdict = BENCH_VERDICT_REGRESSION;
+        else
+            r->verdict = r->baseline_change > 0 ? BENCH_VERDICT_SLOWER : BENCH_VERDICT_FASTER;
+        regressions += r->verdict == BENCH_VERDICT_REGRESSION;
+        if (g_bench.config.verbose)
+            printf("%-40s %10.1f %10.1f %+7.1f%%  %s\n", r->name, b->median_ns, r->stats.median_ns,
+                   r->baseline_change * 100.0, bench_verdict_name(r->verdict));
+    }
+    registry_free(&names);
+    baseline_free(base, n);
+    if (g_bench.config.verbose)
+        printf("%d regression(s) slower than %.3g%% with disjoint 95%% CIs%s\n\n", regressions, threshold * 100.0,
+               g_bench.config.repetitions > 1 ? "" : "; without BENCH_REPETITIONS these exclude run-to-run variance");
+    return regressions;
+}
+
+int bench_selected(const char *name)
+{
+    return !g_bench.filter_invalid && registry_filter_match(&g_bench.filter, name);
+}
+
+/* Prints the name of every benchmark a run would execute, one per line. */
+static int list_selected(void)
+{
+    size_t n, *selected = select_entries(g_bench.config.shard_index, g_bench.config.shard_count, &n);
+    for (size_t k = 0; selected && k < n; k++)
+        printf("%s\n", g_bench.benchmarks[selected[k]].name);
+    free(selected);
+    return selected ? 0 : 1;
 }
 
 int bench_run_all(void)
 {
     if (!g_bench.initialized)
         bench_init();
-    if (g_bench.config.verbose)
+    if (g_bench.filter_invalid)
+        return 1;
+    if (g_bench.config.list)
+        return list_selected();
+    size_t selected = g_bench.count;
+    if (g_bench.config.filter && g_bench.config.filter[0])
+    {
+        selected = 0;
+        for (size_t i = 0; i < g_bench.count; i++)
+            selected += bench_selected(g_bench.benchmarks[i].name);
+    }
+    if (g_bench.config.verbose && selected < g_bench.count)
+        printf("=== Running %zu of %zu benchmarks ===\n\n", selected, g_bench.count);
+    else if (g_bench.config.verbose)
         printf("=== Running %zu benchmarks ===\n\n", g_bench.count);
     g_bench.result_count = 0;
-    for (size_t i = 0; i < g_bench.count; i++)
+    if (g_bench.suite_setup)
+        g_bench.suite_setup();
+    const int orchestrate = g_bench.config.jobs > 1 && g_bench.config.shard_count < 2;
+    if (g_bench.config.samples_file && (g_bench.config.isolate || orchestrate))
+        fprintf(stderr, "warning: raw samples stay in the child processes of isolated and BENCH_JOBS runs; "
+                        "not writing %s\n", g_bench.config.samples_file);
+    else if (g_bench.config.samples_file)
+        g_bench.sampling = samples_open(g_bench.config.samples_file, g_bench.config.compress_samples) == 0;
+    g_bench.repeat.seed = 0;
+    if (g_bench.config.repetitions > 1 && g_bench.config.isolate)
+        fprintf(stderr, "warning: repetitions pool samples in one process; isolated benchmarks run once\n");
+    else if (g_bench.config.repetitions > 1)
     {
-        if (run_single_benchmark(&g_bench.benchmarks[i], &g_bench.results[g_bench.result_count]) == 0)
-            g_bench.result_count++;
+        g_bench.repeat.seed = g_bench.config.seed ? g_bench.config.seed : bench_timestamp_ns();
+        if (g_bench.config.verbose)
+            printf("Repetitions: %d interleaved rounds, seed %llu\n\n", g_bench.config.repetitions,
+                   (unsigned long long)g_bench.repeat.seed);
+    }
+    const int failed =
+        orchestrate ? run_shards() : run_selected(g_bench.config.shard_index, g_bench.config.shard_count);
+    if (g_bench.suite_teardown)
+        g_bench.suite_teardown();
+    if (g_bench.sampling && samples_close(g_bench.ns_per_tick) != 0)
+        fprintf(stderr, "warning: could not write all raw samples to %s\n", g_bench.config.samples_file);
+    else if (g_bench.sampling && g_bench.config.verbose)
+        printf("Raw samples written to %s\n", g_bench.config.samples_file);
+    g_bench.sampling = 0;
+    fit_complexity();
+    fit_scaling();
+    report_cold();
+    report_open_loop();
+    report_warmup();
+    machine_profile(g_bench.results, g_bench.result_count, &g_bench.profile);
+    if (g_bench.config.verbose && (g_bench.profile.measured || g_bench.profile.threads))
+    {
+        machine_print(&g_bench.profile);
+        printf("\n");
     }
+    const int regressed = g_bench.config.baseline_file ? compare_baseline(g_bench.config.baseline_file) : 0;
     if (g_bench.config.output_file)
         bench_write_csv(g_bench.config.output_file);
-    return 0;
+    if (g_bench.config.histogram_file)
+        bench_write_histograms(g_bench.config.histogram_file);
+    if (g_bench.config.history_file)
+        bench_write_history(g_bench.config.history_file);
+    if (g_bench.config.verbose && failed)
+        printf("%d of %zu benchmarks failed\n", failed, selected);
+    return failed + regressed;
 }
 
 int bench_run(const char *name)
 {
     if (!g_bench.initialized)
         bench_init();
-    for (size_t i = 0; i < g_bench.count; i++)
-    {
-        if (strcmp(g_bench.benchmarks[i].name, name) == 0)
-            return run_single_benchmark(&g_bench.benchmarks[i], &g_bench.results[g_bench.result_count++]);
-    }
-    return -1;
+    const long i = registry_find(&g_bench.names, name, strlen(name));
+    if (i < 0 || reserve_results(g_bench.result_count + 1) != 0)
+        return -1;
+    if (g_bench.suite_setup)
+        g_bench.suite_setup();
+    bench_result_t *result = &g_bench.results[g_bench.result_count++];
+    int ret = g_bench.config.isolate ? run_isolated(&g_bench.benchmarks[i], result)
+                                     : run_single_benchmark(&g_bench.benchmarks[i], result);
+    result->index = (int)i;
+    if (g_bench.suite_teardown)
+        g_bench.suite_teardown();
+    return ret;
 }
 
 const bench_result_t *bench_get_results(size_t *count)
@@ -188,19 +2406,117 @@ const bench_result_t *bench_get_results(size_t *count)
     return g_bench.results;
 }
 
+const bench_complexity_t *bench_get_complexity(size_t *count)
+{
+    if (count)
+        *count = g_bench.complexity_count;
+    return g_bench.complexity;
+}
+
+const bench_environment_t *bench_get_environment(void)
+{
+    return &g_bench.environment;
+}
+
+const bench_machine_t *bench_get_machine(void)
+{
+    return &g_bench.profile;
+}
+
+const char *bench_big_o_name(bench_big_o_t big_o)
+{
+    static const char *names[] = {"O(1)", "O(log n)", "O(n)", "O(n log n)", "O(n^2)"};
+    return (unsigned)big_o <= BENCH_O_N_SQUARED ? names[big_o] : "?";
+}
+
+const char *bench_verdict_name(bench_verdict_t verdict)
+{
+    static const char *names[] = {"", "same", "faster", "slower", "regression"};
+    return (unsigned)verdict <= BENCH_VERDICT_REGRESSION ? names[verdict] : "?";
+}
+
 int bench_write_csv(const char *filename)
 {
     FILE *fp = fopen(filename, "w");
     if (!fp)
         return -1;
-    fprintf(fp, "name,description,iterations,min_ns,max_ns,mean_ns,median_ns,stddev_ns,p95_ns,p99_ns\n");
+    fprintf(fp, "name,description,iterations,min_ns,max_ns,mean_ns,median_ns,stddev_ns,p95_ns,p99_ns,batch_size,"
+                "min_cycles,median_cycles,mean_cycles,p99_cycles,overhead_ns,noise_floor_ns,optimized_away,"
+                "hw_cycles,hw_instructions,hw_branch_misses,hw_l1d_misses,hw_llc_misses,hw_dtlb_misses,"
+                "ipc,branch_mpki,l1d_mpki,llc_mpki,dtlb_mpki,p999_ns,p9999_ns,median_rel_error,"
+                "mean_ci_low_ns,mean_ci_high_ns,median_ci_low_ns,median_ci_high_ns,"
+                "outliers_low_severe,outliers_low_mild,outliers_high_mild,outliers_high_severe,outlier_variance,arg,"
+                "pauses,pause_overhead_ns,threads,throughput,scaling_efficiency,error,index,"
+                "bytes_per_second,items_per_second,ns_per_item,user_counters,baseline_change,verdict,"
+                "repetitions,repetition_mean_ns,repetition_median_ns,repetition_stddev_ns,"
+                "allocs_per_call,frees_per_call,alloc_bytes_per_call,peak_heap_bytes,leaked_allocs,"
+                "cold_median_ns,cold_mean_ns,cold_p99_ns,cold_min_ns,cold_slowdown,cold_evict_ns,"
+                "open_loop_rate,open_loop_achieved,open_loop_p50_ns,open_loop_p99_ns,open_loop_p999_ns,"
+                "open_loop_max_ns,open_loop_service_p99_ns,open_loop_slo_ns,open_loop_max_rate,"
+                "warmup_iterations,warmup_steady\n");
     for (size_t i = 0; i < g_bench.result_count; i++)
     {
         bench_result_t *r = &g_bench.results[i];
-        fprintf(fp, "%s,\"%s\",%lu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+        const bench_counters_t *c = &r->counters;
+        fprintf(fp, "%s,\"%s\",%lu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%lu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%d,"
+                    "%.2f,%.2f,%.4f,%.4f,%.4f,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2f,%.2f,%.5f,"
+                    "%.2f,%.2f,%.2f,%.2f,%lu,%lu,%lu,%lu,%.4f,",
                 r->name, r->description, (unsigned long)r->stats.iterations,
                 r->stats.min_ns, r->stats.max_ns, r->stats.mean_ns, r->stats.median_ns,
-                r->stats.stddev_ns, r->stats.p95_ns, r->stats.p99_ns);
+                r->stats.stddev_ns, r->stats.p95_ns, r->stats.p99_ns, (unsigned long)r->stats.batch_size,
+                r->stats.min_cycles, r->stats.median_cycles, r->stats.mean_cycles, r->stats.p99_cycles,
+                r->stats.overhead_ns, r->stats.noise_floor_ns, r->stats.optimized_away,
+                c->cycles, c->instructions, c->branch_misses, c->l1d_misses, c->llc_misses, c->dtlb_misses,
+                c->ipc, c->branch_mpki, c->l1d_mpki, c->llc_mpki, c->dtlb_mpki, r->stats.p999_ns, r->stats.p9999_ns,
+                r->stats.median_rel_error, r->stats.mean_ci_low_ns, r->stats.mean_ci_high_ns,
+                r->stats.median_ci_low_ns, r->stats.median_ci_high_ns, (unsigned long)r->stats.outliers_low_severe,
+                (unsigned long)r->stats.outliers_low_mild, (unsigned long)r->stats.outliers_high_mild,
+                (unsigned long)r->stats.outliers_high_severe, r->stats.outlier_variance);
+        if (r->has_arg)
+            fprintf(fp, "%lld", (long long)r->arg);
+        fprintf(fp, ",%.3f,%.2f,%d,%.2f,%.4f,\"%s\",%d,%.6g,%.6g,%.4f,\"", r->stats.pauses,
+                r->stats.pause_overhead_ns, r->threads, r->throughput, r->scaling_efficiency, r->error, r->index,
+                r->bytes_per_second, r->items_per_second, r->ns_per_item);
+        for (int k = 0; k < r->user_counter_count; k++) /* name=rate per second */
+            fprintf(fp, "%s%s=%.6g", k ? ";" : "", r->user_counters[k].name, r->user_counters[k].per_second);
+        if (r->verdict != BENCH_VERDICT_NONE)
+            fprintf(fp, "\",%.5f,%s,", r->baseline_change, bench_verdict_name(r->verdict));
+        else
+            fprintf(fp, "\",,,");
+        if (r->repetitions.count)
+            fprintf(fp, "%d,%.2f,%.2f,%.2f,", r->repetitions.count, r->repetitions.mean_ns,
+                    r->repetitions.median_ns, r->repetitions.stddev_ns);
+        else
+            fprintf(fp, ",,,,");
+        if (r->alloc.tracked)
+            fprintf(fp, "%.4f,%.4f,%.2f,%llu,%llu,", r->alloc.allocs, r->alloc.frees, r->alloc.bytes,
+                    (unsigned long long)r->alloc.peak_bytes, (unsigned long long)r->alloc.leaks);
+        else
+            fprintf(fp, ",,,,,");
+        const bench_cold_t *cold = &r->cold;
+        if (cold->measured)
+            fprintf(fp, "%.2f,%.2f,%.2f,%.2f,%.4f,%.1f,", cold->stats.median_ns, cold->stats.mean_ns,
+                    cold->stats.p99_ns, cold->stats.min_ns, cold->slowdown, cold->evict_ns);
+        else
+            fprintf(fp, ",,,,,,");
+        const bench_open_loop_t *ol = &r->open_loop;
+        if (ol->measured)
+        {
+            fprintf(fp, "%.6g,%.6g,%.2f,%.2f,%.2f,%.2f,%.2f,", ol->run.rate, ol->run.achieved, ol->latency.median_ns,
+                    ol->latency.p99_ns, ol->latency.p999_ns, ol->latency.max_ns, ol->service.p99_ns);
+            if (!isnan(ol->slo_ns))
+                fprintf(fp, "%.2f", ol->slo_ns);
+            fprintf(fp, ",");
+            if (!isnan(ol->max_rate))
+                fprintf(fp, "%.6g", ol->max_rate);
+            fprintf(fp, ",");
+        }
+        else
+            fprintf(fp, ",,,,,,,,,");
+        fprintf(fp, "%llu,", (unsigned long long)r->warmup.iterations);
+        if (r->warmup.automatic)
+            fprintf(fp, "%d", r->warmup.steady);
+        fprintf(fp, "\n");
     }
     fclose(fp);
     if (g_bench.config.verbose)
@@ -208,22 +2524,198 @@ int bench_write_csv(const char *filename)
     return 0;
 }
 
+/* NaN has no JSON spelling; unavailable readings are written as null. */
+static void json_number(FILE *fp, const char *key, double v, const char *sep)
+{
+    if (isnan(v) || isinf(v))
+        fprintf(fp, "\"%s\":null%s", key, sep);
+    else
+        fprintf(fp, "\"%s\":%.4f%s", key, v, sep);
+}
+
 int bench_write_json(const char *filename)
 {
     FILE *fp = fopen(filename, "w");
     if (!fp)
         return -1;
-    fprintf(fp, "{\n  \"benchmarks\": [\n");
+    fprintf(fp, "{\n  \"timer\": {\"backend\":\"%s\",\"ticks_per_ns\":%.6f},\n",
+            bench_timer_name(), bench_ticks_per_ns());
+    const bench_environment_t *env = &g_bench.environment;
+    fprintf(fp, "  \"environment\": {\"stable\":%s,\"cpu\":%d,\"fifo_priority\":%d,\"memory_locked\":%s,"
+                "\"governor\":\"%s\",\"smt_siblings\":%d,",
+            env->stable ? "true" : "false", env->cpu, env->fifo_priority, env->memory_locked ? "true" : "false",
+            env->governor, env->smt_siblings);
+    json_number(fp, "load_average", env->load_average, "},\n");
+    if (g_bench.shards.orchestrated)
+    {
+        fprintf(fp, "  \"shards\": {\"count\":%d,\"cpus\":[", g_bench.shards.count);
+        for (int s = 0; s < g_bench.shards.count; s++)
+            fprintf(fp, "%s%d", s ? "," : "", g_bench.shards.cpus[s]);
+        fprintf(fp, "],\"calibration_alone_ns\":%.1f,\"calibration_ns\":[", g_bench.shards.alone_ns);
+        for (int s = 0; s < g_bench.shards.count; s++)
+            fprintf(fp, "%s%.1f", s ? "," : "", g_bench.shards.calibration_ns[s]);
+        fprintf(fp, "]},\n");
+    }
+    else if (g_bench.shards.count)
+        fprintf(fp, "  \"shards\": {\"index\":%d,\"count\":%d},\n", g_bench.shards.index, g_bench.shards.count);
+    if (g_bench.repeat.seed)
+        fprintf(fp, "  \"repetitions\": {\"count\":%d,\"seed\":%llu},\n", g_bench.config.repetitions,
+                (unsigned long long)g_bench.repeat.seed);
+    const bench_machine_t *m = &g_bench.profile;
+    if (m->measured || m->threads)
+    {
+        fprintf(fp, "  \"machine\": {\"caches\":[");
+        for (int i = 0; i < m->levels; i++)
+            fprintf(fp, "%s{\"level\":%d,\"bytes\":%llu,\"latency_ns\":%.3f}", i ? "," : "", i + 1,
+                    (unsigned long long)m->cache[i].bytes, m->cache[i].latency_ns);
+        fprintf(fp, "],\"reported_bytes\":[");
+        for (int i = 0; i < BENCH_MAX_CACHE_LEVELS; i++)
+            fprintf(fp, "%s%llu", i ? "," : "", (unsigned long long)m->reported_bytes[i]);
+        fprintf(fp, "],");
+        json_number(fp, "memory_latency_ns", m->measured ? m->memory_latency_ns : NAN, ",");
+        fprintf(fp, "\"stream_bytes\":%llu,\"threads\":%d,", (unsigned long long)m->stream_bytes, m->threads);
+        const bench_bandwidth_t *bw[2] = {&m->single, &m->all};
+        for (int k = 0; k < 2; k++)
+        {
+            fprintf(fp, "\"%s\":{", k ? "bandwidth_all_gbs" : "bandwidth_single_gbs");
+            json_number(fp, "read", bw[k]->read, ",");
+            json_number(fp, "write", bw[k]->write, ",");
+            json_number(fp, "copy", bw[k]->copy, ",");
+            json_number(fp, "triad", bw[k]->triad, k ? "}},\n" : "},");
+        }
+    }
+    fprintf(fp, "  \"benchmarks\": [\n");
     for (size_t i = 0; i < g_bench.result_count; i++)
     {
         bench_result_t *r = &g_bench.results[i];
         fprintf(fp, "    {\"name\":\"%s\",\"description\":\"%s\",\"iterations\":%lu,"
                     "\"min_ns\":%.2f,\"max_ns\":%.2f,\"mean_ns\":%.2f,\"median_ns\":%.2f,"
-                    "\"stddev_ns\":%.2f,\"p95_ns\":%.2f,\"p99_ns\":%.2f}%s\n",
+                    "\"stddev_ns\":%.2f,\"p95_ns\":%.2f,\"p99_ns\":%.2f,\"p999_ns\":%.2f,\"p9999_ns\":%.2f,"
+                    "\"batch_size\":%lu,\"min_cycles\":%.2f,\"median_cycles\":%.2f,\"mean_cycles\":%.2f,\"p99_cycles\":%.2f,"
+                    "\"overhead_ns\":%.2f,\"noise_floor_ns\":%.2f,\"optimized_away\":%s,",
                 r->name, r->description, (unsigned long)r->stats.iterations,
                 r->stats.min_ns, r->stats.max_ns, r->stats.mean_ns, r->stats.median_ns,
-                r->stats.stddev_ns, r->stats.p95_ns, r->stats.p99_ns,
-                (i < g_bench.result_count - 1) ? "," : "");
+                r->stats.stddev_ns, r->stats.p95_ns, r->stats.p99_ns, r->stats.p999_ns, r->stats.p9999_ns,
+                (unsigned long)r->stats.batch_size,
+                r->stats.min_cycles, r->stats.median_cycles, r->stats.mean_cycles, r->stats.p99_cycles,
+                r->stats.overhead_ns, r->stats.noise_floor_ns, r->stats.optimized_away ? "true" : "false");
+        json_number(fp, "median_rel_error", r->stats.median_rel_error, ",");
+        fprintf(fp, "\"mean_ci_ns\":[%.2f,%.2f],\"median_ci_ns\":[%.2f,%.2f],", r->stats.mean_ci_low_ns,
+                r->stats.mean_ci_high_ns, r->stats.median_ci_low_ns, r->stats.median_ci_high_ns);
+        fprintf(fp, "\"outliers\":{\"low_severe\":%lu,\"low_mild\":%lu,\"high_mild\":%lu,\"high_severe\":%lu,",
+                (unsigned long)r->stats.outliers_low_severe, (unsigned long)r->stats.outliers_low_mild,
+                (unsigned long)r->stats.outliers_high_mild, (unsigned long)r->stats.outliers_high_severe);
+        json_number(fp, "variance", r->stats.outlier_variance, "},");
+        if (r->has_arg)
+            fprintf(fp, "\"arg\":%lld,", (long long)r->arg);
+        fprintf(fp, "\"pauses\":%.3f,\"pause_overhead_ns\":%.2f,\"threads\":%d,\"index\":%d,", r->stats.pauses,
+                r->stats.pause_overhead_ns, r->threads, r->index);
+        json_number(fp, "throughput", r->throughput, ",");
+        json_number(fp, "scaling_efficiency", r->scaling_efficiency, ",");
+        json_number(fp, "bytes_per_second", r->bytes_per_second, ",");
+        json_number(fp, "items_per_second", r->items_per_second, ",");
+        json_number(fp, "ns_per_item", r->ns_per_item, ",");
+        fprintf(fp, "\"user_counters\":{");
+        for (int k = 0; k < r->user_counter_count; k++)
+        {
+            fprintf(fp, "%s\"%s\":{", k ? "," : "", r->user_counters[k].name);
+            json_number(fp, "value", r->user_counters[k].value, ",");
+            json_number(fp, "per_second", r->user_counters[k].per_second, "}");
+        }
+        fprintf(fp, "},");
+        if (r->error[0])
+            fprintf(fp, "\"error\":\"%s\",", r->error);
+        if (r->verdict != BENCH_VERDICT_NONE)
+            fprintf(fp, "\"baseline\":{\"change\":%.5f,\"verdict\":\"%s\"},", r->baseline_change,
+                    bench_verdict_name(r->verdict));
+        const bench_repetitions_t *rep = &r->repetitions;
+        if (rep->count)
+        {
+            fprintf(fp, "\"repetitions\":{\"count\":%d,\"mean_ns\":%.2f,\"median_ns\":%.2f,\"stddev_ns\":%.2f,"
+                        "\"min_ns\":%.2f,\"max_ns\":%.2f,\"medians_ns\":[",
+                    rep->count, rep->mean_ns, rep->median_ns, rep->stddev_ns, rep->min_ns, rep->max_ns);
+            for (int k = 0; k < rep->count; k++)
+                fprintf(fp, "%s%.2f", k ? "," : "", rep->medians_ns[k]);
+            fprintf(fp, "]},");
+        }
+        if (r->alloc.tracked)
+        {
+            fprintf(fp, "\"alloc\":{");
+            json_number(fp, "allocs_per_call", r->alloc.allocs, ",");
+            json_number(fp, "frees_per_call", r->alloc.frees, ",");
+            json_number(fp, "bytes_per_call", r->alloc.bytes, ",");
+            fprintf(fp, "\"peak_bytes\":%llu,\"leaks\":%llu},", (unsigned long long)r->alloc.peak_bytes,
+                    (unsigned long long)r->alloc.leaks);
+        }
+        const bench_cold_t *cold = &r->cold;
+        if (cold->measured)
+        {
+            fprintf(fp, "\"cold\":{\"iterations\":%lu,\"min_ns\":%.2f,\"max_ns\":%.2f,\"mean_ns\":%.2f,"
+                        "\"median_ns\":%.2f,\"stddev_ns\":%.2f,\"p95_ns\":%.2f,\"p99_ns\":%.2f,"
+                        "\"median_ci_ns\":[%.2f,%.2f],\"eviction\":\"%s\",\"evict_bytes\":%llu,\"evict_ns\":%.1f,",
+                    (unsigned long)cold->stats.iterations, cold->stats.min_ns, cold->stats.max_ns, cold->stats.mean_ns,
+                    cold->stats.median_ns, cold->stats.stddev_ns, cold->stats.p95_ns, cold->stats.p99_ns,
+                    cold->stats.median_ci_low_ns, cold->stats.median_ci_high_ns, cold->flushed ? "flush" : "sweep",
+                    (unsigned long long)cold->evict_bytes, cold->evict_ns);
+            json_number(fp, "slowdown", cold->slowdown, "},");
+        }
+        const bench_open_loop_t *ol = &r->open_loop;
+        if (ol->measured)
+        {
+            fprintf(fp, "\"open_loop\":{\"arrivals\":\"%s\",\"rate\":%.6g,\"achieved\":%.6g,\"calls\":%lu,"
+                        "\"unsent\":%lu,",
+                    ol->poisson ? "poisson" : "constant", ol->run.rate, ol->run.achieved,
+                    (unsigned long)ol->run.calls, (unsigned long)ol->run.unsent);
+            const bench_stats_t *st[2] = {&ol->latency, &ol->service};
+            for (int k = 0; k < 2; k++)
+                fprintf(fp, "\"%s\":{\"min_ns\":%.2f,\"mean_ns\":%.2f,\"median_ns\":%.2f,\"p95_ns\":%.2f,"
+                            "\"p99_ns\":%.2f,\"p999_ns\":%.2f,\"p9999_ns\":%.2f,\"max_ns\":%.2f},",
+                        k ? "service" : "latency", st[k]->min_ns, st[k]->mean_ns, st[k]->median_ns, st[k]->p95_ns,
+                        st[k]->p99_ns, st[k]->p999_ns, st[k]->p9999_ns, st[k]->max_ns);
+            json_number(fp, "slo_ns", ol->slo_ns, ",");
+            fprintf(fp, "\"met\":%s,", ol->run.met ? "true" : "false");
+            json_number(fp, "max_rate", ol->max_rate, ",\"steps\":[");
+            for (int k = 0; k < ol->steps; k++)
+            {
+                const bench_rate_step_t *s = &ol->step[k];
+                fprintf(fp, "%s{\"rate\":%.6g,\"achieved\":%.6g,\"p50_ns\":%.2f,\"p99_ns\":%.2f,\"p999_ns\":%.2f,"
+                            "\"max_ns\":%.2f,\"calls\":%lu,\"unsent\":%lu,\"met\":%s}",
+                        k ? "," : "", s->rate, s->achieved, s->p50_ns, s->p99_ns, s->p999_ns, s->max_ns,
+                        (unsigned long)s->calls, (unsigned long)s->unsent, s->met ? "true" : "false");
+            }
+            fprintf(fp, "]},");
+        }
+        const bench_warmup_t *w = &r->warmup;
+        fprintf(fp, "\"warmup\":{\"auto\":%s,\"iterations\":%llu,\"seconds\":%.6f,", w->automatic ? "true" : "false",
+                (unsigned long long)w->iterations, w->seconds);
+        if (w->automatic)
+        {
+            fprintf(fp, "\"steady\":%s,\"windows\":%d,", w->steady ? "true" : "false", w->windows);
+            json_number(fp, "median_ns", w->median_ns, "},");
+        }
+        else
+            fprintf(fp, "\"steady\":null},");
+        const bench_counters_t *c = &r->counters;
+        fprintf(fp, "\"counters\":{");
+        json_number(fp, "cycles", c->cycles, ",");
+        json_number(fp, "instructions", c->instructions, ",");
+        json_number(fp, "branch_misses", c->branch_misses, ",");
+        json_number(fp, "l1d_misses", c->l1d_misses, ",");
+        json_number(fp, "llc_misses", c->llc_misses, ",");
+        json_number(fp, "dtlb_misses", c->dtlb_misses, ",");
+        json_number(fp, "ipc", c->ipc, ",");
+        json_number(fp, "branch_mpki", c->branch_mpki, ",");
+        json_number(fp, "l1d_mpki", c->l1d_mpki, ",");
+        json_number(fp, "llc_mpki", c->llc_mpki, ",");
+        json_number(fp, "dtlb_mpki", c->dtlb_mpki, "");
+        fprintf(fp, "}}%s\n", (i < g_bench.result_count - 1) ? "," : "");
+    }
+    fprintf(fp, "  ],\n  \"complexity\": [\n");
+    for (size_t i = 0; i < g_bench.complexity_count; i++)
+    {
+        const bench_complexity_t *c = &g_bench.complexity[i];
+        fprintf(fp, "    {\"name\":\"%s\",\"big_o\":\"%s\",\"coefficient_ns\":%.6g,\"rms\":%.4f}%s\n", c->name,
+                bench_big_o_name(c->big_o), c->coefficient_ns, c->rms, i + 1 < g_bench.complexity_count ? "," : "");
     }
     fprintf(fp, "  ]\n}\n");
     fclose(fp);
@@ -232,4 +2724,67 @@ int bench_write_json(const char *filename)
     return 0;
 }
 
-void bench_cleanup(void) { memset(&g_bench, 0, sizeof(g_bench)); }
+/* One row per non-empty bucket, bounds in ns per call: [lower_ns, upper_ns). */
+int bench_write_histograms(const char *filename)
+{
+    FILE *fp = fopen(filename, "w");
+    if (!fp)
+        return -1;
+    fprintf(fp, "name,lower_ns,upper_ns,count\n");
+    for (size_t i = 0; i < g_bench.result_count; i++)
+    {
+        const histogram_t *h = g_bench.histograms[i];
+        if (!h)
+            continue;
+        const double scale = g_bench.ns_per_tick / (double)g_bench.results[i].stats.batch_size;
+        for (size_t b = 0; b < HIST_BUCKETS; b++)
+        {
+            uint64_t lo, hi;
+            if (!h->counts[b])
+                continue;
+            histogram_bucket_range(b, &lo, &hi);
+            fprintf(fp, "%s,%.4f,%.4f,%lu\n", g_bench.results[i].name, (double)lo * scale,
+                    (double)(hi + 1) * scale, (unsigned long)h->counts[b]);
+        }
+    }
+    fclose(fp);
+    if (g_bench.config.verbose)
+        printf("Histograms written to %s\n", filename);
+    return 0;
+}
+
+int bench_write_history(const char *filename)
+{
+    if (!g_bench.captured)
+        history_capture(&g_bench.machine), g_bench.captured = 1;
+    const bench_config_t *c = &g_bench.config;
+    const uint32_t flags = (g_bench.environment.stable ? HISTORY_STABLE : 0) | (c->streaming ? HISTORY_STREAMING : 0) |
+                           (c->isolate ? HISTORY_ISOLATED : 0) |
+                           (c->shard_count > 1 || g_bench.shards.orchestrated ? HISTORY_SHARDED : 0);
+    const int run = history_append(filename, &g_bench.machine, bench_timer_name(), flags,
+                                   g_bench.environment.load_average, g_bench.results, g_bench.result_count);
+    if (run < 0)
+        return -1;
+    if (c->verbose)
+        printf("History: run %d appended to %s\n", run, filename);
+    return 0;
+}
+
+void bench_cleanup(void)
+{
+    perf_close();
+    for (size_t i = 0; i < g_bench.result_cap; i++)
+        free(g_bench.histograms[i]);
+    free(g_bench.histograms);
+    free(g_bench.results);
+    free(g_bench.complexity);
+    free(g_bench.benchmarks);
+    free(g_bench.fixtures);
+    registry_free(&g_bench.names);
+    registry_free(&g_bench.fixture_names[0]);
+    registry_free(&g_bench.fixture_names[1]);
+    registry_filter_free(&g_bench.filter);
+    registry_filter_free(&g_bench.cold);
+    cold_close();
+    memset(&g_bench, 0, sizeof(g_bench));
+}
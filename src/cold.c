@@ -0,0 +1,141 @@
+#define _GNU_SOURCE
+
+#include "cold.h"
+#include "environment.h"
+#include "machine.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#define COLD_LINE 64
+#define COLD_PAGE 4096
+#define COLD_MIN_BYTES (32ull << 20)  /* 8192 small pages, past any second-level TLB */
+#define COLD_MAX_BYTES (256ull << 20) /* a sweep stays in the tens of milliseconds */
+
+static struct
+{
+    char *buffer;
+    uint64_t bytes;
+    struct
+    {
+        const char *p;
+        size_t bytes;
+    } declared[BENCH_MAX_COLD_BUFFERS];
+    int count;
+} g_cold;
+
+static volatile uint64_t g_sink; /* keeps the sweeps' loads */
+
+int cold_open(void)
+{
+    if (g_cold.buffer)
+        return 0;
+    uint64_t caches[BENCH_MAX_CACHE_LEVELS] = {0}, last = 0;
+    machine_reported_caches(caches);
+    for (int i = 0; i < BENCH_MAX_CACHE_LEVELS; i++)
+        last = caches[i] > last ? caches[i] : last;
+    uint64_t bytes = 2 * last;
+    bytes = bytes < COLD_MIN_BYTES ? COLD_MIN_BYTES : bytes > COLD_MAX_BYTES ? COLD_MAX_BYTES : bytes;
+    void *p = NULL;
+    const int err = posix_memalign(&p, COLD_PAGE, bytes);
+    if (err != 0)
+        return err;
+#ifdef __linux__
+    madvise(p, bytes, MADV_NOHUGEPAGE); /* huge pages would cover it with a few TLB entries */
+#endif
+    environment_prefault(p, bytes); /* written, so no page is the shared zero page */
+    g_cold.buffer = p;
+    g_cold.bytes = bytes;
+    return 0;
+}
+
+uint64_t cold_bytes(void)
+{
+    return cold_flushing() ? COLD_MIN_BYTES : g_cold.bytes;
+}
+
+void cold_add(const void *p, size_t bytes)
+{
+    for (int i = 0; i < g_cold.count; i++)
+        if (g_cold.declared[i].p == p && g_cold.declared[i].bytes == bytes)
+            return;
+    if (g_cold.count < BENCH_MAX_COLD_BUFFERS && p && bytes)
+    {
+        g_cold.declared[g_cold.count].p = p;
+        g_cold.declared[g_cold.count].bytes = bytes;
+        g_cold.count++;
+    }
+}
+
+void cold_clear(void)
+{
+    g_cold.count = 0;
+}
+
+int cold_flushing(void)
+{
+#if defined(__x86_64__) || defined(__aarch64__)
+    return g_cold.count > 0;
+#else
+    return 0;
+#endif
+}
+
+static void flush_line(const char *p)
+{
+#if defined(__x86_64__)
+    __asm__ volatile("clflush (%0)" : : "r"(p) : "memory");
+#elif defined(__aarch64__)
+    __asm__ volatile("dc civac, %0" : : "r"(p) : "memory");
+#else
+    (void)p;
+#endif
+}
+
+static void flush_fence(void)
+{
+#if defined(__x86_64__)
+    __asm__ volatile("mfence" : : : "memory");
+#elif defined(__aarch64__)
+    __asm__ volatile("dsb ish" : : : "memory");
+#endif
+}
+
+/* Loads one word every stride bytes of the first bytes of the buffer. */
+static void sweep(uint64_t bytes, size_t stride)
+{
+    uint64_t sum = 0;
+    for (size_t at = 0; at < bytes; at += stride)
+        sum += *(const volatile uint64_t *)(g_cold.buffer + at);
+    g_sink = sum;
+}
+
+void cold_evict(void)
+{
+    if (!cold_flushing())
+    {
+        sweep(g_cold.bytes, COLD_LINE);
+        return;
+    }
+    for (int i = 0; i < g_cold.count; i++)
+    {
+        const uintptr_t start = (uintptr_t)g_cold.declared[i].p & ~(uintptr_t)(COLD_LINE - 1);
+        const uintptr_t end = (uintptr_t)g_cold.declared[i].p + g_cold.declared[i].bytes;
+        for (uintptr_t at = start; at < end; at += COLD_LINE)
+            flush_line((const char *)at);
+    }
+    flush_fence();
+    sweep(COLD_MIN_BYTES, COLD_PAGE);
+    flush_fence();
+}
+
+void cold_close(void)
+{
+    free(g_cold.buffer);
+    g_cold.buffer = NULL;
+    g_cold.bytes = 0;
+    g_cold.count = 0;
+}
@@ -0,0 +1,23 @@
+#ifndef BENCH_COLD_H
+#define BENCH_COLD_H
+
+#include "benchmark.h"
+
+/* Cold-cache eviction between samples. With buffers declared through
+ * bench_set_cold_buffer, only their lines are flushed (clflush on x86-64,
+ * dc civac on aarch64), and then one line per page of 32 MB is touched,
+ * which is beyond any TLB's reach. Otherwise, and on other targets, the
+ * whole buffer is streamed through, which also displaces every cache level.
+ * The buffer is twice the last-level cache, at least 32 MB and at most
+ * 256 MB, and backed by small pages so that touching it does reach the TLB. */
+int cold_open(void); /* allocates the buffer on first use; 0, or the errno of the allocation */
+uint64_t cold_bytes(void); /* that cold_evict sweeps or touches */
+/* Declared buffers of the running benchmark; a range declared again counts
+ * once, and past the limit they are ignored */
+void cold_add(const void *p, size_t bytes);
+void cold_clear(void);
+int cold_flushing(void); /* cold_evict flushes declared buffers rather than sweeping */
+void cold_evict(void);
+void cold_close(void);
+
+#endif
@@ -0,0 +1,283 @@
+#define _GNU_SOURCE
+
+#include "environment.h"
+#include "stats.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+static struct
+{
+    int stable, locked;
+#ifdef __linux__
+    cpu_set_t allowed; /* affinity before stable mode pinned the thread */
+    int saved;
+#endif
+} g_env;
+
+#ifdef __linux__
+
+/* First line of a sysfs/procfs file without the newline, or -1. */
+static int read_line(const char *path, char *buf, size_t size)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return -1;
+    char *ok = fgets(buf, (int)size, fp);
+    fclose(fp);
+    if (!ok)
+        return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+/* Hardware threads on cpu's core other than cpu, from a list like "2,6" or "0-1". */
+static int smt_siblings(int cpu)
+{
+    char path[96], list[256];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    if (read_line(path, list, sizeof(list)) != 0)
+        return -1;
+    int count = 0;
+    for (char *p = list; *p;)
+    {
+        int lo, hi, used;
+        if (sscanf(p, "%d%n", &lo, &used) != 1)
+            break;
+        p += used;
+        hi = lo;
+        if (*p == '-' && sscanf(p + 1, "%d%n", &hi, &used) == 1)
+            p += 1 + used;
+        count += hi - lo + 1;
+        if (*p == ',')
+            p++;
+    }
+    return count > 0 ? count - 1 : -1;
+}
+
+static void undo(void)
+{
+    if (!g_env.saved)
+        return;
+    struct sched_param normal = {0};
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &normal);
+    pthread_setaffinity_np(pthread_self(), sizeof(g_env.allowed), &g_env.allowed);
+    munlockall();
+    g_env.saved = g_env.locked = 0;
+}
+
+void environment_apply(const bench_config_t *config, bench_environment_t *env)
+{
+    undo();
+    memset(env, 0, sizeof(*env));
+    env->cpu = -1;
+    env->smt_siblings = -1;
+    env->load_average = NAN;
+    env->stable = g_env.stable = config->stable;
+
+    int cpu = sched_getcpu();
+    if (config->stable)
+    {
+        g_env.saved = sched_getaffinity(0, sizeof(g_env.allowed), &g_env.allowed) == 0;
+        const int target = config->cpu >= 0 ? config->cpu : cpu;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        if (target >= 0 && target < CPU_SETSIZE)
+            CPU_SET(target, &one);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+        if (err == 0)
+            env->cpu = cpu = target;
+        else
+            fprintf(stderr, "warning: cannot pin to CPU %d: %s\n", target, strerror(err));
+        if (config->fifo_priority > 0)
+        {
+            struct sched_param param = {.sched_priority = config->fifo_priority};
+            if ((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) == 0)
+                env->fifo_priority = config->fifo_priority;
+            else
+                fprintf(stderr, "warning: cannot switch to SCHED_FIFO: %s\n", strerror(err));
+        }
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+            env->memory_locked = g_env.locked = 1;
+        else
+            fprintf(stderr, "warning: mlockall failed: %s (see ulimit -l)\n", strerror(errno));
+    }
+
+    if (cpu >= 0)
+    {
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu);
+        if (read_line(path, env->governor, sizeof(env->governor)) != 0)
+            env->governor[0] = '\0';
+        env->smt_siblings = smt_siblings(cpu);
+    }
+    char load[128];
+    if (read_line("/proc/loadavg", load, sizeof(load)) == 0)
+        env->load_average = strtod(load, NULL);
+}
+
+void environment_pin_worker(int index, int pin)
+{
+    cpu_set_t allowed, one;
+    if (g_env.saved)
+        allowed = g_env.allowed;
+    else if (!pin || sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return;
+    if (!pin || CPU_COUNT(&allowed) == 0)
+    {
+        pthread_setaffinity_np(pthread_self(), sizeof(allowed), &allowed);
+        return;
+    }
+    int k = index % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &allowed) && k-- == 0)
+        {
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+            return;
+        }
+}
+
+void environment_after_fork(void)
+{
+    if (g_env.locked)
+        mlockall(MCL_CURRENT | MCL_FUTURE);
+}
+
+void environment_prefault(void *p, size_t bytes)
+{
+    memset(p, 0, bytes);
+    if (g_env.stable)
+        mlock(p, bytes);
+}
+
+int environment_cores(int *cpus, int max)
+{
+    cpu_set_t allowed;
+    int cores[CPU_SETSIZE], n = 0;
+    if (g_env.saved)
+        allowed = g_env.allowed;
+    else if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && n < max; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+        /* A core is named by the first CPU of its sibling list */
+        char path[96], list[256];
+        int core = cpu, seen = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if (read_line(path, list, sizeof(list)) == 0 && sscanf(list, "%d", &core) != 1)
+            core = cpu;
+        for (int i = 0; i < n && !seen; i++)
+            seen = cores[i] == core;
+        if (!seen)
+        {
+            cores[n] = core;
+            cpus[n++] = cpu;
+        }
+    }
+    return n;
+}
+
+void environment_pin_cpu(int cpu)
+{
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(one), &one) == 0 && g_env.saved)
+        g_env.allowed = one; /* unpinned threaded workers stay on this core too */
+}
+
+#else
+
+int environment_cores(int *cpus, int max)
+{
+    (void)cpus;
+    (void)max;
+    return 0;
+}
+
+void environment_pin_cpu(int cpu)
+{
+    (void)cpu;
+}
+
+void environment_apply(const bench_config_t *config, bench_environment_t *env)
+{
+    memset(env, 0, sizeof(*env));
+    env->cpu = -1;
+    env->smt_siblings = -1;
+    env->load_average = NAN;
+    env->stable = g_env.stable = config->stable;
+    if (config->stable)
+        fprintf(stderr, "warning: stable mode is Linux-only\n");
+}
+
+void environment_pin_worker(int index, int pin)
+{
+    (void)index;
+    (void)pin;
+}
+
+void environment_after_fork(void) {}
+
+void environment_prefault(void *p, size_t bytes)
+{
+    memset(p, 0, bytes);
+}
+
+#endif
+
+void environment_warn(const bench_environment_t *env)
+{
+    if (env->governor[0] && strcmp(env->governor, "performance") != 0)
+        fprintf(stderr, "warning: CPU frequency governor is '%s'; 'performance' keeps the clock fixed\n",
+                env->governor);
+    if (env->smt_siblings > 0)
+        fprintf(stderr, "warning: %d SMT sibling(s) share this core; keep them idle or disable SMT\n",
+                env->smt_siblings);
+    if (env->load_average > 1.0)
+        fprintf(stderr, "warning: load average %.2f; other work is competing for the CPUs\n", env->load_average);
+}
+
+#define CALIBRATION_SAMPLES 33
+#define CALIBRATION_BYTES (4u << 20)
+
+double environment_calibrate(double *rel_error)
+{
+    uint64_t *buf = malloc(CALIBRATION_BYTES), samples[CALIBRATION_SAMPLES], median;
+    const size_t words = CALIBRATION_BYTES / sizeof(uint64_t), rank = CALIBRATION_SAMPLES / 2;
+    if (!buf)
+        return NAN;
+    for (size_t i = 0; i < words; i++)
+        buf[i] = i;
+    for (int s = -1; s < CALIBRATION_SAMPLES; s++) /* the first pass warms up */
+    {
+        const uint64_t start = bench_timestamp_ns();
+        volatile uint64_t sink;
+        uint64_t x = 1;
+        for (int i = 0; i < 200000; i++)
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        for (size_t i = 0; i < words; i += 8)
+            x += buf[i];
+        sink = x;
+        (void)sink;
+        if (s >= 0)
+            samples[s] = bench_timestamp_ns() - start;
+    }
+    free(buf);
+    stats_select(samples, CALIBRATION_SAMPLES, &rank, 1, &median);
+    if (rel_error)
+        *rel_error = stats_median_error(samples, CALIBRATION_SAMPLES, 1, 0.0);
+    return (double)median;
+}
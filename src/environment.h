@@ -0,0 +1,32 @@
+#ifndef BENCH_ENVIRONMENT_H
+#define BENCH_ENVIRONMENT_H
+
+#include "benchmark.h"
+
+/* Stable mode (Linux): pins the calling thread to config->cpu, optionally
+ * switches it to SCHED_FIFO and locks all memory. Whatever could not be
+ * applied is left out of env rather than treated as an error. The CPU's
+ * governor, SMT siblings and the load average are read in either mode.
+ * Calling it again first undoes the previous call. */
+void environment_apply(const bench_config_t *config, bench_environment_t *env);
+/* One stderr line per reading that makes timings unreliable. */
+void environment_warn(const bench_environment_t *env);
+/* Threaded workers inherit the pinned CPU; this moves worker index to the
+ * index-th CPU the process started with if pin, else back to all of them. */
+void environment_pin_worker(int index, int pin);
+/* One allowed CPU per physical core, so no two share a core or an SMT
+ * sibling; allowed means before stable mode pinned the thread. Returns how
+ * many were written, at most max. */
+int environment_cores(int *cpus, int max);
+void environment_pin_cpu(int cpu);
+/* Median ns of a fixed kernel: a dependent multiply chain (clock speed)
+ * and a sweep over 4 MB (shared cache and memory bandwidth). rel_error is
+ * the median's 95% CI half-width over the median. */
+double environment_calibrate(double *rel_error);
+/* Memory locks are not inherited across fork; an isolated child retakes them. */
+void environment_after_fork(void);
+/* Writes every page of a buffer, and locks it in stable mode, so that its
+ * first-touch page faults do not land inside a timed sample. */
+void environment_prefault(void *p, size_t bytes);
+
+#endif
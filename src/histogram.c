@@ -0,0 +1,149 @@
+#include "histogram.h"
+#include "stats.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t bucket_index(uint64_t v)
+{
+    if (v < HIST_SUB)
+        return (size_t)v;
+    unsigned e = 63u - (unsigned)__builtin_clzll(v) - HIST_SUB_BITS;
+    return (size_t)(e + 1) * HIST_SUB + (size_t)((v >> e) - HIST_SUB);
+}
+
+void histogram_bucket_range(size_t idx, uint64_t *lo, uint64_t *hi)
+{
+    if (idx < HIST_SUB)
+    {
+        *lo = *hi = idx;
+        return;
+    }
+    unsigned e = (unsigned)(idx / HIST_SUB) - 1;
+    *lo = (uint64_t)(idx % HIST_SUB + HIST_SUB) << e;
+    *hi = *lo + ((1ULL << e) - 1);
+}
+
+void histogram_reset(histogram_t *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void histogram_record(histogram_t *h, uint64_t v)
+{
+    h->counts[bucket_index(v)]++;
+    h->total++;
+    if (v < h->min)
+        h->min = v;
+    if (v > h->max)
+        h->max = v;
+    double delta = (double)v - h->mean;
+    h->mean += delta / (double)h->total;
+    h->m2 += delta * ((double)v - h->mean);
+}
+
+void histogram_merge(histogram_t *into, const histogram_t *from)
+{
+    if (from->total == 0)
+        return;
+    for (size_t i = 0; i < HIST_BUCKETS; i++)
+        into->counts[i] += from->counts[i];
+    const double n = (double)into->total, m = (double)from->total, delta = from->mean - into->mean;
+    into->mean += delta * m / (n + m);
+    into->m2 += from->m2 + delta * delta * n * m / (n + m);
+    into->total += from->total;
+    into->min = from->min < into->min ? from->min : into->min;
+    into->max = from->max > into->max ? from->max : into->max;
+}
+
+double histogram_quantile(const histogram_t *h, double q)
+{
+    if (h->total == 0)
+        return 0.0;
+    uint64_t rank = (uint64_t)((double)h->total * q), seen = 0;
+    for (size_t i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += h->counts[i];
+        if (seen > rank)
+        {
+            uint64_t lo, hi;
+            histogram_bucket_range(i, &lo, &hi);
+            if (lo < h->min)
+                lo = h->min;
+            if (hi > h->max)
+                hi = h->max;
+            return ((double)lo + (double)hi) / 2.0;
+        }
+    }
+    return (double)h->max;
+}
+
+/* Bucket bounds clamped to the recorded range for the sample at rank. */
+static void rank_bounds(const histogram_t *h, uint64_t rank, uint64_t *lo, uint64_t *hi)
+{
+    uint64_t seen = 0;
+    size_t i = 0;
+    while (i < HIST_BUCKETS - 1 && (seen += h->counts[i]) <= rank)
+        i++;
+    histogram_bucket_range(i, lo, hi);
+    *lo = *lo < h->min ? h->min : *lo;
+    *hi = *hi > h->max ? h->max : *hi;
+}
+
+double histogram_median_error(const histogram_t *h)
+{
+    if (h->total == 0)
+        return NAN;
+    size_t lo_rank, hi_rank;
+    uint64_t lo, hi, unused;
+    stats_median_ci(h->total, &lo_rank, &hi_rank);
+    rank_bounds(h, lo_rank, &lo, &unused);
+    rank_bounds(h, hi_rank, &unused, &hi);
+    /* At least half a tick either way, the resolution of the samples */
+    const double median = histogram_quantile(h, 0.5);
+    return median > 0 ? fmax((double)(hi - lo), 1.0) / (2.0 * median) : NAN;
+}
+
+void histogram_stats(const histogram_t *h, uint64_t batch, bench_stats_t *stats)
+{
+    if (h->total == 0)
+        return;
+    const double b = (double)batch;
+    stats->iterations = h->total;
+    stats->min_ns = (double)h->min / b;
+    stats->max_ns = (double)h->max / b;
+    stats->mean_ns = h->mean / b;
+    stats->stddev_ns = sqrt(h->m2 / (double)h->total) / b;
+    stats->median_ns = histogram_quantile(h, 0.5) / b;
+    stats->p95_ns = histogram_quantile(h, 0.95) / b;
+    stats->p99_ns = histogram_quantile(h, 0.99) / b;
+    stats->p999_ns = histogram_quantile(h, 0.999) / b;
+    stats->p9999_ns = histogram_quantile(h, 0.9999) / b;
+    stats->median_rel_error = histogram_median_error(h);
+
+    /* Non-empty buckets stand in for the samples in the bootstrap */
+    size_t k = 0;
+    for (size_t i = 0; i < HIST_BUCKETS; i++)
+        k += h->counts[i] != 0;
+    uint64_t *counts = malloc(k * sizeof(uint64_t));
+    double *values = malloc(k * sizeof(double));
+    if (counts && values)
+    {
+        k = 0;
+        for (size_t i = 0; i < HIST_BUCKETS; i++)
+            if (h->counts[i])
+            {
+                uint64_t lo, hi;
+                histogram_bucket_range(i, &lo, &hi);
+                lo = lo < h->min ? h->min : lo;
+                hi = hi > h->max ? h->max : hi;
+                values[k] = ((double)lo + (double)hi) / 2.0 / b;
+                counts[k++] = h->counts[i];
+            }
+        stats_bootstrap(values, counts, k, stats);
+        stats_outliers(values, counts, k, histogram_quantile(h, 0.25) / b, histogram_quantile(h, 0.75) / b, stats);
+    }
+    free(counts);
+    free(values);
+}
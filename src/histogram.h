@@ -0,0 +1,33 @@
+#ifndef BENCH_HISTOGRAM_H
+#define BENCH_HISTOGRAM_H
+
+#include "benchmark.h"
+
+/* Log-linear (HDR-style) histogram of tick counts. Values below 2^HIST_SUB_BITS
+ * are exact; each higher power of two is split into 2^HIST_SUB_BITS buckets,
+ * so a bucket is never wider than 1/2^HIST_SUB_BITS of the values it holds. */
+#define HIST_SUB_BITS 7
+#define HIST_SUB (1u << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+typedef struct
+{
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total, min, max;
+    double mean, m2; /* Welford running moments */
+} histogram_t;
+
+void histogram_reset(histogram_t *h);
+void histogram_record(histogram_t *h, uint64_t v);
+/* Adds every value recorded in from to into. */
+void histogram_merge(histogram_t *into, const histogram_t *from);
+/* Value of the sample at rank floor(total * q), to within one bucket. */
+double histogram_quantile(const histogram_t *h, double q);
+/* Inclusive value range [*lo, *hi] covered by bucket idx. */
+void histogram_bucket_range(size_t idx, uint64_t *lo, uint64_t *hi);
+/* Relative half-width of the median's 95% CI, widened to whole buckets. */
+double histogram_median_error(const histogram_t *h);
+/* Fills stats (in ticks per call) from a histogram of per-batch totals. */
+void histogram_stats(const histogram_t *h, uint64_t batch, bench_stats_t *stats);
+
+#endif
@@ -0,0 +1,283 @@
+#define _GNU_SOURCE
+
+#include "history.h"
+#include "registry.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef BENCH_CFLAGS
+#define BENCH_CFLAGS "" /* the Makefile passes the library's own flags */
+#endif
+
+_Static_assert(sizeof(history_string_t) == HISTORY_RECORD, "history_string_t is one record");
+_Static_assert(sizeof(history_run_t) == HISTORY_RECORD, "history_run_t is one record");
+_Static_assert(sizeof(history_result_t) == HISTORY_RECORD, "history_result_t is one record");
+
+static void copy(char *dst, size_t size, const char *src)
+{
+    snprintf(dst, size, "%s", src);
+}
+
+void history_capture(history_machine_t *machine)
+{
+    const char *env;
+    struct utsname u;
+    memset(machine, 0, sizeof(*machine));
+    if (uname(&u) == 0)
+    {
+        copy(machine->host, sizeof(machine->host), u.nodename);
+        snprintf(machine->kernel, sizeof(machine->kernel), "%s %s", u.sysname, u.release);
+        copy(machine->cpu, sizeof(machine->cpu), u.machine);
+    }
+    FILE *fp = fopen("/proc/cpuinfo", "r");
+    char line[256];
+    while (fp && fgets(line, sizeof(line), fp))
+        if (strncmp(line, "model name", 10) == 0 && strchr(line, ':'))
+        {
+            char *value = strchr(line, ':') + 1;
+            value += strspn(value, " \t");
+            value[strcspn(value, "\n")] = '\0';
+            copy(machine->cpu, sizeof(machine->cpu), value);
+            break;
+        }
+    if (fp)
+        fclose(fp);
+#if defined(__clang__)
+    copy(machine->compiler, sizeof(machine->compiler), "clang " __clang_version__);
+#elif defined(__GNUC__)
+    copy(machine->compiler, sizeof(machine->compiler), "gcc " __VERSION__);
+#endif
+    copy(machine->cflags, sizeof(machine->cflags), BENCH_CFLAGS);
+    if ((env = getenv("BENCH_COMPILER")))
+        copy(machine->compiler, sizeof(machine->compiler), env);
+    if ((env = getenv("BENCH_CFLAGS")))
+        copy(machine->cflags, sizeof(machine->cflags), env);
+    if ((env = getenv("BENCH_LABEL")))
+        copy(machine->label, sizeof(machine->label), env);
+    if ((env = getenv("BENCH_COMMIT")))
+        copy(machine->commit, sizeof(machine->commit), env);
+    else if ((fp = popen("git describe --always --dirty 2>/dev/null", "r")))
+    {
+        if (fgets(machine->commit, sizeof(machine->commit), fp))
+            machine->commit[strcspn(machine->commit, "\n")] = '\0';
+        pclose(fp);
+    }
+}
+
+/* The file's string table and the records this run appends */
+typedef struct
+{
+    char **strings; /* string id - 1 */
+    size_t count, cap;
+    registry_t ids; /* string to id - 1, for interning */
+    char *out;
+    size_t used, size;
+    int failed;
+} writer_t;
+
+static void emit(writer_t *w, const void *record)
+{
+    if (w->used + HISTORY_RECORD > w->size)
+    {
+        size_t size = w->size ? w->size * 2 : 64 * HISTORY_RECORD;
+        char *grown = realloc(w->out, size);
+        if (!grown)
+        {
+            w->failed = 1;
+            return;
+        }
+        w->out = grown, w->size = size;
+    }
+    memcpy(w->out + w->used, record, HISTORY_RECORD);
+    w->used += HISTORY_RECORD;
+}
+
+static int add_string(writer_t *w, char *text)
+{
+    if (w->count == w->cap)
+    {
+        size_t cap = w->cap ? w->cap * 2 : 256;
+        char **grown = realloc(w->strings, cap * sizeof(char *));
+        if (!grown)
+            return -1;
+        w->strings = grown, w->cap = cap;
+    }
+    w->strings[w->count++] = text;
+    return 0;
+}
+
+/* Id of text, emitting its string records the first time it is seen. */
+static uint32_t intern(writer_t *w, const char *text)
+{
+    if (!text[0])
+        return 0;
+    const long found = registry_find(&w->ids, text, strlen(text));
+    if (found >= 0)
+        return (uint32_t)(found + 1);
+    char *dup = strdup(text);
+    if (!dup || add_string(w, dup) != 0)
+    {
+        free(dup);
+        w->failed = 1;
+        return 0;
+    }
+    if (registry_add(&w->ids, dup, w->count - 1) < 0)
+        w->failed = 1;
+    const size_t len = strlen(text), chunk = sizeof(((history_string_t *)0)->text);
+    for (size_t at = 0; at < len; at += chunk)
+    {
+        history_string_t r = {.tag = HISTORY_STRING, .id = (uint32_t)w->count, .part = (uint32_t)(at / chunk)};
+        r.length = (uint32_t)(len - at < chunk ? len - at : chunk);
+        memcpy(r.text, text + at, r.length);
+        emit(w, &r);
+    }
+    return (uint32_t)w->count;
+}
+
+/* Reads the string table and the last run number of an existing file. */
+static int load(int fd, writer_t *w, uint32_t *last_run)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return -1;
+    const size_t size = (size_t)st.st_size;
+    if (size == 0)
+    {
+        char header[HISTORY_RECORD] = {0};
+        const uint32_t version = HISTORY_VERSION, record = HISTORY_RECORD;
+        memcpy(header, HISTORY_MAGIC, 8);
+        memcpy(header + 8, &version, 4);
+        memcpy(header + 12, &record, 4);
+        emit(w, header);
+        return 0;
+    }
+    char *buf = malloc(size);
+    size_t got = 0;
+    for (ssize_t n; buf && got < size; got += (size_t)n)
+        if ((n = pread(fd, buf + got, size - got, (off_t)got)) <= 0)
+            break;
+    uint32_t version = 0;
+    if (buf && got >= HISTORY_RECORD)
+        memcpy(&version, buf + 8, 4);
+    int ok = buf && got == size && size % HISTORY_RECORD == 0 && memcmp(buf, HISTORY_MAGIC, 8) == 0 &&
+             version == HISTORY_VERSION;
+    for (size_t at = HISTORY_RECORD; ok && at < size; at += HISTORY_RECORD)
+    {
+        uint32_t tag;
+        memcpy(&tag, buf + at, 4);
+        if (tag == HISTORY_RUN)
+        {
+            history_run_t r;
+            memcpy(&r, buf + at, sizeof(r));
+            *last_run = r.run > *last_run ? r.run : *last_run;
+        }
+        else if (tag == HISTORY_STRING)
+        {
+            history_string_t r;
+            memcpy(&r, buf + at, sizeof(r));
+            const size_t len = r.length < sizeof(r.text) ? r.length : sizeof(r.text);
+            if (r.part == 0 && r.id == w->count + 1)
+            {
+                char *s = strndup(r.text, len);
+                ok = s && add_string(w, s) == 0;
+                if (!ok)
+                    free(s);
+            }
+            else if (r.part > 0 && r.id == w->count)
+            {
+                const size_t old = strlen(w->strings[w->count - 1]);
+                char *s = realloc(w->strings[w->count - 1], old + len + 1);
+                if ((ok = s != NULL))
+                {
+                    memcpy(s + old, r.text, len);
+                    s[old + len] = '\0';
+                    w->strings[w->count - 1] = s;
+                }
+            }
+            else
+                ok = 0;
+        }
+    }
+    free(buf);
+    for (size_t i = 0; ok && i < w->count; i++) /* strings continue over records, so only now */
+        ok = registry_add(&w->ids, w->strings[i], i) >= 0;
+    return ok ? 0 : -1;
+}
+
+int history_append(const char *path, const history_machine_t *machine, const char *timer, uint32_t flags,
+                   double load_average, const bench_result_t *results, size_t count)
+{
+    const int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0 || flock(fd, LOCK_EX) != 0)
+    {
+        fprintf(stderr, "warning: cannot open history %s: %s\n", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    writer_t w = {0};
+    uint32_t run = 0;
+    if (load(fd, &w, &run) != 0)
+    {
+        fprintf(stderr, "warning: %s is not a benchmark history file, or is damaged\n", path);
+        w.failed = 1;
+    }
+    history_run_t r = {.tag = HISTORY_RUN, .run = ++run, .time = (int64_t)time(NULL)};
+    r.host = intern(&w, machine->host);
+    r.cpu = intern(&w, machine->cpu);
+    r.kernel = intern(&w, machine->kernel);
+    r.compiler = intern(&w, machine->compiler);
+    r.cflags = intern(&w, machine->cflags);
+    r.commit = intern(&w, machine->commit);
+    r.timer = intern(&w, timer);
+    r.label = intern(&w, machine->label);
+    r.benchmarks = (uint32_t)count;
+    r.flags = flags;
+    r.load_average = load_average;
+    uint32_t *names = malloc((count ? count : 1) * sizeof(uint32_t));
+    for (size_t i = 0; names && i < count; i++)
+        names[i] = intern(&w, results[i].name); /* strings go before the records that use them */
+    emit(&w, &r);
+    for (size_t i = 0; names && i < count; i++)
+    {
+        const bench_stats_t *s = &results[i].stats;
+        history_result_t x = {.tag = HISTORY_RESULT, .run = run, .name = names[i]};
+        x.flags = (results[i].error[0] ? HISTORY_FAILED : 0) | (uint32_t)results[i].verdict << 8;
+        x.median_ns = s->median_ns;
+        x.ci_low_ns = s->median_ci_low_ns;
+        x.ci_high_ns = s->median_ci_high_ns;
+        x.mean_ns = s->mean_ns;
+        x.p99_ns = s->p99_ns;
+        x.iterations = s->iterations;
+        emit(&w, &x);
+    }
+    if (!names)
+        w.failed = 1;
+    for (size_t at = 0; !w.failed && at < w.used;)
+    {
+        const ssize_t n = write(fd, w.out + at, w.used - at);
+        if (n <= 0)
+        {
+            fprintf(stderr, "warning: cannot append to history %s: %s\n", path, strerror(errno));
+            w.failed = 1;
+        }
+        else
+            at += (size_t)n;
+    }
+    close(fd); /* releases the lock */
+    for (size_t i = 0; i < w.count; i++)
+        free(w.strings[i]);
+    free(w.strings);
+    registry_free(&w.ids);
+    free(w.out);
+    free(names);
+    return w.failed ? -1 : (int)run;
+}
@@ -0,0 +1,68 @@
+#ifndef BENCH_HISTORY_H
+#define BENCH_HISTORY_H
+
+#include "benchmark.h"
+
+/* Run history (BENCH_HISTORY): an append-only file of 64-byte records in host
+ * byte order. The first record is the header; after it each run appends the
+ * string records it needs, one run record and one result record per
+ * benchmark. Strings are deduplicated across the whole file and referenced
+ * by id, 0 meaning none; a string longer than one record continues in the
+ * next with part + 1. */
+#define HISTORY_MAGIC "BENCHHST"
+#define HISTORY_VERSION 1
+#define HISTORY_RECORD 64
+
+enum
+{
+    HISTORY_STRING = 1,
+    HISTORY_RUN = 2,
+    HISTORY_RESULT = 3
+};
+
+/* Run flags */
+#define HISTORY_STABLE 1u
+#define HISTORY_STREAMING 2u
+#define HISTORY_ISOLATED 4u
+#define HISTORY_SHARDED 8u
+/* Result flags; the verdict against a baseline is in bits 8-15 */
+#define HISTORY_FAILED 1u
+
+typedef struct
+{
+    uint32_t tag, id, part, length;
+    char text[48];
+} history_string_t;
+
+typedef struct
+{
+    uint32_t tag, run; /* runs are numbered from 1 in file order */
+    int64_t time;      /* Unix seconds at the end of the run */
+    uint32_t host, cpu, kernel, compiler, cflags, commit, timer, label;
+    uint32_t benchmarks, flags;
+    double load_average;
+} history_run_t;
+
+typedef struct
+{
+    uint32_t tag, run, name, flags;
+    double median_ns, ci_low_ns, ci_high_ns, mean_ns, p99_ns;
+    uint64_t iterations;
+} history_result_t;
+
+/* What produced a run, as text; empty when unknown */
+typedef struct
+{
+    char host[72], cpu[128], kernel[160], compiler[128], cflags[256], commit[64], label[128];
+} history_machine_t;
+
+/* Fills the machine from uname, /proc/cpuinfo and the build. BENCH_COMPILER,
+ * BENCH_CFLAGS, BENCH_COMMIT and BENCH_LABEL override or add to it; without
+ * BENCH_COMMIT the commit comes from git describe in the working directory. */
+void history_capture(history_machine_t *machine);
+/* Appends one run under an exclusive lock, creating the file if needed.
+ * Returns the run's number, or -1 with a warning on stderr. */
+int history_append(const char *path, const history_machine_t *machine, const char *timer, uint32_t flags,
+                   double load_average, const bench_result_t *results, size_t count);
+
+#endif
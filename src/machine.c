@@ -0,0 +1,406 @@
+#define _GNU_SOURCE
+
+#include "machine.h"
+#include "environment.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MACHINE_MIN_BYTES 4096
+#define MACHINE_MAX_POINTS 64
+#define MACHINE_LINE 64                  /* bytes between chased pointers */
+#define MACHINE_LOADS 1024               /* dependent loads per call */
+#define MACHINE_CHUNK (1u << 20)         /* bytes of each array one bandwidth call streams */
+#define MACHINE_STREAM_MIN (64ull << 20) /* per array, however small the caches look */
+#define MACHINE_STREAM_MAX (256ull << 20) /* per array, however large */
+#define MACHINE_MAX_THREADS 256
+#define MACHINE_STEP 1.3 /* latency over a plateau's first that ends the plateau */
+#define MACHINE_FLAT 1.1 /* growth between neighbouring sizes that starts the next */
+
+#define CHUNK_WORDS (MACHINE_CHUNK / sizeof(double))
+
+static struct
+{
+    void **chase; /* where the chase stands */
+    char *ring;   /* the lines it runs through */
+    double *a, *b, *c;
+    size_t words, stride; /* doubles per array; between the workers' starting points */
+    uint64_t stream_bytes;
+} g_machine;
+
+static void *g_self = &g_self; /* a one-line ring, chased when the working set cannot be allocated */
+static __thread uint64_t t_calls; /* bandwidth calls by this worker */
+
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Links every line of the working set into a single random cycle with
+ * Sattolo's shuffle, so the prefetcher cannot follow it and no shorter
+ * cycle leaves part of the set cold. */
+static void chase_setup(void)
+{
+    const size_t lines = (size_t)bench_current_arg / MACHINE_LINE;
+    uint32_t *order = malloc(lines * sizeof(uint32_t));
+    void *ring = NULL;
+    if (!order || posix_memalign(&ring, 4096, lines * MACHINE_LINE) != 0)
+    {
+        fprintf(stderr, "warning: out of memory for a %lld-byte working set; its latency is meaningless\n",
+                (long long)bench_current_arg);
+        free(order);
+        g_machine.chase = (void **)&g_self;
+        return;
+    }
+    environment_prefault(ring, lines * MACHINE_LINE);
+    for (size_t i = 0; i < lines; i++)
+        order[i] = (uint32_t)i;
+    uint64_t state = lines;
+    for (size_t i = lines - 1; i > 0; i--)
+    {
+        const size_t j = (size_t)(splitmix64(&state) % i);
+        const uint32_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    g_machine.ring = ring;
+    for (size_t i = 0; i < lines; i++)
+        *(void **)(g_machine.ring + i * MACHINE_LINE) = g_machine.ring + (size_t)order[i] * MACHINE_LINE;
+    free(order);
+    g_machine.chase = (void **)g_machine.ring;
+    bench_set_items(MACHINE_LOADS);
+}
+
+static void chase_teardown(void)
+{
+    free(g_machine.ring);
+    g_machine.ring = NULL;
+}
+
+static void chase(void)
+{
+    void **p = g_machine.chase;
+    for (int i = 0; i < MACHINE_LOADS; i++)
+        p = (void **)*p;
+    g_machine.chase = p;
+}
+
+static void stream_teardown(void)
+{
+    free(g_machine.a);
+    free(g_machine.b);
+    free(g_machine.c);
+    g_machine.a = g_machine.b = g_machine.c = NULL;
+}
+
+static void stream_setup(uint64_t bytes_per_call)
+{
+    const size_t bytes = g_machine.words * sizeof(double);
+    void *a = NULL, *b = NULL, *c = NULL;
+    if (posix_memalign(&a, 4096, bytes) || posix_memalign(&b, 4096, bytes) || posix_memalign(&c, 4096, bytes))
+        fprintf(stderr, "warning: out of memory for the %zu-byte bandwidth arrays; skipping the kernel\n", bytes);
+    g_machine.a = a, g_machine.b = b, g_machine.c = c;
+    if (!a || !b || !c)
+    {
+        stream_teardown();
+        return;
+    }
+    environment_prefault(a, bytes);
+    environment_prefault(b, bytes);
+    environment_prefault(c, bytes);
+    bench_set_bytes(bytes_per_call);
+}
+
+/* STREAM's convention: bytes the kernel reads plus writes, no write-allocate */
+static void read_setup(void)
+{
+    stream_setup(MACHINE_CHUNK);
+}
+
+static void write_setup(void)
+{
+    stream_setup(MACHINE_CHUNK);
+}
+
+static void copy_setup(void)
+{
+    stream_setup(2 * MACHINE_CHUNK);
+}
+
+static void triad_setup(void)
+{
+    stream_setup(3 * MACHINE_CHUNK);
+}
+
+/* Offset of this call's chunk. Workers start a stride apart and walk on,
+ * wrapping, so each streams its own part of the arrays from memory. */
+static size_t next_chunk(void)
+{
+    return ((size_t)bench_current_thread * g_machine.stride + (size_t)t_calls++ * CHUNK_WORDS) % g_machine.words;
+}
+
+static void stream_read(void)
+{
+    if (!g_machine.a)
+        return;
+    const double *a = g_machine.a + next_chunk();
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    for (size_t i = 0; i < CHUNK_WORDS; i += 4)
+    {
+        s0 += a[i];
+        s1 += a[i + 1];
+        s2 += a[i + 2];
+        s3 += a[i + 3];
+    }
+    double sum = s0 + s1 + s2 + s3;
+    bench_do_not_optimize(&sum);
+}
+
+static void stream_write(void)
+{
+    if (!g_machine.a)
+        return;
+    double *a = g_machine.a + next_chunk();
+    for (size_t i = 0; i < CHUNK_WORDS; i++)
+        a[i] = 1.0;
+    bench_clobber();
+}
+
+static void stream_copy(void)
+{
+    if (!g_machine.a)
+        return;
+    const size_t at = next_chunk();
+    double *a = g_machine.a + at;
+    const double *b = g_machine.b + at;
+    for (size_t i = 0; i < CHUNK_WORDS; i++)
+        a[i] = b[i];
+    bench_clobber();
+}
+
+static void stream_triad(void)
+{
+    if (!g_machine.a)
+        return;
+    const size_t at = next_chunk();
+    double *a = g_machine.a + at;
+    const double *b = g_machine.b + at, *c = g_machine.c + at;
+    for (size_t i = 0; i < CHUNK_WORDS; i++)
+        a[i] = b[i] + 3.0 * c[i];
+    bench_clobber();
+}
+
+static const struct
+{
+    const char *name, *description;
+    bench_fn_t fn, setup;
+} g_kernels[] = {
+    {"machine/read", "Streaming read bandwidth, sum of a[i]", stream_read, read_setup},
+    {"machine/write", "Streaming write bandwidth, a[i] = s", stream_write, write_setup},
+    {"machine/copy", "Streaming copy bandwidth, a[i] = b[i]", stream_copy, copy_setup},
+    {"machine/triad", "Streaming triad bandwidth, a[i] = b[i] + s * c[i]", stream_triad, triad_setup},
+};
+
+static uint64_t parse_size(const char *text)
+{
+    char *end;
+    uint64_t v = strtoull(text, &end, 10);
+    switch (*end)
+    {
+    case 'G': v <<= 10; /* fall through */
+    case 'M': v <<= 10; /* fall through */
+    case 'K': v <<= 10; break;
+    }
+    return v;
+}
+
+uint64_t machine_parse(const char *text)
+{
+    const uint64_t v = parse_size(text);
+    return v == 0 ? 0 : v < MACHINE_MIN_BYTES ? BENCH_MACHINE_BYTES : v;
+}
+
+void machine_reported_caches(uint64_t bytes[BENCH_MAX_CACHE_LEVELS])
+{
+    for (int i = 0; i < 16; i++)
+    {
+        char path[96], line[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", i);
+        FILE *fp = fopen(path, "r");
+        if (!fp)
+            break;
+        const int instruction = fgets(line, sizeof(line), fp) && strncmp(line, "Instruction", 11) == 0;
+        fclose(fp);
+        int level = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", i);
+        if (instruction || !(fp = fopen(path, "r")))
+            continue;
+        if (fgets(line, sizeof(line), fp))
+            level = atoi(line);
+        fclose(fp);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", i);
+        if (level < 1 || level > BENCH_MAX_CACHE_LEVELS || !(fp = fopen(path, "r")))
+            continue;
+        if (fgets(line, sizeof(line), fp))
+            bytes[level - 1] = parse_size(line);
+        fclose(fp);
+    }
+}
+
+void machine_register(uint64_t max_bytes)
+{
+    const long pages = sysconf(_SC_PHYS_PAGES), page = sysconf(_SC_PAGESIZE);
+    const uint64_t memory = pages > 0 && page > 0 ? (uint64_t)pages * (uint64_t)page : UINT64_MAX;
+    if (max_bytes > memory / 2)
+    {
+        max_bytes = memory / 2;
+        fprintf(stderr, "warning: the machine suite sweeps to %llu MB, half of physical memory\n",
+                (unsigned long long)(max_bytes >> 20));
+    }
+    int64_t sizes[MACHINE_MAX_POINTS];
+    size_t n = 0;
+    for (uint64_t v = MACHINE_MIN_BYTES; v <= max_bytes && n + 2 <= MACHINE_MAX_POINTS; v *= 2)
+    {
+        sizes[n++] = (int64_t)v;
+        if (v / 2 * 3 <= max_bytes)
+            sizes[n++] = (int64_t)(v / 2 * 3);
+    }
+    bench_register_args(chase, "machine/latency", "Load-to-use latency, random pointer chase over the working set",
+                        sizes, n);
+    bench_set_fixture("machine/latency", chase_setup, chase_teardown);
+
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    const int most = cpus < 1 ? 1 : cpus > MACHINE_MAX_THREADS ? MACHINE_MAX_THREADS : (int)cpus;
+    int threads[16], nthreads = 0;
+    for (int t = 1; t < most; t *= 2)
+        threads[nthreads++] = t;
+    threads[nthreads++] = most;
+    /* Arrays well past the last cache, so every kernel streams from memory */
+    uint64_t reported[BENCH_MAX_CACHE_LEVELS] = {0}, stream = MACHINE_STREAM_MIN;
+    machine_reported_caches(reported);
+    for (int i = 0; i < BENCH_MAX_CACHE_LEVELS; i++)
+        stream = 4 * reported[i] > stream ? 4 * reported[i] : stream;
+    stream = stream < MACHINE_STREAM_MAX ? stream : MACHINE_STREAM_MAX;
+    stream = stream < max_bytes ? stream : max_bytes;
+    stream = stream < memory / 6 ? stream : memory / 6; /* three arrays in half the memory */
+    stream = stream > (uint64_t)MACHINE_CHUNK * most ? stream : (uint64_t)MACHINE_CHUNK * most;
+    const size_t chunks = (size_t)(stream / MACHINE_CHUNK);
+    g_machine.stream_bytes = (uint64_t)chunks * MACHINE_CHUNK;
+    g_machine.words = chunks * CHUNK_WORDS;
+    g_machine.stride = chunks / (size_t)most * CHUNK_WORDS;
+    for (size_t k = 0; k < sizeof(g_kernels) / sizeof(g_kernels[0]); k++)
+    {
+        bench_register_threads(g_kernels[k].fn, g_kernels[k].name, g_kernels[k].description, threads,
+                               (size_t)nthreads);
+        for (int t = 0; t < nthreads; t++)
+        {
+            char name[64];
+            snprintf(name, sizeof(name), "%s/threads:%d", g_kernels[k].name, threads[t]);
+            bench_set_fixture(name, g_kernels[k].setup, stream_teardown);
+        }
+    }
+}
+
+/* Finds the plateaus of a latency curve sorted by working set. A plateau
+ * ends at the last size within MACHINE_STEP of its first, and the next one
+ * starts where the curve flattens out again; the last is memory. */
+static void find_levels(const uint64_t *bytes, const double *ns, int n, bench_machine_t *m)
+{
+    for (int i = 0; i < n && m->levels < BENCH_MAX_CACHE_LEVELS;)
+    {
+        int end = i;
+        while (end + 1 < n && ns[end + 1] <= ns[i] * MACHINE_STEP)
+            end++;
+        if (end + 1 >= n)
+            break;
+        m->cache[m->levels].bytes = bytes[end];
+        m->cache[m->levels].latency_ns = ns[i + (end - i) / 2];
+        m->levels++;
+        for (i = end + 1; i + 1 < n && ns[i + 1] > ns[i] * MACHINE_FLAT;)
+            i++;
+    }
+    m->memory_latency_ns = n ? ns[n - 1] : NAN;
+}
+
+void machine_profile(const bench_result_t *results, size_t count, bench_machine_t *m)
+{
+    memset(m, 0, sizeof(*m));
+    double *single = (double *)&m->single, *all = (double *)&m->all; /* bench_bandwidth_t is all doubles */
+    for (size_t k = 0; k < 4; k++)
+        single[k] = all[k] = NAN;
+    uint64_t bytes[MACHINE_MAX_POINTS];
+    double ns[MACHINE_MAX_POINTS];
+    int n = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const bench_result_t *r = &results[i];
+        int threads;
+        char kernel[16];
+        if (r->error[0])
+            continue;
+        if (strncmp(r->name, "machine/latency/", 16) == 0 && r->has_arg && !isnan(r->ns_per_item) &&
+            n < MACHINE_MAX_POINTS)
+        {
+            int at = n++;
+            for (; at > 0 && bytes[at - 1] > (uint64_t)r->arg; at--) /* keep them sorted */
+                bytes[at] = bytes[at - 1], ns[at] = ns[at - 1];
+            bytes[at] = (uint64_t)r->arg;
+            ns[at] = r->ns_per_item;
+        }
+        else if (sscanf(r->name, "machine/%15[a-z]/threads:%d", kernel, &threads) == 2)
+            for (size_t k = 0; k < 4; k++)
+                if (strcmp(kernel, g_kernels[k].name + 8) == 0)
+                {
+                    if (threads == 1)
+                        single[k] = r->bytes_per_second * 1e-9;
+                    if (threads >= m->threads)
+                        m->threads = threads, all[k] = r->bytes_per_second * 1e-9;
+                }
+    }
+    m->measured = n > 0;
+    find_levels(bytes, ns, n, m);
+    machine_reported_caches(m->reported_bytes);
+    m->stream_bytes = g_machine.stream_bytes;
+}
+
+static const char *human(char *buf, size_t size, uint64_t bytes)
+{
+    static const char *units[] = {"B", "KB", "MB", "GB", "TB"};
+    double v = (double)bytes;
+    int u = 0;
+    for (; v >= 1024.0 && u < 4; u++)
+        v /= 1024.0;
+    snprintf(buf, size, "%.4g %s", v, units[u]);
+    return buf;
+}
+
+void machine_print(const bench_machine_t *m)
+{
+    char size[32];
+    if (m->measured)
+    {
+        printf("Machine:");
+        for (int i = 0; i < m->levels; i++)
+            printf(" L%d %s %.2f ns,", i + 1, human(size, sizeof(size), m->cache[i].bytes), m->cache[i].latency_ns);
+        printf(" memory %.1f ns\n", m->memory_latency_ns);
+        printf("  Reported caches:");
+        for (int i = 0, any = 0; i < BENCH_MAX_CACHE_LEVELS; i++)
+            if (m->reported_bytes[i])
+                printf("%s L%d %s", any++ ? "," : "", i + 1, human(size, sizeof(size), m->reported_bytes[i]));
+        printf("\n");
+    }
+    if (m->threads > 1)
+        printf("  Bandwidth GB/s, 1 / %d threads over %s arrays: read %.1f / %.1f, write %.1f / %.1f, "
+               "copy %.1f / %.1f, triad %.1f / %.1f\n",
+               m->threads, human(size, sizeof(size), m->stream_bytes), m->single.read, m->all.read, m->single.write,
+               m->all.write, m->single.copy, m->all.copy, m->single.triad, m->all.triad);
+    else if (m->threads)
+        printf("  Bandwidth GB/s, 1 thread over %s arrays: read %.1f, write %.1f, copy %.1f, triad %.1f\n",
+               human(size, sizeof(size), m->stream_bytes), m->single.read, m->single.write, m->single.copy,
+               m->single.triad);
+}
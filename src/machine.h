@@ -0,0 +1,26 @@
+#ifndef BENCH_MACHINE_H
+#define BENCH_MACHINE_H
+
+#include "benchmark.h"
+
+/* Machine characterization suite, registered as ordinary benchmarks so the
+ * engine times, filters, shards and reports them like any other:
+ *   machine/latency/<bytes>   a random pointer chase over that working set,
+ *                             from 4 KB to max_bytes, two sizes per octave
+ *   machine/<kernel>/threads:N  streaming read, write, copy and triad over
+ *                             arrays well beyond the last cache, at 1, 2, 4
+ *                             ... up to the online CPUs */
+void machine_register(uint64_t max_bytes);
+/* BENCH_MACHINE: 0 for off, a size like 256M for the largest working set,
+ * or any other number for BENCH_MACHINE_BYTES. */
+uint64_t machine_parse(const char *text);
+/* Reads the profile back out of the suite's results: the cache levels are
+ * the steps of the latency curve, and sysfs supplies the sizes the kernel
+ * reports for comparison. measured is 0 when no latency result is there. */
+void machine_profile(const bench_result_t *results, size_t count, bench_machine_t *m);
+void machine_print(const bench_machine_t *m);
+/* Data or unified cache bytes by level, as the kernel reports them for CPU 0;
+ * levels it does not report are left alone. */
+void machine_reported_caches(uint64_t bytes[BENCH_MAX_CACHE_LEVELS]);
+
+#endif
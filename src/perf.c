@@ -0,0 +1,196 @@
+#define _GNU_SOURCE
+
+#include "perf.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_COUNT
+};
+
+static struct
+{
+    int fd[PERF_COUNT];
+    uint64_t id[PERF_COUNT];
+    int leader;
+    char error[128];
+} g_perf = {.leader = -1};
+
+static void set_readings(bench_counters_t *out, const double *v)
+{
+    out->cycles = v[PERF_CYCLES];
+    out->instructions = v[PERF_INSTRUCTIONS];
+    out->branch_misses = v[PERF_BRANCH_MISSES];
+    out->l1d_misses = v[PERF_L1D_MISSES];
+    out->llc_misses = v[PERF_LLC_MISSES];
+    out->dtlb_misses = v[PERF_DTLB_MISSES];
+    out->ipc = out->instructions / out->cycles;
+    out->branch_mpki = 1000.0 * out->branch_misses / out->instructions;
+    out->l1d_mpki = 1000.0 * out->l1d_misses / out->instructions;
+    out->llc_mpki = 1000.0 * out->llc_misses / out->instructions;
+    out->dtlb_mpki = 1000.0 * out->dtlb_misses / out->instructions;
+}
+
+const char *perf_error(void) { return g_perf.error; }
+
+#ifdef __linux__
+
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct
+{
+    uint32_t type;
+    uint64_t config;
+} perf_events[PERF_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL)},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+static int open_event(int i, int group_fd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perf_events[i].type;
+    attr.config = perf_events[i].config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+int perf_open(void)
+{
+    if (g_perf.leader >= 0)
+        return 0;
+    for (int i = 0; i < PERF_COUNT; i++)
+    {
+        g_perf.fd[i] = open_event(i, g_perf.leader);
+        if (g_perf.fd[i] < 0)
+        {
+            if (i == PERF_CYCLES)
+            {
+                int paranoid = -1;
+                FILE *fp = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+                if (fp)
+                {
+                    if (fscanf(fp, "%d", &paranoid) != 1)
+                        paranoid = -1;
+                    fclose(fp);
+                }
+                snprintf(g_perf.error, sizeof(g_perf.error), "%s (perf_event_paranoid=%d)",
+                         strerror(errno), paranoid);
+                return -1;
+            }
+            continue; /* an event this PMU lacks just reads as NaN */
+        }
+        if (i == PERF_CYCLES)
+            g_perf.leader = g_perf.fd[i];
+        if (ioctl(g_perf.fd[i], PERF_EVENT_IOC_ID, &g_perf.id[i]) < 0)
+            g_perf.id[i] = 0;
+    }
+    g_perf.error[0] = '\0';
+    return 0;
+}
+
+void perf_start(void)
+{
+    if (g_perf.leader < 0)
+        return;
+    ioctl(g_perf.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(g_perf.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void perf_pause(void)
+{
+    if (g_perf.leader >= 0)
+        ioctl(g_perf.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void perf_resume(void)
+{
+    if (g_perf.leader >= 0)
+        ioctl(g_perf.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void perf_stop(bench_counters_t *out, uint64_t calls)
+{
+    double v[PERF_COUNT];
+    for (int i = 0; i < PERF_COUNT; i++)
+        v[i] = NAN;
+    if (g_perf.leader >= 0)
+    {
+        uint64_t buf[3 + 2 * PERF_COUNT];
+        ioctl(g_perf.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        ssize_t n = read(g_perf.leader, buf, sizeof(buf));
+        /* buf: nr, time_enabled, time_running, {value, id}[nr]. A group that
+         * never got the PMU (time_running == 0) is treated as unavailable. */
+        if (n >= (ssize_t)(3 * sizeof(uint64_t)) && buf[2] > 0 && calls > 0)
+        {
+            double scale = (double)buf[1] / (double)buf[2] / (double)calls;
+            for (uint64_t k = 0; k < buf[0] && k < PERF_COUNT; k++)
+                for (int i = 0; i < PERF_COUNT; i++)
+                    if (g_perf.fd[i] >= 0 && g_perf.id[i] == buf[4 + 2 * k])
+                        v[i] = (double)buf[3 + 2 * k] * scale;
+        }
+    }
+    set_readings(out, v);
+}
+
+void perf_close(void)
+{
+    if (g_perf.leader < 0)
+        return;
+    for (int i = 0; i < PERF_COUNT; i++)
+        if (g_perf.fd[i] >= 0)
+            close(g_perf.fd[i]);
+    g_perf.leader = -1;
+}
+
+#else
+
+int perf_open(void)
+{
+    snprintf(g_perf.error, sizeof(g_perf.error), "perf_event_open is Linux-only");
+    return -1;
+}
+
+void perf_start(void) {}
+void perf_pause(void) {}
+void perf_resume(void) {}
+
+void perf_stop(bench_counters_t *out, uint64_t calls)
+{
+    double v[PERF_COUNT];
+    (void)calls;
+    for (int i = 0; i < PERF_COUNT; i++)
+        v[i] = NAN;
+    set_readings(out, v);
+}
+
+void perf_close(void) {}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef BENCH_PERF_H
+#define BENCH_PERF_H
+
+#include "benchmark.h"
+
+/* Hardware counter group (Linux perf_event_open) around a timed region.
+ * perf_open returns 0 if at least one counter is usable; otherwise the
+ * reason is available from perf_error() and every reading is NaN. */
+int perf_open(void);
+void perf_start(void);
+void perf_pause(void);
+void perf_resume(void);
+void perf_stop(bench_counters_t *out, uint64_t calls);
+void perf_close(void);
+const char *perf_error(void);
+
+#endif
@@ -0,0 +1,202 @@
+#define _GNU_SOURCE
+
+#include "registry.h"
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REGISTRY_BLOCK (64 * 1024)
+
+struct registry_block
+{
+    registry_block_t *next;
+    size_t size;
+    char data[];
+};
+
+const char *registry_copy(registry_t *r, const char *text, size_t len)
+{
+    if (!r->blocks || r->used + len + 1 > r->blocks->size)
+    {
+        const size_t size = len + 1 > REGISTRY_BLOCK ? len + 1 : REGISTRY_BLOCK;
+        registry_block_t *b = malloc(sizeof(*b) + size);
+        if (!b)
+            return NULL;
+        b->next = r->blocks;
+        b->size = size;
+        r->blocks = b;
+        r->used = 0;
+    }
+    char *copy = r->blocks->data + r->used;
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    r->used += len + 1;
+    return copy;
+}
+
+/* FNV-1a a word at a time, since generated names are long, with the
+ * murmur3 finalizer spreading the result into the low bits. */
+static uint64_t hash(const char *name, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL ^ len, w;
+    for (; len >= 8; name += 8, len -= 8)
+    {
+        memcpy(&w, name, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+    }
+    w = 0;
+    memcpy(&w, name, len);
+    h = (h ^ w) * 0x100000001b3ULL;
+    h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+    return h ^ (h >> 33);
+}
+
+/* Slot holding the first len bytes of name, or the empty slot it belongs in */
+static registry_slot_t *probe(registry_slot_t *slots, size_t size, const char *name, size_t len, uint64_t h)
+{
+    for (size_t i = h & (size - 1);; i = (i + 1) & (size - 1))
+        if (!slots[i].name ||
+            (slots[i].hash == h && strncmp(slots[i].name, name, len) == 0 && slots[i].name[len] == '\0'))
+            return &slots[i];
+}
+
+long registry_add(registry_t *r, const char *name, size_t index)
+{
+    if ((r->count + 1) * 2 > r->size)
+    {
+        const size_t size = r->size ? r->size * 2 : 1024;
+        registry_slot_t *slots = calloc(size, sizeof(*slots));
+        if (!slots)
+            return -1;
+        for (size_t i = 0; i < r->size; i++)
+        {
+            size_t k = r->slots[i].hash & (size - 1);
+            while (r->slots[i].name && slots[k].name)
+                k = (k + 1) & (size - 1);
+            if (r->slots[i].name)
+                slots[k] = r->slots[i];
+        }
+        free(r->slots);
+        r->slots = slots;
+        r->size = size;
+    }
+    const size_t len = strlen(name);
+    const uint64_t h = hash(name, len);
+    registry_slot_t *s = probe(r->slots, r->size, name, len, h);
+    if (!s->name)
+    {
+        s->name = name;
+        s->hash = h;
+        s->index = index;
+        r->count++;
+    }
+    return (long)s->index;
+}
+
+long registry_find(const registry_t *r, const char *name, size_t len)
+{
+    if (!r->count)
+        return -1;
+    const registry_slot_t *s = probe(r->slots, r->size, name, len, hash(name, len));
+    return s->name ? (long)s->index : -1;
+}
+
+void registry_free(registry_t *r)
+{
+    while (r->blocks)
+    {
+        registry_block_t *next = r->blocks->next;
+        free(r->blocks);
+        r->blocks = next;
+    }
+    free(r->slots);
+    memset(r, 0, sizeof(*r));
+}
+
+int registry_filter_compile(registry_filter_t *f, const char *spec)
+{
+    memset(f, 0, sizeof(*f));
+    if (!spec || !spec[0])
+        return 0;
+    size_t max = 1;
+    for (const char *p = spec; *p; p++)
+        max += *p == ',';
+    if (!(f->text = strdup(spec)) || !(f->patterns = calloc(max, sizeof(*f->patterns))))
+    {
+        registry_filter_free(f);
+        return -1;
+    }
+    char *save = NULL;
+    for (char *p = strtok_r(f->text, ",", &save); p; p = strtok_r(NULL, ",", &save))
+    {
+        const int exclude = *p == '-';
+        p += exclude;
+        if (!*p)
+            continue;
+        f->patterns[f->count].exclude = exclude;
+        if (strncmp(p, "re:", 3) == 0)
+        {
+            const int err = regcomp(&f->patterns[f->count].regex, p + 3, REG_EXTENDED | REG_NOSUB);
+            if (err)
+            {
+                char msg[128];
+                regerror(err, &f->patterns[f->count].regex, msg, sizeof(msg));
+                fprintf(stderr, "warning: BENCH_FILTER pattern %s: %s\n", p, msg);
+                registry_filter_free(f);
+                return -1;
+            }
+        }
+        else
+            f->patterns[f->count].glob = p;
+        f->includes += !exclude;
+        f->count++;
+    }
+    return 0;
+}
+
+static int glob_match(const char *glob, const char *name)
+{
+    if (fnmatch(glob, name, 0) == 0)
+        return 1;
+    char buf[256];
+    for (const char *slash = strchr(name, '/'); slash; slash = strchr(slash + 1, '/'))
+    {
+        const size_t len = (size_t)(slash - name);
+        char *family = len < sizeof(buf) ? buf : malloc(len + 1);
+        if (!family)
+            return 0;
+        memcpy(family, name, len);
+        family[len] = '\0';
+        const int match = fnmatch(glob, family, 0) == 0;
+        if (family != buf)
+            free(family);
+        if (match)
+            return 1;
+    }
+    return 0;
+}
+
+int registry_filter_match(const registry_filter_t *f, const char *name)
+{
+    int included = !f->includes;
+    for (size_t i = 0; i < f->count; i++)
+    {
+        const int match = f->patterns[i].glob ? glob_match(f->patterns[i].glob, name)
+                                              : regexec(&f->patterns[i].regex, name, 0, NULL, 0) == 0;
+        if (match && f->patterns[i].exclude)
+            return 0;
+        included |= match;
+    }
+    return included;
+}
+
+void registry_filter_free(registry_filter_t *f)
+{
+    for (size_t i = 0; f->patterns && i < f->count; i++)
+        if (!f->patterns[i].glob)
+            regfree(&f->patterns[i].regex);
+    free(f->patterns);
+    free(f->text);
+    memset(f, 0, sizeof(*f));
+}
@@ -0,0 +1,62 @@
+#ifndef BENCH_REGISTRY_H
+#define BENCH_REGISTRY_H
+
+#include "benchmark.h"
+#include <regex.h>
+
+/* Names of a suite that may hold hundreds of thousands of benchmarks. Copies
+ * live in an arena of large blocks released together, and an open-addressed
+ * hash table maps each name to the index it was added with, so registration
+ * and lookup stay O(1) and no name is ever truncated. */
+typedef struct registry_block registry_block_t;
+
+typedef struct
+{
+    const char *name; /* NULL when empty */
+    uint64_t hash;
+    size_t index;
+} registry_slot_t;
+
+typedef struct
+{
+    registry_slot_t *slots;
+    size_t size, count;       /* slots, a power of two at most half full */
+    registry_block_t *blocks; /* newest first */
+    size_t used;              /* bytes of the newest block */
+} registry_t;
+
+/* NUL-terminated arena copy of the first len bytes of text; NULL when out of
+ * memory. Valid until registry_free, in forked children too. */
+const char *registry_copy(registry_t *r, const char *text, size_t len);
+/* Maps name, which must outlive the registry, to index unless it is mapped
+ * already. Returns the index name maps to, or -1 when out of memory. */
+long registry_add(registry_t *r, const char *name, size_t index);
+/* Index of the first len bytes of name, or -1. */
+long registry_find(const registry_t *r, const char *name, size_t len);
+void registry_free(registry_t *r);
+
+/* BENCH_FILTER: comma-separated patterns. A pattern is a glob, or with the
+ * prefix "re:" a POSIX extended regex matched anywhere in the name; a
+ * leading '-' makes it exclude. A glob also matches a parameter or thread
+ * family by the name before a '/'. A name is selected when it matches an
+ * including pattern, or there are none, and no excluding one. */
+typedef struct
+{
+    char *text; /* the patterns, split in place */
+    struct
+    {
+        const char *glob; /* NULL for a regex */
+        regex_t regex;
+        int exclude;
+    } *patterns;
+    size_t count;
+    int includes;
+} registry_filter_t;
+
+/* Returns 0, or -1 with a warning on stderr for a pattern that does not
+ * compile; an empty or NULL spec selects everything. */
+int registry_filter_compile(registry_filter_t *f, const char *spec);
+int registry_filter_match(const registry_filter_t *f, const char *name);
+void registry_filter_free(registry_filter_t *f);
+
+#endif
@@ -0,0 +1,157 @@
+#define _GNU_SOURCE
+
+#include "samples.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SAMPLES_HEADER_BYTES 32
+#define SAMPLES_BUFFER 4096
+
+static struct
+{
+    FILE *fp;
+    int compress, failed;
+    samples_record_t *index, block; /* block is the one being written */
+    size_t count, cap;
+    uint64_t prev; /* last sample of the block, for varint deltas */
+} g_samples;
+
+static void put(const void *p, size_t size)
+{
+    if (g_samples.fp && fwrite(p, 1, size, g_samples.fp) != size)
+        g_samples.failed = 1;
+}
+
+int samples_open(const char *path, int compress)
+{
+    memset(&g_samples, 0, sizeof(g_samples));
+    if (!(g_samples.fp = fopen(path, "wb")))
+    {
+        fprintf(stderr, "warning: cannot write raw samples to %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    g_samples.compress = compress;
+    const char zero[SAMPLES_HEADER_BYTES] = {0}; /* filled in by samples_close */
+    put(zero, sizeof(zero));
+    return 0;
+}
+
+void samples_begin(const char *name, uint64_t batch, double subtract, int threads, int width)
+{
+    if (!g_samples.fp)
+        return;
+    static const char pad[8];
+    put(pad, (size_t)((8 - ftello(g_samples.fp) % 8) % 8));
+    memset(&g_samples.block, 0, sizeof(g_samples.block));
+    if (strlen(name) >= BENCH_MAX_NAME_LEN)
+        fprintf(stderr, "warning: raw samples of %s are indexed under its first %d bytes\n", name,
+                BENCH_MAX_NAME_LEN - 1);
+    strncpy(g_samples.block.name, name, BENCH_MAX_NAME_LEN - 1);
+    g_samples.block.offset = (uint64_t)ftello(g_samples.fp);
+    g_samples.block.batch = batch;
+    g_samples.block.subtract = subtract;
+    g_samples.block.threads = (uint32_t)(threads > 1 ? threads : 1);
+    g_samples.block.width = g_samples.compress ? 8 : (uint32_t)width;
+    g_samples.block.encoding = g_samples.compress ? SAMPLES_VARINT : SAMPLES_RAW;
+    g_samples.prev = 0;
+}
+
+void samples_write(const uint64_t *samples, size_t n)
+{
+    if (!g_samples.fp)
+        return;
+    samples_record_t *b = &g_samples.block;
+    b->count += n;
+    if (b->encoding == SAMPLES_VARINT)
+    {
+        unsigned char buf[SAMPLES_BUFFER + 10];
+        size_t used = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            const int64_t d = (int64_t)(samples[i] - g_samples.prev);
+            uint64_t z = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+            g_samples.prev = samples[i];
+            for (; z >= 0x80; z >>= 7)
+                buf[used++] = (unsigned char)(z | 0x80);
+            buf[used++] = (unsigned char)z;
+            if (used >= SAMPLES_BUFFER || i + 1 == n)
+            {
+                put(buf, used);
+                b->bytes += used;
+                used = 0;
+            }
+        }
+    }
+    else if (b->width == 4)
+    {
+        uint32_t buf[SAMPLES_BUFFER / 4];
+        for (size_t i = 0; i < n;)
+        {
+            size_t k = 0;
+            for (; k < SAMPLES_BUFFER / 4 && i < n; k++, i++)
+                buf[k] = (uint32_t)samples[i];
+            put(buf, k * 4);
+        }
+        b->bytes += n * 4;
+    }
+    else
+    {
+        put(samples, n * 8);
+        b->bytes += n * 8;
+    }
+}
+
+void samples_end(void)
+{
+    if (!g_samples.fp)
+        return;
+    if (g_samples.count == g_samples.cap)
+    {
+        size_t cap = g_samples.cap ? g_samples.cap * 2 : 64;
+        samples_record_t *grown = realloc(g_samples.index, cap * sizeof(*grown));
+        if (!grown)
+        {
+            g_samples.failed = 1;
+            return;
+        }
+        g_samples.index = grown, g_samples.cap = cap;
+    }
+    g_samples.index[g_samples.count++] = g_samples.block;
+}
+
+void samples_block(const char *name, uint64_t batch, double subtract, int threads, const uint64_t *samples,
+                   size_t n)
+{
+    uint64_t max = 0;
+    for (size_t i = 0; i < n; i++)
+        max = samples[i] > max ? samples[i] : max;
+    samples_begin(name, batch, subtract, threads, max > UINT32_MAX ? 8 : 4);
+    samples_write(samples, n);
+    samples_end();
+}
+
+int samples_close(double ns_per_tick)
+{
+    if (!g_samples.fp)
+        return -1;
+    static const char pad[8];
+    put(pad, (size_t)((8 - ftello(g_samples.fp) % 8) % 8));
+    const uint64_t index_offset = (uint64_t)ftello(g_samples.fp);
+    put(g_samples.index, g_samples.count * sizeof(samples_record_t));
+    const uint32_t version = SAMPLES_VERSION, count = (uint32_t)g_samples.count;
+    if (fseeko(g_samples.fp, 0, SEEK_SET) != 0)
+        g_samples.failed = 1;
+    put(SAMPLES_MAGIC, 8);
+    put(&version, 4);
+    put(&count, 4);
+    put(&ns_per_tick, 8);
+    put(&index_offset, 8);
+    if (fclose(g_samples.fp) != 0)
+        g_samples.failed = 1;
+    g_samples.fp = NULL;
+    free(g_samples.index);
+    g_samples.index = NULL;
+    return g_samples.failed ? -1 : 0;
+}
@@ -0,0 +1,52 @@
+#ifndef BENCH_SAMPLES_H
+#define BENCH_SAMPLES_H
+
+#include "benchmark.h"
+
+/* Raw sample file (BENCH_SAMPLES): every timed sample of every benchmark in
+ * the order it was taken, as ticks per batch before overhead subtraction.
+ * Host byte order (little-endian on every supported target):
+ *
+ *   header   char magic[8] "BENCHRAW", u32 version, u32 count,
+ *            f64 ns_per_tick, u64 offset of the index
+ *   data     one block per benchmark, each starting 8-byte aligned
+ *   index    count samples_record_t
+ *
+ * A raw block is a plain u32 or u64 array that numpy.memmap maps as is; a
+ * varint block holds zigzag deltas between consecutive samples as LEB128. */
+#define SAMPLES_MAGIC "BENCHRAW"
+#define SAMPLES_VERSION 1
+
+enum
+{
+    SAMPLES_RAW = 0,
+    SAMPLES_VARINT = 1
+};
+
+typedef struct
+{
+    char name[BENCH_MAX_NAME_LEN];
+    uint64_t offset;   /* of the block from the start of the file */
+    uint64_t bytes;    /* block size without the alignment padding */
+    uint64_t count;    /* samples */
+    uint64_t batch;    /* calls per sample */
+    double subtract;   /* ticks per sample the statistics subtracted as overhead */
+    uint32_t width;    /* bytes per raw sample, 4 or 8; 8 for varint */
+    uint32_t encoding; /* SAMPLES_RAW or SAMPLES_VARINT */
+    uint32_t threads;  /* > 1: count / threads samples per thread, one thread after another */
+    uint32_t reserved;
+} samples_record_t;
+
+/* Starts a file; 0 on success. With compress every block is varint encoded. */
+int samples_open(const char *path, int compress);
+/* Streams one block of samples of the given raw width. */
+void samples_begin(const char *name, uint64_t batch, double subtract, int threads, int width);
+void samples_write(const uint64_t *samples, size_t n);
+void samples_end(void);
+/* One whole block, as narrow as its largest sample allows. */
+void samples_block(const char *name, uint64_t batch, double subtract, int threads, const uint64_t *samples,
+                   size_t n);
+/* Writes the index and the header; 0 if the whole file was written. */
+int samples_close(double ns_per_tick);
+
+#endif
@@ -0,0 +1,463 @@
+#include "stats.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define RADIX_BITS 16
+#define STATS_RANKS 11
+#define BOOTSTRAP_RESAMPLES 1000
+/* Samples are grouped for the bootstrap in log-linear bins of their distance
+ * from the minimum: exact below 2^BIN_SUB_BITS ticks, 0.1% wide above. */
+#define BIN_SUB_BITS 10
+#define BIN_SUB (1u << BIN_SUB_BITS)
+
+/* Radix selection over the values in [lo, lo + range]: one counting pass over
+ * the top RADIX_BITS of the range finds the bin holding each rank, and one
+ * more pass gathers just those bins for refinement. Tick counts cluster
+ * tightly, so the first pass is usually exact. Ranks are relative to the
+ * values inside the range. */
+static int radix_select(const uint64_t *v, size_t n, uint64_t lo, uint64_t range, const size_t *ranks, size_t nr,
+                        uint64_t *out)
+{
+    unsigned shift = 0;
+    while ((range >> shift) >> RADIX_BITS)
+        shift++;
+    const size_t bins = (size_t)(range >> shift) + 1;
+    size_t *counts = calloc(bins, sizeof(size_t));
+    if (!counts)
+        return -1;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t d = v[i] - lo;
+        if (d <= range)
+            counts[d >> shift]++;
+    }
+
+    /* Resolve each rank to a bin; ranks sharing a bin form one group */
+    size_t bin[STATS_RANKS], first[STATS_RANKS + 1], size[STATS_RANKS], below[STATS_RANKS];
+    size_t groups = 0, seen = 0, b = 0;
+    for (size_t r = 0; r < nr; r++)
+    {
+        while (seen + counts[b] <= ranks[r])
+            seen += counts[b++];
+        if (shift == 0)
+            out[r] = lo + b;
+        else if (groups == 0 || bin[groups - 1] != b)
+        {
+            bin[groups] = b;
+            first[groups] = r;
+            size[groups] = counts[b];
+            below[groups++] = seen;
+        }
+    }
+    first[groups] = nr;
+    if (groups == 0)
+    {
+        free(counts);
+        return 0;
+    }
+
+    /* The counts become a bin -> group map for the gathering pass */
+    uint64_t *gathered[STATS_RANKS];
+    size_t fill[STATS_RANKS] = {0}, total = 0;
+    for (size_t i = 0; i < bins; i++)
+        counts[i] = 0;
+    for (size_t g = 0; g < groups; g++)
+    {
+        counts[bin[g]] = g + 1;
+        total += size[g];
+    }
+    int rc = -1;
+    uint64_t *buf = malloc(total * sizeof(uint64_t));
+    if (buf)
+    {
+        gathered[0] = buf;
+        for (size_t g = 1; g < groups; g++)
+            gathered[g] = gathered[g - 1] + size[g - 1];
+        for (size_t i = 0; i < n; i++)
+        {
+            uint64_t d = v[i] - lo;
+            size_t g = d <= range ? counts[d >> shift] : 0;
+            if (g)
+                gathered[g - 1][fill[g - 1]++] = v[i];
+        }
+        rc = 0;
+        for (size_t g = 0; g < groups && rc == 0; g++)
+        {
+            size_t sub[STATS_RANKS];
+            for (size_t r = first[g]; r < first[g + 1]; r++)
+                sub[r - first[g]] = ranks[r] - below[g];
+            rc = radix_select(gathered[g], size[g], lo + ((uint64_t)bin[g] << shift), (1ULL << shift) - 1, sub,
+                              first[g + 1] - first[g], out + first[g]);
+        }
+        free(buf);
+    }
+    free(counts);
+    return rc;
+}
+
+void stats_select(const uint64_t *samples, size_t n, const size_t *ranks, size_t nr, uint64_t *out)
+{
+    uint64_t lo = UINT64_MAX, hi = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        lo = samples[i] < lo ? samples[i] : lo;
+        hi = samples[i] > hi ? samples[i] : hi;
+    }
+    if (radix_select(samples, n, lo, hi - lo, ranks, nr, out) != 0)
+        for (size_t r = 0; r < nr; r++)
+            out[r] = lo; /* out of memory */
+}
+
+void stats_median_ci(size_t n, size_t *lo, size_t *hi)
+{
+    /* Rank of the median is Binomial(n, 1/2): n/2 +- 1.96 * sqrt(n/4) */
+    const double half = 0.98 * sqrt((double)n), mid = (double)n / 2.0;
+    *lo = mid - half > 0 ? (size_t)floor(mid - half) : 0;
+    *hi = mid + half < (double)(n - 1) ? (size_t)ceil(mid + half) : n - 1;
+}
+
+/* Half-width of [lo, hi] over the median. Samples are whole ticks, so the
+ * half-width is at least half of one: a CI collapsed onto a single tick
+ * value is quantization, not precision, and must not end an adaptive run. */
+static double relative_error(double lo, double hi, double median, double tick)
+{
+    return median > 0 ? fmax(hi - lo, tick) / (2.0 * median) : NAN;
+}
+
+double stats_median_error(const uint64_t *samples, size_t n, uint64_t batch, double subtract)
+{
+    if (n == 0)
+        return NAN;
+    size_t ranks[3] = {0, n / 2, 0};
+    uint64_t q[3];
+    stats_median_ci(n, &ranks[0], &ranks[2]);
+    stats_select(samples, n, ranks, 3, q);
+    const double sub = subtract * (double)batch;
+    return relative_error(fmax((double)q[0] - sub, 0.0), fmax((double)q[2] - sub, 0.0),
+                          fmax((double)q[1] - sub, 0.0), 1.0);
+}
+
+static size_t bin_index(uint64_t d)
+{
+    if (d < BIN_SUB)
+        return (size_t)d;
+    unsigned e = 63u - (unsigned)__builtin_clzll(d) - BIN_SUB_BITS;
+    return (size_t)(e + 1) * BIN_SUB + (size_t)((d >> e) - BIN_SUB);
+}
+
+static double bin_center(size_t idx)
+{
+    if (idx < BIN_SUB)
+        return (double)idx;
+    unsigned e = (unsigned)(idx / BIN_SUB) - 1;
+    return (double)((uint64_t)(idx % BIN_SUB + BIN_SUB) << e) + (double)((1ULL << e) - 1) / 2.0;
+}
+
+/* xoshiro256**, seeded through splitmix64 so every run resamples alike */
+typedef struct
+{
+    uint64_t s[4];
+} rng_t;
+
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static void rng_seed(rng_t *r, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        r->s[i] = z ^ (z >> 31);
+    }
+}
+
+static double rng_uniform(rng_t *r)
+{
+    uint64_t *s = r->s, result = rotl(s[1] * 5, 7) * 9, t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return (double)(result >> 11) * 0x1.0p-53;
+}
+
+/* Poisson(lambda): multiplication of uniforms for small lambda, a rounded
+ * normal for large lambda, where the bootstrap cannot tell the difference. */
+static uint64_t rng_poisson(rng_t *r, uint64_t lambda)
+{
+    static const double exp_neg[16] = {1.0, 3.67879441171442e-01, 1.35335283236613e-01, 4.97870683678639e-02,
+                                       1.83156388887342e-02, 6.73794699908547e-03, 2.47875217666636e-03,
+                                       9.11881965554516e-04, 3.35462627902512e-04, 1.23409804086680e-04,
+                                       4.53999297624849e-05, 1.67017007902457e-05, 6.14421235332821e-06,
+                                       2.26032940698105e-06, 8.31528719103568e-07, 3.05902320501826e-07};
+    if (lambda < 16)
+    {
+        uint64_t k = 0;
+        for (double p = rng_uniform(r); p > exp_neg[lambda]; p *= rng_uniform(r))
+            k++;
+        return k;
+    }
+    double u = 1.0 - rng_uniform(r), v = rng_uniform(r);
+    double x = (double)lambda + sqrt((double)lambda) * sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+    return x > 0 ? (uint64_t)(x + 0.5) : 0;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+void stats_bootstrap(const double *values, const uint64_t *counts, size_t k, bench_stats_t *stats)
+{
+    /* Poisson resampling: the multiplicity of each of a bin's c samples is
+     * Poisson(1), so the bin as a whole draws Poisson(c). A resample then
+     * costs one sequential sweep over the bins rather than n random reads. */
+    uint64_t *weights = malloc(k * sizeof(uint64_t));
+    double *means = malloc(2 * BOOTSTRAP_RESAMPLES * sizeof(double)), *medians = means + BOOTSTRAP_RESAMPLES;
+    if (!weights || !means || k == 0)
+    {
+        free(weights);
+        free(means);
+        return;
+    }
+    rng_t rng;
+    rng_seed(&rng, 0x5eed);
+    for (int b = 0; b < BOOTSTRAP_RESAMPLES;)
+    {
+        uint64_t total = 0;
+        double sum = 0.0;
+        for (size_t j = 0; j < k; j++)
+        {
+            weights[j] = rng_poisson(&rng, counts[j]);
+            total += weights[j];
+            sum += (double)weights[j] * values[j];
+        }
+        if (total == 0)
+            continue;
+        size_t j = 0;
+        for (uint64_t seen = weights[0]; seen <= total / 2; seen += weights[++j])
+            ;
+        means[b] = sum / (double)total;
+        medians[b++] = values[j];
+    }
+    qsort(means, BOOTSTRAP_RESAMPLES, sizeof(double), compare_double);
+    qsort(medians, BOOTSTRAP_RESAMPLES, sizeof(double), compare_double);
+    const size_t lo = (size_t)(BOOTSTRAP_RESAMPLES * 0.025), hi = (size_t)(BOOTSTRAP_RESAMPLES * 0.975);
+    stats->mean_ci_low_ns = means[lo];
+    stats->mean_ci_high_ns = means[hi];
+    stats->median_ci_low_ns = medians[lo];
+    stats->median_ci_high_ns = medians[hi];
+    free(weights);
+    free(means);
+}
+
+void stats_outliers(const double *values, const uint64_t *counts, size_t k, double q1, double q3,
+                    bench_stats_t *stats)
+{
+    const double iqr = q3 - q1;
+    const double low_severe = q1 - 3.0 * iqr, low_mild = q1 - 1.5 * iqr;
+    const double high_mild = q3 + 1.5 * iqr, high_severe = q3 + 3.0 * iqr;
+    double n_all = 0, s_all = 0, s2_all = 0, n_in = 0, s_in = 0, s2_in = 0;
+    stats->outliers_low_severe = stats->outliers_low_mild = 0;
+    stats->outliers_high_mild = stats->outliers_high_severe = 0;
+    for (size_t j = 0; j < k; j++)
+    {
+        const double v = values[j], c = (double)counts[j], d = v - q1;
+        n_all += c, s_all += c * d, s2_all += c * d * d;
+        if (v < low_severe)
+            stats->outliers_low_severe += counts[j];
+        else if (v < low_mild)
+            stats->outliers_low_mild += counts[j];
+        else if (v > high_severe)
+            stats->outliers_high_severe += counts[j];
+        else if (v > high_mild)
+            stats->outliers_high_mild += counts[j];
+        else
+            n_in += c, s_in += c * d, s2_in += c * d * d;
+    }
+    const double mean_all = s_all / n_all, var_all = s2_all / n_all - mean_all * mean_all;
+    const double mean_in = n_in > 0 ? s_in / n_in : 0.0, var_in = n_in > 0 ? s2_in / n_in - mean_in * mean_in : 0.0;
+    stats->outlier_variance = var_all > 0 ? fmax(1.0 - var_in / var_all, 0.0) : 0.0;
+}
+
+void stats_compute(const uint64_t *samples, size_t n, uint64_t batch, double subtract, bench_stats_t *stats)
+{
+    if (n == 0)
+        return;
+
+    /* The median CI bounds interleave with the tail ranks for small n, so
+     * the rank list is sorted along with where each result goes. */
+    double ci_lo, ci_hi, q1, q3;
+    size_t ranks[STATS_RANKS] = {0, n / 2, (size_t)(n * 0.95), (size_t)(n * 0.99),
+                                 (size_t)(n * 0.999), (size_t)(n * 0.9999), n - 1, 0, 0, n / 4, 3 * n / 4};
+    double *fields[STATS_RANKS] = {&stats->min_ns, &stats->median_ns, &stats->p95_ns, &stats->p99_ns,
+                                   &stats->p999_ns, &stats->p9999_ns, &stats->max_ns, &ci_lo, &ci_hi, &q1, &q3};
+    stats_median_ci(n, &ranks[7], &ranks[8]);
+    for (int i = 1; i < STATS_RANKS; i++)
+        for (int j = i; j > 0 && ranks[j - 1] > ranks[j]; j--)
+        {
+            size_t r = ranks[j];
+            double *f = fields[j];
+            ranks[j] = ranks[j - 1], fields[j] = fields[j - 1];
+            ranks[j - 1] = r, fields[j - 1] = f;
+        }
+    uint64_t q[STATS_RANKS];
+    stats_select(samples, n, ranks, STATS_RANKS, q);
+
+    /* Subtraction is monotone, so it commutes with selection */
+    const double sub = subtract * (double)batch, scale = 1.0 / (double)batch;
+    uint64_t c = 0;
+    for (int i = 0; i < STATS_RANKS; i++)
+    {
+        *fields[i] = fmax((double)q[i] - sub, 0.0) * scale;
+        if (fields[i] == &stats->median_ns)
+            c = q[i];
+    }
+    stats->median_rel_error = relative_error(ci_lo, ci_hi, stats->median_ns, scale);
+
+    /* Moments about the median keep the one-pass variance from cancelling,
+     * and four accumulators keep the adds off a single dependency chain. The
+     * signed difference converts cheaply; the zero clamp only needs the
+     * slower path when some sample falls below the subtraction. */
+    const uint64_t min = q[0];
+    double s[4] = {0}, s2[4] = {0};
+    size_t i = 0;
+    if ((double)min >= sub)
+    {
+        for (; i + 4 <= n; i += 4)
+            for (int j = 0; j < 4; j++)
+            {
+                double d = (double)(int64_t)(samples[i + j] - c);
+                s[j] += d;
+                s2[j] += d * d;
+            }
+        for (; i < n; i++)
+        {
+            double d = (double)(int64_t)(samples[i] - c);
+            s[0] += d;
+            s2[0] += d * d;
+        }
+    }
+    else
+    {
+        const double cs = fmax((double)c - sub, 0.0);
+        for (; i < n; i++)
+        {
+            double d = fmax((double)samples[i] - sub, 0.0) - cs;
+            s[i & 3] += d;
+            s2[i & 3] += d * d;
+        }
+    }
+    const double mean = ((s[0] + s[1]) + (s[2] + s[3])) / (double)n;
+    const double var = ((s2[0] + s2[1]) + (s2[2] + s2[3])) / (double)n - mean * mean;
+
+    stats->mean_ns = (stats->median_ns / scale + mean) * scale;
+    stats->stddev_ns = sqrt(var > 0 ? var : 0) * scale;
+    stats->iterations = n;
+
+    /* Bootstrap and outliers work on the binned distribution, compacted to
+     * its non-empty bins in ascending order. */
+    const size_t nbins = bin_index(q[STATS_RANKS - 1] - min) + 1;
+    uint64_t *counts = calloc(nbins, sizeof(uint64_t));
+    double *values = malloc(nbins * sizeof(double));
+    if (counts && values)
+    {
+        for (i = 0; i < n; i++)
+            counts[bin_index(samples[i] - min)]++;
+        size_t k = 0;
+        for (size_t j = 0; j < nbins; j++)
+            if (counts[j])
+            {
+                values[k] = fmax((double)min + bin_center(j) - sub, 0.0) * scale;
+                counts[k++] = counts[j];
+            }
+        stats_bootstrap(values, counts, k, stats);
+        stats_outliers(values, counts, k, q1, q3, stats);
+    }
+    free(counts);
+    free(values);
+}
+
+/* Mann-Kendall S: concordant minus discordant pairs, +-n(n-1)/2 when monotonic */
+static int kendall_s(const double *v, size_t n)
+{
+    int s = 0;
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i + 1; j < n; j++)
+            s += (v[j] > v[i]) - (v[j] < v[i]);
+    return s;
+}
+
+int stats_steady(const double *medians, const double *spreads, size_t n, double tolerance)
+{
+    double lo = medians[0], hi = medians[0], slo = spreads[0], shi = spreads[0], mean = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        lo = fmin(lo, medians[i]), hi = fmax(hi, medians[i]);
+        slo = fmin(slo, spreads[i]), shi = fmax(shi, spreads[i]);
+        mean += spreads[i] / (double)n;
+    }
+    const int monotonic = (int)(n * (n - 1) / 2);
+    const double band = tolerance * (lo + hi); /* +-tolerance around the middle */
+    if (n < 3 || abs(kendall_s(medians, n)) == monotonic || abs(kendall_s(spreads, n)) == monotonic)
+        return 0;
+    return hi - lo <= band && shi - slo <= fmax(band, mean);
+}
+
+static double growth(bench_big_o_t big_o, double n)
+{
+    switch (big_o)
+    {
+    case BENCH_O_1:
+        return 1.0;
+    case BENCH_O_LOG_N:
+        return log2(n);
+    case BENCH_O_N:
+        return n;
+    case BENCH_O_N_LOG_N:
+        return n * log2(n);
+    case BENCH_O_N_SQUARED:
+        return n * n;
+    }
+    return 1.0;
+}
+
+void stats_fit_complexity(const double *n, const double *t, size_t k, bench_complexity_t *fit)
+{
+    double mean = 0.0;
+    for (size_t i = 0; i < k; i++)
+        mean += t[i] / (double)k;
+    fit->rms = INFINITY;
+    for (int m = BENCH_O_1; m <= BENCH_O_N_SQUARED; m++)
+    {
+        /* Single coefficient, no intercept: a = sum(t f) / sum(f^2) */
+        double tf = 0.0, ff = 0.0, err = 0.0;
+        for (size_t i = 0; i < k; i++)
+        {
+            const double f = growth((bench_big_o_t)m, n[i]);
+            tf += t[i] * f;
+            ff += f * f;
+        }
+        if (ff <= 0)
+            continue;
+        for (size_t i = 0; i < k; i++)
+        {
+            const double r = t[i] - tf / ff * growth((bench_big_o_t)m, n[i]);
+            err += r * r;
+        }
+        const double rms = sqrt(err / (double)k) / mean;
+        if (rms < fit->rms)
+        {
+            fit->big_o = (bench_big_o_t)m;
+            fit->coefficient_ns = tf / ff;
+            fit->rms = rms;
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef BENCH_STATS_H
+#define BENCH_STATS_H
+
+#include "benchmark.h"
+
+/* Exact statistics over raw per-batch tick totals. subtract (ticks per call)
+ * is removed from every sample, clamped at zero; results are in ticks per
+ * call. The samples are left in measurement order. */
+void stats_compute(const uint64_t *samples, size_t n, uint64_t batch, double subtract, bench_stats_t *stats);
+
+/* Writes the order statistic of samples at each of up to 11 ascending ranks
+ * to out. */
+void stats_select(const uint64_t *samples, size_t n, const size_t *ranks, size_t nr, uint64_t *out);
+
+/* Ranks bounding a distribution-free 95% confidence interval of the median. */
+void stats_median_ci(size_t n, size_t *lo, size_t *hi);
+
+/* Half-width of that interval relative to the median, after subtraction;
+ * NaN when the median is zero but the interval is not. */
+double stats_median_error(const uint64_t *samples, size_t n, uint64_t batch, double subtract);
+
+/* The functions below take a distribution as ascending values (ticks per call)
+ * with their counts. */
+
+/* Percentile 95% CIs of the mean and median from a Poisson bootstrap. */
+void stats_bootstrap(const double *values, const uint64_t *counts, size_t k, bench_stats_t *stats);
+
+/* Tukey-fence outlier counts around quartiles q1, q3 and the share of the
+ * variance they contribute. */
+void stats_outliers(const double *values, const uint64_t *counts, size_t k, double q1, double q3,
+                    bench_stats_t *stats);
+
+/* Whether n consecutive windows, oldest first, look like a steady state:
+ * their medians lie within +-tolerance of the middle of their range, their
+ * spreads (IQRs) vary by no more than that band or their mean, whichever is
+ * wider, and neither series is strictly monotonic, which a Mann-Kendall test
+ * over 5 windows calls a trend at under 2%. */
+int stats_steady(const double *medians, const double *spreads, size_t n, double tolerance);
+
+/* Fits t ~ a * f(n) by least squares for each bench_big_o_t and keeps the
+ * model with the lowest RMS residual; needs k >= 2 points. */
+void stats_fit_complexity(const double *n, const double *t, size_t k, bench_complexity_t *fit);
+
+#endif